@@ -0,0 +1,176 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * btree_map.cpp -- this benchmark is used to compare the time of inserts,
+ * lookups and range scans in the ordered containers: btree_map,
+ * concurrent_map and radix_tree.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <libpmemobj++/experimental/btree_map.hpp>
+#include <libpmemobj++/experimental/concurrent_map.hpp>
+#include <libpmemobj++/experimental/radix_tree.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include "../measure.hpp"
+
+#ifndef _WIN32
+
+#include <unistd.h>
+#define CREATE_MODE_RW (S_IWUSR | S_IRUSR)
+
+#else
+
+#include <windows.h>
+#define CREATE_MODE_RW (S_IWRITE | S_IREAD)
+
+#endif
+
+static const std::string LAYOUT = "btree_map";
+
+using value_type = pmem::obj::p<uint64_t>;
+using btree_map_type =
+	pmem::obj::experimental::btree_map<value_type, value_type>;
+using concurrent_map_type =
+	pmem::obj::experimental::concurrent_map<value_type, value_type>;
+using radix_tree_type =
+	pmem::obj::experimental::radix_tree<uint64_t, value_type>;
+
+struct root {
+	pmem::obj::persistent_ptr<btree_map_type> btree;
+	pmem::obj::persistent_ptr<concurrent_map_type> skip_list;
+	pmem::obj::persistent_ptr<radix_tree_type> radix;
+};
+
+template <typename Iterator>
+static uint64_t
+value_of(const Iterator &it)
+{
+	return it->second;
+}
+
+static uint64_t
+value_of(const radix_tree_type::iterator &it)
+{
+	return it->value();
+}
+
+/*
+ * Inserts keys (in random order), looks up each of them and runs scans of
+ * range_length elements from random keys, prints the total time of each
+ * phase.
+ */
+template <typename MapType>
+static void
+run(pmem::obj::pool<root> &pop, pmem::obj::persistent_ptr<MapType> &map,
+    const std::string &name, const std::vector<uint64_t> &keys, size_t scans,
+    size_t range_length)
+{
+	pmem::obj::transaction::run(
+		pop, [&] { map = pmem::obj::make_persistent<MapType>(); });
+
+	std::cout << name << ": emplace "
+		  << measure<std::chrono::milliseconds>([&] {
+			     for (auto k : keys)
+				     map->try_emplace(k, k);
+		     })
+		  << "ms";
+
+	uint64_t found = 0;
+	std::cout << ", find " << measure<std::chrono::milliseconds>([&] {
+		for (auto k : keys)
+			found += map->find(k) != map->end();
+	}) << "ms";
+
+	if (found != keys.size())
+		throw std::runtime_error("not all keys were found");
+
+	uint64_t sum = 0;
+	std::cout << ", scan " << measure<std::chrono::milliseconds>([&] {
+		for (size_t i = 0; i < scans; i++) {
+			auto it = map->lower_bound(keys[i]);
+			for (size_t j = 0; j < range_length && it != map->end();
+			     ++j, ++it)
+				sum += value_of(it);
+		}
+	}) << "ms" << std::endl;
+
+	if (sum == 0)
+		throw std::runtime_error("no elements were scanned");
+
+	pmem::obj::transaction::run(pop, [&] {
+		pmem::obj::delete_persistent<MapType>(map);
+		map = nullptr;
+	});
+}
+
+int
+main(int argc, char *argv[])
+{
+	using pool = pmem::obj::pool<root>;
+	pool pop;
+
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0]
+			  << " file-name [count] [scans] [range_length]"
+			  << std::endl;
+		return 1;
+	}
+
+	const char *path = argv[1];
+	size_t count = 1000000;
+	size_t scans = 10000;
+	size_t range_length = 100;
+
+	if (argc > 2)
+		count = std::stoul(argv[2]);
+	if (argc > 3)
+		scans = std::stoul(argv[3]);
+	if (argc > 4)
+		range_length = std::stoul(argv[4]);
+
+	std::vector<uint64_t> keys(count);
+	for (size_t i = 0; i < count; i++)
+		keys[i] = i;
+	std::shuffle(keys.begin(), keys.end(), std::mt19937_64(count));
+
+	scans = (std::min)(scans, count);
+
+	try {
+		try {
+			pop = pool::create(path, LAYOUT, PMEMOBJ_MIN_POOL * 400,
+					   CREATE_MODE_RW);
+		} catch (const pmem::pool_error &pe) {
+			pop = pool::open(path, LAYOUT);
+		}
+
+		auto r = pop.root();
+
+		run(pop, r->btree, "btree_map", keys, scans, range_length);
+		run(pop, r->skip_list, "concurrent_map", keys, scans,
+		    range_length);
+		run(pop, r->radix, "radix_tree", keys, scans, range_length);
+
+		pop.close();
+	} catch (const pmem::pool_error &pe) {
+		std::cerr << "!pool::create: " << pe.what() << " " << path
+			  << std::endl;
+		return 1;
+	} catch (const std::logic_error &e) {
+		std::cerr << "!pool::close: " << e.what() << std::endl;
+		return 1;
+	} catch (const std::exception &e) {
+		std::cerr << "!exception: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * emplace_duplicates.cpp -- this benchmark is used to measure time of
+ * emplace() in concurrent_map for a mix of new and already existing keys.
+ *
+ * With a transparent comparator the key of a string map is found before the
+ * element is allocated, otherwise the element is allocated first and deleted
+ * if the key already exists, so both variants are measured.
+ */
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <libpmemobj++/container/string.hpp>
+#include <libpmemobj++/experimental/concurrent_map.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include "../measure.hpp"
+
+#ifndef _WIN32
+
+#include <unistd.h>
+#define CREATE_MODE_RW (S_IWUSR | S_IRUSR)
+
+#else
+
+#include <windows.h>
+#define CREATE_MODE_RW (S_IWRITE | S_IREAD)
+
+#endif
+
+static const std::string LAYOUT = "emplace_duplicates";
+
+struct hetero_less {
+	using is_transparent = void;
+	template <typename T1, typename T2>
+	bool
+	operator()(const T1 &lhs, const T2 &rhs) const
+	{
+		return lhs < rhs;
+	}
+};
+
+using search_first_map_type = pmem::obj::experimental::concurrent_map<
+	pmem::obj::string, pmem::obj::p<uint64_t>, hetero_less>;
+using allocate_first_map_type =
+	pmem::obj::experimental::concurrent_map<pmem::obj::string,
+						pmem::obj::p<uint64_t>>;
+
+struct root {
+	pmem::obj::persistent_ptr<search_first_map_type> search_first;
+	pmem::obj::persistent_ptr<allocate_first_map_type> allocate_first;
+};
+
+static std::string
+key_of(uint64_t i)
+{
+	return "key" + std::to_string(i);
+}
+
+/*
+ * Every thread emplaces count keys, dup_percent of them already exist in the
+ * map, the rest are new and unique.
+ */
+template <typename MapType>
+static void
+emplace_mix(MapType &map, size_t count, size_t dup_percent, size_t n_threads)
+{
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < n_threads; t++) {
+		threads.emplace_back([&, t] {
+			uint64_t next = count * (t + 1);
+			for (uint64_t i = 0; i < count; i++) {
+				uint64_t key =
+					i % 100 < dup_percent ? i : next++;
+				map.emplace(key_of(key), key);
+			}
+		});
+	}
+
+	for (auto &t : threads)
+		t.join();
+}
+
+template <typename MapType>
+static void
+run(pmem::obj::pool<root> &pop, pmem::obj::persistent_ptr<MapType> &map,
+    const std::string &name, size_t count, size_t dup_percent, size_t n_threads)
+{
+	pmem::obj::transaction::run(
+		pop, [&] { map = pmem::obj::make_persistent<MapType>(); });
+
+	for (uint64_t i = 0; i < count; i++)
+		map->emplace(key_of(i), i);
+
+	std::cout << "Run time " << name << " "
+		  << measure<std::chrono::milliseconds>([&] {
+			     emplace_mix(*map, count, dup_percent, n_threads);
+		     })
+		  << "ms" << std::endl;
+
+	pmem::obj::transaction::run(pop, [&] {
+		pmem::obj::delete_persistent<MapType>(map);
+		map = nullptr;
+	});
+}
+
+int
+main(int argc, char *argv[])
+{
+	using pool = pmem::obj::pool<root>;
+	pool pop;
+
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0]
+			  << " file-name [count] [dup_percent] [threads]"
+			  << std::endl;
+		return 1;
+	}
+
+	const char *path = argv[1];
+	size_t count = 100000;
+	size_t dup_percent = 70;
+	size_t n_threads = 4;
+
+	if (argc > 2)
+		count = std::stoul(argv[2]);
+	if (argc > 3)
+		dup_percent = std::stoul(argv[3]);
+	if (argc > 4)
+		n_threads = std::stoul(argv[4]);
+
+	if (dup_percent > 100) {
+		std::cerr << "dup_percent has to be in [0, 100]" << std::endl;
+		return 1;
+	}
+
+	try {
+		try {
+			pop = pool::create(path, LAYOUT, PMEMOBJ_MIN_POOL * 200,
+					   CREATE_MODE_RW);
+		} catch (const pmem::pool_error &pe) {
+			pop = pool::open(path, LAYOUT);
+		}
+
+		auto r = pop.root();
+
+		run(pop, r->search_first, "search-first emplace", count,
+		    dup_percent, n_threads);
+		run(pop, r->allocate_first, "allocate-first emplace", count,
+		    dup_percent, n_threads);
+
+		pop.close();
+	} catch (const pmem::pool_error &pe) {
+		std::cerr << "!pool::create: " << pe.what() << " " << path
+			  << std::endl;
+		return 1;
+	} catch (const std::logic_error &e) {
+		std::cerr << "!pool::close: " << e.what() << std::endl;
+		return 1;
+	} catch (const std::exception &e) {
+		std::cerr << "!exception: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * from_sorted.cpp -- this benchmark is used to compare the time of loading
+ * sorted elements into concurrent_map one by one (emplace) and in bulk
+ * (from_sorted), with the default pmem::obj::mutex and with null_mutex.
+ */
+
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include <libpmemobj++/experimental/concurrent_map.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include "../measure.hpp"
+
+#ifndef _WIN32
+
+#include <unistd.h>
+#define CREATE_MODE_RW (S_IWUSR | S_IRUSR)
+
+#else
+
+#include <windows.h>
+#define CREATE_MODE_RW (S_IWRITE | S_IREAD)
+
+#endif
+
+static const std::string LAYOUT = "from_sorted";
+
+using key_type = pmem::obj::p<uint64_t>;
+
+using map_type = pmem::obj::experimental::concurrent_map<key_type, key_type>;
+using single_map_type = pmem::obj::experimental::concurrent_map<
+	key_type, key_type, std::less<key_type>,
+	pmem::obj::allocator<pmem::detail::pair<const key_type, key_type>>,
+	pmem::obj::experimental::null_mutex>;
+
+struct root {
+	pmem::obj::persistent_ptr<map_type> map;
+	pmem::obj::persistent_ptr<single_map_type> single_map;
+};
+
+using input_type = std::vector<std::pair<uint64_t, uint64_t>>;
+
+template <typename MapType>
+static void
+run(pmem::obj::pool<root> &pop, pmem::obj::persistent_ptr<MapType> &map,
+    const std::string &name, const input_type &input)
+{
+	pmem::obj::transaction::run(
+		pop, [&] { map = pmem::obj::make_persistent<MapType>(); });
+
+	std::cout << "Run time " << name << " emplace "
+		  << measure<std::chrono::milliseconds>([&] {
+			     for (auto &e : input)
+				     map->emplace(e.first, e.second);
+		     })
+		  << "ms" << std::endl;
+
+	map->clear();
+
+	std::cout << "Run time " << name << " from_sorted "
+		  << measure<std::chrono::milliseconds>([&] {
+			     map->from_sorted(input.begin(), input.end());
+		     })
+		  << "ms" << std::endl;
+
+	pmem::obj::transaction::run(pop, [&] {
+		pmem::obj::delete_persistent<MapType>(map);
+		map = nullptr;
+	});
+}
+
+int
+main(int argc, char *argv[])
+{
+	using pool = pmem::obj::pool<root>;
+	pool pop;
+
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0] << " file-name [count]"
+			  << std::endl;
+		return 1;
+	}
+
+	const char *path = argv[1];
+	size_t count = 100000;
+
+	if (argc > 2)
+		count = std::stoul(argv[2]);
+
+	input_type input;
+	input.reserve(count);
+	for (uint64_t i = 0; i < count; i++)
+		input.emplace_back(i, i);
+
+	try {
+		try {
+			pop = pool::create(path, LAYOUT, PMEMOBJ_MIN_POOL * 200,
+					   CREATE_MODE_RW);
+		} catch (const pmem::pool_error &pe) {
+			pop = pool::open(path, LAYOUT);
+		}
+
+		auto r = pop.root();
+
+		run(pop, r->map, "mutex", input);
+		run(pop, r->single_map, "null_mutex", input);
+
+		pop.close();
+	} catch (const pmem::pool_error &pe) {
+		std::cerr << "!pool::create: " << pe.what() << " " << path
+			  << std::endl;
+		return 1;
+	} catch (const std::logic_error &e) {
+		std::cerr << "!pool::close: " << e.what() << std::endl;
+		return 1;
+	} catch (const std::exception &e) {
+		std::cerr << "!exception: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * key_prefix.cpp -- this benchmark is used to compare the time of lookups
+ * in a string-keyed concurrent_map which compares whole keys and which
+ * compares the key prefixes stored in nodes first (key_prefix_less).
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <libpmemobj++/container/string.hpp>
+#include <libpmemobj++/experimental/concurrent_map.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include "../measure.hpp"
+
+#ifndef _WIN32
+
+#include <unistd.h>
+#define CREATE_MODE_RW (S_IWUSR | S_IRUSR)
+
+#else
+
+#include <windows.h>
+#define CREATE_MODE_RW (S_IWRITE | S_IREAD)
+
+#endif
+
+static const std::string LAYOUT = "key_prefix";
+
+using value_type = pmem::obj::p<uint64_t>;
+
+struct full_key_less {
+	using is_transparent = void;
+	template <typename T1, typename T2>
+	bool
+	operator()(const T1 &lhs, const T2 &rhs) const
+	{
+		return lhs < rhs;
+	}
+};
+
+using full_key_map_type =
+	pmem::obj::experimental::concurrent_map<pmem::obj::string, value_type,
+						full_key_less>;
+using prefix_map_type = pmem::obj::experimental::concurrent_map<
+	pmem::obj::string, value_type,
+	pmem::obj::experimental::key_prefix_less>;
+
+struct root {
+	pmem::obj::persistent_ptr<full_key_map_type> full_key;
+	pmem::obj::persistent_ptr<prefix_map_type> prefix;
+};
+
+template <typename MapType>
+static void
+run(pmem::obj::pool<root> &pop, pmem::obj::persistent_ptr<MapType> &map,
+    const std::string &name, const std::vector<std::string> &keys,
+    const std::vector<std::string> &lookups)
+{
+	pmem::obj::transaction::run(
+		pop, [&] { map = pmem::obj::make_persistent<MapType>(); });
+
+	for (uint64_t i = 0; i < keys.size(); i++)
+		map->emplace(keys[i], i);
+
+	uint64_t found = 0;
+	std::cout << "Run time " << name << " find "
+		  << measure<std::chrono::milliseconds>([&] {
+			     for (auto &k : lookups)
+				     found += map->count(k);
+		     })
+		  << "ms" << std::endl;
+
+	if (found != lookups.size())
+		throw std::runtime_error("not all keys were found");
+
+	pmem::obj::transaction::run(pop, [&] {
+		pmem::obj::delete_persistent<MapType>(map);
+		map = nullptr;
+	});
+}
+
+int
+main(int argc, char *argv[])
+{
+	using pool = pmem::obj::pool<root>;
+	pool pop;
+
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0]
+			  << " file-name [count] [key_length]" << std::endl;
+		return 1;
+	}
+
+	const char *path = argv[1];
+	size_t count = 100000;
+	size_t key_length = 64;
+
+	if (argc > 2)
+		count = std::stoul(argv[2]);
+	if (argc > 3)
+		key_length = std::stoul(argv[3]);
+
+	/* random keys, long enough to be stored out of line */
+	std::mt19937_64 generator(count);
+	std::vector<std::string> keys;
+	for (size_t i = 0; i < count; i++) {
+		std::string key(key_length, '\0');
+		for (auto &c : key)
+			c = static_cast<char>('a' + generator() % 26);
+		keys.push_back(std::move(key));
+	}
+
+	std::vector<std::string> lookups(keys);
+	std::shuffle(lookups.begin(), lookups.end(), generator);
+
+	try {
+		try {
+			pop = pool::create(path, LAYOUT, PMEMOBJ_MIN_POOL * 200,
+					   CREATE_MODE_RW);
+		} catch (const pmem::pool_error &pe) {
+			pop = pool::open(path, LAYOUT);
+		}
+
+		auto r = pop.root();
+
+		run(pop, r->full_key, "full key", keys, lookups);
+		run(pop, r->prefix, "key_prefix_less", keys, lookups);
+
+		pop.close();
+	} catch (const pmem::pool_error &pe) {
+		std::cerr << "!pool::create: " << pe.what() << " " << path
+			  << std::endl;
+		return 1;
+	} catch (const std::logic_error &e) {
+		std::cerr << "!pool::close: " << e.what() << std::endl;
+		return 1;
+	} catch (const std::exception &e) {
+		std::cerr << "!exception: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
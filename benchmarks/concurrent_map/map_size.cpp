@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * map_size.cpp -- this benchmark is used to measure the time of emplace()
+ * and find() in concurrent_map of different sizes, which depends on the
+ * heights of the nodes chosen by the level generator.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <libpmemobj++/experimental/concurrent_map.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include "../measure.hpp"
+
+#ifndef _WIN32
+
+#include <unistd.h>
+#define CREATE_MODE_RW (S_IWUSR | S_IRUSR)
+
+#else
+
+#include <windows.h>
+#define CREATE_MODE_RW (S_IWRITE | S_IREAD)
+
+#endif
+
+static const std::string LAYOUT = "map_size";
+
+using value_type = pmem::obj::p<uint64_t>;
+using map_type =
+	pmem::obj::experimental::concurrent_map<value_type, value_type>;
+
+struct root {
+	pmem::obj::persistent_ptr<map_type> map;
+};
+
+/*
+ * Fills a map with size elements (in random order) and looks up each of
+ * them, prints the average time of one operation.
+ */
+static void
+run(pmem::obj::pool<root> &pop, size_t size)
+{
+	auto r = pop.root();
+	pmem::obj::transaction::run(
+		pop, [&] { r->map = pmem::obj::make_persistent<map_type>(); });
+
+	std::vector<uint64_t> keys(size);
+	for (size_t i = 0; i < size; i++)
+		keys[i] = i;
+	std::shuffle(keys.begin(), keys.end(), std::mt19937_64(size));
+
+	auto &map = *r->map;
+
+	auto emplace_time = measure<std::chrono::nanoseconds>([&] {
+		for (auto k : keys)
+			map.emplace(k, k);
+	});
+
+	std::shuffle(keys.begin(), keys.end(), std::mt19937_64(size + 1));
+
+	uint64_t found = 0;
+	auto find_time = measure<std::chrono::nanoseconds>([&] {
+		for (auto k : keys)
+			found += map.count(k);
+	});
+
+	if (found != size)
+		throw std::runtime_error("not all keys were found");
+
+	std::cout << "size " << size << ": emplace "
+		  << static_cast<size_t>(emplace_time) / size << "ns, find "
+		  << static_cast<size_t>(find_time) / size << "ns" << std::endl;
+
+	pmem::obj::transaction::run(pop, [&] {
+		pmem::obj::delete_persistent<map_type>(r->map);
+		r->map = nullptr;
+	});
+}
+
+int
+main(int argc, char *argv[])
+{
+	using pool = pmem::obj::pool<root>;
+	pool pop;
+
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0] << " file-name [max_size]"
+			  << std::endl;
+		return 1;
+	}
+
+	const char *path = argv[1];
+	size_t max_size = 1000000;
+
+	if (argc > 2)
+		max_size = std::stoul(argv[2]);
+
+	try {
+		try {
+			pop = pool::create(path, LAYOUT, PMEMOBJ_MIN_POOL * 400,
+					   CREATE_MODE_RW);
+		} catch (const pmem::pool_error &pe) {
+			pop = pool::open(path, LAYOUT);
+		}
+
+		for (size_t size = 1000; size <= max_size; size *= 10)
+			run(pop, size);
+
+		pop.close();
+	} catch (const pmem::pool_error &pe) {
+		std::cerr << "!pool::create: " << pe.what() << " " << path
+			  << std::endl;
+		return 1;
+	} catch (const std::logic_error &e) {
+		std::cerr << "!pool::close: " << e.what() << std::endl;
+		return 1;
+	} catch (const std::exception &e) {
+		std::cerr << "!exception: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * range_scan.cpp -- this benchmark is used to compare the time of range
+ * queries in concurrent_map done with iterators (lower_bound and increments)
+ * and with snapshot_scan(), while another thread keeps inserting elements.
+ */
+
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#include <libpmemobj++/experimental/concurrent_map.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include "../measure.hpp"
+
+#ifndef _WIN32
+
+#include <unistd.h>
+#define CREATE_MODE_RW (S_IWUSR | S_IRUSR)
+
+#else
+
+#include <windows.h>
+#define CREATE_MODE_RW (S_IWRITE | S_IREAD)
+
+#endif
+
+static const std::string LAYOUT = "range_scan";
+
+using value_type = pmem::obj::p<uint64_t>;
+using map_type =
+	pmem::obj::experimental::concurrent_map<value_type, value_type>;
+
+struct root {
+	pmem::obj::persistent_ptr<map_type> map;
+};
+
+static uint64_t
+iterator_scan(map_type &map, uint64_t first, uint64_t last)
+{
+	uint64_t sum = 0;
+	for (auto it = map.lower_bound(first);
+	     it != map.end() && it->first < last; ++it)
+		sum += it->second;
+
+	return sum;
+}
+
+static uint64_t
+snapshot_scan(map_type &map, uint64_t first, uint64_t last)
+{
+	uint64_t sum = 0;
+	map.snapshot_scan(first, last,
+			  [&](const map_type::scan_batch_type &batch) {
+				  for (auto e : batch)
+					  sum += e->second;
+			  });
+
+	return sum;
+}
+
+/*
+ * Runs scans of range_length keys starting at random even keys, while
+ * another thread inserts odd keys.
+ */
+template <typename Scan>
+static void
+run(map_type &map, const std::string &name, size_t count, size_t scans,
+    size_t range_length, Scan scan)
+{
+	std::atomic<bool> done(false);
+	std::thread writer([&] {
+		std::mt19937_64 generator(count);
+		while (!done)
+			map.emplace(2 * (generator() % count) + 1, 1U);
+	});
+
+	std::mt19937_64 generator(scans);
+	uint64_t sum = 0;
+
+	std::cout << "Run time " << name << " "
+		  << measure<std::chrono::milliseconds>([&] {
+			     for (size_t i = 0; i < scans; i++) {
+				     uint64_t first = 2 * (generator() % count);
+				     sum += scan(map, first,
+						 first + 2 * range_length);
+			     }
+		     })
+		  << "ms" << std::endl;
+
+	done = true;
+	writer.join();
+
+	if (sum == 0)
+		throw std::runtime_error("no elements were scanned");
+}
+
+int
+main(int argc, char *argv[])
+{
+	using pool = pmem::obj::pool<root>;
+	pool pop;
+
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0]
+			  << " file-name [count] [scans] [range_length]"
+			  << std::endl;
+		return 1;
+	}
+
+	const char *path = argv[1];
+	size_t count = 100000;
+	size_t scans = 10000;
+	size_t range_length = 1000;
+
+	if (argc > 2)
+		count = std::stoul(argv[2]);
+	if (argc > 3)
+		scans = std::stoul(argv[3]);
+	if (argc > 4)
+		range_length = std::stoul(argv[4]);
+
+	try {
+		try {
+			pop = pool::create(path, LAYOUT, PMEMOBJ_MIN_POOL * 200,
+					   CREATE_MODE_RW);
+		} catch (const pmem::pool_error &pe) {
+			pop = pool::open(path, LAYOUT);
+		}
+
+		auto r = pop.root();
+		pmem::obj::transaction::run(pop, [&] {
+			r->map = pmem::obj::make_persistent<map_type>();
+		});
+
+		for (uint64_t i = 0; i < count; i++)
+			r->map->emplace(2 * i, 1U);
+
+		run(*r->map, "iterators", count, scans, range_length,
+		    iterator_scan);
+		run(*r->map, "snapshot_scan", count, scans, range_length,
+		    snapshot_scan);
+
+		pmem::obj::transaction::run(pop, [&] {
+			pmem::obj::delete_persistent<map_type>(r->map);
+			r->map = nullptr;
+		});
+
+		pop.close();
+	} catch (const pmem::pool_error &pe) {
+		std::cerr << "!pool::create: " << pe.what() << " " << path
+			  << std::endl;
+		return 1;
+	} catch (const std::logic_error &e) {
+		std::cerr << "!pool::close: " << e.what() << std::endl;
+		return 1;
+	} catch (const std::exception &e) {
+		std::cerr << "!exception: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * flat_hash_map.cpp -- this benchmark is used to compare the time of inserts,
+ * lookups (of existing and missing keys) and erases in flat_hash_map and
+ * concurrent_hash_map.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <libpmemobj++/container/concurrent_hash_map.hpp>
+#include <libpmemobj++/experimental/flat_hash_map.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include "../measure.hpp"
+
+#ifndef _WIN32
+
+#include <unistd.h>
+#define CREATE_MODE_RW (S_IWUSR | S_IRUSR)
+
+#else
+
+#include <windows.h>
+#define CREATE_MODE_RW (S_IWRITE | S_IREAD)
+
+#endif
+
+static const std::string LAYOUT = "flat_hash_map";
+
+using value_type = pmem::obj::p<uint64_t>;
+using flat_map_type =
+	pmem::obj::experimental::flat_hash_map<uint64_t, value_type>;
+using chained_map_type = pmem::obj::concurrent_hash_map<value_type, value_type>;
+
+struct root {
+	pmem::obj::persistent_ptr<flat_map_type> flat;
+	pmem::obj::persistent_ptr<chained_map_type> chained;
+};
+
+/*
+ * Inserts keys (in random order), looks up each of them and as many missing
+ * keys, then erases all of them, prints the total time of each phase.
+ */
+template <typename MapType>
+static void
+run(pmem::obj::pool<root> &pop, pmem::obj::persistent_ptr<MapType> &map,
+    const std::string &name, const std::vector<uint64_t> &keys)
+{
+	pmem::obj::transaction::run(
+		pop, [&] { map = pmem::obj::make_persistent<MapType>(); });
+	map->runtime_initialize();
+
+	std::cout << name << ": insert "
+		  << measure<std::chrono::milliseconds>([&] {
+			     for (auto k : keys)
+				     map->insert(typename MapType::value_type(
+					     k, k));
+		     })
+		  << "ms";
+
+	uint64_t found = 0;
+	std::cout << ", find " << measure<std::chrono::milliseconds>([&] {
+		for (auto k : keys) {
+			typename MapType::const_accessor acc;
+			found += map->find(acc, k);
+		}
+	}) << "ms";
+
+	if (found != keys.size())
+		throw std::runtime_error("not all keys were found");
+
+	/* keys are smaller than keys.size() */
+	std::cout << ", find missing "
+		  << measure<std::chrono::milliseconds>([&] {
+			     for (auto k : keys)
+				     found += map->count(k + keys.size());
+		     })
+		  << "ms";
+
+	std::cout << ", erase " << measure<std::chrono::milliseconds>([&] {
+		for (auto k : keys)
+			map->erase(k);
+	}) << "ms" << std::endl;
+
+	if (found != keys.size())
+		throw std::runtime_error("missing keys were found");
+
+	pmem::obj::transaction::run(pop, [&] {
+		pmem::obj::delete_persistent<MapType>(map);
+		map = nullptr;
+	});
+}
+
+int
+main(int argc, char *argv[])
+{
+	using pool = pmem::obj::pool<root>;
+	pool pop;
+
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0] << " file-name [count]"
+			  << std::endl;
+		return 1;
+	}
+
+	const char *path = argv[1];
+	size_t count = 1000000;
+
+	if (argc > 2)
+		count = std::stoul(argv[2]);
+
+	std::vector<uint64_t> keys(count);
+	for (size_t i = 0; i < count; i++)
+		keys[i] = i;
+	std::shuffle(keys.begin(), keys.end(), std::mt19937_64(count));
+
+	try {
+		try {
+			pop = pool::create(path, LAYOUT, PMEMOBJ_MIN_POOL * 400,
+					   CREATE_MODE_RW);
+		} catch (const pmem::pool_error &pe) {
+			pop = pool::open(path, LAYOUT);
+		}
+
+		auto r = pop.root();
+
+		run(pop, r->flat, "flat_hash_map", keys);
+		run(pop, r->chained, "concurrent_hash_map", keys);
+
+		pop.close();
+	} catch (const pmem::pool_error &pe) {
+		std::cerr << "!pool::create: " << pe.what() << " " << path
+			  << std::endl;
+		return 1;
+	} catch (const std::logic_error &e) {
+		std::cerr << "!pool::close: " << e.what() << std::endl;
+		return 1;
+	} catch (const std::exception &e) {
+		std::cerr << "!exception: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
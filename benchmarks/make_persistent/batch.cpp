@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * batch.cpp -- this benchmark is used to compare the time of allocating many
+ * small objects one by one (make_persistent, make_persistent_atomic) and in
+ * batches (experimental::make_persistent_batch,
+ * experimental::make_persistent_batch_atomic)
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include <libpmemobj++/experimental/make_persistent_batch.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/make_persistent_array.hpp>
+#include <libpmemobj++/make_persistent_atomic.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include "../measure.hpp"
+
+#ifndef _WIN32
+
+#include <unistd.h>
+#define CREATE_MODE_RW (S_IWUSR | S_IRUSR)
+
+#else
+
+#include <windows.h>
+#define CREATE_MODE_RW (S_IWRITE | S_IREAD)
+
+#endif
+
+static const std::string LAYOUT = "batch";
+
+template <typename U>
+using persistent_ptr = pmem::obj::persistent_ptr<U>;
+
+struct node {
+	node(uint64_t v) : value(v)
+	{
+	}
+
+	pmem::obj::p<uint64_t> value;
+	persistent_ptr<node> next;
+};
+
+struct root {
+	persistent_ptr<node> head;
+	persistent_ptr<persistent_ptr<node>[]> nodes;
+};
+
+/* links nodes into a list, in a transaction */
+static void
+link(persistent_ptr<root> &r, const std::vector<persistent_ptr<node>> &nodes)
+{
+	for (auto &n : nodes) {
+		n->next = r->head;
+		r->head = n;
+	}
+}
+
+static void
+build_single(pmem::obj::pool<root> &pop, size_t count, size_t batch_size)
+{
+	auto r = pop.root();
+
+	for (size_t i = 0; i < count; i += batch_size) {
+		pmem::obj::transaction::run(pop, [&] {
+			std::vector<persistent_ptr<node>> nodes;
+			for (size_t j = i; j < count && j < i + batch_size; j++)
+				nodes.push_back(
+					pmem::obj::make_persistent<node>(j));
+			link(r, nodes);
+		});
+	}
+}
+
+static void
+build_batch(pmem::obj::pool<root> &pop, size_t count, size_t batch_size)
+{
+	auto r = pop.root();
+
+	for (size_t i = 0; i < count; i += batch_size) {
+		pmem::obj::transaction::run(pop, [&] {
+			auto n = (std::min)(batch_size, count - i);
+			link(r,
+			     pmem::obj::experimental::make_persistent_batch<
+				     node>(pop, n, i));
+		});
+	}
+}
+
+static void
+build_single_atomic(pmem::obj::pool<root> &pop, size_t count)
+{
+	auto nodes = pop.root()->nodes.get();
+
+	for (size_t i = 0; i < count; i++)
+		pmem::obj::make_persistent_atomic<node>(pop, nodes[i], i);
+}
+
+static void
+build_batch_atomic(pmem::obj::pool<root> &pop, size_t count, size_t batch_size)
+{
+	auto nodes = pop.root()->nodes.get();
+
+	for (size_t i = 0; i < count; i += batch_size) {
+		auto n = (std::min)(batch_size, count - i);
+		pmem::obj::experimental::make_persistent_batch_atomic<node>(
+			pop, nodes + i, n, i);
+	}
+}
+
+static void
+destroy(pmem::obj::pool<root> &pop, size_t count)
+{
+	auto r = pop.root();
+	auto nodes = r->nodes.get();
+
+	pmem::obj::transaction::run(pop, [&] {
+		auto n = r->head;
+		while (n != nullptr) {
+			auto next = n->next;
+			pmem::obj::delete_persistent<node>(n);
+			n = next;
+		}
+		r->head = nullptr;
+
+		for (size_t i = 0; i < count; i++) {
+			pmem::obj::delete_persistent<node>(nodes[i]);
+			nodes[i] = nullptr;
+		}
+	});
+}
+
+int
+main(int argc, char *argv[])
+{
+	using pool = pmem::obj::pool<root>;
+	pool pop;
+
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0]
+			  << " file-name [count] [batch_size]" << std::endl;
+		return 1;
+	}
+
+	const char *path = argv[1];
+	size_t count = 100000;
+	size_t batch_size = 100;
+
+	if (argc > 2)
+		count = std::stoul(argv[2]);
+	if (argc > 3)
+		batch_size = std::stoul(argv[3]);
+
+	if (batch_size == 0) {
+		std::cerr << "batch_size has to be greater than 0" << std::endl;
+		return 1;
+	}
+
+	try {
+		try {
+			pop = pool::create(path, LAYOUT, PMEMOBJ_MIN_POOL * 100,
+					   CREATE_MODE_RW);
+		} catch (const pmem::pool_error &pe) {
+			pop = pool::open(path, LAYOUT);
+		}
+
+		auto r = pop.root();
+		pmem::obj::transaction::run(pop, [&] {
+			r->nodes = pmem::obj::make_persistent<
+				persistent_ptr<node>[]>(count);
+		});
+
+		std::cout << "Run time make_persistent "
+			  << measure<std::chrono::milliseconds>([&] {
+				     build_single(pop, count, batch_size);
+			     })
+			  << "ms" << std::endl;
+		destroy(pop, count);
+
+		std::cout << "Run time make_persistent_batch "
+			  << measure<std::chrono::milliseconds>([&] {
+				     build_batch(pop, count, batch_size);
+			     })
+			  << "ms" << std::endl;
+		destroy(pop, count);
+
+		std::cout << "Run time make_persistent_atomic "
+			  << measure<std::chrono::milliseconds>(
+				     [&] { build_single_atomic(pop, count); })
+			  << "ms" << std::endl;
+		destroy(pop, count);
+
+		std::cout << "Run time make_persistent_batch_atomic "
+			  << measure<std::chrono::milliseconds>([&] {
+				     build_batch_atomic(pop, count, batch_size);
+			     })
+			  << "ms" << std::endl;
+		destroy(pop, count);
+
+		pmem::obj::transaction::run(pop, [&] {
+			pmem::obj::delete_persistent<persistent_ptr<node>[]>(
+				r->nodes, count);
+			r->nodes = nullptr;
+		});
+
+		pop.close();
+	} catch (const pmem::pool_error &pe) {
+		std::cerr << "!pool::create: " << pe.what() << " " << path
+			  << std::endl;
+		return 1;
+	} catch (const std::logic_error &e) {
+		std::cerr << "!pool::close: " << e.what() << std::endl;
+		return 1;
+	} catch (const std::exception &e) {
+		std::cerr << "!exception: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * lock_unlock.cpp -- this benchmark is used to measure time of uncontended
+ * lock and unlock operations of persistent mutexes (with and without the
+ * pool lookup cache) and compare it with volatile std mutexes
+ */
+
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+
+#include <libpmemobj++/experimental/cached_mutex.hpp>
+#include <libpmemobj++/mutex.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/shared_mutex.hpp>
+
+#include "../measure.hpp"
+
+#ifndef _WIN32
+
+#include <unistd.h>
+#define CREATE_MODE_RW (S_IWUSR | S_IRUSR)
+
+#else
+
+#include <windows.h>
+#define CREATE_MODE_RW (S_IWRITE | S_IREAD)
+
+#endif
+
+static const std::string LAYOUT = "lock_unlock";
+
+struct root {
+	pmem::obj::mutex pmutex;
+	pmem::obj::shared_mutex pshared_mutex;
+	pmem::obj::experimental::cached_mutex cmutex;
+	pmem::obj::experimental::cached_shared_mutex cshared_mutex;
+};
+
+template <typename F>
+void
+run(const std::string &name, size_t iterations, F &&lock_unlock)
+{
+	std::cout << "Run time " << name << " "
+		  << measure<std::chrono::milliseconds>([&] {
+			     for (size_t i = 0; i < iterations; i++)
+				     lock_unlock();
+		     })
+		  << "ms" << std::endl;
+}
+
+int
+main(int argc, char *argv[])
+{
+	using pool = pmem::obj::pool<root>;
+	pool pop;
+
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0] << " file-name [iterations]"
+			  << std::endl;
+		return 1;
+	}
+
+	const char *path = argv[1];
+	size_t iterations = 10000000;
+
+	if (argc > 2)
+		iterations = std::stoul(argv[2]);
+
+	try {
+		try {
+			pop = pool::create(path, LAYOUT, PMEMOBJ_MIN_POOL,
+					   CREATE_MODE_RW);
+		} catch (const pmem::pool_error &pe) {
+			pop = pool::open(path, LAYOUT);
+		}
+
+		auto r = pop.root();
+		auto *prwlock = r->pshared_mutex.native_handle();
+
+		std::mutex mtx;
+		std::shared_timed_mutex shared_mtx;
+
+		run("std::mutex", iterations, [&] {
+			mtx.lock();
+			mtx.unlock();
+		});
+		run("pmem::obj::mutex", iterations, [&] {
+			r->pmutex.lock();
+			r->pmutex.unlock();
+		});
+		run("pmem::obj::experimental::cached_mutex", iterations, [&] {
+			r->cmutex.lock();
+			r->cmutex.unlock();
+		});
+		run("std::shared_timed_mutex exclusive", iterations, [&] {
+			shared_mtx.lock();
+			shared_mtx.unlock();
+		});
+		run("pmem::obj::shared_mutex exclusive", iterations, [&] {
+			r->pshared_mutex.lock();
+			r->pshared_mutex.unlock();
+		});
+		run("pmem::obj::experimental::cached_shared_mutex exclusive",
+		    iterations, [&] {
+			    r->cshared_mutex.lock();
+			    r->cshared_mutex.unlock();
+		    });
+		run("std::shared_timed_mutex shared", iterations, [&] {
+			shared_mtx.lock_shared();
+			shared_mtx.unlock_shared();
+		});
+		run("pmem::obj::shared_mutex shared", iterations, [&] {
+			r->pshared_mutex.lock_shared();
+			r->pshared_mutex.unlock_shared();
+		});
+		run("pmem::obj::experimental::cached_shared_mutex shared",
+		    iterations, [&] {
+			    r->cshared_mutex.lock_shared();
+			    r->cshared_mutex.unlock_shared();
+		    });
+		/* what a lock costs without any pool lookup */
+		run("pmemobj_rwlock with a known pool", iterations, [&] {
+			pmemobj_rwlock_rdlock(pop.handle(), prwlock);
+			pmemobj_rwlock_unlock(pop.handle(), prwlock);
+		});
+
+		pop.close();
+	} catch (const pmem::pool_error &pe) {
+		std::cerr << "!pool::create: " << pe.what() << " " << path
+			  << std::endl;
+		return 1;
+	} catch (const std::logic_error &e) {
+		std::cerr << "!pool::close: " << e.what() << std::endl;
+		return 1;
+	} catch (const std::exception &e) {
+		std::cerr << "!exception: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
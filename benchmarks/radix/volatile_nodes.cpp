@@ -0,0 +1,168 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * volatile_nodes.cpp -- this benchmark is used to measure the time of
+ * rebuilding the internal nodes of radix_tree with volatile nodes after the
+ * pool is opened, and to compare inserts and lookups with the default
+ * radix_tree.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <libpmemobj++/experimental/radix_tree.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include "../measure.hpp"
+
+#ifndef _WIN32
+
+#include <unistd.h>
+#define CREATE_MODE_RW (S_IWUSR | S_IRUSR)
+
+#else
+
+#include <windows.h>
+#define CREATE_MODE_RW (S_IWRITE | S_IREAD)
+
+#endif
+
+static const std::string LAYOUT = "radix_volatile_nodes";
+
+using value_type = pmem::obj::p<uint64_t>;
+using radix_tree_type =
+	pmem::obj::experimental::radix_tree<uint64_t, value_type>;
+using volatile_tree_type = pmem::obj::experimental::radix_tree<
+	uint64_t, value_type, pmem::obj::experimental::bytes_view<uint64_t>,
+	false, true>;
+
+struct root {
+	pmem::obj::persistent_ptr<radix_tree_type> radix;
+	pmem::obj::persistent_ptr<volatile_tree_type> volatile_radix;
+};
+
+/*
+ * Inserts keys (in random order) and looks up each of them, prints the
+ * total time of each phase.
+ */
+template <typename TreeType>
+static void
+run(pmem::obj::pool<root> &pop, pmem::obj::persistent_ptr<TreeType> &tree,
+    const std::string &name, const std::vector<uint64_t> &keys)
+{
+	pmem::obj::transaction::run(
+		pop, [&] { tree = pmem::obj::make_persistent<TreeType>(); });
+
+	std::cout << name << ": emplace "
+		  << measure<std::chrono::milliseconds>([&] {
+			     for (auto k : keys)
+				     tree->try_emplace(k, k);
+		     })
+		  << "ms";
+
+	uint64_t found = 0;
+	std::cout << ", find " << measure<std::chrono::milliseconds>([&] {
+		for (auto k : keys)
+			found += tree->find(k) != tree->end();
+	}) << "ms" << std::endl;
+
+	if (found != keys.size())
+		throw std::runtime_error("not all keys were found");
+}
+
+/*
+ * Reopens the pool and rebuilds the internal nodes of the volatile tree
+ * using the given number of threads, prints the time of the rebuild.
+ */
+static void
+reopen(pmem::obj::pool<root> &pop, const char *path, size_t concurrency,
+       const std::vector<uint64_t> &keys)
+{
+	pop.close();
+	pop = pmem::obj::pool<root>::open(path, LAYOUT);
+
+	auto &tree = *pop.root()->volatile_radix;
+	std::cout << "runtime_initialize(" << concurrency
+		  << "): " << measure<std::chrono::milliseconds>([&] {
+			     tree.runtime_initialize(concurrency);
+		     })
+		  << "ms" << std::endl;
+
+	if (tree.find(keys[0]) == tree.end())
+		throw std::runtime_error("key was not found");
+}
+
+int
+main(int argc, char *argv[])
+{
+	using pool = pmem::obj::pool<root>;
+	pool pop;
+
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0]
+			  << " file-name [count] [concurrency]" << std::endl;
+		return 1;
+	}
+
+	const char *path = argv[1];
+	size_t count = 1000000;
+	size_t concurrency = std::thread::hardware_concurrency();
+
+	if (argc > 2)
+		count = std::stoul(argv[2]);
+	if (argc > 3)
+		concurrency = std::stoul(argv[3]);
+
+	std::vector<uint64_t> keys(count);
+	for (size_t i = 0; i < count; i++)
+		keys[i] = i;
+	std::shuffle(keys.begin(), keys.end(), std::mt19937_64(count));
+
+	try {
+		try {
+			pop = pool::create(path, LAYOUT, PMEMOBJ_MIN_POOL * 400,
+					   CREATE_MODE_RW);
+		} catch (const pmem::pool_error &pe) {
+			pop = pool::open(path, LAYOUT);
+		}
+
+		auto r = pop.root();
+
+		run(pop, r->radix, "radix_tree", keys);
+		run(pop, r->volatile_radix, "radix_tree (volatile nodes)",
+		    keys);
+
+		reopen(pop, path, 1, keys);
+		reopen(pop, path, concurrency, keys);
+
+		r = pop.root();
+		pmem::obj::transaction::run(pop, [&] {
+			pmem::obj::delete_persistent<radix_tree_type>(r->radix);
+			pmem::obj::delete_persistent<volatile_tree_type>(
+				r->volatile_radix);
+			r->radix = nullptr;
+			r->volatile_radix = nullptr;
+		});
+
+		pop.close();
+	} catch (const pmem::pool_error &pe) {
+		std::cerr << "!pool::create: " << pe.what() << " " << path
+			  << std::endl;
+		return 1;
+	} catch (const std::logic_error &e) {
+		std::cerr << "!pool::close: " << e.what() << std::endl;
+		return 1;
+	} catch (const std::exception &e) {
+		std::cerr << "!exception: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
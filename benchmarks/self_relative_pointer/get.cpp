@@ -1,16 +1,20 @@
 // SPDX-License-Identifier: BSD-3-Clause
-/* Copyright 2020, Intel Corporation */
+/* Copyright 2020-2021, Intel Corporation */
 
 /*
  * get.cpp -- this simple benchmark is used to measure time of getting and
  * changing a specified number of elements from a persistent array using
- * self_relative_ptr and persistent_ptr
+ * self_relative_ptr, self_relative_ptr32 and persistent_ptr (dereferenced
+ * with get() and with experimental::cached_get(), which has its own per-thread
+ * pool cache only on Windows)
  */
 
 #include <cassert>
 #include <iostream>
 
+#include <libpmemobj++/experimental/cached_get.hpp>
 #include <libpmemobj++/experimental/self_relative_ptr.hpp>
+#include <libpmemobj++/experimental/self_relative_ptr32.hpp>
 #include <libpmemobj++/make_persistent.hpp>
 #include <libpmemobj++/persistent_ptr.hpp>
 #include <libpmemobj++/pool.hpp>
@@ -38,6 +42,8 @@ constexpr int ARR_SIZE = 10000000;
 
 struct root {
 	pmem::obj::persistent_ptr<value_type> pptr;
+	/* self_relative_ptr32 has to reside in the same pool as the array */
+	pmem::obj::experimental::self_relative_ptr32<value_type> offset_ptr32;
 };
 
 pmem::obj::persistent_ptr<value_type>
@@ -85,6 +91,9 @@ main(int argc, char *argv[])
 		pmem::obj::experimental::self_relative_ptr<value_type>
 			offset_ptr = root->pptr;
 		int *vptr = root->pptr.get();
+		pmem::obj::transaction::run(
+			pop, [&] { root->offset_ptr32 = root->pptr; });
+		auto &offset_ptr32 = root->offset_ptr32;
 
 		std::cout << "Run time volatile ptr "
 			  << measure<std::chrono::milliseconds>([&] {
@@ -102,6 +111,14 @@ main(int argc, char *argv[])
 			     })
 			  << "ms" << std::endl;
 
+		std::cout << "Run time self-relative ptr32 "
+			  << measure<std::chrono::milliseconds>([&] {
+				     for (int i = 0; i < ARR_SIZE; i++) {
+					     offset_ptr32[i] += 1;
+				     }
+			     })
+			  << "ms" << std::endl;
+
 		std::cout << "Run time persistent ptr "
 			  << measure<std::chrono::milliseconds>([&] {
 				     for (int i = 0; i < ARR_SIZE; i++) {
@@ -110,6 +127,16 @@ main(int argc, char *argv[])
 			     })
 			  << "ms" << std::endl;
 
+		std::cout
+			<< "Run time persistent ptr cached_get "
+			<< measure<std::chrono::milliseconds>([&] {
+				   for (int i = 0; i < ARR_SIZE; i++) {
+					   pmem::obj::experimental::cached_get(
+						   pptr)[i] += 1;
+				   }
+			   })
+			<< "ms" << std::endl;
+
 		pmem::obj::transaction::run(pop, [&] {
 			pmem::obj::delete_persistent<value_type>(
 				pop.root()->pptr, ARR_SIZE);
@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * list.cpp -- this benchmark is used to compare node sizes and the time of
+ * building and traversing a persistent singly linked list, which uses
+ * persistent_ptr, self_relative_ptr or self_relative_ptr32 as a link
+ */
+
+#include <cassert>
+#include <iostream>
+
+#include <libpmemobj++/experimental/self_relative_ptr.hpp>
+#include <libpmemobj++/experimental/self_relative_ptr32.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include "../measure.hpp"
+
+#ifndef _WIN32
+
+#include <unistd.h>
+#define CREATE_MODE_RW (S_IWUSR | S_IRUSR)
+
+#else
+
+#include <windows.h>
+#define CREATE_MODE_RW (S_IWRITE | S_IREAD)
+
+#endif
+
+static const std::string LAYOUT = "list";
+
+template <typename U>
+using persistent_ptr = pmem::obj::persistent_ptr<U>;
+template <typename U>
+using self_relative_ptr = pmem::obj::experimental::self_relative_ptr<U>;
+template <typename U>
+using self_relative_ptr32 = pmem::obj::experimental::self_relative_ptr32<U>;
+
+template <template <typename U> class pointer>
+struct node {
+	pmem::obj::p<uint32_t> value;
+	pointer<node> next;
+};
+
+template <template <typename U> class pointer>
+struct list {
+	pointer<node<pointer>> head;
+};
+
+struct root {
+	persistent_ptr<list<persistent_ptr>> pers_list;
+	persistent_ptr<list<self_relative_ptr>> self_list;
+	persistent_ptr<list<self_relative_ptr32>> self32_list;
+};
+
+template <template <typename U> class pointer>
+void
+build(pmem::obj::pool_base &pop, persistent_ptr<list<pointer>> &l, size_t count)
+{
+	pmem::obj::transaction::run(pop, [&] {
+		l = pmem::obj::make_persistent<list<pointer>>();
+		for (size_t i = 0; i < count; i++) {
+			auto n = pmem::obj::make_persistent<node<pointer>>();
+			n->value = static_cast<uint32_t>(i);
+			n->next = l->head;
+			l->head = n;
+		}
+	});
+}
+
+template <template <typename U> class pointer>
+uint64_t
+traverse(persistent_ptr<list<pointer>> &l)
+{
+	uint64_t sum = 0;
+	for (auto n = l->head.get(); n != nullptr; n = n->next.get())
+		sum += n->value;
+
+	return sum;
+}
+
+template <template <typename U> class pointer>
+void
+destroy(pmem::obj::pool_base &pop, persistent_ptr<list<pointer>> &l)
+{
+	pmem::obj::transaction::run(pop, [&] {
+		auto n = l->head.get();
+		while (n != nullptr) {
+			auto next = n->next.get();
+			pmem::obj::delete_persistent<node<pointer>>(
+				persistent_ptr<node<pointer>>(n));
+			n = next;
+		}
+		pmem::obj::delete_persistent<list<pointer>>(l);
+		l = nullptr;
+	});
+}
+
+template <template <typename U> class pointer>
+void
+run(pmem::obj::pool_base &pop, persistent_ptr<list<pointer>> &l,
+    const std::string &name, size_t count, size_t iterations)
+{
+	std::cout << name << " node size " << sizeof(node<pointer>) << "B"
+		  << std::endl;
+
+	std::cout << "Run time build " << name << " "
+		  << measure<std::chrono::milliseconds>(
+			     [&] { build(pop, l, count); })
+		  << "ms" << std::endl;
+
+	uint64_t sum = 0;
+	std::cout << "Run time traverse " << name << " "
+		  << measure<std::chrono::milliseconds>([&] {
+			     for (size_t i = 0; i < iterations; i++)
+				     sum += traverse(l);
+		     })
+		  << "ms" << std::endl;
+
+	assert(sum == iterations * (count * (count - 1) / 2));
+	(void)sum;
+
+	destroy(pop, l);
+}
+
+int
+main(int argc, char *argv[])
+{
+	using pool = pmem::obj::pool<root>;
+	pool pop;
+
+	if (argc < 2) {
+		std::cerr << "usage: " << argv[0]
+			  << " file-name [count] [iterations]" << std::endl;
+		return 1;
+	}
+
+	const char *path = argv[1];
+	size_t count = 100000;
+	size_t iterations = 10;
+
+	if (argc > 2)
+		count = std::stoul(argv[2]);
+	if (argc > 3)
+		iterations = std::stoul(argv[3]);
+
+	try {
+		try {
+			pop = pool::create(path, LAYOUT, PMEMOBJ_MIN_POOL * 100,
+					   CREATE_MODE_RW);
+		} catch (const pmem::pool_error &pe) {
+			pop = pool::open(path, LAYOUT);
+		}
+
+		auto r = pop.root();
+
+		run(pop, r->pers_list, "persistent ptr", count, iterations);
+		run(pop, r->self_list, "self-relative ptr", count, iterations);
+		run(pop, r->self32_list, "self-relative ptr32", count,
+		    iterations);
+
+		pop.close();
+	} catch (const pmem::pool_error &pe) {
+		std::cerr << "!pool::create: " << pe.what() << " " << path
+			  << std::endl;
+		return 1;
+	} catch (const std::logic_error &e) {
+		std::cerr << "!pool::close: " << e.what() << std::endl;
+		return 1;
+	} catch (const std::exception &e) {
+		std::cerr << "!exception: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: BSD-3-Clause
-/* Copyright 2019, Intel Corporation */
+/* Copyright 2019-2021, Intel Corporation */
 
 /**
  * @file
@@ -23,6 +23,8 @@ namespace obj
  * Allowed flags are:
  * - allocation_flag::class_id(id) - allocate the object from the allocation
  *   class with id equal to id.
+ * - allocation_flag::arena_id(id) - allocate the object from the arena with
+ *   id equal to id.
  * - allocation_flag::no_flush() - skip flush on commit.
  * - allocation_flag::none() - do not change allocator behaviour.
  *
@@ -45,6 +47,15 @@ struct allocation_flag {
 		return allocation_flag(POBJ_CLASS_ID(id));
 	}
 
+	/**
+	 * Allocate the object from the arena with id equal to id.
+	 */
+	static allocation_flag
+	arena_id(uint64_t id)
+	{
+		return allocation_flag(POBJ_ARENA_ID(id));
+	}
+
 	/**
 	 * Skip flush on commit.
 	 */
@@ -87,6 +98,8 @@ struct allocation_flag {
  * Allowed flags are:
  * - allocation_flag_atomic::class_id(id) - allocate the object from the
  *   allocation class with id equal to id.
+ * - allocation_flag_atomic::arena_id(id) - allocate the object from the
+ *   arena with id equal to id.
  * - allocation_flag_atomic::none() - do not change allocator behaviour.
  *
  * Flags can be combined with each other using operator|()
@@ -108,6 +121,15 @@ struct allocation_flag_atomic {
 		return allocation_flag_atomic(POBJ_CLASS_ID(id));
 	}
 
+	/**
+	 * Allocate the object from the arena with id equal to id.
+	 */
+	static allocation_flag_atomic
+	arena_id(uint64_t id)
+	{
+		return allocation_flag_atomic(POBJ_ARENA_ID(id));
+	}
+
 	/**
 	 * Do not change allocator behaviour.
 	 */
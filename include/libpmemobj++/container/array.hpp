@@ -12,9 +12,11 @@
 #include <algorithm>
 #include <functional>
 #include <initializer_list>
+#include <iterator>
 
 #include <libpmemobj++/container/detail/contiguous_iterator.hpp>
 #include <libpmemobj++/detail/common.hpp>
+#include <libpmemobj++/detail/iterator_traits.hpp>
 #include <libpmemobj++/persistent_ptr.hpp>
 #include <libpmemobj++/pext.hpp>
 #include <libpmemobj++/slice.hpp>
@@ -625,6 +627,115 @@ struct array {
 		});
 	}
 
+	/**
+	 * Fills n elements, starting at index start, with specified value
+	 * inside internal transaction. Only the modified range is added to
+	 * the transaction, in a single snapshot.
+	 *
+	 * @param[in] start index of the first element to fill.
+	 * @param[in] n number of elements to fill.
+	 * @param[in] value value to assign to the elements.
+	 *
+	 * @throw std::out_of_range if any element of the range would be
+	 *	outside of the array.
+	 * @throw transaction_error when adding the object to the
+	 *		transaction failed.
+	 * @throw pmem::pool_error if an object is not in persistent memory.
+	 */
+	void
+	fill_range(size_type start, size_type n, const_reference value)
+	{
+		auto pop = _get_pool();
+
+		if (start + n > N)
+			throw std::out_of_range("array::fill_range");
+
+		flat_transaction::run(pop, [&] {
+			detail::conditional_add_to_tx(
+				_get_data() + start, n,
+				POBJ_XADD_ASSUME_INITIALIZED);
+			std::fill_n(_get_data() + start, n, value);
+		});
+	}
+
+	/**
+	 * Replaces first std::distance(first, last) elements with copies of
+	 * elements in range [first, last) inside internal transaction.
+	 * Remaining elements are left unchanged. The modified range is added
+	 * to the transaction once, instead of element by element.
+	 *
+	 * @param[in] first first iterator.
+	 * @param[in] last last iterator.
+	 *
+	 * @throw std::out_of_range if the range [first, last) is longer than
+	 *	the array.
+	 * @throw transaction_error when adding the object to the
+	 *		transaction failed.
+	 * @throw pmem::pool_error if an object is not in persistent memory.
+	 */
+	template <typename ForwardIt,
+		  typename = typename std::enable_if<
+			  detail::is_forward_iterator<ForwardIt>::value>::type>
+	void
+	assign(ForwardIt first, ForwardIt last)
+	{
+		auto pop = _get_pool();
+
+		auto n = static_cast<size_type>(std::distance(first, last));
+		if (n > N)
+			throw std::out_of_range("array::assign");
+
+		flat_transaction::run(pop, [&] {
+			detail::conditional_add_to_tx(
+				_get_data(), n, POBJ_XADD_ASSUME_INITIALIZED);
+			std::copy(first, last, _get_data());
+		});
+	}
+
+	/**
+	 * Copies n elements from the (volatile or persistent) buffer src into
+	 * the array, starting at index start, inside internal transaction.
+	 * The destination range is added to the transaction in a single
+	 * snapshot; for trivially copyable types the data is copied with
+	 * memmove.
+	 *
+	 * @param[in] start index of the first element to overwrite.
+	 * @param[in] src pointer to the source buffer. It must not overlap
+	 *	with the destination range.
+	 * @param[in] n number of elements to copy.
+	 *
+	 * @throw std::out_of_range if any element of the range would be
+	 *	outside of the array.
+	 * @throw transaction_error when adding the object to the
+	 *		transaction failed.
+	 * @throw pmem::pool_error if an object is not in persistent memory.
+	 */
+	void
+	copy_from(size_type start, const T *src, size_type n)
+	{
+		auto pop = _get_pool();
+
+		if (start + n > N)
+			throw std::out_of_range("array::copy_from");
+
+		flat_transaction::run(pop, [&] {
+			detail::conditional_add_to_tx(
+				_get_data() + start, n,
+				POBJ_XADD_ASSUME_INITIALIZED);
+			std::copy_n(src, n, _get_data() + start);
+		});
+	}
+
+	/**
+	 * Copies elements of slice src into the array, starting at index
+	 * start. See copy_from(size_type, const T *, size_type).
+	 */
+	void
+	copy_from(size_type start, slice<const T *> src)
+	{
+		copy_from(start, src.begin(), src.size());
+	}
+
 	/**
 	 * Swaps content with other array's content inside internal transaction.
 	 *
@@ -40,12 +40,25 @@ namespace obj
  * The implementation is still missing some methods, but it doesn't
  * impact regular use of this container.
  *
+ * InlineBytes specifies the size (in bytes) of the whole string object.
+ * The first 8 bytes are used for the size, the rest holds characters
+ * stored in place (short string optimization). Longer strings are kept in
+ * a separate allocation. The default (32 bytes) gives the same layout as
+ * pmem::obj::string; 64 or 128 bytes keep longer keys within one or two
+ * cache lines, at the cost of a bigger object.
+ *
  * Simple example of pmem::obj::string usage:
  * @snippet string/string.cpp string_example
  * @ingroup containers
  */
-template <typename CharT, typename Traits = std::char_traits<CharT>>
+template <typename CharT, typename Traits = std::char_traits<CharT>,
+	  std::size_t InlineBytes = 32>
 class basic_string {
+	static_assert(InlineBytes % 8 == 0,
+		      "InlineBytes must be a multiple of 8");
+	static_assert(InlineBytes >= 32,
+		      "InlineBytes must be at least 32 (size of a vector)");
+
 public:
 	/* Member types */
 	using traits_type = Traits;
@@ -66,7 +79,8 @@ public:
 		std::function<void(persistent_ptr_base &)>;
 
 	/* Number of characters which can be stored using sso */
-	static constexpr size_type sso_capacity = (32 - 8) / sizeof(CharT) - 1;
+	static constexpr size_type sso_capacity =
+		(InlineBytes - 8) / sizeof(CharT) - 1;
 
 	/* Constructors */
 	basic_string();
@@ -414,11 +428,13 @@ private:
 	void set_sso_size(size_type new_size);
 	void sso_to_large(size_t new_capacity);
 	void large_to_sso();
-	typename basic_string<CharT, Traits>::non_sso_type &non_sso_data();
-	typename basic_string<CharT, Traits>::sso_type &sso_data();
-	const typename basic_string<CharT, Traits>::non_sso_type &
+	typename basic_string<CharT, Traits, InlineBytes>::non_sso_type &
+	non_sso_data();
+	typename basic_string<CharT, Traits, InlineBytes>::sso_type &sso_data();
+	const typename basic_string<CharT, Traits, InlineBytes>::non_sso_type &
 	non_sso_data() const;
-	const typename basic_string<CharT, Traits>::sso_type &sso_data() const;
+	const typename basic_string<CharT, Traits, InlineBytes>::sso_type &
+	sso_data() const;
 };
 
 /**
@@ -430,8 +446,8 @@ private:
  * @throw pmem::transaction_scope_error if constructor wasn't called in
  * transaction.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits>::basic_string()
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes>::basic_string()
 {
 	check_pmem_tx();
 	sso._size = 0;
@@ -454,8 +470,9 @@ basic_string<CharT, Traits>::basic_string()
  * @throw pmem::transaction_scope_error if constructor wasn't called in
  * transaction.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits>::basic_string(size_type count, CharT ch)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes>::basic_string(size_type count,
+						       CharT ch)
 {
 	check_pmem_tx();
 	sso._size = 0;
@@ -481,9 +498,9 @@ basic_string<CharT, Traits>::basic_string(size_type count, CharT ch)
  * @throw pmem::transaction_scope_error if constructor wasn't called in
  * transaction.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits>::basic_string(const basic_string &other,
-					  size_type pos, size_type count)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes>::basic_string(
+	const basic_string &other, size_type pos, size_type count)
 {
 	check_pmem_tx();
 	sso._size = 0;
@@ -519,9 +536,9 @@ basic_string<CharT, Traits>::basic_string(const basic_string &other,
  * @throw pmem::transaction_scope_error if constructor wasn't called in
  * transaction.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits>::basic_string(const std::basic_string<CharT> &other,
-					  size_type pos, size_type count)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes>::basic_string(
+	const std::basic_string<CharT> &other, size_type pos, size_type count)
     : basic_string(basic_string_view<CharT>(other), pos, count)
 {
 }
@@ -541,8 +558,9 @@ basic_string<CharT, Traits>::basic_string(const std::basic_string<CharT> &other,
  * @throw pmem::transaction_scope_error if constructor wasn't called in
  * transaction.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits>::basic_string(const CharT *s, size_type count)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes>::basic_string(const CharT *s,
+						       size_type count)
 {
 	check_pmem_tx();
 	sso._size = 0;
@@ -564,8 +582,8 @@ basic_string<CharT, Traits>::basic_string(const CharT *s, size_type count)
  * @throw pmem::transaction_scope_error if constructor wasn't called in
  * transaction.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits>::basic_string(const CharT *s)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes>::basic_string(const CharT *s)
 {
 	check_pmem_tx();
 	sso._size = 0;
@@ -592,9 +610,10 @@ basic_string<CharT, Traits>::basic_string(const CharT *s)
  * @throw pmem::transaction_scope_error if constructor wasn't called in
  * transaction.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 template <typename InputIt, typename Enable>
-basic_string<CharT, Traits>::basic_string(InputIt first, InputIt last)
+basic_string<CharT, Traits, InlineBytes>::basic_string(InputIt first,
+						       InputIt last)
 {
 	auto len = std::distance(first, last);
 	assert(len >= 0);
@@ -620,8 +639,9 @@ basic_string<CharT, Traits>::basic_string(InputIt first, InputIt last)
  * @throw pmem::transaction_scope_error if constructor wasn't called in
  * transaction.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits>::basic_string(const basic_string &other)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes>::basic_string(
+	const basic_string &other)
 {
 	check_pmem_tx();
 	sso._size = 0;
@@ -645,8 +665,9 @@ basic_string<CharT, Traits>::basic_string(const basic_string &other)
  * @throw pmem::transaction_scope_error if constructor wasn't called in
  * transaction.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits>::basic_string(const std::basic_string<CharT> &other)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes>::basic_string(
+	const std::basic_string<CharT> &other)
     : basic_string(other.cbegin(), other.cend())
 {
 }
@@ -665,8 +686,8 @@ basic_string<CharT, Traits>::basic_string(const std::basic_string<CharT> &other)
  * @throw pmem::transaction_scope_error if constructor wasn't called in
  * transaction.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits>::basic_string(basic_string &&other)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes>::basic_string(basic_string &&other)
 {
 	check_pmem_tx();
 	sso._size = 0;
@@ -688,8 +709,9 @@ basic_string<CharT, Traits>::basic_string(basic_string &&other)
  * @throw pmem::transaction_scope_error if constructor wasn't called in
  * transaction.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits>::basic_string(std::initializer_list<CharT> ilist)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes>::basic_string(
+	std::initializer_list<CharT> ilist)
 {
 	check_pmem_tx();
 	sso._size = 0;
@@ -713,9 +735,9 @@ basic_string<CharT, Traits>::basic_string(std::initializer_list<CharT> ilist)
  * @throw pmem::transaction_scope_error if constructor wasn't called in
  * transaction.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 template <class T, typename Enable>
-basic_string<CharT, Traits>::basic_string(const T &t)
+basic_string<CharT, Traits, InlineBytes>::basic_string(const T &t)
 {
 	check_pmem_tx();
 	sso._size = 0;
@@ -743,10 +765,11 @@ basic_string<CharT, Traits>::basic_string(const T &t)
  * @throw pmem::transaction_scope_error if constructor wasn't called in
  * transaction.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 template <class T, typename Enable>
-basic_string<CharT, Traits>::basic_string(const T &t, size_type pos,
-					  size_type n)
+basic_string<CharT, Traits, InlineBytes>::basic_string(const T &t,
+						       size_type pos,
+						       size_type n)
 {
 	check_pmem_tx();
 	sso._size = 0;
@@ -769,8 +792,8 @@ basic_string<CharT, Traits>::basic_string(const T &t, size_type pos,
 /**
  * Destructor.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits>::~basic_string()
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes>::~basic_string()
 {
 	try {
 		free_data();
@@ -788,9 +811,9 @@ basic_string<CharT, Traits>::~basic_string()
  * @throw pmem::transaction_alloc_error when allocating memory for
  * underlying storage in transaction failed.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::operator=(const basic_string &other)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::operator=(const basic_string &other)
 {
 	return assign(other);
 }
@@ -805,9 +828,10 @@ basic_string<CharT, Traits>::operator=(const basic_string &other)
  * @throw pmem::transaction_alloc_error when allocating memory for
  * underlying storage in transaction failed.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::operator=(const std::basic_string<CharT> &other)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::operator=(
+	const std::basic_string<CharT> &other)
 {
 	return assign(other);
 }
@@ -821,9 +845,9 @@ basic_string<CharT, Traits>::operator=(const std::basic_string<CharT> &other)
  * @throw pmem::transaction_alloc_error when allocating memory for
  * underlying storage in transaction failed.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::operator=(basic_string &&other)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::operator=(basic_string &&other)
 {
 	return assign(std::move(other));
 }
@@ -836,9 +860,9 @@ basic_string<CharT, Traits>::operator=(basic_string &&other)
  * @throw pmem::transaction_alloc_error when allocating memory for
  * underlying storage in transaction failed.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::operator=(const CharT *s)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::operator=(const CharT *s)
 {
 	return assign(s);
 }
@@ -851,9 +875,9 @@ basic_string<CharT, Traits>::operator=(const CharT *s)
  * @throw pmem::transaction_alloc_error when allocating memory for
  * underlying storage in transaction failed.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::operator=(CharT ch)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::operator=(CharT ch)
 {
 	return assign(1, ch);
 }
@@ -867,9 +891,10 @@ basic_string<CharT, Traits>::operator=(CharT ch)
  * @throw pmem::transaction_alloc_error when allocating memory for
  * underlying storage in transaction failed.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::operator=(std::initializer_list<CharT> ilist)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::operator=(
+	std::initializer_list<CharT> ilist)
 {
 	return assign(ilist);
 }
@@ -883,10 +908,10 @@ basic_string<CharT, Traits>::operator=(std::initializer_list<CharT> ilist)
  * @throw pmem::transaction_alloc_error when allocating memory for
  * underlying storage in transaction failed.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 template <class T, typename Enable>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::operator=(const T &t)
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::operator=(const T &t)
 {
 	basic_string_view<CharT, Traits> sv(t);
 	return assign(sv.data(), sv.size());
@@ -902,9 +927,9 @@ basic_string<CharT, Traits>::operator=(const T &t)
  * @throw pmem::transaction_alloc_error when allocating memory for
  * underlying storage in transaction failed.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::assign(size_type count, CharT ch)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::assign(size_type count, CharT ch)
 {
 	auto pop = get_pool();
 
@@ -922,9 +947,9 @@ basic_string<CharT, Traits>::assign(size_type count, CharT ch)
  * @throw pmem::transaction_alloc_error when allocating memory for
  * underlying storage in transaction failed.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::assign(const basic_string &other)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::assign(const basic_string &other)
 {
 	if (&other == this)
 		return *this;
@@ -947,9 +972,10 @@ basic_string<CharT, Traits>::assign(const basic_string &other)
  * @throw pmem::transaction_alloc_error when allocating memory for
  * underlying storage in transaction failed.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::assign(const std::basic_string<CharT> &other)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::assign(
+	const std::basic_string<CharT> &other)
 {
 	return assign(other.cbegin(), other.cend());
 }
@@ -966,10 +992,10 @@ basic_string<CharT, Traits>::assign(const std::basic_string<CharT> &other)
  * @throw pmem::transaction_alloc_error when allocating memory for
  * underlying storage in transaction failed.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::assign(const basic_string &other, size_type pos,
-				    size_type count)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::assign(const basic_string &other,
+						 size_type pos, size_type count)
 {
 	if (pos > other.size())
 		throw std::out_of_range("Index out of range.");
@@ -1002,10 +1028,10 @@ basic_string<CharT, Traits>::assign(const basic_string &other, size_type pos,
  * @throw pmem::transaction_alloc_error when allocating memory for
  * underlying storage in transaction failed.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::assign(const std::basic_string<CharT> &other,
-				    size_type pos, size_type count)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::assign(
+	const std::basic_string<CharT> &other, size_type pos, size_type count)
 {
 	if (pos > other.size())
 		throw std::out_of_range("Index out of range.");
@@ -1026,9 +1052,10 @@ basic_string<CharT, Traits>::assign(const std::basic_string<CharT> &other,
  * @throw pmem::transaction_alloc_error when allocating memory for
  * underlying storage in transaction failed.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::assign(const CharT *s, size_type count)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::assign(const CharT *s,
+						 size_type count)
 {
 	auto pop = get_pool();
 
@@ -1045,9 +1072,9 @@ basic_string<CharT, Traits>::assign(const CharT *s, size_type count)
  * @throw pmem::transaction_alloc_error when allocating memory for
  * underlying storage in transaction failed.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::assign(const CharT *s)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::assign(const CharT *s)
 {
 	auto pop = get_pool();
 
@@ -1069,10 +1096,10 @@ basic_string<CharT, Traits>::assign(const CharT *s)
  * @throw pmem::transaction_alloc_error when allocating memory for
  * underlying storage in transaction failed.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 template <typename InputIt, typename Enable>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::assign(InputIt first, InputIt last)
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::assign(InputIt first, InputIt last)
 {
 	auto pop = get_pool();
 
@@ -1090,9 +1117,9 @@ basic_string<CharT, Traits>::assign(InputIt first, InputIt last)
  * @throw pmem::transaction_alloc_error when allocating memory for
  * underlying storage in transaction failed.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::assign(basic_string &&other)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::assign(basic_string &&other)
 {
 	if (&other == this)
 		return *this;
@@ -1116,9 +1143,10 @@ basic_string<CharT, Traits>::assign(basic_string &&other)
  * @throw pmem::transaction_alloc_error when allocating memory for
  * underlying storage in transaction failed.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::assign(std::initializer_list<CharT> ilist)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::assign(
+	std::initializer_list<CharT> ilist)
 {
 	return assign(ilist.begin(), ilist.end());
 }
@@ -1130,9 +1158,10 @@ basic_string<CharT, Traits>::assign(std::initializer_list<CharT> ilist)
  *
  * @param func callback function to call on internal pointer.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::for_each_ptr(for_each_ptr_function func)
+basic_string<CharT, Traits, InlineBytes>::for_each_ptr(
+	for_each_ptr_function func)
 {
 	if (!is_sso_used()) {
 		non_sso._data.for_each_ptr(func);
@@ -1144,9 +1173,9 @@ basic_string<CharT, Traits>::for_each_ptr(for_each_ptr_function func)
  *
  * @return an iterator pointing to the first element in the string.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::iterator
-basic_string<CharT, Traits>::begin()
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::iterator
+basic_string<CharT, Traits, InlineBytes>::begin()
 {
 	return is_sso_used() ? iterator(&*sso_data().begin())
 			     : iterator(&*non_sso_data().begin());
@@ -1157,9 +1186,9 @@ basic_string<CharT, Traits>::begin()
  *
  * @return const iterator pointing to the first element in the string.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::const_iterator
-basic_string<CharT, Traits>::begin() const noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::const_iterator
+basic_string<CharT, Traits, InlineBytes>::begin() const noexcept
 {
 	return cbegin();
 }
@@ -1169,9 +1198,9 @@ basic_string<CharT, Traits>::begin() const noexcept
  *
  * @return const iterator pointing to the first element in the string.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::const_iterator
-basic_string<CharT, Traits>::cbegin() const noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::const_iterator
+basic_string<CharT, Traits, InlineBytes>::cbegin() const noexcept
 {
 	return is_sso_used() ? const_iterator(&*sso_data().cbegin())
 			     : const_iterator(&*non_sso_data().cbegin());
@@ -1182,9 +1211,9 @@ basic_string<CharT, Traits>::cbegin() const noexcept
  *
  * @return iterator referring to the past-the-end element in the string.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::iterator
-basic_string<CharT, Traits>::end()
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::iterator
+basic_string<CharT, Traits, InlineBytes>::end()
 {
 	return begin() + static_cast<difference_type>(size());
 }
@@ -1195,9 +1224,9 @@ basic_string<CharT, Traits>::end()
  * @return const_iterator referring to the past-the-end element in the
  * string.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::const_iterator
-basic_string<CharT, Traits>::end() const noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::const_iterator
+basic_string<CharT, Traits, InlineBytes>::end() const noexcept
 {
 	return cbegin() + static_cast<difference_type>(size());
 }
@@ -1208,9 +1237,9 @@ basic_string<CharT, Traits>::end() const noexcept
  * @return const_iterator referring to the past-the-end element in the
  * string.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::const_iterator
-basic_string<CharT, Traits>::cend() const noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::const_iterator
+basic_string<CharT, Traits, InlineBytes>::cend() const noexcept
 {
 	return cbegin() + static_cast<difference_type>(size());
 }
@@ -1221,9 +1250,9 @@ basic_string<CharT, Traits>::cend() const noexcept
  * @return a reverse iterator pointing to the last element in
  * non-reversed string.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::reverse_iterator
-basic_string<CharT, Traits>::rbegin()
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::reverse_iterator
+basic_string<CharT, Traits, InlineBytes>::rbegin()
 {
 	return reverse_iterator(end());
 }
@@ -1234,9 +1263,9 @@ basic_string<CharT, Traits>::rbegin()
  * @return a const reverse iterator pointing to the last element in
  * non-reversed string.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::const_reverse_iterator
-basic_string<CharT, Traits>::rbegin() const noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::const_reverse_iterator
+basic_string<CharT, Traits, InlineBytes>::rbegin() const noexcept
 {
 	return crbegin();
 }
@@ -1247,9 +1276,9 @@ basic_string<CharT, Traits>::rbegin() const noexcept
  * @return a const reverse iterator pointing to the last element in
  * non-reversed string.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::const_reverse_iterator
-basic_string<CharT, Traits>::crbegin() const noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::const_reverse_iterator
+basic_string<CharT, Traits, InlineBytes>::crbegin() const noexcept
 {
 	return const_reverse_iterator(cend());
 }
@@ -1260,9 +1289,9 @@ basic_string<CharT, Traits>::crbegin() const noexcept
  * @return reverse iterator referring to character preceding first
  * character in the non-reversed string.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::reverse_iterator
-basic_string<CharT, Traits>::rend()
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::reverse_iterator
+basic_string<CharT, Traits, InlineBytes>::rend()
 {
 	return reverse_iterator(begin());
 }
@@ -1273,9 +1302,9 @@ basic_string<CharT, Traits>::rend()
  * @return const reverse iterator referring to character preceding
  * first character in the non-reversed string.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::const_reverse_iterator
-basic_string<CharT, Traits>::rend() const noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::const_reverse_iterator
+basic_string<CharT, Traits, InlineBytes>::rend() const noexcept
 {
 	return crend();
 }
@@ -1286,9 +1315,9 @@ basic_string<CharT, Traits>::rend() const noexcept
  * @return const reverse iterator referring to character preceding
  * first character in the non-reversed string.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::const_reverse_iterator
-basic_string<CharT, Traits>::crend() const noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::const_reverse_iterator
+basic_string<CharT, Traits, InlineBytes>::crend() const noexcept
 {
 	return const_reverse_iterator(cbegin());
 }
@@ -1306,9 +1335,9 @@ basic_string<CharT, Traits>::crend() const noexcept
  * @throw pmem::transaction_error when adding the object to the
  * transaction failed.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::reference
-basic_string<CharT, Traits>::at(size_type n)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::reference
+basic_string<CharT, Traits, InlineBytes>::at(size_type n)
 {
 	if (n >= size())
 		throw std::out_of_range("string::at");
@@ -1326,9 +1355,9 @@ basic_string<CharT, Traits>::at(size_type n)
  * @throw std::out_of_range if n is not within the range of the
  * container.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::const_reference
-basic_string<CharT, Traits>::at(size_type n) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::const_reference
+basic_string<CharT, Traits, InlineBytes>::at(size_type n) const
 {
 	return const_at(n);
 }
@@ -1346,9 +1375,9 @@ basic_string<CharT, Traits>::at(size_type n) const
  * @throw std::out_of_range if n is not within the range of the
  * container.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::const_reference
-basic_string<CharT, Traits>::const_at(size_type n) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::const_reference
+basic_string<CharT, Traits, InlineBytes>::const_at(size_type n) const
 {
 	if (n >= size())
 		throw std::out_of_range("string::const_at");
@@ -1369,9 +1398,9 @@ basic_string<CharT, Traits>::const_at(size_type n) const
  * @throw pmem::transaction_error when adding the object to the
  * transaction failed.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::reference
-	basic_string<CharT, Traits>::operator[](size_type n)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::reference
+basic_string<CharT, Traits, InlineBytes>::operator[](size_type n)
 {
 	return is_sso_used() ? sso_data()[n] : non_sso_data()[n];
 }
@@ -1383,9 +1412,9 @@ typename basic_string<CharT, Traits>::reference
  *
  * @return const_reference to element number n in underlying array.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::const_reference
-	basic_string<CharT, Traits>::operator[](size_type n) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::const_reference
+basic_string<CharT, Traits, InlineBytes>::operator[](size_type n) const
 {
 	return is_sso_used() ? sso_data()[n] : non_sso_data()[n];
 }
@@ -1403,9 +1432,9 @@ typename basic_string<CharT, Traits>::const_reference
  * string.
  * @throw pmem::transaction_error when snapshotting failed.
  */
-template <typename CharT, typename Traits>
-slice<typename basic_string<CharT, Traits>::pointer>
-basic_string<CharT, Traits>::range(size_type start, size_type n)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+slice<typename basic_string<CharT, Traits, InlineBytes>::pointer>
+basic_string<CharT, Traits, InlineBytes>::range(size_type start, size_type n)
 {
 	if (start + n > size())
 		throw std::out_of_range("basic_string::range");
@@ -1430,10 +1459,11 @@ basic_string<CharT, Traits>::range(size_type start, size_type n)
  * string.
  * @throw pmem::transaction_error when snapshotting failed.
  */
-template <typename CharT, typename Traits>
-slice<typename basic_string<CharT, Traits>::range_snapshotting_iterator>
-basic_string<CharT, Traits>::range(size_type start, size_type n,
-				   size_type snapshot_size)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+slice<typename basic_string<CharT, Traits,
+			    InlineBytes>::range_snapshotting_iterator>
+basic_string<CharT, Traits, InlineBytes>::range(size_type start, size_type n,
+						size_type snapshot_size)
 {
 	if (start + n > size())
 		throw std::out_of_range("basic_string::range");
@@ -1456,9 +1486,10 @@ basic_string<CharT, Traits>::range(size_type start, size_type n,
  * @throw std::out_of_range if any element of the range would be outside of the
  * string.
  */
-template <typename CharT, typename Traits>
-slice<typename basic_string<CharT, Traits>::const_iterator>
-basic_string<CharT, Traits>::range(size_type start, size_type n) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+slice<typename basic_string<CharT, Traits, InlineBytes>::const_iterator>
+basic_string<CharT, Traits, InlineBytes>::range(size_type start,
+						size_type n) const
 {
 	return crange(start, n);
 }
@@ -1474,9 +1505,10 @@ basic_string<CharT, Traits>::range(size_type start, size_type n) const
  * @throw std::out_of_range if any element of the range would be outside of the
  * string.
  */
-template <typename CharT, typename Traits>
-slice<typename basic_string<CharT, Traits>::const_iterator>
-basic_string<CharT, Traits>::crange(size_type start, size_type n) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+slice<typename basic_string<CharT, Traits, InlineBytes>::const_iterator>
+basic_string<CharT, Traits, InlineBytes>::crange(size_type start,
+						 size_type n) const
 {
 	if (start + n > size())
 		throw std::out_of_range("basic_string::range");
@@ -1494,9 +1526,9 @@ basic_string<CharT, Traits>::crange(size_type start, size_type n) const
  * @throw pmem::transaction_error when adding the object to the
  * transaction failed.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 CharT &
-basic_string<CharT, Traits>::front()
+basic_string<CharT, Traits, InlineBytes>::front()
 {
 	return (*this)[0];
 }
@@ -1506,9 +1538,9 @@ basic_string<CharT, Traits>::front()
  *
  * @return const reference to first element in string.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 const CharT &
-basic_string<CharT, Traits>::front() const
+basic_string<CharT, Traits, InlineBytes>::front() const
 {
 	return cfront();
 }
@@ -1521,9 +1553,9 @@ basic_string<CharT, Traits>::front() const
  *
  * @return const reference to first element in string.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 const CharT &
-basic_string<CharT, Traits>::cfront() const
+basic_string<CharT, Traits, InlineBytes>::cfront() const
 {
 	return static_cast<const basic_string &>(*this)[0];
 }
@@ -1537,9 +1569,9 @@ basic_string<CharT, Traits>::cfront() const
  * @throw pmem::transaction_error when adding the object to the
  * transaction failed.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 CharT &
-basic_string<CharT, Traits>::back()
+basic_string<CharT, Traits, InlineBytes>::back()
 {
 	return (*this)[size() - 1];
 }
@@ -1549,9 +1581,9 @@ basic_string<CharT, Traits>::back()
  *
  * @return const reference to last element in string.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 const CharT &
-basic_string<CharT, Traits>::back() const
+basic_string<CharT, Traits, InlineBytes>::back() const
 {
 	return cback();
 }
@@ -1564,9 +1596,9 @@ basic_string<CharT, Traits>::back() const
  *
  * @return const reference to last element in string.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 const CharT &
-basic_string<CharT, Traits>::cback() const
+basic_string<CharT, Traits, InlineBytes>::cback() const
 {
 	return static_cast<const basic_string &>(*this)[size() - 1];
 }
@@ -1574,9 +1606,9 @@ basic_string<CharT, Traits>::cback() const
 /**
  * @return number of CharT elements in the string.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::size() const noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::size() const noexcept
 {
 	if (is_sso_used())
 		return get_sso_size();
@@ -1592,9 +1624,9 @@ basic_string<CharT, Traits>::size() const noexcept
  * @throw transaction_error when adding data to the
  * transaction failed.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 CharT *
-basic_string<CharT, Traits>::data()
+basic_string<CharT, Traits, InlineBytes>::data()
 {
 	return is_sso_used() ? sso_data().range(0, get_sso_size() + 1).begin()
 			     : non_sso_data().data();
@@ -1618,9 +1650,10 @@ basic_string<CharT, Traits>::data()
  * @throw pmem::transaction_error when snapshotting failed.
  * @throw rethrows destructor exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::erase(size_type index, size_type count)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::erase(size_type index,
+						size_type count)
 {
 	auto sz = size();
 
@@ -1675,9 +1708,9 @@ basic_string<CharT, Traits>::erase(size_type index, size_type count)
  * @throw pmem::transaction_error when snapshotting failed.
  * @throw rethrows destructor exception.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::iterator
-basic_string<CharT, Traits>::erase(const_iterator pos)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::iterator
+basic_string<CharT, Traits, InlineBytes>::erase(const_iterator pos)
 {
 	return erase(pos, pos + 1);
 }
@@ -1700,9 +1733,10 @@ basic_string<CharT, Traits>::erase(const_iterator pos)
  * @throw pmem::transaction_error when snapshotting failed.
  * @throw rethrows destructor exception.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::iterator
-basic_string<CharT, Traits>::erase(const_iterator first, const_iterator last)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::iterator
+basic_string<CharT, Traits, InlineBytes>::erase(const_iterator first,
+						const_iterator last)
 {
 	size_type index =
 		static_cast<size_type>(std::distance(cbegin(), first));
@@ -1723,9 +1757,9 @@ basic_string<CharT, Traits>::erase(const_iterator first, const_iterator last)
  * @throw pmem::transaction_error when snapshotting failed.
  * @throw rethrows destructor exception.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::pop_back()
+basic_string<CharT, Traits, InlineBytes>::pop_back()
 {
 	erase(size() - 1, 1);
 }
@@ -1749,9 +1783,9 @@ basic_string<CharT, Traits>::pop_back()
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::append(size_type count, CharT ch)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::append(size_type count, CharT ch)
 {
 	auto sz = size();
 	auto new_size = sz + count;
@@ -1808,9 +1842,9 @@ basic_string<CharT, Traits>::append(size_type count, CharT ch)
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::append(const basic_string &str)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::append(const basic_string &str)
 {
 	return append(str.data(), str.size());
 }
@@ -1840,10 +1874,10 @@ basic_string<CharT, Traits>::append(const basic_string &str)
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::append(const basic_string &str, size_type pos,
-				    size_type count)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::append(const basic_string &str,
+						 size_type pos, size_type count)
 {
 	auto sz = str.size();
 
@@ -1876,9 +1910,10 @@ basic_string<CharT, Traits>::append(const basic_string &str, size_type pos,
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::append(const CharT *s, size_type count)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::append(const CharT *s,
+						 size_type count)
 {
 	return append(s, s + count);
 }
@@ -1902,9 +1937,9 @@ basic_string<CharT, Traits>::append(const CharT *s, size_type count)
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::append(const CharT *s)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::append(const CharT *s)
 {
 	return append(s, traits_type::length(s));
 }
@@ -1930,10 +1965,10 @@ basic_string<CharT, Traits>::append(const CharT *s)
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 template <typename InputIt, typename Enable>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::append(InputIt first, InputIt last)
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::append(InputIt first, InputIt last)
 {
 	auto sz = size();
 	auto count = static_cast<size_type>(std::distance(first, last));
@@ -1999,9 +2034,10 @@ basic_string<CharT, Traits>::append(InputIt first, InputIt last)
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::append(std::initializer_list<CharT> ilist)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::append(
+	std::initializer_list<CharT> ilist)
 {
 	return append(ilist.begin(), ilist.end());
 }
@@ -2022,9 +2058,9 @@ basic_string<CharT, Traits>::append(std::initializer_list<CharT> ilist)
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::push_back(CharT ch)
+basic_string<CharT, Traits, InlineBytes>::push_back(CharT ch)
 {
 	append(static_cast<size_type>(1), ch);
 }
@@ -2047,9 +2083,9 @@ basic_string<CharT, Traits>::push_back(CharT ch)
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::operator+=(const basic_string &str)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::operator+=(const basic_string &str)
 {
 	return append(str);
 }
@@ -2073,9 +2109,9 @@ basic_string<CharT, Traits>::operator+=(const basic_string &str)
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::operator+=(const CharT *s)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::operator+=(const CharT *s)
 {
 	return append(s);
 }
@@ -2096,9 +2132,9 @@ basic_string<CharT, Traits>::operator+=(const CharT *s)
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::operator+=(CharT ch)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::operator+=(CharT ch)
 {
 	push_back(ch);
 
@@ -2123,9 +2159,10 @@ basic_string<CharT, Traits>::operator+=(CharT ch)
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::operator+=(std::initializer_list<CharT> ilist)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::operator+=(
+	std::initializer_list<CharT> ilist)
 {
 	return append(ilist);
 }
@@ -2151,9 +2188,10 @@ basic_string<CharT, Traits>::operator+=(std::initializer_list<CharT> ilist)
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::insert(size_type index, size_type count, CharT ch)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::insert(size_type index,
+						 size_type count, CharT ch)
 {
 	if (index > size())
 		throw std::out_of_range("Index out of range.");
@@ -2186,9 +2224,10 @@ basic_string<CharT, Traits>::insert(size_type index, size_type count, CharT ch)
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::insert(size_type index, const CharT *s)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::insert(size_type index,
+						 const CharT *s)
 {
 	return insert(index, s, traits_type::length(s));
 }
@@ -2214,10 +2253,11 @@ basic_string<CharT, Traits>::insert(size_type index, const CharT *s)
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::insert(size_type index, const CharT *s,
-				    size_type count)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::insert(size_type index,
+						 const CharT *s,
+						 size_type count)
 {
 	if (index > size())
 		throw std::out_of_range("Index out of range.");
@@ -2249,9 +2289,10 @@ basic_string<CharT, Traits>::insert(size_type index, const CharT *s,
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::insert(size_type index, const basic_string &str)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::insert(size_type index,
+						 const basic_string &str)
 {
 	return insert(index, str.data(), str.size());
 }
@@ -2278,10 +2319,12 @@ basic_string<CharT, Traits>::insert(size_type index, const basic_string &str)
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::insert(size_type index1, const basic_string &str,
-				    size_type index2, size_type count)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::insert(size_type index1,
+						 const basic_string &str,
+						 size_type index2,
+						 size_type count)
 {
 	auto sz = str.size();
 
@@ -2315,9 +2358,9 @@ basic_string<CharT, Traits>::insert(size_type index1, const basic_string &str,
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::iterator
-basic_string<CharT, Traits>::insert(const_iterator pos, CharT ch)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::iterator
+basic_string<CharT, Traits, InlineBytes>::insert(const_iterator pos, CharT ch)
 {
 	return insert(pos, 1, ch);
 }
@@ -2346,10 +2389,10 @@ basic_string<CharT, Traits>::insert(const_iterator pos, CharT ch)
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::iterator
-basic_string<CharT, Traits>::insert(const_iterator pos, size_type count,
-				    CharT ch)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::iterator
+basic_string<CharT, Traits, InlineBytes>::insert(const_iterator pos,
+						 size_type count, CharT ch)
 {
 	auto sz = size();
 
@@ -2414,11 +2457,11 @@ basic_string<CharT, Traits>::insert(const_iterator pos, size_type count,
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 template <typename InputIt, typename Enable>
-typename basic_string<CharT, Traits>::iterator
-basic_string<CharT, Traits>::insert(const_iterator pos, InputIt first,
-				    InputIt last)
+typename basic_string<CharT, Traits, InlineBytes>::iterator
+basic_string<CharT, Traits, InlineBytes>::insert(const_iterator pos,
+						 InputIt first, InputIt last)
 {
 	auto sz = size();
 
@@ -2500,10 +2543,10 @@ basic_string<CharT, Traits>::insert(const_iterator pos, InputIt first,
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::iterator
-basic_string<CharT, Traits>::insert(const_iterator pos,
-				    std::initializer_list<CharT> ilist)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::iterator
+basic_string<CharT, Traits, InlineBytes>::insert(
+	const_iterator pos, std::initializer_list<CharT> ilist)
 {
 	return insert(pos, ilist.begin(), ilist.end());
 }
@@ -2530,10 +2573,11 @@ basic_string<CharT, Traits>::insert(const_iterator pos,
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::replace(size_type index, size_type count,
-				     const basic_string &str)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::replace(size_type index,
+						  size_type count,
+						  const basic_string &str)
 {
 	return replace(index, count, str.data(), str.size());
 }
@@ -2558,10 +2602,11 @@ basic_string<CharT, Traits>::replace(size_type index, size_type count,
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::replace(const_iterator first, const_iterator last,
-				     const basic_string &str)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::replace(const_iterator first,
+						  const_iterator last,
+						  const basic_string &str)
 {
 	return replace(first, last, str.data(), str.data() + str.size());
 }
@@ -2592,11 +2637,13 @@ basic_string<CharT, Traits>::replace(const_iterator first, const_iterator last,
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::replace(size_type index, size_type count,
-				     const basic_string &str, size_type index2,
-				     size_type count2)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::replace(size_type index,
+						  size_type count,
+						  const basic_string &str,
+						  size_type index2,
+						  size_type count2)
 {
 	auto sz = str.size();
 
@@ -2633,11 +2680,12 @@ basic_string<CharT, Traits>::replace(size_type index, size_type count,
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 template <typename InputIt, typename Enable>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::replace(const_iterator first, const_iterator last,
-				     InputIt first2, InputIt last2)
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::replace(const_iterator first,
+						  const_iterator last,
+						  InputIt first2, InputIt last2)
 {
 	auto sz = size();
 	auto index = static_cast<size_type>(std::distance(cbegin(), first));
@@ -2716,10 +2764,12 @@ basic_string<CharT, Traits>::replace(const_iterator first, const_iterator last,
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::replace(const_iterator first, const_iterator last,
-				     const CharT *s, size_type count2)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::replace(const_iterator first,
+						  const_iterator last,
+						  const CharT *s,
+						  size_type count2)
 {
 	return replace(first, last, s, s + count2);
 }
@@ -2747,10 +2797,12 @@ basic_string<CharT, Traits>::replace(const_iterator first, const_iterator last,
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::replace(size_type index, size_type count,
-				     const CharT *s, size_type count2)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::replace(size_type index,
+						  size_type count,
+						  const CharT *s,
+						  size_type count2)
 {
 	if (index > size())
 		throw std::out_of_range("Index out of range.");
@@ -2784,10 +2836,11 @@ basic_string<CharT, Traits>::replace(size_type index, size_type count,
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::replace(size_type index, size_type count,
-				     const CharT *s)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::replace(size_type index,
+						  size_type count,
+						  const CharT *s)
 {
 	return replace(index, count, s, traits_type::length(s));
 }
@@ -2815,10 +2868,11 @@ basic_string<CharT, Traits>::replace(size_type index, size_type count,
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::replace(size_type index, size_type count,
-				     size_type count2, CharT ch)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::replace(size_type index,
+						  size_type count,
+						  size_type count2, CharT ch)
 {
 	if (index > size())
 		throw std::out_of_range("Index out of range.");
@@ -2851,10 +2905,11 @@ basic_string<CharT, Traits>::replace(size_type index, size_type count,
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::replace(const_iterator first, const_iterator last,
-				     size_type count2, CharT ch)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::replace(const_iterator first,
+						  const_iterator last,
+						  size_type count2, CharT ch)
 {
 	auto sz = size();
 	auto index = static_cast<size_type>(std::distance(cbegin(), first));
@@ -2922,10 +2977,11 @@ basic_string<CharT, Traits>::replace(const_iterator first, const_iterator last,
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::replace(const_iterator first, const_iterator last,
-				     const CharT *s)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::replace(const_iterator first,
+						  const_iterator last,
+						  const CharT *s)
 {
 	return replace(first, last, s, traits_type::length(s));
 }
@@ -2952,10 +3008,11 @@ basic_string<CharT, Traits>::replace(const_iterator first, const_iterator last,
  * @throw pmem::transaction_free_error when freeing old underlying array failed.
  * @throw rethrows constructor's exception.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::replace(const_iterator first, const_iterator last,
-				     std::initializer_list<CharT> ilist)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::replace(
+	const_iterator first, const_iterator last,
+	std::initializer_list<CharT> ilist)
 {
 	return replace(first, last, ilist.begin(), ilist.end());
 }
@@ -2973,10 +3030,10 @@ basic_string<CharT, Traits>::replace(const_iterator first, const_iterator last,
  *
  * @throw std::out_of_range if index > size().
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::copy(CharT *s, size_type count,
-				  size_type index) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::copy(CharT *s, size_type count,
+					       size_type index) const
 {
 	auto sz = size();
 
@@ -3007,10 +3064,12 @@ basic_string<CharT, Traits>::copy(CharT *s, size_type count,
  *
  * @throw std::out_of_range is pos > size()
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 int
-basic_string<CharT, Traits>::compare(size_type pos, size_type count1,
-				     const CharT *s, size_type count2) const
+basic_string<CharT, Traits, InlineBytes>::compare(size_type pos,
+						  size_type count1,
+						  const CharT *s,
+						  size_type count2) const
 {
 	if (pos > size())
 		throw std::out_of_range("Index out of range.");
@@ -3041,10 +3100,10 @@ basic_string<CharT, Traits>::compare(size_type pos, size_type count1,
  * @return Position of the first character of the found substring or
  * npos if no such substring is found.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find(const basic_string &str, size_type pos) const
-	noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find(const basic_string &str,
+					       size_type pos) const noexcept
 {
 	return find(str.data(), pos, str.size());
 }
@@ -3060,10 +3119,10 @@ basic_string<CharT, Traits>::find(const basic_string &str, size_type pos) const
  * @return Position of the first character of the found substring or
  * npos if no such substring is found.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find(const CharT *s, size_type pos,
-				  size_type count) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find(const CharT *s, size_type pos,
+					       size_type count) const
 {
 	return operator basic_string_view<CharT, Traits>().find(s, pos, count);
 }
@@ -3078,9 +3137,10 @@ basic_string<CharT, Traits>::find(const CharT *s, size_type pos,
  * @return Position of the first character of the found substring or
  * npos if no such substring is found.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find(const CharT *s, size_type pos) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find(const CharT *s,
+					       size_type pos) const
 {
 	return find(s, pos, traits_type::length(s));
 }
@@ -3094,9 +3154,10 @@ basic_string<CharT, Traits>::find(const CharT *s, size_type pos) const
  * @return Position of the first character equal to ch, or npos if no such
  * character is found.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find(CharT ch, size_type pos) const noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find(CharT ch,
+					       size_type pos) const noexcept
 {
 	return find(&ch, pos, 1);
 }
@@ -3111,10 +3172,10 @@ basic_string<CharT, Traits>::find(CharT ch, size_type pos) const noexcept
  * @return Position (as an offset from the start of the string) of the first
  * character of the found substring or npos if no such substring is found
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::rfind(const basic_string &str, size_type pos) const
-	noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::rfind(const basic_string &str,
+						size_type pos) const noexcept
 {
 	return rfind(str.cdata(), pos, str.size());
 }
@@ -3135,10 +3196,10 @@ basic_string<CharT, Traits>::rfind(const basic_string &str, size_type pos) const
  * searching for an empty string returns pos unless pos > size(), in which
  * case returns size().
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::rfind(const CharT *s, size_type pos,
-				   size_type count) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::rfind(const CharT *s, size_type pos,
+						size_type count) const
 {
 	return operator basic_string_view<CharT, Traits>().rfind(s, pos, count);
 }
@@ -3155,9 +3216,10 @@ basic_string<CharT, Traits>::rfind(const CharT *s, size_type pos,
  * @return Position (as an offset from the start of the string) of the first
  * character of the found substring or npos if no such substring is found
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::rfind(const CharT *s, size_type pos) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::rfind(const CharT *s,
+						size_type pos) const
 {
 	return rfind(s, pos, traits_type::length(s));
 }
@@ -3173,9 +3235,10 @@ basic_string<CharT, Traits>::rfind(const CharT *s, size_type pos) const
  * @return Position (as an offset from the start of the string) of the first
  * character equal to ch or npos if no such character is found
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::rfind(CharT ch, size_type pos) const noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::rfind(CharT ch,
+						size_type pos) const noexcept
 {
 	return rfind(&ch, pos, 1);
 }
@@ -3189,10 +3252,10 @@ basic_string<CharT, Traits>::rfind(CharT ch, size_type pos) const noexcept
  * @return The position of the first character that matches.
  * If no matches are found, the function returns npos.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find_first_of(const basic_string &str,
-					   size_type pos) const noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find_first_of(
+	const basic_string &str, size_type pos) const noexcept
 {
 	return find_first_of(str.cdata(), pos, str.size());
 }
@@ -3210,10 +3273,11 @@ basic_string<CharT, Traits>::find_first_of(const basic_string &str,
  * @return The position of the first character that matches.
  * If no matches are found, the function returns npos.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find_first_of(const CharT *s, size_type pos,
-					   size_type count) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find_first_of(const CharT *s,
+							size_type pos,
+							size_type count) const
 {
 	return operator basic_string_view<CharT, Traits>().find_first_of(s, pos,
 									 count);
@@ -3231,9 +3295,10 @@ basic_string<CharT, Traits>::find_first_of(const CharT *s, size_type pos,
  * @return The position of the first character that matches.
  * If no matches are found, the function returns npos.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find_first_of(const CharT *s, size_type pos) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find_first_of(const CharT *s,
+							size_type pos) const
 {
 	return find_first_of(s, pos, traits_type::length(s));
 }
@@ -3247,10 +3312,10 @@ basic_string<CharT, Traits>::find_first_of(const CharT *s, size_type pos) const
  * @return The position of the first character that matches.
  * If no matches are found, the function returns npos.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find_first_of(CharT ch, size_type pos) const
-	noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find_first_of(
+	CharT ch, size_type pos) const noexcept
 {
 	return find(ch, pos);
 }
@@ -3264,10 +3329,10 @@ basic_string<CharT, Traits>::find_first_of(CharT ch, size_type pos) const
  * @return The position of the first character that does not match.
  * If no such characters are found, the function returns npos.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find_first_not_of(const basic_string &str,
-					       size_type pos) const noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find_first_not_of(
+	const basic_string &str, size_type pos) const noexcept
 {
 	return find_first_not_of(str.cdata(), pos, str.size());
 }
@@ -3285,10 +3350,10 @@ basic_string<CharT, Traits>::find_first_not_of(const basic_string &str,
  * @return The position of the first character that does not match.
  * If no such characters are found, the function returns npos.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find_first_not_of(const CharT *s, size_type pos,
-					       size_type count) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find_first_not_of(
+	const CharT *s, size_type pos, size_type count) const
 {
 	return operator basic_string_view<CharT, Traits>().find_first_not_of(
 		s, pos, count);
@@ -3306,10 +3371,10 @@ basic_string<CharT, Traits>::find_first_not_of(const CharT *s, size_type pos,
  * @return The position of the first character that does not match.
  * If no such characters are found, the function returns npos.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find_first_not_of(const CharT *s,
-					       size_type pos) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find_first_not_of(const CharT *s,
+							    size_type pos) const
 {
 	return find_first_not_of(s, pos, traits_type::length(s));
 }
@@ -3323,10 +3388,10 @@ basic_string<CharT, Traits>::find_first_not_of(const CharT *s,
  * @return The position of the first character that does not match.
  * If no such characters are found, the function returns npos.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find_first_not_of(CharT ch, size_type pos) const
-	noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find_first_not_of(
+	CharT ch, size_type pos) const noexcept
 {
 	return find_first_not_of(&ch, pos, 1);
 }
@@ -3340,10 +3405,10 @@ basic_string<CharT, Traits>::find_first_not_of(CharT ch, size_type pos) const
  * @return The position of the last character that matches.
  * If no matches are found, the function returns npos.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find_last_of(const basic_string &str,
-					  size_type pos) const noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find_last_of(
+	const basic_string &str, size_type pos) const noexcept
 {
 	return find_last_of(str.cdata(), pos, str.size());
 }
@@ -3361,10 +3426,11 @@ basic_string<CharT, Traits>::find_last_of(const basic_string &str,
  * @return The position of the last character that matches.
  * If no matches are found, the function returns npos.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find_last_of(const CharT *s, size_type pos,
-					  size_type count) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find_last_of(const CharT *s,
+						       size_type pos,
+						       size_type count) const
 {
 	return operator basic_string_view<CharT, Traits>().find_last_of(s, pos,
 									count);
@@ -3382,9 +3448,10 @@ basic_string<CharT, Traits>::find_last_of(const CharT *s, size_type pos,
  * @return The position of the last character that matches.
  * If no matches are found, the function returns npos.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find_last_of(const CharT *s, size_type pos) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find_last_of(const CharT *s,
+						       size_type pos) const
 {
 	return find_last_of(s, pos, traits_type::length(s));
 }
@@ -3398,10 +3465,10 @@ basic_string<CharT, Traits>::find_last_of(const CharT *s, size_type pos) const
  * @return The position of the last character that matches.
  * If no matches are found, the function returns npos.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find_last_of(CharT ch, size_type pos) const
-	noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find_last_of(
+	CharT ch, size_type pos) const noexcept
 {
 	return rfind(ch, pos);
 }
@@ -3415,10 +3482,10 @@ basic_string<CharT, Traits>::find_last_of(CharT ch, size_type pos) const
  * @return The position of the first character that does not match.
  * If no such characters are found, the function returns npos.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find_last_not_of(const basic_string &str,
-					      size_type pos) const noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find_last_not_of(
+	const basic_string &str, size_type pos) const noexcept
 {
 	return find_last_not_of(str.cdata(), pos, str.size());
 }
@@ -3436,10 +3503,10 @@ basic_string<CharT, Traits>::find_last_not_of(const basic_string &str,
  * @return The position of the first character that does not match.
  * If no such characters are found, the function returns npos.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find_last_not_of(const CharT *s, size_type pos,
-					      size_type count) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find_last_not_of(
+	const CharT *s, size_type pos, size_type count) const
 {
 	return operator basic_string_view<CharT, Traits>().find_last_not_of(
 		s, pos, count);
@@ -3457,10 +3524,10 @@ basic_string<CharT, Traits>::find_last_not_of(const CharT *s, size_type pos,
  * @return Position of the first character not equal to any of the characters
  * in the given string, or npos if no such character is found.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find_last_not_of(const CharT *s,
-					      size_type pos) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find_last_not_of(const CharT *s,
+							   size_type pos) const
 {
 	return find_last_not_of(s, pos, traits_type::length(s));
 }
@@ -3474,10 +3541,10 @@ basic_string<CharT, Traits>::find_last_not_of(const CharT *s,
  * @return The position of the first character that does not match.
  * If no such characters are found, the function returns npos.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::find_last_not_of(CharT ch, size_type pos) const
-	noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::find_last_not_of(
+	CharT ch, size_type pos) const noexcept
 {
 	return find_last_not_of(&ch, pos, 1);
 }
@@ -3490,9 +3557,10 @@ basic_string<CharT, Traits>::find_last_not_of(CharT ch, size_type pos) const
  * @return negative value if *this < other in lexicographical order,
  * zero if *this == other and positive value if *this > other.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 int
-basic_string<CharT, Traits>::compare(const basic_string &other) const
+basic_string<CharT, Traits, InlineBytes>::compare(
+	const basic_string &other) const
 {
 	return compare(0, size(), other.cdata(), other.size());
 }
@@ -3505,9 +3573,9 @@ basic_string<CharT, Traits>::compare(const basic_string &other) const
  * @return negative value if *this < other in lexicographical order,
  * zero if *this == other and positive value if *this > other.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 int
-basic_string<CharT, Traits>::compare(
+basic_string<CharT, Traits, InlineBytes>::compare(
 	const std::basic_string<CharT> &other) const
 {
 	return compare(0, size(), other.data(), other.size());
@@ -3526,10 +3594,10 @@ basic_string<CharT, Traits>::compare(
  *
  * @throw std::out_of_range is pos > size()
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 int
-basic_string<CharT, Traits>::compare(size_type pos, size_type count,
-				     const basic_string &other) const
+basic_string<CharT, Traits, InlineBytes>::compare(
+	size_type pos, size_type count, const basic_string &other) const
 {
 	return compare(pos, count, other.cdata(), other.size());
 }
@@ -3548,9 +3616,9 @@ basic_string<CharT, Traits>::compare(size_type pos, size_type count,
  *
  * @throw std::out_of_range is pos > size()
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 int
-basic_string<CharT, Traits>::compare(
+basic_string<CharT, Traits, InlineBytes>::compare(
 	size_type pos, size_type count,
 	const std::basic_string<CharT> &other) const
 {
@@ -3575,11 +3643,13 @@ basic_string<CharT, Traits>::compare(
  *
  * @throw std::out_of_range is pos1 > size() or pos2 > other.size()
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 int
-basic_string<CharT, Traits>::compare(size_type pos1, size_type count1,
-				     const basic_string &other, size_type pos2,
-				     size_type count2) const
+basic_string<CharT, Traits, InlineBytes>::compare(size_type pos1,
+						  size_type count1,
+						  const basic_string &other,
+						  size_type pos2,
+						  size_type count2) const
 {
 	if (pos2 > other.size())
 		throw std::out_of_range("Index out of range.");
@@ -3608,11 +3678,11 @@ basic_string<CharT, Traits>::compare(size_type pos1, size_type count1,
  *
  * @throw std::out_of_range is pos1 > size() or pos2 > other.size()
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 int
-basic_string<CharT, Traits>::compare(size_type pos1, size_type count1,
-				     const std::basic_string<CharT> &other,
-				     size_type pos2, size_type count2) const
+basic_string<CharT, Traits, InlineBytes>::compare(
+	size_type pos1, size_type count1, const std::basic_string<CharT> &other,
+	size_type pos2, size_type count2) const
 {
 	if (pos2 > other.size())
 		throw std::out_of_range("Index out of range.");
@@ -3631,9 +3701,9 @@ basic_string<CharT, Traits>::compare(size_type pos1, size_type count1,
  * @return negative value if *this < s in lexicographical order,
  * zero if *this == s and positive value if *this > s.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 int
-basic_string<CharT, Traits>::compare(const CharT *s) const
+basic_string<CharT, Traits, InlineBytes>::compare(const CharT *s) const
 {
 	return compare(0, size(), s, traits_type::length(s));
 }
@@ -3651,10 +3721,11 @@ basic_string<CharT, Traits>::compare(const CharT *s) const
  *
  * @throw std::out_of_range is pos > size()
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 int
-basic_string<CharT, Traits>::compare(size_type pos, size_type count,
-				     const CharT *s) const
+basic_string<CharT, Traits, InlineBytes>::compare(size_type pos,
+						  size_type count,
+						  const CharT *s) const
 {
 	return compare(pos, count, s, traits_type::length(s));
 }
@@ -3662,9 +3733,9 @@ basic_string<CharT, Traits>::compare(size_type pos, size_type count,
 /**
  * @return const pointer to underlying data.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 const CharT *
-basic_string<CharT, Traits>::cdata() const noexcept
+basic_string<CharT, Traits, InlineBytes>::cdata() const noexcept
 {
 	return is_sso_used() ? sso_data().cdata() : non_sso_data().cdata();
 }
@@ -3672,9 +3743,9 @@ basic_string<CharT, Traits>::cdata() const noexcept
 /**
  * @return pointer to underlying data.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 const CharT *
-basic_string<CharT, Traits>::data() const noexcept
+basic_string<CharT, Traits, InlineBytes>::data() const noexcept
 {
 	return cdata();
 }
@@ -3682,9 +3753,9 @@ basic_string<CharT, Traits>::data() const noexcept
 /**
  * @return pointer to underlying data.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 const CharT *
-basic_string<CharT, Traits>::c_str() const noexcept
+basic_string<CharT, Traits, InlineBytes>::c_str() const noexcept
 {
 	return cdata();
 }
@@ -3692,9 +3763,9 @@ basic_string<CharT, Traits>::c_str() const noexcept
 /**
  * @return number of CharT elements in the string.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::length() const noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::length() const noexcept
 {
 	return size();
 }
@@ -3702,9 +3773,9 @@ basic_string<CharT, Traits>::length() const noexcept
 /**
  * @return maximum number of elements the string is able to hold.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::max_size() const noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::max_size() const noexcept
 {
 	return PMEMOBJ_MAX_ALLOC_SIZE / sizeof(CharT) - 1;
 }
@@ -3713,9 +3784,9 @@ basic_string<CharT, Traits>::max_size() const noexcept
  * @return number of characters that can be held in currently allocated
  * storage.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::capacity() const noexcept
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::capacity() const noexcept
 {
 	return is_sso_used() ? sso_capacity : non_sso_data().capacity() - 1;
 }
@@ -3739,9 +3810,9 @@ basic_string<CharT, Traits>::capacity() const noexcept
  * @throw pmem::transaction_free_error when freeing old underlying array
  * failed.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::resize(size_type count, CharT ch)
+basic_string<CharT, Traits, InlineBytes>::resize(size_type count, CharT ch)
 {
 	if (count > max_size())
 		throw std::length_error("Count exceeds max size.");
@@ -3781,9 +3852,9 @@ basic_string<CharT, Traits>::resize(size_type count, CharT ch)
  * @throw pmem::transaction_free_error when freeing old underlying array
  * failed.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::resize(size_type count)
+basic_string<CharT, Traits, InlineBytes>::resize(size_type count)
 {
 	resize(count, CharT());
 }
@@ -3808,9 +3879,9 @@ basic_string<CharT, Traits>::resize(size_type count)
  * @throw pmem::transaction_free_error when freeing old underlying array
  * failed.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::reserve(size_type new_cap)
+basic_string<CharT, Traits, InlineBytes>::reserve(size_type new_cap)
 {
 	if (new_cap > max_size())
 		throw std::length_error("New capacity exceeds max size.");
@@ -3840,9 +3911,9 @@ basic_string<CharT, Traits>::reserve(size_type new_cap)
  * @throw rethrows constructor's exception.
  * @throw rethrows destructor exception.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::shrink_to_fit()
+basic_string<CharT, Traits, InlineBytes>::shrink_to_fit()
 {
 	if (is_sso_used())
 		return;
@@ -3865,9 +3936,9 @@ basic_string<CharT, Traits>::shrink_to_fit()
  * @throw pmem::transaction_error when snapshotting failed.
  * @throw rethrows destructor exception.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::clear()
+basic_string<CharT, Traits, InlineBytes>::clear()
 {
 	erase(begin(), end());
 }
@@ -3884,9 +3955,9 @@ basic_string<CharT, Traits>::clear()
  * @throw pmem::transaction_free_error when freeing of underlying structure
  * failed.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::free_data()
+basic_string<CharT, Traits, InlineBytes>::free_data()
 {
 	auto pop = get_pool();
 
@@ -3906,23 +3977,23 @@ basic_string<CharT, Traits>::free_data()
 /**
  * @return true if string is empty, false otherwise.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 bool
-basic_string<CharT, Traits>::empty() const noexcept
+basic_string<CharT, Traits, InlineBytes>::empty() const noexcept
 {
 	return size() == 0;
 }
 
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 bool
-basic_string<CharT, Traits>::is_sso_used() const
+basic_string<CharT, Traits, InlineBytes>::is_sso_used() const
 {
 	return (sso._size & _sso_mask) != 0;
 }
 
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::destroy_data()
+basic_string<CharT, Traits, InlineBytes>::destroy_data()
 {
 	assert(pmemobj_tx_stage() == TX_STAGE_WORK);
 
@@ -3941,10 +4012,11 @@ basic_string<CharT, Traits>::destroy_data()
  *
  * Return std::distance(first, last) for pair of iterators.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 template <typename InputIt, typename Enable>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::get_size(InputIt first, InputIt last) const
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::get_size(InputIt first,
+						   InputIt last) const
 {
 	return static_cast<size_type>(std::distance(first, last));
 }
@@ -3955,9 +4027,10 @@ basic_string<CharT, Traits>::get_size(InputIt first, InputIt last) const
  *
  * Return count for (count, value)
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::get_size(size_type count, value_type ch) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::get_size(size_type count,
+						   value_type ch) const
 {
 	return count;
 }
@@ -3968,9 +4041,10 @@ basic_string<CharT, Traits>::get_size(size_type count, value_type ch) const
  *
  * Return size of other basic_string
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::get_size(const basic_string &other) const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::get_size(
+	const basic_string &other) const
 {
 	return other.size();
 }
@@ -3981,10 +4055,10 @@ basic_string<CharT, Traits>::get_size(const basic_string &other) const
  * - size_type count, CharT value
  * - InputIt first, InputIt last
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 template <typename... Args>
-typename basic_string<CharT, Traits>::pointer
-basic_string<CharT, Traits>::replace_content(Args &&... args)
+typename basic_string<CharT, Traits, InlineBytes>::pointer
+basic_string<CharT, Traits, InlineBytes>::replace_content(Args &&... args)
 {
 	assert(pmemobj_tx_stage() == TX_STAGE_WORK);
 
@@ -4010,10 +4084,10 @@ basic_string<CharT, Traits>::replace_content(Args &&... args)
  * @pre must be called in transaction scope.
  * @pre memory must be allocated before initialization.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 template <typename... Args>
-typename basic_string<CharT, Traits>::pointer
-basic_string<CharT, Traits>::initialize(Args &&... args)
+typename basic_string<CharT, Traits, InlineBytes>::pointer
+basic_string<CharT, Traits, InlineBytes>::initialize(Args &&... args)
 {
 	assert(pmemobj_tx_stage() == TX_STAGE_WORK);
 
@@ -4033,9 +4107,9 @@ basic_string<CharT, Traits>::initialize(Args &&... args)
  *
  * @param[in] n elements to allocate.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::allocate(size_type n)
+basic_string<CharT, Traits, InlineBytes>::allocate(size_type n)
 {
 	assert(pmemobj_tx_stage() == TX_STAGE_WORK);
 
@@ -4060,10 +4134,11 @@ basic_string<CharT, Traits>::allocate(size_type n)
 /**
  * Initialize sso data. Overload for pair of iterators
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 template <typename InputIt, typename Enable>
-typename basic_string<CharT, Traits>::pointer
-basic_string<CharT, Traits>::assign_sso_data(InputIt first, InputIt last)
+typename basic_string<CharT, Traits, InlineBytes>::pointer
+basic_string<CharT, Traits, InlineBytes>::assign_sso_data(InputIt first,
+							  InputIt last)
 {
 	auto size = static_cast<size_type>(std::distance(first, last));
 
@@ -4083,9 +4158,10 @@ basic_string<CharT, Traits>::assign_sso_data(InputIt first, InputIt last)
 /**
  * Initialize sso data. Overload for (count, value).
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::pointer
-basic_string<CharT, Traits>::assign_sso_data(size_type count, value_type ch)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::pointer
+basic_string<CharT, Traits, InlineBytes>::assign_sso_data(size_type count,
+							  value_type ch)
 {
 	assert(pmemobj_tx_stage() == TX_STAGE_WORK);
 	assert(count <= sso_capacity);
@@ -4104,10 +4180,11 @@ basic_string<CharT, Traits>::assign_sso_data(size_type count, value_type ch)
  * Initialize non_sso.data - call constructor of non_sso.data.
  * Overload for pair of iterators.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 template <typename InputIt, typename Enable>
-typename basic_string<CharT, Traits>::pointer
-basic_string<CharT, Traits>::assign_large_data(InputIt first, InputIt last)
+typename basic_string<CharT, Traits, InlineBytes>::pointer
+basic_string<CharT, Traits, InlineBytes>::assign_large_data(InputIt first,
+							    InputIt last)
 {
 	assert(pmemobj_tx_stage() == TX_STAGE_WORK);
 
@@ -4124,9 +4201,10 @@ basic_string<CharT, Traits>::assign_large_data(InputIt first, InputIt last)
  * Initialize non_sso.data - call constructor of non_sso.data.
  * Overload for (count, value).
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::pointer
-basic_string<CharT, Traits>::assign_large_data(size_type count, value_type ch)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::pointer
+basic_string<CharT, Traits, InlineBytes>::assign_large_data(size_type count,
+							    value_type ch)
 {
 	assert(pmemobj_tx_stage() == TX_STAGE_WORK);
 
@@ -4141,9 +4219,9 @@ basic_string<CharT, Traits>::assign_large_data(size_type count, value_type ch)
  * Move initialize for basic_string. Expects data is not
  * initialized.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::pointer
-basic_string<CharT, Traits>::move_data(basic_string &&other)
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::pointer
+basic_string<CharT, Traits, InlineBytes>::move_data(basic_string &&other)
 {
 	assert(pmemobj_tx_stage() == TX_STAGE_WORK);
 
@@ -4173,9 +4251,9 @@ basic_string<CharT, Traits>::move_data(basic_string &&other)
 /**
  * Swap the content of persistent strings.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::swap(basic_string &other)
+basic_string<CharT, Traits, InlineBytes>::swap(basic_string &other)
 {
 	pool_base pb = get_pool();
 	flat_transaction::run(pb, [&] {
@@ -4205,8 +4283,9 @@ basic_string<CharT, Traits>::swap(basic_string &other)
 /**
  * Return new view from this string object.
  */
-template <typename CharT, typename Traits>
-basic_string<CharT, Traits>::operator basic_string_view<CharT, Traits>() const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+basic_string<CharT, Traits,
+	     InlineBytes>::operator basic_string_view<CharT, Traits>() const
 {
 	return basic_string_view<CharT, Traits>(cdata(), length());
 }
@@ -4214,9 +4293,9 @@ basic_string<CharT, Traits>::operator basic_string_view<CharT, Traits>() const
 /**
  * Return pool_base instance and assert that object is on pmem.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 pool_base
-basic_string<CharT, Traits>::get_pool() const
+basic_string<CharT, Traits, InlineBytes>::get_pool() const
 {
 	return pmem::obj::pool_by_vptr(this);
 }
@@ -4224,9 +4303,9 @@ basic_string<CharT, Traits>::get_pool() const
 /**
  * @throw pmem::pool_error if an object is not in persistent memory.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::check_pmem() const
+basic_string<CharT, Traits, InlineBytes>::check_pmem() const
 {
 	if (pmemobj_pool_by_ptr(this) == nullptr)
 		throw pmem::pool_error("Object is not on pmem.");
@@ -4235,9 +4314,9 @@ basic_string<CharT, Traits>::check_pmem() const
 /**
  * @throw pmem::transaction_scope_error if called outside of a transaction.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::check_tx_stage_work() const
+basic_string<CharT, Traits, InlineBytes>::check_tx_stage_work() const
 {
 	if (pmemobj_tx_stage() != TX_STAGE_WORK)
 		throw pmem::transaction_scope_error(
@@ -4248,9 +4327,9 @@ basic_string<CharT, Traits>::check_tx_stage_work() const
  * @throw pmem::pool_error if an object is not in persistent memory.
  * @throw pmem::transaction_scope_error if called outside of a transaction.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::check_pmem_tx() const
+basic_string<CharT, Traits, InlineBytes>::check_pmem_tx() const
 {
 	check_pmem();
 	check_tx_stage_work();
@@ -4259,10 +4338,10 @@ basic_string<CharT, Traits>::check_pmem_tx() const
 /**
  * Snapshot sso data.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::add_sso_to_tx(size_type idx_first,
-					   size_type num) const
+basic_string<CharT, Traits, InlineBytes>::add_sso_to_tx(size_type idx_first,
+							size_type num) const
 {
 	assert(idx_first + num <= sso_capacity + 1);
 	assert(is_sso_used());
@@ -4284,9 +4363,9 @@ basic_string<CharT, Traits>::add_sso_to_tx(size_type idx_first,
 /**
  * Return size of sso string.
  */
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::size_type
-basic_string<CharT, Traits>::get_sso_size() const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::size_type
+basic_string<CharT, Traits, InlineBytes>::get_sso_size() const
 {
 	return sso._size & ~_sso_mask;
 }
@@ -4294,9 +4373,9 @@ basic_string<CharT, Traits>::get_sso_size() const
 /**
  * Enable sso string.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::enable_sso()
+basic_string<CharT, Traits, InlineBytes>::enable_sso()
 {
 	/* temporary size_type must be created to avoid undefined reference
 	 * linker error */
@@ -4306,9 +4385,9 @@ basic_string<CharT, Traits>::enable_sso()
 /**
  * Disable sso string.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::disable_sso()
+basic_string<CharT, Traits, InlineBytes>::disable_sso()
 {
 	sso._size &= ~_sso_mask;
 }
@@ -4316,9 +4395,9 @@ basic_string<CharT, Traits>::disable_sso()
 /**
  * Set size for sso.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::set_sso_size(size_type new_size)
+basic_string<CharT, Traits, InlineBytes>::set_sso_size(size_type new_size)
 {
 	sso._size = new_size | _sso_mask;
 }
@@ -4334,9 +4413,9 @@ basic_string<CharT, Traits>::set_sso_size(size_type new_size)
  *
  * @param[in] new_capacity capacity of constructed large string.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::sso_to_large(size_t new_capacity)
+basic_string<CharT, Traits, InlineBytes>::sso_to_large(size_t new_capacity)
 {
 	assert(pmemobj_tx_stage() == TX_STAGE_WORK);
 	assert(new_capacity > sso_capacity);
@@ -4368,9 +4447,9 @@ basic_string<CharT, Traits>::sso_to_large(size_t new_capacity)
  *
  * @post sso is used.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 void
-basic_string<CharT, Traits>::large_to_sso()
+basic_string<CharT, Traits, InlineBytes>::large_to_sso()
 {
 	assert(pmemobj_tx_stage() == TX_STAGE_WORK);
 	assert(!is_sso_used());
@@ -4394,33 +4473,33 @@ basic_string<CharT, Traits>::large_to_sso()
 	assert(is_sso_used());
 };
 
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::non_sso_type &
-basic_string<CharT, Traits>::non_sso_data()
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::non_sso_type &
+basic_string<CharT, Traits, InlineBytes>::non_sso_data()
 {
 	assert(!is_sso_used());
 	return non_sso._data;
 }
 
-template <typename CharT, typename Traits>
-typename basic_string<CharT, Traits>::sso_type &
-basic_string<CharT, Traits>::sso_data()
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+typename basic_string<CharT, Traits, InlineBytes>::sso_type &
+basic_string<CharT, Traits, InlineBytes>::sso_data()
 {
 	assert(is_sso_used());
 	return sso._data;
 }
 
-template <typename CharT, typename Traits>
-const typename basic_string<CharT, Traits>::non_sso_type &
-basic_string<CharT, Traits>::non_sso_data() const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+const typename basic_string<CharT, Traits, InlineBytes>::non_sso_type &
+basic_string<CharT, Traits, InlineBytes>::non_sso_data() const
 {
 	assert(!is_sso_used());
 	return non_sso._data;
 }
 
-template <typename CharT, typename Traits>
-const typename basic_string<CharT, Traits>::sso_type &
-basic_string<CharT, Traits>::sso_data() const
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+const typename basic_string<CharT, Traits, InlineBytes>::sso_type &
+basic_string<CharT, Traits, InlineBytes>::sso_data() const
 {
 	assert(is_sso_used());
 	return sso._data;
@@ -4430,10 +4509,10 @@ basic_string<CharT, Traits>::sso_data() const
  * Participate in overload resolution only if T is convertible to size_type.
  * Call basic_string &erase(size_type index, size_type count = npos) if enabled.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 template <typename T, typename Enable>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::erase(T param)
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::erase(T param)
 {
 	return erase(static_cast<size_type>(param));
 }
@@ -4442,10 +4521,10 @@ basic_string<CharT, Traits>::erase(T param)
  * Participate in overload resolution only if T is not convertible to size_type.
  * Call iterator erase(const_iterator pos) if enabled.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 template <typename T, typename Enable>
-typename basic_string<CharT, Traits>::iterator
-basic_string<CharT, Traits>::erase(T param)
+typename basic_string<CharT, Traits, InlineBytes>::iterator
+basic_string<CharT, Traits, InlineBytes>::erase(T param)
 {
 	return erase(static_cast<const_iterator>(param));
 }
@@ -4455,10 +4534,11 @@ basic_string<CharT, Traits>::erase(T param)
  * Call basic_string &insert(size_type index, size_type count, CharT ch) if
  * enabled.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 template <typename T, typename Enable>
-basic_string<CharT, Traits> &
-basic_string<CharT, Traits>::insert(T param, size_type count, CharT ch)
+basic_string<CharT, Traits, InlineBytes> &
+basic_string<CharT, Traits, InlineBytes>::insert(T param, size_type count,
+						 CharT ch)
 {
 	return insert(static_cast<size_type>(param), count, ch);
 }
@@ -4468,10 +4548,11 @@ basic_string<CharT, Traits>::insert(T param, size_type count, CharT ch)
  * Call iterator insert(const_iterator pos, size_type count, CharT ch) if
  * enabled.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, std::size_t InlineBytes>
 template <typename T, typename Enable>
-typename basic_string<CharT, Traits>::iterator
-basic_string<CharT, Traits>::insert(T param, size_type count, CharT ch)
+typename basic_string<CharT, Traits, InlineBytes>::iterator
+basic_string<CharT, Traits, InlineBytes>::insert(T param, size_type count,
+						 CharT ch)
 {
 	return insert(static_cast<const_iterator>(param), count, ch);
 }
@@ -4480,10 +4561,10 @@ basic_string<CharT, Traits>::insert(T param, size_type count, CharT ch)
  * Non-member equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator==(const basic_string<CharT, Traits> &lhs,
-	   const basic_string<CharT, Traits> &rhs)
+operator==(const basic_string<CharT, Traits, InlineBytes> &lhs,
+	   const basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return lhs.compare(rhs) == 0;
 }
@@ -4492,10 +4573,10 @@ operator==(const basic_string<CharT, Traits> &lhs,
  * Non-member not equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator!=(const basic_string<CharT, Traits> &lhs,
-	   const basic_string<CharT, Traits> &rhs)
+operator!=(const basic_string<CharT, Traits, InlineBytes> &lhs,
+	   const basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return lhs.compare(rhs) != 0;
 }
@@ -4504,10 +4585,10 @@ operator!=(const basic_string<CharT, Traits> &lhs,
  * Non-member less than operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator<(const basic_string<CharT, Traits> &lhs,
-	  const basic_string<CharT, Traits> &rhs)
+operator<(const basic_string<CharT, Traits, InlineBytes> &lhs,
+	  const basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return lhs.compare(rhs) < 0;
 }
@@ -4516,10 +4597,10 @@ operator<(const basic_string<CharT, Traits> &lhs,
  * Non-member less or equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator<=(const basic_string<CharT, Traits> &lhs,
-	   const basic_string<CharT, Traits> &rhs)
+operator<=(const basic_string<CharT, Traits, InlineBytes> &lhs,
+	   const basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return lhs.compare(rhs) <= 0;
 }
@@ -4528,10 +4609,10 @@ operator<=(const basic_string<CharT, Traits> &lhs,
  * Non-member greater than operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator>(const basic_string<CharT, Traits> &lhs,
-	  const basic_string<CharT, Traits> &rhs)
+operator>(const basic_string<CharT, Traits, InlineBytes> &lhs,
+	  const basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return lhs.compare(rhs) > 0;
 }
@@ -4540,10 +4621,10 @@ operator>(const basic_string<CharT, Traits> &lhs,
  * Non-member greater or equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator>=(const basic_string<CharT, Traits> &lhs,
-	   const basic_string<CharT, Traits> &rhs)
+operator>=(const basic_string<CharT, Traits, InlineBytes> &lhs,
+	   const basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return lhs.compare(rhs) >= 0;
 }
@@ -4552,9 +4633,10 @@ operator>=(const basic_string<CharT, Traits> &lhs,
  * Non-member equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator==(const CharT *lhs, const basic_string<CharT, Traits> &rhs)
+operator==(const CharT *lhs,
+	   const basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return rhs.compare(lhs) == 0;
 }
@@ -4563,9 +4645,10 @@ operator==(const CharT *lhs, const basic_string<CharT, Traits> &rhs)
  * Non-member not equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator!=(const CharT *lhs, const basic_string<CharT, Traits> &rhs)
+operator!=(const CharT *lhs,
+	   const basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return rhs.compare(lhs) != 0;
 }
@@ -4574,9 +4657,9 @@ operator!=(const CharT *lhs, const basic_string<CharT, Traits> &rhs)
  * Non-member less than operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator<(const CharT *lhs, const basic_string<CharT, Traits> &rhs)
+operator<(const CharT *lhs, const basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return rhs.compare(lhs) > 0;
 }
@@ -4585,9 +4668,10 @@ operator<(const CharT *lhs, const basic_string<CharT, Traits> &rhs)
  * Non-member less or equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator<=(const CharT *lhs, const basic_string<CharT, Traits> &rhs)
+operator<=(const CharT *lhs,
+	   const basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return rhs.compare(lhs) >= 0;
 }
@@ -4596,9 +4680,9 @@ operator<=(const CharT *lhs, const basic_string<CharT, Traits> &rhs)
  * Non-member greater than operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator>(const CharT *lhs, const basic_string<CharT, Traits> &rhs)
+operator>(const CharT *lhs, const basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return rhs.compare(lhs) < 0;
 }
@@ -4607,9 +4691,10 @@ operator>(const CharT *lhs, const basic_string<CharT, Traits> &rhs)
  * Non-member greater or equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator>=(const CharT *lhs, const basic_string<CharT, Traits> &rhs)
+operator>=(const CharT *lhs,
+	   const basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return rhs.compare(lhs) <= 0;
 }
@@ -4618,9 +4703,10 @@ operator>=(const CharT *lhs, const basic_string<CharT, Traits> &rhs)
  * Non-member equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator==(const basic_string<CharT, Traits> &lhs, const CharT *rhs)
+operator==(const basic_string<CharT, Traits, InlineBytes> &lhs,
+	   const CharT *rhs)
 {
 	return lhs.compare(rhs) == 0;
 }
@@ -4629,9 +4715,10 @@ operator==(const basic_string<CharT, Traits> &lhs, const CharT *rhs)
  * Non-member not equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator!=(const basic_string<CharT, Traits> &lhs, const CharT *rhs)
+operator!=(const basic_string<CharT, Traits, InlineBytes> &lhs,
+	   const CharT *rhs)
 {
 	return lhs.compare(rhs) != 0;
 }
@@ -4640,9 +4727,9 @@ operator!=(const basic_string<CharT, Traits> &lhs, const CharT *rhs)
  * Non-member less than operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator<(const basic_string<CharT, Traits> &lhs, const CharT *rhs)
+operator<(const basic_string<CharT, Traits, InlineBytes> &lhs, const CharT *rhs)
 {
 	return lhs.compare(rhs) < 0;
 }
@@ -4651,9 +4738,10 @@ operator<(const basic_string<CharT, Traits> &lhs, const CharT *rhs)
  * Non-member less or equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator<=(const basic_string<CharT, Traits> &lhs, const CharT *rhs)
+operator<=(const basic_string<CharT, Traits, InlineBytes> &lhs,
+	   const CharT *rhs)
 {
 	return lhs.compare(rhs) <= 0;
 }
@@ -4662,9 +4750,9 @@ operator<=(const basic_string<CharT, Traits> &lhs, const CharT *rhs)
  * Non-member greater than operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator>(const basic_string<CharT, Traits> &lhs, const CharT *rhs)
+operator>(const basic_string<CharT, Traits, InlineBytes> &lhs, const CharT *rhs)
 {
 	return lhs.compare(rhs) > 0;
 }
@@ -4673,9 +4761,10 @@ operator>(const basic_string<CharT, Traits> &lhs, const CharT *rhs)
  * Non-member greater or equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator>=(const basic_string<CharT, Traits> &lhs, const CharT *rhs)
+operator>=(const basic_string<CharT, Traits, InlineBytes> &lhs,
+	   const CharT *rhs)
 {
 	return lhs.compare(rhs) >= 0;
 }
@@ -4684,10 +4773,10 @@ operator>=(const basic_string<CharT, Traits> &lhs, const CharT *rhs)
  * Non-member equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
 operator==(const std::basic_string<CharT, Traits> &lhs,
-	   const basic_string<CharT, Traits> &rhs)
+	   const basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return rhs.compare(lhs) == 0;
 }
@@ -4696,10 +4785,10 @@ operator==(const std::basic_string<CharT, Traits> &lhs,
  * Non-member not equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
 operator!=(const std::basic_string<CharT, Traits> &lhs,
-	   const basic_string<CharT, Traits> &rhs)
+	   const basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return rhs.compare(lhs) != 0;
 }
@@ -4708,10 +4797,10 @@ operator!=(const std::basic_string<CharT, Traits> &lhs,
  * Non-member less than operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
 operator<(const std::basic_string<CharT, Traits> &lhs,
-	  const basic_string<CharT, Traits> &rhs)
+	  const basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return rhs.compare(lhs) > 0;
 }
@@ -4720,10 +4809,10 @@ operator<(const std::basic_string<CharT, Traits> &lhs,
  * Non-member less or equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
 operator<=(const std::basic_string<CharT, Traits> &lhs,
-	   const basic_string<CharT, Traits> &rhs)
+	   const basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return rhs.compare(lhs) >= 0;
 }
@@ -4732,10 +4821,10 @@ operator<=(const std::basic_string<CharT, Traits> &lhs,
  * Non-member greater than operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
 operator>(const std::basic_string<CharT, Traits> &lhs,
-	  const basic_string<CharT, Traits> &rhs)
+	  const basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return rhs.compare(lhs) < 0;
 }
@@ -4744,10 +4833,10 @@ operator>(const std::basic_string<CharT, Traits> &lhs,
  * Non-member greater or equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
 operator>=(const std::basic_string<CharT, Traits> &lhs,
-	   const basic_string<CharT, Traits> &rhs)
+	   const basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return rhs.compare(lhs) <= 0;
 }
@@ -4756,9 +4845,9 @@ operator>=(const std::basic_string<CharT, Traits> &lhs,
  * Non-member equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator==(const basic_string<CharT, Traits> &lhs,
+operator==(const basic_string<CharT, Traits, InlineBytes> &lhs,
 	   const std::basic_string<CharT, Traits> &rhs)
 {
 	return lhs.compare(rhs) == 0;
@@ -4768,9 +4857,9 @@ operator==(const basic_string<CharT, Traits> &lhs,
  * Non-member not equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator!=(const basic_string<CharT, Traits> &lhs,
+operator!=(const basic_string<CharT, Traits, InlineBytes> &lhs,
 	   const std::basic_string<CharT, Traits> &rhs)
 {
 	return lhs.compare(rhs) != 0;
@@ -4780,9 +4869,9 @@ operator!=(const basic_string<CharT, Traits> &lhs,
  * Non-member less than operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator<(const basic_string<CharT, Traits> &lhs,
+operator<(const basic_string<CharT, Traits, InlineBytes> &lhs,
 	  const std::basic_string<CharT, Traits> &rhs)
 {
 	return lhs.compare(rhs) < 0;
@@ -4792,9 +4881,9 @@ operator<(const basic_string<CharT, Traits> &lhs,
  * Non-member less or equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator<=(const basic_string<CharT, Traits> &lhs,
+operator<=(const basic_string<CharT, Traits, InlineBytes> &lhs,
 	   const std::basic_string<CharT, Traits> &rhs)
 {
 	return lhs.compare(rhs) <= 0;
@@ -4804,9 +4893,9 @@ operator<=(const basic_string<CharT, Traits> &lhs,
  * Non-member greater than operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator>(const basic_string<CharT, Traits> &lhs,
+operator>(const basic_string<CharT, Traits, InlineBytes> &lhs,
 	  const std::basic_string<CharT, Traits> &rhs)
 {
 	return lhs.compare(rhs) > 0;
@@ -4816,9 +4905,9 @@ operator>(const basic_string<CharT, Traits> &lhs,
  * Non-member greater or equal operator.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 bool
-operator>=(const basic_string<CharT, Traits> &lhs,
+operator>=(const basic_string<CharT, Traits, InlineBytes> &lhs,
 	   const std::basic_string<CharT, Traits> &rhs)
 {
 	return lhs.compare(rhs) >= 0;
@@ -4828,9 +4917,10 @@ operator>=(const basic_string<CharT, Traits> &lhs,
  * Swap the content of persistent strings.
  * @relates basic_string
  */
-template <class CharT, class Traits>
+template <class CharT, class Traits, std::size_t InlineBytes>
 void
-swap(basic_string<CharT, Traits> &lhs, basic_string<CharT, Traits> &rhs)
+swap(basic_string<CharT, Traits, InlineBytes> &lhs,
+     basic_string<CharT, Traits, InlineBytes> &rhs)
 {
 	return lhs.swap(rhs);
 }
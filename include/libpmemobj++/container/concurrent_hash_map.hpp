@@ -13,6 +13,7 @@
 #include <libpmemobj++/detail/atomic_backoff.hpp>
 #include <libpmemobj++/detail/common.hpp>
 #include <libpmemobj++/detail/pair.hpp>
+#include <libpmemobj++/detail/parallel_for.hpp>
 #include <libpmemobj++/detail/template_helpers.hpp>
 
 #include <libpmemobj++/defrag.hpp>
@@ -23,6 +24,7 @@
 #include <libpmemobj++/transaction.hpp>
 
 #include <libpmemobj++/detail/persistent_pool_ptr.hpp>
+#include <libpmemobj++/detail/self_relative_pool_ptr.hpp>
 #include <libpmemobj++/shared_mutex.hpp>
 
 #include <libpmemobj++/detail/enumerable_thread_specific.hpp>
@@ -228,7 +230,8 @@ template <typename Key, typename T, typename Hash = std::hash<Key>,
 	  typename KeyEqual = std::equal_to<Key>,
 	  typename MutexType = pmem::obj::shared_mutex,
 	  typename ScopedLockType = concurrent_hash_map_internal::
-		  shared_mutex_scoped_lock<MutexType>>
+		  shared_mutex_scoped_lock<MutexType>,
+	  template <typename> class NodePointer = detail::persistent_pool_ptr>
 class concurrent_hash_map;
 
 /** @cond INTERNAL */
@@ -243,6 +246,110 @@ check_outside_tx()
 			"Function called inside transaction scope.");
 }
 
+/*
+ * Tracks the operations which access buckets using a mask loaded from a map,
+ * so that the segments which are no longer covered by the mask (after the
+ * map was shrunk) are freed only when no operation can access them.
+ *
+ * An operation increments the counter of the current epoch (one of the
+ * counters of the epoch, picked by the thread id, to avoid contention) and
+ * decrements it when it finishes. synchronize() switches the epoch and waits
+ * until the counters of the previous one drop to zero. It does that twice,
+ * because an operation which read the epoch before a switch may increment the
+ * counter of the previous epoch after it was checked.
+ *
+ * A single instance is shared by all maps.
+ */
+class mask_readers {
+	static constexpr std::size_t STRIPES = 64;
+
+	struct alignas(64) counter {
+		std::atomic<std::size_t> value;
+	};
+
+public:
+	/** Decrements the counter of an operation when it finishes */
+	class guard {
+	public:
+		explicit guard(std::atomic<std::size_t> &c) : cnt(&c)
+		{
+		}
+
+		guard(guard &&g) noexcept : cnt(g.cnt)
+		{
+			g.cnt = nullptr;
+		}
+
+		guard(const guard &) = delete;
+		guard &operator=(const guard &) = delete;
+
+		~guard()
+		{
+			if (cnt)
+				cnt->fetch_sub(1, std::memory_order_release);
+		}
+
+	private:
+		std::atomic<std::size_t> *cnt;
+	};
+
+	static mask_readers &
+	instance()
+	{
+		static mask_readers readers;
+		return readers;
+	}
+
+	/**
+	 * Registers an operation. The mask must be loaded after this call
+	 * with memory_order_seq_cst.
+	 */
+	guard
+	enter()
+	{
+		auto id = std::this_thread::get_id();
+		std::size_t stripe = std::hash<std::thread::id>{}(id) % STRIPES;
+		std::size_t e = epoch.load(std::memory_order_relaxed);
+		auto &c = counters[e][stripe].value;
+		c.fetch_add(1, std::memory_order_seq_cst);
+
+		return guard(c);
+	}
+
+	/**
+	 * Waits until all operations registered before this call finish. The
+	 * mask must be stored before this call with memory_order_seq_cst.
+	 */
+	void
+	synchronize()
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+
+		for (int i = 0; i < 2; ++i) {
+			std::size_t e = epoch.load(std::memory_order_relaxed);
+			epoch.store(e ^ 1, std::memory_order_seq_cst);
+
+			for (auto &c : counters[e]) {
+				while (c.value.load(std::memory_order_seq_cst) !=
+				       0)
+					std::this_thread::yield();
+			}
+		}
+	}
+
+private:
+	mask_readers() : epoch(0)
+	{
+		for (auto &e : counters)
+			for (auto &c : e)
+				c.value.store(0, std::memory_order_relaxed);
+	}
+
+	counter counters[2][STRIPES];
+	std::atomic<std::size_t> epoch;
+	std::mutex mtx;
+};
+
 template <typename Hash>
 using transparent_key_equal = typename Hash::transparent_key_equal;
 
@@ -273,7 +380,8 @@ assert_not_locked(Mutex &mtx)
 #endif
 }
 
-template <typename Key, typename T, typename MutexType, typename ScopedLockType>
+template <typename Key, typename T, typename MutexType, typename ScopedLockType,
+	  template <typename> class NodePointer>
 struct hash_map_node {
 	/**Mutex type. */
 	using mutex_t = MutexType;
@@ -284,8 +392,8 @@ struct hash_map_node {
 	using value_type = detail::pair<const Key, T>;
 
 	/** Persistent pointer type for next. */
-	using node_ptr_t = detail::persistent_pool_ptr<
-		hash_map_node<Key, T, mutex_t, scoped_t>>;
+	using node_ptr_t = NodePointer<
+		hash_map_node<Key, T, mutex_t, scoped_t, NodePointer>>;
 
 	/** Next node in chain. */
 	node_ptr_t next;
@@ -754,8 +862,10 @@ private:
  * Implements logic not dependent to Key/Value types.
  * MutexType - type of mutex used by buckets.
  * ScopedLockType - type of scoped lock for mutex.
+ * NodePointer - type of pointers linking nodes in buckets.
  */
-template <typename Key, typename T, typename MutexType, typename ScopedLockType>
+template <typename Key, typename T, typename MutexType, typename ScopedLockType,
+	  template <typename> class NodePointer>
 class hash_map_base {
 public:
 	using mutex_t = MutexType;
@@ -768,10 +878,10 @@ public:
 	using hashcode_type = size_t;
 
 	/** Node base type. */
-	using node = hash_map_node<Key, T, mutex_t, scoped_t>;
+	using node = hash_map_node<Key, T, mutex_t, scoped_t, NodePointer>;
 
 	/** Node base pointer. */
-	using node_ptr_t = detail::persistent_pool_ptr<node>;
+	using node_ptr_t = NodePointer<node>;
 
 	/** Bucket type. */
 	struct bucket {
@@ -856,10 +966,23 @@ public:
 		std::aligned_storage<56, 8> padding;
 	};
 
-	using tls_t = detail::enumerable_thread_specific<tls_data_t>;
+	/*
+	 * Maps with self-relative nodes have a new layout, so they can keep
+	 * entries of different threads in separate cache lines. The default
+	 * layout keeps the original tls format for compatibility.
+	 */
+	using tls_t = typename std::conditional<
+		std::is_same<node_ptr_t,
+			     detail::self_relative_pool_ptr<node>>::value,
+		detail::padded_enumerable_thread_specific<tls_data_t>,
+		detail::enumerable_thread_specific<tls_data_t>>::type;
 
 	enum feature_flags : uint32_t { FEATURE_CONSISTENT_SIZE = 1 };
 
+	enum incompat_feature_flags : uint32_t {
+		INCOMPAT_FEATURE_SELF_RELATIVE_NODES = 1
+	};
+
 	/** Compat and incompat features of a layout */
 	struct features {
 		p<uint32_t> compat;
@@ -914,8 +1037,22 @@ public:
 	 */
 	p<size_t> on_init_size;
 
+	/**
+	 * Flags used to allocate new nodes, e.g. id of an allocation class.
+	 * Ids of allocation classes and arenas are valid only until the pool
+	 * is closed, so it is always reset on restart.
+	 */
+	std::atomic<uint64_t> my_node_alloc_flags;
+
+	/**
+	 * Mask the table is being shrunk to or 0. Buckets above it are being
+	 * merged into their parents and must not be rehashed. Always reset on
+	 * restart.
+	 */
+	std::atomic<hashcode_type> my_shrink_mask;
+
 	/** Reserved for future use */
-	std::aligned_storage<40, 8>::type reserved;
+	std::aligned_storage<24, 8>::type reserved;
 
 	/** Segment mutex used to enable new segment. */
 	segment_enable_mutex_t my_segment_enable_mutex;
@@ -929,7 +1066,13 @@ public:
 	static constexpr features
 	header_features()
 	{
-		return {FEATURE_CONSISTENT_SIZE, 0};
+		return {FEATURE_CONSISTENT_SIZE,
+			std::is_same<
+				node_ptr_t,
+				detail::self_relative_pool_ptr<node>>::value
+				? static_cast<uint32_t>(
+					  INCOMPAT_FEATURE_SELF_RELATIVE_NODES)
+				: uint32_t(0)};
 	}
 
 	const std::atomic<hashcode_type> &
@@ -1000,7 +1143,7 @@ public:
 #if LIBPMEMOBJ_CPP_VG_HELGRIND_ENABLED
 		VALGRIND_HG_DISABLE_CHECKING(&my_mask, sizeof(my_mask));
 #endif
-		layout_features = {0, 0};
+		layout_features = {0, header_features().incompat};
 
 		PMEMoid oid = pmemobj_oid(this);
 
@@ -1073,6 +1216,54 @@ public:
 		mask().store(m, std::memory_order_relaxed);
 	}
 
+	/**
+	 * Reset flags used to allocate nodes on each process restart.
+	 */
+	void
+	reset_node_alloc_flags()
+	{
+#if LIBPMEMOBJ_CPP_VG_HELGRIND_ENABLED
+		VALGRIND_HG_DISABLE_CHECKING(&my_node_alloc_flags,
+					     sizeof(my_node_alloc_flags));
+#endif
+#if LIBPMEMOBJ_CPP_VG_PMEMCHECK_ENABLED
+		VALGRIND_PMC_REMOVE_PMEM_MAPPING(&my_node_alloc_flags,
+						 sizeof(my_node_alloc_flags));
+#endif
+
+		my_node_alloc_flags.store(0, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Reset the mask of an interrupted shrink on each process restart.
+	 */
+	void
+	reset_shrink_mask()
+	{
+#if LIBPMEMOBJ_CPP_VG_HELGRIND_ENABLED
+		VALGRIND_HG_DISABLE_CHECKING(&my_shrink_mask,
+					     sizeof(my_shrink_mask));
+#endif
+#if LIBPMEMOBJ_CPP_VG_PMEMCHECK_ENABLED
+		VALGRIND_PMC_REMOVE_PMEM_MAPPING(&my_shrink_mask,
+						 sizeof(my_shrink_mask));
+#endif
+
+		my_shrink_mask.store(0, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @returns true if the bucket is being merged into its parent, then
+	 * its elements are in the parent bucket and it must not be rehashed.
+	 */
+	bool
+	is_merging(hashcode_type h) const
+	{
+		hashcode_type m = my_shrink_mask.load(std::memory_order_acquire);
+
+		return m != 0 && h > m;
+	}
+
 	/**
 	 * Initialize buckets in the new segment.
 	 */
@@ -1177,7 +1368,11 @@ public:
 		ANNOTATE_HAPPENS_AFTER(&(this->my_mask));
 #endif
 
-		if (m_old != m_now)
+		/* a bucket merged by shrink_to_fit() is accessed through its
+		 * parent, so the larger mask could not miss an element */
+		if (m_now < m_old)
+			m = m_now;
+		else if (m_old != m_now)
 			return check_rehashing_collision(h, m_old, m = m_now);
 
 		return false;
@@ -1218,13 +1413,14 @@ public:
 	 */
 	template <typename Node, typename... Args>
 	void
-	insert_new_node_internal(bucket *b,
-				 detail::persistent_pool_ptr<Node> &new_node,
+	insert_new_node_internal(bucket *b, NodePointer<Node> &new_node,
 				 Args &&... args)
 	{
 		assert(pmemobj_tx_stage() == TX_STAGE_WORK);
 
 		new_node = pmem::obj::make_persistent<Node>(
+			allocation_flag(my_node_alloc_flags.load(
+				std::memory_order_relaxed)),
 			b->node_list, std::forward<Args>(args)...);
 		b->node_list = new_node; /* bucket is locked */
 	}
@@ -1235,8 +1431,7 @@ public:
 	 */
 	template <typename Node, typename... Args>
 	size_type
-	insert_new_node(bucket *b, detail::persistent_pool_ptr<Node> &new_node,
-			Args &&... args)
+	insert_new_node(bucket *b, NodePointer<Node> &new_node, Args &&... args)
 	{
 		pool_base pop = get_pool_base();
 
@@ -1322,7 +1517,8 @@ public:
 	 * @throw std::transaction_error in case of PMDK transaction failed
 	 */
 	void
-	internal_swap(hash_map_base<Key, T, mutex_t, scoped_t> &table)
+	internal_swap(
+		hash_map_base<Key, T, mutex_t, scoped_t, NodePointer> &table)
 	{
 		pool_base p = get_pool_base();
 		{
@@ -1412,7 +1608,8 @@ public:
 #if !defined(_MSC_VER) || defined(__INTEL_COMPILER)
 private:
 	template <typename Key, typename T, typename Hash, typename KeyEqual,
-		  typename MutexType, typename ScopedLockType>
+		  typename MutexType, typename ScopedLockType,
+		  template <typename> class NodePointer>
 	friend class ::pmem::obj::concurrent_hash_map;
 #else
 public: /* workaround */
@@ -1614,6 +1811,15 @@ operator!=(const hash_map_iterator<Container, M> &i,
  * improve performance if MutexType supports efficient upgrading and
  * downgrading operations.
  *
+ * NodePointer defines the type of pointers which link the nodes in buckets.
+ * By default it's detail::persistent_pool_ptr, which requires a pool lookup
+ * on every dereference. detail::self_relative_pool_ptr (see
+ * experimental::self_relative_concurrent_hash_map) computes the address from
+ * the location of the pointer itself, which makes lookups cheaper. Both types
+ * have the same size, but the layouts are not compatible - opening a map with
+ * a different NodePointer than it was created with results in
+ * pmem::layout_error being thrown by runtime_initialize().
+ *
  * @note In some cases, when testing with Valgrind, helgrind and drd might
  * report lock ordering errors. This might happen when calling find, insert or
  * erase while already holding an accessor to some element.
@@ -1627,23 +1833,26 @@ operator!=(const hash_map_iterator<Container, M> &i,
  * @ingroup containers
  */
 template <typename Key, typename T, typename Hash, typename KeyEqual,
-	  typename MutexType, typename ScopedLockType>
+	  typename MutexType, typename ScopedLockType,
+	  template <typename> class NodePointer>
 class concurrent_hash_map
-    : protected concurrent_hash_map_internal::hash_map_base<Key, T, MutexType,
-							    ScopedLockType> {
+    : protected concurrent_hash_map_internal::hash_map_base<
+	      Key, T, MutexType, ScopedLockType, NodePointer> {
 	template <typename Container, bool is_const>
 	friend class concurrent_hash_map_internal::hash_map_iterator;
 
 public:
 	using size_type = typename concurrent_hash_map_internal::hash_map_base<
-		Key, T, MutexType, ScopedLockType>::size_type;
+		Key, T, MutexType, ScopedLockType, NodePointer>::size_type;
 	using hashcode_type =
 		typename concurrent_hash_map_internal::hash_map_base<
-			Key, T, MutexType, ScopedLockType>::hashcode_type;
+			Key, T, MutexType, ScopedLockType,
+			NodePointer>::hashcode_type;
 	using key_type = Key;
 	using mapped_type = T;
 	using value_type = typename concurrent_hash_map_internal::hash_map_base<
-		Key, T, MutexType, ScopedLockType>::node::value_type;
+		Key, T, MutexType, ScopedLockType,
+		NodePointer>::node::value_type;
 	using difference_type = ptrdiff_t;
 	using pointer = value_type *;
 	using const_pointer = const value_type *;
@@ -1663,9 +1872,8 @@ protected:
 	/*
 	 * Explicitly use methods and types from template base class
 	 */
-	using hash_map_base =
-		concurrent_hash_map_internal::hash_map_base<Key, T, mutex_t,
-							    scoped_t>;
+	using hash_map_base = concurrent_hash_map_internal::hash_map_base<
+		Key, T, mutex_t, scoped_t, NodePointer>;
 	using hash_map_base::calculate_mask;
 	using hash_map_base::check_growth;
 	using hash_map_base::check_mask_race;
@@ -1679,6 +1887,8 @@ protected:
 	using hash_map_base::layout_features;
 	using hash_map_base::mask;
 	using hash_map_base::reserve;
+	using hash_map_base::reset_node_alloc_flags;
+	using hash_map_base::reset_shrink_mask;
 	using tls_t = typename hash_map_base::tls_t;
 	using node = typename hash_map_base::node;
 	using node_mutex_t = typename node::mutex_t;
@@ -1688,11 +1898,13 @@ protected:
 	using segment_index_t = typename hash_map_base::segment_index_t;
 	using segment_traits_t = typename hash_map_base::segment_traits_t;
 	using segment_facade_t = typename hash_map_base::segment_facade_t;
+	using segment_enable_mutex_t =
+		typename hash_map_base::segment_enable_mutex_t;
 	using scoped_lock_traits_type =
 		concurrent_hash_map_internal::scoped_lock_traits<scoped_t>;
 
 	friend class const_accessor;
-	using persistent_node_ptr_t = detail::persistent_pool_ptr<node>;
+	using persistent_node_ptr_t = NodePointer<node>;
 
 	void
 	delete_node(const node_ptr_t &n)
@@ -1753,26 +1965,49 @@ protected:
 
 		/**
 		 * Find a bucket by masked hashcode, optionally rehash, and
-		 * acquire the lock
+		 * acquire the lock. If the bucket is being merged into its
+		 * parent, the bucket holding its elements is locked instead.
 		 */
 		inline void
-		acquire(concurrent_hash_map *base, const hashcode_type h,
+		acquire(concurrent_hash_map *base, hashcode_type h,
 			bool writer = false)
 		{
-			my_b = base->get_bucket(h);
+			while (true) {
+				my_b = base->get_bucket(h);
 
-			if (my_b->is_rehashed(std::memory_order_acquire) ==
-				    false &&
-			    bucket_lock_type::try_acquire(this->my_b->mutex,
-							  /*write=*/true)) {
 				if (my_b->is_rehashed(
-					    std::memory_order_relaxed) ==
-				    false) {
-					/* recursive rehashing */
-					base->rehash_bucket<false>(my_b, h);
+					    std::memory_order_acquire) ==
+					    false &&
+				    bucket_lock_type::try_acquire(
+					    this->my_b->mutex,
+					    /*write=*/true)) {
+					if (my_b->is_rehashed(
+						    std::memory_order_relaxed))
+						break;
+
+					if (!base->is_merging(h)) {
+						/* recursive rehashing */
+						base->rehash_bucket<false>(my_b,
+									   h);
+						break;
+					}
+
+					/* get parent from the topmost bit */
+					bucket_lock_type::release();
+					h &= (hashcode_type(1)
+					      << detail::Log2(h)) -
+						1;
+				} else {
+					bucket_lock_type::acquire(my_b->mutex,
+								  writer);
+
+					if (my_b->is_rehashed(
+						    std::memory_order_relaxed))
+						break;
+
+					/* merged while waiting for the lock */
+					bucket_lock_type::release();
 				}
-			} else {
-				bucket_lock_type::acquire(my_b->mutex, writer);
 			}
 
 			assert(my_b->is_rehashed(std::memory_order_relaxed));
@@ -1985,8 +2220,8 @@ public:
 	 */
 	class const_accessor
 	    : protected node::scoped_t /*which derived from no_copy*/ {
-		friend class concurrent_hash_map<Key, T, Hash, KeyEqual,
-						 mutex_t, scoped_t>;
+		friend class concurrent_hash_map<
+			Key, T, Hash, KeyEqual, mutex_t, scoped_t, NodePointer>;
 		friend class accessor;
 		using node_ptr_t = pmem::obj::persistent_ptr<node>;
 		using node::scoped_t::try_acquire;
@@ -2172,6 +2407,8 @@ public:
 		check_incompat_features();
 
 		calculate_mask();
+		reset_node_alloc_flags();
+		reset_shrink_mask();
 
 		/*
 		 * Handle case where hash_map was created without
@@ -2210,6 +2447,8 @@ public:
 		check_incompat_features();
 
 		calculate_mask();
+		reset_node_alloc_flags();
+		reset_shrink_mask();
 
 		if (!graceful_shutdown) {
 			auto actual_size =
@@ -2278,6 +2517,27 @@ public:
 	 */
 	void rehash(size_type n = 0);
 
+	/**
+	 * Frees the buckets which are no longer needed after many elements
+	 * were erased. As long as the table with half of the buckets would
+	 * be at most half full, the elements of the last segment are moved
+	 * to their parent buckets and the segment is deallocated (buckets of
+	 * the first block are deallocated all at once).
+	 *
+	 * Can be called concurrently with find(), count(), insert(), erase()
+	 * and parallel_for_each(), which access the merged buckets through
+	 * their parents. The segments are freed after all these operations
+	 * which could have loaded the old mask finish, so the call waits for
+	 * them, so it must not be called while the calling thread holds an
+	 * accessor. The table does not grow during the call. Must not be
+	 * called concurrently with other methods, e.g. iteration or
+	 * defragment().
+	 *
+	 * @throw pmem::transaction_scope_error if called inside transaction
+	 * @throw pmem::transaction_error in case of PMDK transaction failure
+	 */
+	void shrink_to_fit();
+
 	/**
 	 * Clear hash map content
 	 * Not thread safe.
@@ -2416,6 +2676,45 @@ public:
 		return mask() + 1;
 	}
 
+	/**
+	 * @returns size of a single node, e.g. for registering an allocation
+	 * class which fits the nodes exactly.
+	 */
+	static constexpr size_type
+	node_allocation_size() noexcept
+	{
+		return sizeof(node);
+	}
+
+	/**
+	 * Sets flags used to allocate new nodes, e.g. to allocate them from
+	 * a custom allocation class or arena:
+	 * @code
+	 * map.set_node_allocation_flag(
+	 *	pmem::obj::allocation_flag::class_id(id) |
+	 *	pmem::obj::allocation_flag::arena_id(arena));
+	 * @endcode
+	 *
+	 * The setting is not persistent, it is reset to
+	 * allocation_flag::none() by runtime_initialize(). Not thread safe.
+	 */
+	void
+	set_node_allocation_flag(allocation_flag flag) noexcept
+	{
+		this->my_node_alloc_flags.store(flag.value,
+						std::memory_order_relaxed);
+	}
+
+	/**
+	 * @returns flags used to allocate new nodes.
+	 */
+	allocation_flag
+	node_allocation_flag() const noexcept
+	{
+		return allocation_flag(this->my_node_alloc_flags.load(
+			std::memory_order_relaxed));
+	}
+
 	/**
 	 * Swap two instances. Iterators are invalidated. Not thread safe.
 	 */
@@ -2821,6 +3120,67 @@ public:
 		return internal_erase(key);
 	}
 
+	/**
+	 * Calls f(const_reference) for each element of the map. Buckets are
+	 * split into (at most) concurrency ranges, each processed by
+	 * a separate thread.
+	 *
+	 * Each element is visited while its bucket and the element itself
+	 * are locked for reading, so insert, erase and find can be called
+	 * concurrently from other threads. Elements which are present during
+	 * the whole call are visited exactly once, unless the table grows
+	 * concurrently (then elements moved to the new buckets might not be
+	 * visited). Elements inserted or erased during the call may or may
+	 * not be visited.
+	 *
+	 * f must be thread safe and must not call methods of this map.
+	 *
+	 * @param[in] f function to be called for each element.
+	 * @param[in] concurrency number of threads.
+	 *
+	 * @throw pmem::transaction_scope_error if called inside transaction
+	 * @throw rethrows an exception thrown by f.
+	 */
+	template <typename F>
+	void
+	parallel_for_each(
+		F f,
+		size_t concurrency = std::thread::hardware_concurrency()) const
+	{
+		concurrent_hash_map_internal::check_outside_tx();
+
+		auto guard =
+			concurrent_hash_map_internal::mask_readers::instance()
+				.enter();
+		hashcode_type m = mask().load(std::memory_order_seq_cst);
+#if LIBPMEMOBJ_CPP_VG_HELGRIND_ENABLED
+		ANNOTATE_HAPPENS_AFTER(&(this->my_mask));
+#endif
+
+		/* minimal number of buckets processed by a thread */
+		const size_type chunk_size = 1024;
+		concurrency = (std::min)(concurrency, m / chunk_size + 1);
+
+		auto map = const_cast<concurrent_hash_map *>(this);
+		std::atomic<bool> failed(false);
+
+		pmem::detail::parallel_for(
+			concurrency, m + 1, [&](size_t first, size_t last) {
+				std::vector<node *> visited;
+
+				try {
+					for (hashcode_type h = first;
+					     h < last && !failed.load(); ++h)
+						map->internal_for_each(
+							h, m, f, visited);
+				} catch (...) {
+					/* stop the other threads */
+					failed.store(true);
+					throw;
+				}
+			});
+	}
+
 	/**
 	 * Defragment the given (by 'start_percent' and 'amount_percent') part
 	 * of buckets of the hash map. The algorithm is 'opportunistic' -
@@ -2925,6 +3285,73 @@ protected:
 	bool try_acquire_item(const_accessor *result, node_mutex_t &mutex,
 			      bool write);
 
+	/*
+	 * Calls f for each element of the bucket h which belongs to it for
+	 * the mask m. Elements of a child bucket which is not rehashed yet
+	 * are skipped here, they are moved to the child bucket and visited
+	 * when it is processed.
+	 */
+	template <typename F>
+	void
+	internal_for_each(hashcode_type h, hashcode_type m, F &f,
+			  std::vector<node *> &visited)
+	{
+		bucket *b = get_bucket(h);
+
+		/*
+		 * Empty buckets are skipped without locking. All elements of
+		 * a rehashed bucket are in its list, so the unlocked read can
+		 * only miss elements inserted concurrently.
+		 */
+		if (b->is_rehashed(std::memory_order_acquire) &&
+		    b->node_list == nullptr)
+			return;
+
+		visited.clear();
+
+		while (true) {
+			bucket_accessor acc(
+				this, h,
+				scoped_lock_traits_type::initial_rw_state(
+					false));
+
+			node *n = static_cast<node *>(
+				acc->node_list.get(this->my_pool_uuid));
+			for (node *next; n; n = next) {
+				next = static_cast<node *>(
+					n->next.get(this->my_pool_uuid));
+				if (next)
+					detail::prefetch(next);
+
+				if ((hasher{}(n->item.first) & m) != h)
+					continue;
+
+				/* already visited before the restart */
+				bool found = false;
+				for (auto v : visited)
+					found = found || v == n;
+				if (found)
+					continue;
+
+				const_accessor item;
+				if (!try_acquire_item(&item, n->mutex, false))
+					break;
+
+				f(static_cast<const_reference>(n->item));
+				visited.push_back(n);
+			}
+
+			if (!n)
+				return;
+
+			/* the wait takes really long, release the bucket and
+			 * restart */
+			acc.release();
+
+			std::this_thread::yield();
+		}
+	}
+
 	/**
 	 * Vector of locks to be unlocked at the destruction time.
 	 * MutexType - type of mutex used by buckets.
@@ -3003,6 +3430,8 @@ protected:
 
 	void clear_segment(segment_index_t s);
 
+	void merge_segment(segment_index_t s);
+
 	/**
 	 * Copy "source" to *this, where *this must start out empty.
 	 */
@@ -3037,12 +3466,13 @@ protected:
 }; // class concurrent_hash_map
 
 template <typename Key, typename T, typename Hash, typename KeyEqual,
-	  typename MutexType, typename ScopedLockType>
+	  typename MutexType, typename ScopedLockType,
+	  template <typename> class NodePointer>
 bool
-concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType,
-		    ScopedLockType>::try_acquire_item(const_accessor *result,
-						      node_mutex_t &mutex,
-						      bool write)
+concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType,
+		    NodePointer>::try_acquire_item(const_accessor *result,
+						   node_mutex_t &mutex,
+						   bool write)
 {
 	/* acquire the item */
 	if (!result->try_acquire(mutex, write)) {
@@ -3059,17 +3489,20 @@ concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType,
 }
 
 template <typename Key, typename T, typename Hash, typename KeyEqual,
-	  typename MutexType, typename ScopedLockType>
+	  typename MutexType, typename ScopedLockType,
+	  template <typename> class NodePointer>
 template <typename K>
 bool
-concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType,
-		    ScopedLockType>::internal_find(const K &key,
-						   const_accessor *result,
-						   bool write)
+concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType,
+		    NodePointer>::internal_find(const K &key,
+						const_accessor *result,
+						bool write)
 {
 	assert(!result || !result->my_node);
 
-	hashcode_type m = mask().load(std::memory_order_acquire);
+	auto guard = concurrent_hash_map_internal::mask_readers::instance()
+			     .enter();
+	hashcode_type m = mask().load(std::memory_order_seq_cst);
 #if LIBPMEMOBJ_CPP_VG_HELGRIND_ENABLED
 	ANNOTATE_HAPPENS_AFTER(&(this->my_mask));
 #endif
@@ -3124,18 +3557,20 @@ concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType,
 }
 
 template <typename Key, typename T, typename Hash, typename KeyEqual,
-	  typename MutexType, typename ScopedLockType>
+	  typename MutexType, typename ScopedLockType,
+	  template <typename> class NodePointer>
 template <typename K, typename... Args>
 bool
-concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType,
-		    ScopedLockType>::internal_insert(const K &key,
-						     const_accessor *result,
-						     bool write,
-						     Args &&... args)
+concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType,
+		    NodePointer>::internal_insert(const K &key,
+						  const_accessor *result,
+						  bool write, Args &&... args)
 {
 	assert(!result || !result->my_node);
 
-	hashcode_type m = mask().load(std::memory_order_acquire);
+	auto guard = concurrent_hash_map_internal::mask_readers::instance()
+			     .enter();
+	hashcode_type m = mask().load(std::memory_order_seq_cst);
 #if LIBPMEMOBJ_CPP_VG_HELGRIND_ENABLED
 	ANNOTATE_HAPPENS_AFTER(&(this->my_mask));
 #endif
@@ -3197,15 +3632,18 @@ concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType,
 }
 
 template <typename Key, typename T, typename Hash, typename KeyEqual,
-	  typename MutexType, typename ScopedLockType>
+	  typename MutexType, typename ScopedLockType,
+	  template <typename> class NodePointer>
 template <typename K>
 bool
-concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType,
-		    ScopedLockType>::internal_erase(const K &key)
+concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType,
+		    NodePointer>::internal_erase(const K &key)
 {
 	node_ptr_t n;
 	hashcode_type const h = hasher{}(key);
-	hashcode_type m = mask().load(std::memory_order_acquire);
+	auto guard = concurrent_hash_map_internal::mask_readers::instance()
+			     .enter();
+	hashcode_type m = mask().load(std::memory_order_seq_cst);
 #if LIBPMEMOBJ_CPP_VG_HELGRIND_ENABLED
 	ANNOTATE_HAPPENS_AFTER(&(this->my_mask));
 #endif
@@ -3285,19 +3723,23 @@ search:
 }
 
 template <typename Key, typename T, typename Hash, typename KeyEqual,
-	  typename MutexType, typename ScopedLockType>
+	  typename MutexType, typename ScopedLockType,
+	  template <typename> class NodePointer>
 void
-concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType>::swap(
-	concurrent_hash_map<Key, T, Hash, KeyEqual, mutex_t, scoped_t> &table)
+concurrent_hash_map<
+	Key, T, Hash, KeyEqual, MutexType, ScopedLockType,
+	NodePointer>::swap(concurrent_hash_map<Key, T, Hash, KeyEqual, mutex_t,
+					       scoped_t, NodePointer> &table)
 {
 	internal_swap(table);
 }
 
 template <typename Key, typename T, typename Hash, typename KeyEqual,
-	  typename MutexType, typename ScopedLockType>
+	  typename MutexType, typename ScopedLockType,
+	  template <typename> class NodePointer>
 void
-concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType>::rehash(
-	size_type sz)
+concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType,
+		    NodePointer>::rehash(size_type sz)
 {
 	concurrent_hash_map_internal::check_outside_tx();
 
@@ -3324,9 +3766,90 @@ concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType>::rehash(
 }
 
 template <typename Key, typename T, typename Hash, typename KeyEqual,
-	  typename MutexType, typename ScopedLockType>
+	  typename MutexType, typename ScopedLockType,
+	  template <typename> class NodePointer>
 void
-concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType>::clear()
+concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType,
+		    NodePointer>::shrink_to_fit()
+{
+	concurrent_hash_map_internal::check_outside_tx();
+
+	/* the table does not grow until it's shrunk */
+	std::unique_lock<segment_enable_mutex_t> lock(
+		this->my_segment_enable_mutex);
+
+	pool_base pop = get_pool_base();
+	hashcode_type m = mask().load(std::memory_order_relaxed);
+	hashcode_type new_mask = m;
+	size_type sz = size();
+
+	assert((m & (m + 1)) == 0);
+
+	while (new_mask + 1 > embedded_buckets) {
+		segment_index_t s = segment_traits_t::segment_index_of(new_mask);
+
+		/* the first block is allocated (and freed) as a whole */
+		if (s < segment_traits_t::first_block)
+			s = segment_traits_t::embedded_segments;
+
+		/* the smaller table would be more than half full */
+		if (sz > segment_traits_t::segment_base(s) / 2)
+			break;
+
+		new_mask = segment_traits_t::segment_base(s) - 1;
+	}
+
+	if (new_mask == m)
+		return;
+
+	segment_index_t first = segment_traits_t::segment_index_of(new_mask) + 1;
+	segment_index_t last = segment_traits_t::segment_index_of(m);
+	auto &readers = concurrent_hash_map_internal::mask_readers::instance();
+
+	this->my_shrink_mask.store(new_mask, std::memory_order_seq_cst);
+
+	try {
+		/*
+		 * Operations which loaded the mask before the table last grew
+		 * rely on buckets being split only, they must not see buckets
+		 * being merged.
+		 */
+		readers.synchronize();
+
+		for (segment_index_t seg = last + 1; seg-- > first;)
+			merge_segment(seg);
+
+#if LIBPMEMOBJ_CPP_VG_HELGRIND_ENABLED
+		ANNOTATE_HAPPENS_BEFORE(&(this->my_mask));
+#endif
+		mask().store(new_mask, std::memory_order_seq_cst);
+
+		/* operations which use the old mask may still access the
+		 * merged buckets */
+		readers.synchronize();
+
+		flat_transaction::run(pop, [&] {
+			for (segment_index_t seg = last + 1; seg-- > first;)
+				segment_facade_t(this->my_table, seg).disable();
+		});
+	} catch (...) {
+		/*
+		 * Merged buckets are empty and not rehashed, so they are
+		 * rehashed again if the table is not shrunk.
+		 */
+		this->my_shrink_mask.store(0, std::memory_order_release);
+		throw;
+	}
+
+	this->my_shrink_mask.store(0, std::memory_order_release);
+}
+
+template <typename Key, typename T, typename Hash, typename KeyEqual,
+	  typename MutexType, typename ScopedLockType,
+	  template <typename> class NodePointer>
+void
+concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType,
+		    NodePointer>::clear()
 {
 	hashcode_type m = mask();
 
@@ -3378,10 +3901,11 @@ concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType>::clear()
 }
 
 template <typename Key, typename T, typename Hash, typename KeyEqual,
-	  typename MutexType, typename ScopedLockType>
+	  typename MutexType, typename ScopedLockType,
+	  template <typename> class NodePointer>
 void
-concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType,
-		    ScopedLockType>::clear_segment(segment_index_t s)
+concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType,
+		    NodePointer>::clear_segment(segment_index_t s)
 {
 	segment_facade_t segment(this->my_table, s);
 
@@ -3400,11 +3924,72 @@ concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType,
 		segment.disable();
 }
 
+/*
+ * Moves all elements of the segment to their parent buckets (the same bucket
+ * index with the topmost bit cleared) and marks the buckets as not rehashed.
+ * After each bucket the table is in the same state as after enabling a new
+ * segment, so if the process is interrupted, the elements are rehashed back
+ * lazily. Concurrent operations which find a merged bucket go to its parent
+ * (see bucket_accessor::acquire()).
+ */
 template <typename Key, typename T, typename Hash, typename KeyEqual,
-	  typename MutexType, typename ScopedLockType>
+	  typename MutexType, typename ScopedLockType,
+	  template <typename> class NodePointer>
 void
-concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType>::
-	internal_copy(const concurrent_hash_map &source)
+concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType,
+		    NodePointer>::merge_segment(segment_index_t s)
+{
+	segment_facade_t segment(this->my_table, s);
+
+	assert(segment.is_valid());
+
+	pool_base pop = get_pool_base();
+	size_type sz = segment.size();
+
+	assert(segment_traits_t::segment_base(s) == sz);
+
+	for (segment_index_t i = 0; i < sz; ++i) {
+		bucket *b = &segment[i];
+
+		assert(this->is_merging(sz + i));
+
+		bucket_lock_type b_lock(b->mutex, /*write=*/true);
+
+		if (b->node_list == nullptr) {
+			if (b->is_rehashed(std::memory_order_relaxed)) {
+				b->rehashed.get_rw().store(
+					false, std::memory_order_relaxed);
+				pop.persist(b->rehashed);
+			}
+			continue;
+		}
+
+		/* bucket (sz + i) was split from bucket i, which has to be
+		 * rehashed before it gets the elements back (buckets are
+		 * locked in the same order as in rehash_bucket()) */
+		bucket_accessor parent(this, i, /*writer=*/true);
+
+		flat_transaction::run(pop, [&] {
+			node_ptr_t *tail = &(b->node_list);
+			while (*tail != nullptr)
+				tail = &((*tail)(this->my_pool_uuid)->next);
+
+			*tail = parent->node_list;
+			parent->node_list = b->node_list;
+			b->node_list = nullptr;
+			b->rehashed.get_rw().store(false,
+						   std::memory_order_relaxed);
+		});
+	}
+}
+
+template <typename Key, typename T, typename Hash, typename KeyEqual,
+	  typename MutexType, typename ScopedLockType,
+	  template <typename> class NodePointer>
+void
+concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType,
+		    NodePointer>::internal_copy(const concurrent_hash_map
+							&source)
 {
 	auto pop = get_pool_base();
 
@@ -3413,11 +3998,12 @@ concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType>::
 }
 
 template <typename Key, typename T, typename Hash, typename KeyEqual,
-	  typename MutexType, typename ScopedLockType>
+	  typename MutexType, typename ScopedLockType,
+	  template <typename> class NodePointer>
 template <typename I>
 void
-concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType,
-		    ScopedLockType>::internal_copy(I first, I last)
+concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType,
+		    NodePointer>::internal_copy(I first, I last)
 {
 	hashcode_type m = mask();
 
@@ -3427,29 +4013,31 @@ concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType,
 
 		assert(b->is_rehashed(std::memory_order_relaxed));
 
-		detail::persistent_pool_ptr<node> p;
+		persistent_node_ptr_t p;
 		insert_new_node(b, p, *first);
 	}
 }
 
 template <typename Key, typename T, typename Hash, typename KeyEqual,
-	  typename MutexType, typename ScopedLockType>
+	  typename MutexType, typename ScopedLockType,
+	  template <typename> class NodePointer>
 inline bool
 operator==(const concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType,
-				     ScopedLockType> &a,
+				     ScopedLockType, NodePointer> &a,
 	   const concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType,
-				     ScopedLockType> &b)
+				     ScopedLockType, NodePointer> &b)
 {
 	if (a.size() != b.size())
 		return false;
 
 	typename concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType,
-				     ScopedLockType>::const_iterator
-		i(a.begin()),
+				     ScopedLockType,
+				     NodePointer>::const_iterator i(a.begin()),
 		i_end(a.end());
 
 	typename concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType,
-				     ScopedLockType>::const_iterator j,
+				     ScopedLockType,
+				     NodePointer>::const_iterator j,
 		j_end(b.end());
 
 	for (; i != i_end; ++i) {
@@ -3463,25 +4051,50 @@ operator==(const concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType,
 }
 
 template <typename Key, typename T, typename Hash, typename KeyEqual,
-	  typename MutexType, typename ScopedLockType>
+	  typename MutexType, typename ScopedLockType,
+	  template <typename> class NodePointer>
 inline bool
 operator!=(const concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType,
-				     ScopedLockType> &a,
+				     ScopedLockType, NodePointer> &a,
 	   const concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType,
-				     ScopedLockType> &b)
+				     ScopedLockType, NodePointer> &b)
 {
 	return !(a == b);
 }
 
 template <typename Key, typename T, typename Hash, typename KeyEqual,
-	  typename MutexType, typename ScopedLockType>
+	  typename MutexType, typename ScopedLockType,
+	  template <typename> class NodePointer>
 inline void
-swap(concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType> &a,
-     concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType> &b)
+swap(concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType,
+			 NodePointer> &a,
+     concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType,
+			 NodePointer> &b)
 {
 	a.swap(b);
 }
 
+namespace experimental
+{
+
+/**
+ * concurrent_hash_map which links nodes with self-relative pointers.
+ *
+ * Dereferencing a node pointer does not require a pool lookup, which makes
+ * find, insert, erase and iteration cheaper. The layout is not compatible with
+ * the default concurrent_hash_map.
+ */
+template <typename Key, typename T, typename Hash = std::hash<Key>,
+	  typename KeyEqual = std::equal_to<Key>,
+	  typename MutexType = pmem::obj::shared_mutex,
+	  typename ScopedLockType = concurrent_hash_map_internal::
+		  shared_mutex_scoped_lock<MutexType>>
+using self_relative_concurrent_hash_map =
+	concurrent_hash_map<Key, T, Hash, KeyEqual, MutexType, ScopedLockType,
+			    detail::self_relative_pool_ptr>;
+
+} /* namespace experimental */
+
 } /* namespace obj */
 } /* namespace pmem */
 
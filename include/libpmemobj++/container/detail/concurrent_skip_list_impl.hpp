@@ -12,17 +12,27 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <cstdint>
 #include <cstdlib>
+#include <functional>
+#include <iterator>
 #include <limits>
 #include <mutex> /* for std::unique_lock */
 #include <random>
+#include <tuple>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
+#include <libpmemobj++/defrag.hpp>
+#include <libpmemobj++/detail/atomic_backoff.hpp>
 #include <libpmemobj++/detail/common.hpp>
 #include <libpmemobj++/detail/enumerable_thread_specific.hpp>
+#include <libpmemobj++/detail/iterator_traits.hpp>
 #include <libpmemobj++/detail/life.hpp>
 #include <libpmemobj++/detail/pair.hpp>
 #include <libpmemobj++/detail/template_helpers.hpp>
+#include <libpmemobj++/detail/volatile_state.hpp>
 #include <libpmemobj++/mutex.hpp>
 #include <libpmemobj++/persistent_ptr.hpp>
 #include <libpmemobj++/pool.hpp>
@@ -120,8 +130,175 @@ allocator_swap(MyAlloc &, OtherAlloc &, std::false_type)
 { /* NO SWAP */
 }
 
+/**
+ * Describes how an argument of (decayed) type K, from which the key of
+ * a new element is constructed, can be used to search for the element.
+ *
+ * It is used directly if it is the key itself or the comparator is
+ * transparent (like in try_emplace). Otherwise, if a volatile key can be
+ * constructed from it at no risk (e.g. p<int> from int), a copy of the key
+ * is used.
+ */
+template <typename Traits, typename K>
+struct emplace_lookup_key {
+	using key_type = typename Traits::key_type;
+	using compare_type = typename Traits::compare_type;
+
+	static constexpr bool direct = std::is_same<K, key_type>::value ||
+		(has_is_transparent<compare_type>::value &&
+		 std::is_constructible<key_type, const K &>::value);
+
+	static constexpr bool converted = !direct &&
+		std::is_trivially_destructible<key_type>::value &&
+		std::is_constructible<key_type, const K &>::value;
+
+	static constexpr bool extractable = direct || converted;
+
+	using type =
+		typename std::conditional<direct, const K &, key_type>::type;
+};
+
+/**
+ * Extracts the key of an element which would be constructed from
+ * emplace() arguments (decayed types Args), without constructing the
+ * element. Supported are: the element itself, a std::pair, a key with
+ * a mapped value and a piecewise construction. For other arguments
+ * extractable is false.
+ */
+template <typename Traits, typename... Args>
+struct emplace_key_extractor {
+	static constexpr bool extractable = false;
+};
+
+template <typename Traits, typename Arg>
+struct emplace_key_extractor<Traits, Arg> {
+	using value_type = typename Traits::value_type;
+	using type = const typename Traits::key_type &;
+
+	static constexpr bool extractable =
+		std::is_same<Arg, value_type>::value;
+
+	static type
+	get(const value_type &value)
+	{
+		return Traits::get_key(value);
+	}
+};
+
+template <typename Traits, typename K, typename V>
+struct emplace_key_extractor<Traits, std::pair<K, V>> {
+	using lookup = emplace_lookup_key<Traits, K>;
+	using type = typename lookup::type;
+
+	static constexpr bool extractable = lookup::extractable &&
+		!std::is_same<typename Traits::key_type,
+			      typename Traits::value_type>::value;
+
+	static type
+	get(const std::pair<K, V> &value)
+	{
+		return static_cast<type>(value.first);
+	}
+};
+
+template <typename Traits, typename K, typename V>
+struct emplace_key_extractor<Traits, K, V> {
+	using lookup = emplace_lookup_key<Traits, K>;
+	using type = typename lookup::type;
+
+	static constexpr bool extractable = lookup::extractable &&
+		!std::is_same<typename Traits::key_type,
+			      typename Traits::value_type>::value;
+
+	static type
+	get(const K &key, const V &)
+	{
+		return static_cast<type>(key);
+	}
+};
+
+template <typename Traits, typename K, typename ValueArgs>
+struct emplace_key_extractor<Traits, std::piecewise_construct_t, std::tuple<K>,
+			     ValueArgs> {
+	using lookup = emplace_lookup_key<Traits, typename std::decay<K>::type>;
+	using type = typename lookup::type;
+
+	static constexpr bool extractable = lookup::extractable &&
+		!std::is_same<typename Traits::key_type,
+			      typename Traits::value_type>::value;
+
+	static type
+	get(const std::piecewise_construct_t &, const std::tuple<K> &key,
+	    const ValueArgs &)
+	{
+		return static_cast<type>(std::get<0>(key));
+	}
+};
+
+/**
+ * Key prefix type of comparators which do not provide one.
+ */
+struct no_key_prefix {};
+
+/*
+ * A comparator can provide a short prefix of the key (prefix_type and a
+ * prefix(key) method), which is stored in every node. The prefixes have to
+ * be ordered consistently with the comparator: if the prefixes of two keys
+ * differ, they decide the order of the keys. Only equal prefixes require
+ * comparing the keys themselves.
+ */
+template <typename Compare, typename = void>
+struct key_prefix_traits {
+	using prefix_type = no_key_prefix;
+	static constexpr bool enabled = false;
+
+	template <typename K>
+	static prefix_type
+	make(const Compare &, const K &)
+	{
+		return prefix_type();
+	}
+};
+
+template <typename Compare>
+struct key_prefix_traits<Compare, void_t<typename Compare::prefix_type>> {
+	using prefix_type = typename Compare::prefix_type;
+	static constexpr bool enabled = true;
+
+	template <typename K>
+	static prefix_type
+	make(const Compare &cmp, const K &key)
+	{
+		return cmp.prefix(key);
+	}
+};
+
+/*
+ * Last fields of the skip list node, placed right before the array of next
+ * pointers, so the key prefix shares a cache line with the lowest levels.
+ */
+template <typename Prefix>
+struct skip_list_node_tail {
+	skip_list_node_tail(std::size_t h) : height_version(h), prefix()
+	{
+	}
+
+	std::atomic<uint64_t> height_version;
+	Prefix prefix;
+};
+
+template <>
+struct skip_list_node_tail<no_key_prefix> {
+	skip_list_node_tail(std::size_t h) : height_version(h)
+	{
+	}
+
+	std::atomic<uint64_t> height_version;
+};
+
 template <typename Value, typename Mutex = pmem::obj::mutex,
-	  typename LockType = std::unique_lock<Mutex>>
+	  typename LockType = std::unique_lock<Mutex>,
+	  typename Prefix = no_key_prefix>
 class skip_list_node {
 public:
 	using value_type = Value;
@@ -135,10 +312,18 @@ public:
 	using atomic_node_pointer = std::atomic<node_pointer>;
 	using mutex_type = Mutex;
 	using lock_type = LockType;
+	using prefix_type = Prefix;
+
+	/** Number of low bits of the height_version word used by height. */
+	static constexpr unsigned HEIGHT_BITS = 8;
+	static constexpr uint64_t HEIGHT_MASK =
+		(uint64_t(1) << HEIGHT_BITS) - 1;
+	static constexpr uint64_t MAX_VERSION =
+		(uint64_t(1) << (64 - HEIGHT_BITS)) - 1;
 
-	skip_list_node(size_type levels) : height_(levels)
+	skip_list_node(size_type levels) : tail_(levels)
 	{
-		for (size_type lev = 0; lev < height_; ++lev)
+		for (size_type lev = 0; lev < height(); ++lev)
 			detail::create<atomic_node_pointer>(&get_next(lev),
 							    nullptr);
 
@@ -148,17 +333,19 @@ public:
 		 * Valgrind does not understand atomic semantic and reports
 		 * false-postives in drd and helgrind tools.
 		 */
-		for (size_type lev = 0; lev < height_; ++lev) {
+		for (size_type lev = 0; lev < height(); ++lev) {
 			VALGRIND_HG_DISABLE_CHECKING(&get_next(lev),
 						     sizeof(get_next(lev)));
 		}
+		VALGRIND_HG_DISABLE_CHECKING(&tail_.height_version,
+					     sizeof(tail_.height_version));
 #endif
 	}
 
 	skip_list_node(size_type levels, const node_pointer *new_nexts)
-	    : height_(levels)
+	    : tail_(levels)
 	{
-		for (size_type lev = 0; lev < height_; ++lev)
+		for (size_type lev = 0; lev < height(); ++lev)
 			detail::create<atomic_node_pointer>(&get_next(lev),
 							    new_nexts[lev]);
 
@@ -168,16 +355,18 @@ public:
 		 * Valgrind does not understand atomic semantic and reports
 		 * false-postives in drd and helgrind tools.
 		 */
-		for (size_type lev = 0; lev < height_; ++lev) {
+		for (size_type lev = 0; lev < height(); ++lev) {
 			VALGRIND_HG_DISABLE_CHECKING(&get_next(lev),
 						     sizeof(get_next(lev)));
 		}
+		VALGRIND_HG_DISABLE_CHECKING(&tail_.height_version,
+					     sizeof(tail_.height_version));
 #endif
 	}
 
 	~skip_list_node()
 	{
-		for (size_type lev = 0; lev < height_; ++lev)
+		for (size_type lev = 0; lev < height(); ++lev)
 			detail::destroy<atomic_node_pointer>(get_next(lev));
 	}
 
@@ -258,7 +447,60 @@ public:
 	size_type
 	height() const
 	{
-		return height_;
+		return static_cast<size_type>(
+			tail_.height_version.load(std::memory_order_relaxed) &
+			HEIGHT_MASK);
+	}
+
+	/** @return version of the insert which linked the node */
+	uint64_t
+	version() const
+	{
+		return tail_.height_version.load(std::memory_order_acquire) >>
+			HEIGHT_BITS;
+	}
+
+	/**
+	 * The version is meaningful only until the pool is closed, so it is
+	 * not persisted. It is kept in the upper bits of the word which
+	 * stores the height, so it does not make the node bigger.
+	 */
+	void
+	set_version(uint64_t version)
+	{
+		assert(version <= MAX_VERSION);
+		tail_.height_version.store((version << HEIGHT_BITS) | height(),
+					   std::memory_order_release);
+#if LIBPMEMOBJ_CPP_VG_PMEMCHECK_ENABLED
+		VALGRIND_PMC_DO_FLUSH(&tail_.height_version,
+				      sizeof(tail_.height_version));
+#endif
+	}
+
+	/** Sets the version and persists it */
+	void
+	set_version(obj::pool_base pop, uint64_t version)
+	{
+		set_version(version);
+		pop.persist(&tail_.height_version,
+			    sizeof(tail_.height_version));
+	}
+
+	/** @return prefix of the key, set by set_key_prefix() */
+	const prefix_type &
+	key_prefix() const
+	{
+		return tail_.prefix;
+	}
+
+	/**
+	 * Can`t be called concurrently
+	 * Should be called on a newly allocated node
+	 */
+	void
+	set_key_prefix(const prefix_type &prefix)
+	{
+		tail_.prefix = prefix;
 	}
 
 	lock_type
@@ -293,7 +535,7 @@ private:
 	union {
 		value_type val;
 	};
-	size_type height_;
+	skip_list_node_tail<prefix_type> tail_;
 };
 
 template <typename NodeType, bool is_const>
@@ -405,17 +647,59 @@ operator!=(const skip_list_iterator<T, M> &lhs,
 	return lhs.node != rhs.node;
 }
 
+/**
+ * xorshift64* pseudo-random number generator. It is much cheaper than
+ * std::mt19937_64 and good enough for choosing heights of the nodes.
+ */
+class xorshift64_star {
+public:
+	using result_type = uint64_t;
+
+	xorshift64_star(uint64_t seed) : state(seed ? seed : 1)
+	{
+	}
+
+	result_type
+	operator()()
+	{
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+
+		return state * 0x2545F4914F6CDD1DULL;
+	}
+
+	static constexpr result_type
+	min()
+	{
+		return 1;
+	}
+
+	static constexpr result_type
+	max()
+	{
+		return std::numeric_limits<result_type>::max();
+	}
+
+private:
+	uint64_t state;
+};
+
 struct default_random_generator {
-	using gen_type = std::mt19937_64;
+	using gen_type = xorshift64_star;
 	using result_type = typename gen_type::result_type;
 
 	size_t
 	operator()()
 	{
+		/* the address of a thread_local variable differs between
+		 * threads started at the same time */
+		static thread_local char thread_seed;
 		static thread_local gen_type engine(
-			static_cast<size_t>(time(0)));
+			static_cast<uint64_t>(time(0)) ^
+			reinterpret_cast<uintptr_t>(&thread_seed));
 
-		return engine();
+		return static_cast<size_t>(engine());
 	}
 
 	static constexpr result_type
@@ -431,24 +715,44 @@ struct default_random_generator {
 	}
 };
 
+/**
+ * Generates heights of the nodes for a skip list with the given number of
+ * elements. The height is the number of trailing zero bits of a random
+ * number (divided by the number of bits per level), so a node reaches the
+ * next level with probability 1/2, or 1/4 in maps with at least
+ * QUARTER_P_SIZE elements. Both probabilities give the same expected
+ * number of comparisons per search, but 1/4 writes fewer pointers per
+ * insert. The height is limited to about the expected height of the
+ * tallest node, so small maps do not get needlessly tall towers.
+ *
+ * RndGenerator should be a thread-safe generator of uniformly distributed
+ * 64-bit numbers.
+ */
 template <typename RndGenerator, size_t MAX_LEVEL>
-class geometric_level_generator {
+class adaptive_level_generator {
 public:
 	using rnd_generator_type = RndGenerator;
 
 	static constexpr size_t max_level = MAX_LEVEL;
 
+	static constexpr size_t QUARTER_P_SIZE = size_t(1) << 16;
+
 	size_t
-	operator()()
+	operator()(size_t size)
 	{
-		/* rnd_generator_type should be thread-safe random number
-		 * generator. */
 		static rnd_generator_type gen;
-		/* std::geometric_distribution is not thread-safe. We mark it as
-		 * a thread_local to avoid data races. */
-		static thread_local std::geometric_distribution<size_t> d;
 
-		return (d(gen) % MAX_LEVEL) + 1;
+		size_t bits_per_level = size < QUARTER_P_SIZE ? 1 : 2;
+		size_t cap =
+			static_cast<size_t>(Log2(size | 1)) / bits_per_level +
+			2;
+
+		/* the highest bit limits the result to 63 */
+		uint64_t r = static_cast<uint64_t>(gen()) | (1ULL << 63);
+		size_t zeros = mssb_index64(r & (~r + 1));
+		size_t height = zeros / bits_per_level + 1;
+
+		return (std::min)(height, (std::min)(cap, MAX_LEVEL));
 	}
 };
 
@@ -493,19 +797,36 @@ protected:
 	using allocator_type = typename traits_type::allocator_type;
 	using allocator_traits_type = std::allocator_traits<allocator_type>;
 
+	/* func argument type definition for 'for_each_ptr' method */
+	using for_each_ptr_function =
+		std::function<void(obj::persistent_ptr_base &)>;
+
+	/* batch of elements passed to the 'snapshot_scan' callback */
+	using scan_batch_type = std::vector<const value_type *>;
+
 	using reference = value_type &;
 	using const_reference = const value_type &;
 	using pointer = typename allocator_traits_type::pointer;
 	using const_pointer = typename allocator_traits_type::const_pointer;
 
-	using list_node_type = skip_list_node<value_type>;
+	using key_prefix_traits_type = key_prefix_traits<key_compare>;
+	using key_prefix_type = typename key_prefix_traits_type::prefix_type;
+	using key_prefix_enabled =
+		std::integral_constant<bool, key_prefix_traits_type::enabled>;
+	using mutex_type = typename traits_type::mutex_type;
+
+	using list_node_type =
+		skip_list_node<value_type, mutex_type,
+			       std::unique_lock<mutex_type>, key_prefix_type>;
 
 	using iterator = skip_list_iterator<list_node_type, false>;
 	using const_iterator = skip_list_iterator<list_node_type, true>;
 
 	static constexpr size_type MAX_LEVEL = traits_type::max_level;
+	static_assert(MAX_LEVEL <= list_node_type::HEIGHT_MASK,
+		      "max_level does not fit in a node");
 
-	using random_level_generator_type = geometric_level_generator<
+	using random_level_generator_type = adaptive_level_generator<
 		typename traits_type::random_generator_type, MAX_LEVEL>;
 	using node_allocator_type = typename std::allocator_traits<
 		allocator_type>::template rebind_alloc<uint8_t>;
@@ -567,7 +888,8 @@ public:
 	/**
 	 * Constructs the container with the contents of the range [first,
 	 * last). If multiple elements in the range have keys that compare
-	 * equivalent, the first element is inserted.
+	 * equivalent, the first element is inserted. If the range is sorted
+	 * with respect to comp, it is loaded in linear time.
 	 *
 	 * @param[in] first first iterator of inserted range.
 	 * @param[in] last last iterator of inserted range.
@@ -595,8 +917,7 @@ public:
 	{
 		check_tx_stage_work();
 		init();
-		while (first != last)
-			internal_unsafe_emplace(*first++);
+		internal_insert_sorted(first, last);
 	}
 
 	/**
@@ -729,11 +1050,20 @@ public:
 	 * MUST be called every time after process restart.
 	 * Not thread safe.
 	 *
+	 * @throw pmem::transaction_scope_error if called inside transaction.
 	 */
 	void
 	runtime_initialize()
 	{
+		runtime_data *data =
+			pmem::detail::volatile_state::get<runtime_data>(
+				pmemobj_oid(this));
+
+		/* recovery searches all levels */
+		data->max_height.store(MAX_LEVEL, std::memory_order_relaxed);
 		tls_restore();
+		init_versions(*data);
+		restore_max_height(*data);
 
 		assert(this->size() ==
 		       size_type(std::distance(this->begin(), this->end())));
@@ -761,6 +1091,8 @@ public:
 		obj::flat_transaction::run(pop, [&] {
 			clear();
 			delete_dummy_head();
+			pmem::detail::volatile_state::destroy(
+				pmemobj_oid(this));
 		});
 	}
 
@@ -1056,6 +1388,90 @@ public:
 		insert(ilist.begin(), ilist.end());
 	}
 
+	/**
+	 * Bulk-loads elements from range [first, last) in a single
+	 * transaction. Elements which are greater than every element already
+	 * in the container are appended at the end of all their levels
+	 * without searching, so loading a sorted range into an empty
+	 * container (or past its last element) takes linear time. Other
+	 * elements are inserted one by one. If multiple elements have keys
+	 * that compare equivalent, the first one is inserted (unless
+	 * multimapping is allowed).
+	 *
+	 * This method is not thread-safe, the container must not be accessed
+	 * concurrently. It can be called within a transaction.
+	 *
+	 * @param[in] first first iterator of inserted range.
+	 * @param[in] last last iterator of inserted range.
+	 *
+	 * @throw pmem::transaction_error when snapshotting failed.
+	 * @throw pmem::transaction_alloc_error when allocating new memory
+	 * failed.
+	 * @throw rethrows constructor exception.
+	 */
+	template <typename InputIterator>
+	void
+	from_sorted(InputIterator first, InputIterator last)
+	{
+		auto pop = get_pool_base();
+		obj::flat_transaction::run(
+			pop, [&] { internal_insert_sorted(first, last); });
+	}
+
+	/**
+	 * Calls f with consecutive batches of elements with keys in range
+	 * [first, last), in ascending order. The elements are a consistent
+	 * snapshot of the range: they are exactly the elements which were in
+	 * the range when the scan started, elements inserted concurrently
+	 * during the scan are skipped. Mapped values are not part of the
+	 * snapshot, they are read when f is called.
+	 *
+	 * The batch is a vector of pointers to the elements, at most
+	 * batch_size long, which is valid only during the call to f. While a
+	 * batch is collected, the following nodes are prefetched.
+	 *
+	 * This method is thread-safe, it can be called concurrently with
+	 * other scans, lookups and inserts, but not with erasures.
+	 *
+	 * @param[in] first the lower bound of the scanned range.
+	 * @param[in] last the upper bound (not included) of the scanned range.
+	 * @param[in] f callable object, called with const scan_batch_type &.
+	 * @param[in] batch_size maximum number of elements in a batch.
+	 */
+	template <typename K1, typename K2, typename F>
+	void
+	snapshot_scan(const K1 &first, const K2 &last, F &&f,
+		      size_type batch_size = 64) const
+	{
+		const_node_ptr prev = dummy_head.get();
+		persistent_node_ptr next = nullptr;
+		key_prefix_type prefix = key_prefix(first);
+
+		for (size_type h = search_height(); h > 0; --h)
+			next = internal_find_position(h - 1, prev, first,
+						      prefix, _compare);
+
+		internal_snapshot_scan(next.get(), &last, std::forward<F>(f),
+				       batch_size);
+	}
+
+	/**
+	 * Calls f with consecutive batches of all elements of the container,
+	 * in ascending order. The elements are a consistent snapshot of the
+	 * container, see snapshot_scan(first, last, f, batch_size).
+	 *
+	 * @param[in] f callable object, called with const scan_batch_type &.
+	 * @param[in] batch_size maximum number of elements in a batch.
+	 */
+	template <typename F>
+	void
+	snapshot_scan(F &&f, size_type batch_size = 64) const
+	{
+		internal_snapshot_scan(dummy_head->next(0).get(),
+				       static_cast<const key_type *>(nullptr),
+				       std::forward<F>(f), batch_size);
+	}
+
 	/**
 	 * Inserts a new element into the container constructed in-place with
 	 * the given args if there is no element with the key in the container.
@@ -2149,9 +2565,34 @@ public:
 				(size_t *)&(other._size));
 			_size = other._size.exchange(_size,
 						     std::memory_order_relaxed);
+
+			exchange_runtime_data(other);
 		});
 	}
 
+	/**
+	 * Iterates over pointers stored in all elements (in keys and mapped
+	 * values which are defragmentable, e.g. pmem::obj::string) and
+	 * executes a callback function on each of them.
+	 *
+	 * Nodes are linked with self-relative pointers, which cannot be
+	 * updated by the defragmentation, so they are not visited.
+	 * For the same reason the container itself must not be relocated:
+	 * add it to pmem::obj::defrag by reference, not by a persistent_ptr
+	 * to it.
+	 *
+	 * Must not be called concurrently with any modifications of the
+	 * container.
+	 *
+	 * @param func callback function to call on internal pointer.
+	 */
+	void
+	for_each_ptr(for_each_ptr_function func)
+	{
+		for (auto it = begin(); it != end(); ++it)
+			value_for_each_ptr(*it, func);
+	}
+
 	/**
 	 * Returns a range containing all elements with the given key in the
 	 * container. The range is defined by two iterators, one pointing to the
@@ -2291,6 +2732,28 @@ public:
 	}
 
 private:
+	/*
+	 * Relocation does not change the value of the key, so its pointers can
+	 * be safely updated even though the key is const.
+	 */
+	template <typename K, typename V>
+	static void
+	value_for_each_ptr(pair<K, V> &v, for_each_ptr_function &func)
+	{
+		detail::for_each_ptr_of(
+			const_cast<typename std::remove_const<K>::type &>(
+				v.first),
+			func);
+		detail::for_each_ptr_of(v.second, func);
+	}
+
+	template <typename V>
+	static void
+	value_for_each_ptr(V &v, for_each_ptr_function &func)
+	{
+		detail::for_each_ptr_of(v, func);
+	}
+
 	/* Status flags stored in insert_stage field */
 	enum insert_stage_type : uint8_t { not_started = 0, in_progress = 1 };
 	/*
@@ -2309,6 +2772,31 @@ private:
 	static_assert(sizeof(tls_entry_type) == 64,
 		      "The size of tls_entry_type should be 64 bytes.");
 
+	/*
+	 * Runtime-only data of the list. It is kept in
+	 * pmem::detail::volatile_state, the layout of the persistent list
+	 * does not depend on it.
+	 */
+	struct runtime_data {
+		/* Sequence number of the next concurrent insert */
+		std::atomic<uint64_t> insert_version{0};
+
+		/*
+		 * Versions below this bound can be given out without
+		 * raising the bound stored in the dummy head. 0 until
+		 * init_versions() is called.
+		 */
+		std::atomic<uint64_t> reserved_version{0};
+		std::mutex reserve_mutex;
+
+		/*
+		 * Upper bound of the heights of all nodes, searches start at
+		 * this level instead of the top of the dummy head. 0 if it is
+		 * not computed yet.
+		 */
+		mutable std::atomic<size_type> max_height{0};
+	};
+
 	/**
 	 * Private helper function. Checks if current transaction stage is equal
 	 * to TX_STAGE_WORK and throws an exception otherwise.
@@ -2356,6 +2844,8 @@ private:
 		_size.store(other._size.load(std::memory_order_relaxed),
 			    std::memory_order_relaxed);
 		on_init_size = other.on_init_size;
+
+		exchange_runtime_data(other);
 	}
 
 	static const_reference
@@ -2417,6 +2907,7 @@ private:
 	 * @param level - on which level search prev node
 	 * @param prev - pointer to the start node to search
 	 * @param key - key to search
+	 * @param prefix - prefix of the key, computed once per search
 	 * @param cmp - callable object to compare two objects
 	 *  (_compare member is default comparator)
 	 * @returns pointer to the node which is not satisfy the comparison with
@@ -2425,13 +2916,14 @@ private:
 	template <typename K, typename pointer_type, typename comparator>
 	persistent_node_ptr
 	internal_find_position(size_type level, pointer_type &prev,
-			       const K &key, const comparator &cmp) const
+			       const K &key, const key_prefix_type &prefix,
+			       const comparator &cmp) const
 	{
 		assert(level < prev->height());
 		persistent_node_ptr next = prev->next(level);
 		pointer_type curr = next.get();
 
-		while (curr && cmp(get_key(curr), key)) {
+		while (curr && node_compare(curr, key, prefix, cmp)) {
 			prev = curr;
 			assert(level < prev->height());
 			next = prev->next(level);
@@ -2441,6 +2933,268 @@ private:
 		return next;
 	}
 
+	/**
+	 * Version of a node which is being linked by a concurrent insert.
+	 * Nodes created in transactions have version 0.
+	 */
+	static constexpr uint64_t PENDING_VERSION = list_node_type::MAX_VERSION;
+
+	/**
+	 * Number of versions reserved at once. The dummy head is persisted
+	 * once per this many concurrent inserts.
+	 */
+	static constexpr uint64_t VERSION_RESERVE = uint64_t(1) << 20;
+
+	/**
+	 * Returns runtime data of the list. Creates it on the first use,
+	 * except inside a transaction, where nullptr is returned if it does
+	 * not exist yet.
+	 */
+	runtime_data *
+	get_runtime_data() const
+	{
+		PMEMoid oid = pmemobj_oid(this);
+		runtime_data *data =
+			pmem::detail::volatile_state::get_if_exists<
+				runtime_data>(oid);
+
+		if (data == nullptr && pmemobj_tx_stage() == TX_STAGE_NONE)
+			data = pmem::detail::volatile_state::get<runtime_data>(
+				oid);
+
+		if (data &&
+		    data->reserved_version.load(std::memory_order_acquire) ==
+			    0)
+			init_versions(*data);
+
+		return data;
+	}
+
+	/**
+	 * Starts the versions of this run above the bound stored in the
+	 * dummy head, which is greater than every version given out in
+	 * the earlier runs. Versions left in the nodes do not have to be
+	 * reset then, they are smaller than every snapshot sequence number
+	 * of this run, just as version 0.
+	 */
+	void
+	init_versions(runtime_data &data) const
+	{
+		std::lock_guard<std::mutex> lock(data.reserve_mutex);
+		if (data.reserved_version.load(std::memory_order_relaxed) != 0)
+			return;
+
+		uint64_t version =
+			(std::max)(dummy_head->version(), uint64_t(1));
+		if (version > list_node_type::MAX_VERSION / 2) {
+			/* practically unreachable, restart the versions */
+			reset_node_versions();
+			version = 1;
+		}
+
+		data.insert_version.store(version, std::memory_order_relaxed);
+		reserve_versions(data, version);
+	}
+
+	/**
+	 * Raises the bound stored in the dummy head above version, before
+	 * any node can get it. Called with reserve_mutex held.
+	 */
+	void
+	reserve_versions(runtime_data &data, uint64_t version) const
+	{
+		uint64_t reserved = version + VERSION_RESERVE;
+		assert(reserved < PENDING_VERSION);
+		assert(reserved > dummy_head->version());
+
+		dummy_head->set_version(get_pool_base(), reserved);
+		data.reserved_version.store(reserved,
+					    std::memory_order_release);
+	}
+
+	/** @return version for a node linked by a concurrent insert */
+	uint64_t
+	next_version(runtime_data &data)
+	{
+		uint64_t version = data.insert_version.fetch_add(
+			1, std::memory_order_acq_rel);
+
+		if (version >=
+		    data.reserved_version.load(std::memory_order_acquire)) {
+			std::lock_guard<std::mutex> lock(data.reserve_mutex);
+			if (version >= data.reserved_version.load(
+					       std::memory_order_relaxed))
+				reserve_versions(data, version);
+		}
+
+		assert(version < PENDING_VERSION);
+		return version;
+	}
+
+	/**
+	 * Fixes runtime data of both lists after their dummy heads (and so
+	 * their nodes) were exchanged. The insert counter of each list is
+	 * moved above the bound stored in its new dummy head and the bound
+	 * is raised by the next insert. The bounds of the heights are
+	 * computed again on the next use.
+	 * Not thread safe.
+	 */
+	void
+	exchange_runtime_data(concurrent_skip_list &other)
+	{
+		restart_versions(get_runtime_data());
+		other.restart_versions(other.get_runtime_data());
+	}
+
+	void
+	restart_versions(runtime_data *data)
+	{
+		if (data == nullptr)
+			return;
+
+		uint64_t version = (std::max)(
+			data->insert_version.load(std::memory_order_relaxed),
+			dummy_head->version());
+		data->insert_version.store(version, std::memory_order_relaxed);
+		data->reserved_version.store(version,
+					     std::memory_order_relaxed);
+		data->max_height.store(0, std::memory_order_relaxed);
+	}
+
+	void
+	reset_node_versions() const
+	{
+		obj::pool_base pop = get_pool_base();
+		for (node_ptr n = dummy_head->next(0).get(); n;
+		     n = n->next(0).get()) {
+			if (n->version() != 0)
+				n->set_version(pop, 0);
+		}
+	}
+
+	/**
+	 * Checks whether the node belongs to the snapshot taken when
+	 * the insert counter was equal to seq. Waits for the inserts which are
+	 * linking the node at the moment.
+	 */
+	bool
+	in_snapshot(const_node_ptr n, uint64_t seq) const
+	{
+		uint64_t version = n->version();
+
+		for (atomic_backoff backoff; version == PENDING_VERSION;
+		     backoff.pause())
+			version = n->version();
+
+		return version < seq;
+	}
+
+	/**
+	 * Scans level 0 from the node n up to the key *last (or to the end if
+	 * last is null).
+	 */
+	template <typename K, typename F>
+	void
+	internal_snapshot_scan(const_node_ptr n, const K *last, F &&f,
+			       size_type batch_size) const
+	{
+		assert(batch_size > 0);
+
+		/* without runtime data there were no concurrent inserts in
+		 * this run, all nodes belong to the snapshot */
+		const runtime_data *data = get_runtime_data();
+		uint64_t seq = data
+			? data->insert_version.load(std::memory_order_acquire)
+			: PENDING_VERSION;
+
+		scan_batch_type batch;
+		const scan_batch_type &const_batch = batch;
+		batch.reserve(batch_size);
+
+		while (n && (!last || _compare(get_key(n), *last))) {
+			const_node_ptr succ = n->next(0).get();
+			if (succ)
+				prefetch(succ->get());
+
+			/* the upper levels point to the nodes further ahead */
+			const_node_ptr ahead =
+				n->height() > 1 ? n->next(1).get() : nullptr;
+			if (ahead)
+				prefetch(ahead->get());
+
+			if (in_snapshot(n, seq)) {
+				batch.push_back(n->get());
+				if (batch.size() == batch_size) {
+					f(const_batch);
+					batch.clear();
+				}
+			}
+
+			n = succ;
+		}
+
+		if (!batch.empty())
+			f(const_batch);
+	}
+
+	template <typename K>
+	key_prefix_type
+	key_prefix(const K &key) const
+	{
+		return key_prefix_traits_type::make(_compare, key);
+	}
+
+	/**
+	 * Compares the key of the node n with the key using cmp. If the
+	 * comparator provides key prefixes and the prefix of the node differs
+	 * from the prefix of the key, the result is decided without accessing
+	 * the key stored in the node.
+	 */
+	template <typename K, typename comparator>
+	bool
+	node_compare(const_node_ptr n, const K &key,
+		     const key_prefix_type &prefix, const comparator &cmp) const
+	{
+		return node_compare(n, key, prefix, cmp, key_prefix_enabled{});
+	}
+
+	template <typename K, typename comparator>
+	bool
+	node_compare(const_node_ptr n, const K &key, const key_prefix_type &,
+		     const comparator &cmp, std::false_type) const
+	{
+		return cmp(get_key(n), key);
+	}
+
+	/*
+	 * cmp is either _compare or not_greater_compare. Different prefixes
+	 * mean that the keys are not equivalent, so for both of them the
+	 * result is the order of the prefixes.
+	 */
+	template <typename K, typename comparator>
+	bool
+	node_compare(const_node_ptr n, const K &key,
+		     const key_prefix_type &prefix, const comparator &cmp,
+		     std::true_type) const
+	{
+		const key_prefix_type &node_prefix = n->key_prefix();
+		if (node_prefix != prefix)
+			return node_prefix < prefix;
+
+		return cmp(get_key(n), key);
+	}
+
+	void
+	set_key_prefix(node_ptr, std::false_type)
+	{
+	}
+
+	void
+	set_key_prefix(node_ptr n, std::true_type)
+	{
+		n->set_key_prefix(key_prefix(get_key(n)));
+	}
+
 	/**
 	 * The method finds insert position for the given @arg key. It finds
 	 * successor and predecessor nodes on each level of the skip list.
@@ -2485,10 +3239,11 @@ private:
 		node_ptr prev = dummy_head.get();
 		prev_nodes.fill(prev);
 		next_nodes.fill(nullptr);
+		key_prefix_type prefix = key_prefix(key);
 
-		for (size_type h = prev->height(); h > 0; --h) {
-			persistent_node_ptr next =
-				internal_find_position(h - 1, prev, key, cmp);
+		for (size_type h = search_height(); h > 0; --h) {
+			persistent_node_ptr next = internal_find_position(
+				h - 1, prev, key, prefix, cmp);
 			prev_nodes[h - 1] = prev;
 			next_nodes[h - 1] = next;
 		}
@@ -2507,6 +3262,39 @@ private:
 	template <typename... Args>
 	std::pair<iterator, bool>
 	internal_emplace(Args &&... args)
+	{
+		using extractor = emplace_key_extractor<
+			traits_type, typename std::decay<Args>::type...>;
+
+		return internal_emplace_impl(
+			std::integral_constant<bool, extractor::extractable>(),
+			std::forward<Args>(args)...);
+	}
+
+	/**
+	 * The key is known before the element is constructed, so the node
+	 * is allocated only after a free position is found and locked (see
+	 * internal_insert). Emplacing an existing key costs only a search.
+	 */
+	template <typename... Args>
+	std::pair<iterator, bool>
+	internal_emplace_impl(std::true_type, Args &&... args)
+	{
+		using extractor = emplace_key_extractor<
+			traits_type, typename std::decay<Args>::type...>;
+
+		typename extractor::type key = extractor::get(args...);
+
+		return internal_insert(key, std::forward<Args>(args)...);
+	}
+
+	/**
+	 * The key is known only after the element is constructed, so the node
+	 * is created first and deleted if the key already exists.
+	 */
+	template <typename... Args>
+	std::pair<iterator, bool>
+	internal_emplace_impl(std::false_type, Args &&... args)
 	{
 		check_outside_tx();
 		tls_entry_type &tls_entry = tls_data.local();
@@ -2556,7 +3344,6 @@ private:
 
 	/**
 	 * Not thread-safe but can be called within a transaction.
-	 * XXX: Need to optimize for single-threaded case.
 	 */
 	template <typename... Args>
 	std::pair<iterator, bool>
@@ -2567,6 +3354,16 @@ private:
 		persistent_node_ptr new_node =
 			create_node(std::forward<Args>(args)...);
 
+		return internal_unsafe_insert(new_node);
+	}
+
+	/**
+	 * Links an already created node or deletes it if its key exists.
+	 * Not thread-safe but can be called within a transaction.
+	 */
+	std::pair<iterator, bool>
+	internal_unsafe_insert(persistent_node_ptr &new_node)
+	{
 		node_ptr n = new_node.get();
 		size_type height = n->height();
 
@@ -2592,6 +3389,115 @@ private:
 		return insert_result;
 	}
 
+	/**
+	 * Inserts elements from the range [first, last). As long as they come
+	 * in order, every node is linked after the last node on each of its
+	 * levels, without any search or locking, so a sorted range is loaded
+	 * in O(n). An element which is out of order (or a duplicate) is
+	 * inserted with internal_unsafe_insert().
+	 *
+	 * Not thread-safe, must be called within a transaction.
+	 */
+	template <typename InputIt>
+	void
+	internal_insert_sorted(InputIt first, InputIt last)
+	{
+		assert(pmemobj_tx_stage() == TX_STAGE_WORK);
+
+		prev_array_type tails;
+		find_tails(tails);
+
+		obj::flat_transaction::snapshot((size_type *)&_size);
+		size_type sz = 0;
+
+		/* _size is updated after the loop, levels are generated for
+		 * the size of the list after the whole range is inserted */
+		size_type final_size = _size.load(std::memory_order_relaxed) +
+			range_size(first, last, is_forward_iterator<InputIt>());
+
+		for (; first != last; ++first) {
+			size_type height = random_level((std::max)(
+				final_size,
+				_size.load(std::memory_order_relaxed) + sz));
+			persistent_node_ptr new_node =
+				create_node(std::forward_as_tuple(height),
+					    std::forward_as_tuple(*first));
+			node_ptr n = new_node.get();
+
+			if (!is_after_tail(tails[0], n)) {
+				if (internal_unsafe_insert(new_node).second)
+					find_tails(tails);
+				continue;
+			}
+
+			for (size_type level = 0; level < n->height();
+			     ++level) {
+				assert(tails[level]->next(level) == nullptr);
+				tails[level]->set_next_tx(level, new_node);
+				tails[level] = n;
+			}
+			++sz;
+		}
+
+		on_init_size += sz;
+		_size += sz;
+	}
+
+	/**
+	 * @return number of elements in the range [first, last).
+	 */
+	template <typename InputIt>
+	static size_type
+	range_size(InputIt first, InputIt last, std::true_type)
+	{
+		return static_cast<size_type>(std::distance(first, last));
+	}
+
+	/**
+	 * Input iterators can be traversed only once, the number of elements
+	 * is not known in advance.
+	 */
+	template <typename InputIt>
+	static size_type
+	range_size(InputIt, InputIt, std::false_type)
+	{
+		return 0;
+	}
+
+	/**
+	 * Checks whether the node n can be linked after the last node tail.
+	 */
+	bool
+	is_after_tail(const_node_ptr tail, const_node_ptr n) const
+	{
+		if (tail == dummy_head.get())
+			return true;
+
+		if (allow_multimapping)
+			return !_compare(get_key(n), get_key(tail));
+
+		return _compare(get_key(tail), get_key(n));
+	}
+
+	/**
+	 * Fills tails with the last node on each level (or the dummy head
+	 * for empty levels).
+	 */
+	void
+	find_tails(prev_array_type &tails)
+	{
+		node_ptr prev = dummy_head.get();
+		tails.fill(prev);
+
+		for (size_type h = search_height(); h > 0; --h) {
+			for (node_ptr next = prev->next(h - 1).get();
+			     next != nullptr; next = prev->next(h - 1).get())
+				prev = next;
+
+			tails[h - 1] = prev;
+		}
+	}
+
 	/**
 	 * Construct and insert new node to the skip list in a thread-safe way.
 	 */
@@ -2695,6 +3601,15 @@ private:
 		 */
 		new_node_lock = n->acquire();
 
+		/*
+		 * Hidden from snapshot scans until it gets its version. In
+		 * a transaction, before the runtime data is created, there are
+		 * no scans and the node keeps version 0.
+		 */
+		runtime_data *data = get_runtime_data();
+		if (data)
+			n->set_version(PENDING_VERSION);
+
 		obj::pool_base pop = get_pool_base();
 		/*
 		 * In the loop below we are linking a new node to all layers of
@@ -2704,26 +3619,41 @@ private:
 		 * OK if concurrent readers will see not a fully-linked node
 		 * because during recovery the insert procedure will be
 		 * completed.
+		 *
+		 * Unsafe inserts called in a transaction have to be rolled
+		 * back when it aborts, the links are snapshotted then.
 		 */
+		bool in_tx = pmemobj_tx_stage() == TX_STAGE_WORK;
 		for (size_type level = 0; level < height; ++level) {
 			assert(prev_nodes[level]->height() > level);
 			assert(prev_nodes[level]->next(level) ==
 			       next_nodes[level]);
 			assert(prev_nodes[level]->next(level) ==
 			       n->next(level));
-			prev_nodes[level]->set_next(pop, level, new_node);
+			if (in_tx)
+				prev_nodes[level]->set_next_tx(level,
+							       new_node);
+			else
+				prev_nodes[level]->set_next(pop, level,
+							    new_node);
 		}
 
 #ifndef NDEBUG
 		try_insert_node_finish_marker();
 #endif
 
+		/* a pending version must not outlive the entry in the TLS */
+		if (data)
+			n->set_version(pop, next_version(*data));
+
 		new_node = nullptr;
 		/* We need to persist the node pointer. Otherwise, on a restart,
 		 * this pointer might be not null but the node can be already
 		 * deleted. */
 		pop.persist(&new_node, sizeof(new_node));
 
+		if (in_tx)
+			obj::flat_transaction::snapshot((size_type *)&_size);
 		++_size;
 #if LIBPMEMOBJ_CPP_VG_PMEMCHECK_ENABLED
 		VALGRIND_PMC_DO_FLUSH(&_size, sizeof(_size));
@@ -2793,9 +3723,11 @@ private:
 		const_node_ptr prev = dummy_head.get();
 		assert(prev->height() > 0);
 		persistent_node_ptr next = nullptr;
+		key_prefix_type prefix = key_prefix(key);
 
-		for (size_type h = prev->height(); h > 0; --h) {
-			next = internal_find_position(h - 1, prev, key, cmp);
+		for (size_type h = search_height(); h > 0; --h) {
+			next = internal_find_position(h - 1, prev, key, prefix,
+						      cmp);
 		}
 
 		return const_iterator(next.get());
@@ -2819,9 +3751,11 @@ private:
 		node_ptr prev = dummy_head.get();
 		assert(prev->height() > 0);
 		persistent_node_ptr next = nullptr;
+		key_prefix_type prefix = key_prefix(key);
 
-		for (size_type h = prev->height(); h > 0; --h) {
-			next = internal_find_position(h - 1, prev, key, cmp);
+		for (size_type h = search_height(); h > 0; --h) {
+			next = internal_find_position(h - 1, prev, key, prefix,
+						      cmp);
 		}
 
 		return iterator(next.get());
@@ -2845,9 +3779,10 @@ private:
 	{
 		const_node_ptr prev = dummy_head.get();
 		assert(prev->height() > 0);
+		key_prefix_type prefix = key_prefix(key);
 
-		for (size_type h = prev->height(); h > 0; --h) {
-			internal_find_position(h - 1, prev, key, cmp);
+		for (size_type h = search_height(); h > 0; --h) {
+			internal_find_position(h - 1, prev, key, prefix, cmp);
 		}
 
 		if (prev == dummy_head.get())
@@ -2984,11 +3919,95 @@ private:
 			}));
 	}
 
-	/** Generate random level */
+	/**
+	 * Generate random level for the current size of the skip list. Raises
+	 * the bound of the heights before the node is searched for and
+	 * linked, so every search covers all levels of all nodes.
+	 */
 	size_type
 	random_level()
 	{
-		return _rnd_generator();
+		return random_level(_size.load(std::memory_order_relaxed));
+	}
+
+	/**
+	 * Generate random level for a skip list of the given size.
+	 *
+	 * In a transaction, before the runtime data is created, the bound is
+	 * not raised. It is computed from the dummy head when the data is
+	 * created and searches cover all levels until then.
+	 */
+	size_type
+	random_level(size_type size)
+	{
+		size_type height = _rnd_generator(size);
+		assert(height > 0 && height <= MAX_LEVEL);
+
+		runtime_data *data = get_runtime_data();
+		if (data == nullptr)
+			return height;
+
+		size_type max_height = load_max_height(*data);
+		while (max_height < height &&
+		       !data->max_height.compare_exchange_weak(max_height,
+							       height))
+			;
+
+		return height;
+	}
+
+	/** @return number of levels which have to be searched */
+	size_type
+	search_height() const
+	{
+		const runtime_data *data = get_runtime_data();
+		if (data == nullptr)
+			return MAX_LEVEL;
+
+		return load_max_height(*data);
+	}
+
+	/**
+	 * @return the bound of the heights, computes it if it is not known
+	 * (0).
+	 */
+	size_type
+	load_max_height(const runtime_data &data) const
+	{
+		size_type max_height =
+			data.max_height.load(std::memory_order_acquire);
+		if (max_height != 0)
+			return max_height;
+
+		/* only the first thread sets it, concurrent inserts raise it
+		 * afterwards */
+		size_type height = top_height();
+		if (data.max_height.compare_exchange_strong(max_height,
+							    height))
+			return height;
+
+		return max_height;
+	}
+
+	/**
+	 * Sets the bound of the heights to the height of the highest
+	 * non-empty level.
+	 */
+	void
+	restore_max_height(runtime_data &data)
+	{
+		data.max_height.store(top_height(), std::memory_order_relaxed);
+	}
+
+	/** @return number of non-empty levels, at least 1 */
+	size_type
+	top_height() const
+	{
+		size_type height = dummy_head->height();
+		while (height > 1 && dummy_head->next(height - 1) == nullptr)
+			--height;
+
+		return height;
 	}
 
 	static size_type
@@ -3026,6 +4045,8 @@ private:
 			std::forward<std::tuple<ValueArgs...>>(value_args),
 			index_sequence_for<ValueArgs...>{});
 
+		set_key_prefix(node.get(), key_prefix_enabled{});
+
 		return node;
 	}
 
@@ -3217,6 +4238,10 @@ private:
 			}
 		}
 
+		/* the version might have been left pending */
+		if (n->version() != 0)
+			n->set_version(pop, 0);
+
 		node = nullptr;
 		pop.persist(&node, sizeof(node));
 	}
@@ -3257,11 +4282,12 @@ private:
 
 template <typename Key, typename Value, typename KeyCompare,
 	  typename RND_GENERATOR, typename Allocator, bool AllowMultimapping,
-	  size_t MAX_LEVEL>
+	  size_t MAX_LEVEL, typename Mutex = pmem::obj::mutex>
 class map_traits {
 public:
 	static constexpr size_t max_level = MAX_LEVEL;
 	using random_generator_type = RND_GENERATOR;
+	using mutex_type = Mutex;
 	using key_type = Key;
 	using mapped_type = Value;
 	using compare_type = KeyCompare;
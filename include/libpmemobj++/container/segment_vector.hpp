@@ -12,6 +12,7 @@
 #include <libpmemobj++/container/array.hpp>
 #include <libpmemobj++/container/detail/segment_vector_policies.hpp>
 #include <libpmemobj++/container/vector.hpp>
+#include <libpmemobj++/defrag.hpp>
 #include <libpmemobj++/detail/common.hpp>
 #include <libpmemobj++/detail/life.hpp>
 #include <libpmemobj++/detail/temp_value.hpp>
@@ -22,6 +23,7 @@
 #include <libpmemobj++/transaction.hpp>
 #include <libpmemobj++/utils.hpp>
 
+#include <functional>
 #include <vector>
 
 namespace pmem
@@ -529,6 +531,9 @@ public:
 		segment_vector_internal::segment_iterator<segment_vector, true>;
 	using reverse_iterator = std::reverse_iterator<iterator>;
 	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	/* func argument type definition for 'for_each_ptr' method */
+	using for_each_ptr_function =
+		std::function<void(persistent_ptr_base &)>;
 
 	/* Constructors */
 	segment_vector();
@@ -597,6 +602,8 @@ public:
 	slice<const_iterator> range(size_type start, size_type n) const;
 	slice<const_iterator> crange(size_type start, size_type n) const;
 
+	void for_each_ptr(for_each_ptr_function func);
+
 	/* Capacity */
 	constexpr bool empty() const noexcept;
 	size_type size() const noexcept;
@@ -2416,6 +2423,25 @@ segment_vector<T, Policy>::swap(segment_vector &other)
 	});
 }
 
+/**
+ * Iterates over all internal pointers and executes a callback function
+ * on each of them. These are pointers to the data of every segment and,
+ * if segments are kept in a pmem::obj::vector, the pointer to its data.
+ *
+ * Pointers stored in the elements are not visited.
+ *
+ * @param func callback function to call on internal pointer.
+ */
+template <typename T, typename Policy>
+void
+segment_vector<T, Policy>::for_each_ptr(for_each_ptr_function func)
+{
+	detail::for_each_ptr_of(_data, func);
+
+	for (auto &segment : _data)
+		segment.for_each_ptr(func);
+}
+
 /**
  * Private helper method. Increases capacity.
  * Allocs new segments if new_capacity is greater than current capacity.
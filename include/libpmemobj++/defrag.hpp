@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: BSD-3-Clause
-/* Copyright 2020, Intel Corporation */
+/* Copyright 2020-2021, Intel Corporation */
 
 /**
  * @file
@@ -9,10 +9,19 @@
 #ifndef LIBPMEMOBJ_CPP_DEFRAG_HPP
 #define LIBPMEMOBJ_CPP_DEFRAG_HPP
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <string>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
+#include <libpmemobj++/detail/parallel_for.hpp>
 #include <libpmemobj++/detail/template_helpers.hpp>
+#include <libpmemobj++/pexceptions.hpp>
 #include <libpmemobj++/persistent_ptr_base.hpp>
 #include <libpmemobj++/pool.hpp>
 #include <libpmemobj/atomic_base.h>
@@ -33,6 +42,26 @@ using t_has_for_each_ptr = typename std::enable_if<
 
 template <typename T>
 using t_is_defragmentable = supports<T, t_has_for_each_ptr>;
+
+/**
+ * Calls t.for_each_ptr(func). Used by containers to pass the pointers of
+ * their elements to the defragmentation.
+ */
+template <typename T, typename F>
+typename std::enable_if<t_is_defragmentable<T>::value>::type
+for_each_ptr_of(T &t, F &&func)
+{
+	t.for_each_ptr(func);
+}
+
+/**
+ * Specialization for non-defragmentable types, does nothing.
+ */
+template <typename T, typename F>
+typename std::enable_if<!t_is_defragmentable<T>::value>::type
+for_each_ptr_of(T &, F &&)
+{
+}
 }
 
 namespace obj
@@ -193,7 +222,234 @@ public:
 		return result;
 	}
 
+	/**
+	 * Starts defragmentation with previously stored pointers, using
+	 * a number of threads.
+	 *
+	 * Pointers are split into groups, each passed to a separate
+	 * pool_base::defrag() call. Pointers to the same object, as well as
+	 * pointers stored inside an object and pointers to that object, are
+	 * always in the same group (e.g. a vector and the strings kept in it),
+	 * so no object is relocated by one thread while another thread updates
+	 * a pointer stored in it. If all pointers are connected this way,
+	 * the defragmentation runs in the calling thread, as in run().
+	 *
+	 * @param[in] concurrency number of threads to use.
+	 *
+	 * @return result struct containing a number of relocated and total
+	 *	processed objects, summed over all partitions.
+	 *
+	 * @throw pmem::transaction_scope_error if called inside a transaction.
+	 * @throw rethrows pmem::defrag_error when a failure during
+	 *	defragmentation of any partition occurs. Its result contains
+	 *	the summary stats of all partitions.
+	 */
+	pobj_defrag_result
+	run(size_t concurrency)
+	{
+		if (pmemobj_tx_stage() != TX_STAGE_NONE)
+			throw pmem::transaction_scope_error(
+				"parallel defragmentation cannot be run in a transaction");
+
+		if (concurrency <= 1 || this->container.size() < concurrency)
+			return run();
+
+		auto partitions = partition(concurrency);
+		if (partitions.size() <= 1)
+			return run();
+
+		concurrency = partitions.size();
+
+		std::vector<pobj_defrag_result> results(concurrency, {0, 0});
+		auto summary = [&] {
+			pobj_defrag_result result = {0, 0};
+			for (auto &r : results) {
+				result.total += r.total;
+				result.relocated += r.relocated;
+			}
+
+			return result;
+		};
+
+		try {
+			pmem::detail::parallel_for(
+				concurrency, concurrency,
+				[&](size_t first, size_t last) {
+					for (size_t i = first; i < last; ++i)
+						defrag_partition(partitions[i],
+								 results[i]);
+				});
+		} catch (pmem::defrag_error &err) {
+			throw pmem::defrag_error(summary(), err.what());
+		}
+
+		return summary();
+	}
+
 private:
+	/**
+	 * Defragments one group of pointers, stores the stats in result
+	 * also when pmem::defrag_error is thrown.
+	 */
+	void
+	defrag_partition(std::vector<persistent_ptr_base *> &ptrs,
+			 pobj_defrag_result &result)
+	{
+		try {
+			result = this->pop.defrag(ptrs.data(), ptrs.size());
+		} catch (pmem::defrag_error &e) {
+			result = e.result;
+			throw;
+		}
+	}
+
+	/**
+	 * Splits stored pointers into at most concurrency groups. Objects
+	 * pointed to by the stored pointers are joined (using union-find)
+	 * when one of them contains a pointer to the other, every connected
+	 * set of objects is then assigned, with all pointers to it, to
+	 * the least loaded group. Empty groups are not returned.
+	 */
+	std::vector<std::vector<persistent_ptr_base *>>
+	partition(size_t concurrency) const
+	{
+		/* distinct objects, sorted by offset */
+		std::vector<PMEMoid> objs;
+		objs.reserve(this->container.size());
+		for (auto ptr : this->container) {
+			if (!OID_IS_NULL(ptr->raw()))
+				objs.push_back(ptr->raw());
+		}
+
+		std::sort(objs.begin(), objs.end(),
+			  [](const PMEMoid &lhs, const PMEMoid &rhs) {
+				  return lhs.off < rhs.off;
+			  });
+		objs.erase(
+			std::unique(objs.begin(), objs.end(),
+				    [](const PMEMoid &lhs, const PMEMoid &rhs) {
+					    return lhs.off == rhs.off;
+				    }),
+			objs.end());
+
+		std::vector<uint64_t> ends(objs.size());
+		for (size_t i = 0; i < objs.size(); ++i)
+			ends[i] = objs[i].off +
+				pmemobj_alloc_usable_size(objs[i]);
+
+		auto index_of = [&](uint64_t off) {
+			return static_cast<size_t>(
+				std::lower_bound(
+					objs.begin(), objs.end(), off,
+					[](const PMEMoid &oid, uint64_t o) {
+						return oid.off < o;
+					}) -
+				objs.begin());
+		};
+
+		std::vector<size_t> parent(objs.size());
+		std::iota(parent.begin(), parent.end(), size_t(0));
+
+		auto find = [&](size_t i) {
+			while (parent[i] != i) {
+				parent[i] = parent[parent[i]];
+				i = parent[i];
+			}
+			return i;
+		};
+
+		/* address of offset 0 of the pool */
+		auto base = objs.empty()
+			? uintptr_t(0)
+			: reinterpret_cast<uintptr_t>(pmemobj_direct(objs[0])) -
+				objs[0].off;
+		for (auto ptr : this->container) {
+			if (OID_IS_NULL(ptr->raw()))
+				continue;
+
+			auto addr = reinterpret_cast<uintptr_t>(ptr);
+			if (addr < base)
+				continue;
+
+			/* the last object starting at or before the pointer */
+			uint64_t off = addr - base;
+			auto it = std::upper_bound(
+				objs.begin(), objs.end(), off,
+				[](uint64_t o, const PMEMoid &oid) {
+					return o < oid.off;
+				});
+			if (it == objs.begin())
+				continue;
+
+			size_t owner =
+				static_cast<size_t>(it - objs.begin()) - 1;
+			if (off >= ends[owner])
+				continue;
+
+			parent[find(owner)] = find(index_of(ptr->raw().off));
+		}
+
+		/* pointers of every connected set of objects */
+		std::vector<size_t> component(objs.size(), objs.size());
+		std::vector<std::vector<persistent_ptr_base *>> components;
+		std::vector<persistent_ptr_base *> nulls;
+		for (auto ptr : this->container) {
+			if (OID_IS_NULL(ptr->raw())) {
+				nulls.push_back(ptr);
+				continue;
+			}
+
+			size_t root = find(index_of(ptr->raw().off));
+			if (component[root] == objs.size()) {
+				component[root] = components.size();
+				components.emplace_back();
+			}
+			components[component[root]].push_back(ptr);
+		}
+
+		std::sort(components.begin(), components.end(),
+			  [](const std::vector<persistent_ptr_base *> &lhs,
+			     const std::vector<persistent_ptr_base *> &rhs) {
+				  return lhs.size() > rhs.size();
+			  });
+
+		/* (number of pointers, group index) of the least loaded group
+		 */
+		using load_type = std::pair<size_t, size_t>;
+		std::priority_queue<load_type, std::vector<load_type>,
+				    std::greater<load_type>>
+			loads;
+		for (size_t i = 0; i < concurrency; ++i)
+			loads.emplace(0, i);
+
+		std::vector<std::vector<persistent_ptr_base *>> partitions(
+			concurrency);
+		for (auto &c : components) {
+			auto least = loads.top();
+			loads.pop();
+
+			auto &p = partitions[least.second];
+			p.insert(p.end(), c.begin(), c.end());
+			loads.emplace(p.size(), least.second);
+		}
+
+		partitions.erase(
+			std::remove_if(
+				partitions.begin(), partitions.end(),
+				[](const std::vector<persistent_ptr_base *>
+					   &p) { return p.empty(); }),
+			partitions.end());
+
+		if (!nulls.empty()) {
+			if (partitions.empty())
+				partitions.emplace_back();
+			partitions[0].insert(partitions[0].end(), nulls.begin(),
+					     nulls.end());
+		}
+
+		return partitions;
+	}
+
 	std::vector<persistent_ptr_base *> container;
 	pool_base pop;
 };
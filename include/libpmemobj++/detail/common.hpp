@@ -275,6 +275,17 @@ Log2(uint64_t x)
 }
 #endif
 
+/** Hints the processor to fetch the cache line with addr */
+static inline void
+prefetch(const void *addr)
+{
+#if __GNUC__ || __clang__
+	__builtin_prefetch(addr);
+#else
+	(void)addr;
+#endif
+}
+
 #ifndef _MSC_VER
 
 /** Returns index of most significant set bit */
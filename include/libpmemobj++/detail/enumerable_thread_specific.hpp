@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: BSD-3-Clause
-/* Copyright 2019-2020, Intel Corporation */
+/* Copyright 2019-2021, Intel Corporation */
 
 /**
  * @file
@@ -16,6 +16,7 @@
 
 #include <cassert>
 #include <deque>
+#include <iterator>
 #include <mutex>
 #include <numeric>
 #include <thread>
@@ -440,6 +441,206 @@ enumerable_thread_specific<T, Mutex, Storage>::get_pool() const noexcept
 	return obj::pool_base(pop);
 }
 
+/**
+ * Slot which holds a T followed by enough padding that two slots stored
+ * contiguously never place their values in the same cache line.
+ *
+ * Persistent allocations are not guaranteed to be cache line aligned, so
+ * the padding is such that at least CACHELINE_SIZE - 1 bytes separate the
+ * end of one value from the beginning of the next one, regardless of the
+ * alignment of the first slot.
+ */
+template <typename T>
+struct cache_line_padded {
+	static constexpr size_t slot_size =
+		(sizeof(T) + 2 * CACHELINE_SIZE - 2) / CACHELINE_SIZE *
+		CACHELINE_SIZE;
+
+	T value;
+	char padding[slot_size - sizeof(T)];
+};
+
+/**
+ * Storage for enumerable_thread_specific which keeps every element in its
+ * own cache_line_padded slot.
+ *
+ * Elements of different threads are updated concurrently (e.g. size
+ * counters of concurrent containers), so keeping them in separate cache
+ * lines avoids false sharing between threads. Satisfies the Storage
+ * requirements of enumerable_thread_specific.
+ */
+template <typename T>
+class padded_segment_storage {
+	using slot_type = cache_line_padded<T>;
+	using slots_type =
+		obj::segment_vector<slot_type,
+				    obj::exponential_size_array_policy<>>;
+
+	template <typename SlotIterator, typename Value>
+	class iterator_impl {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = Value;
+		using difference_type = std::ptrdiff_t;
+		using reference = Value &;
+		using pointer = Value *;
+
+		iterator_impl() = default;
+
+		explicit iterator_impl(SlotIterator it) : it(it)
+		{
+		}
+
+		/** Conversion from non-const iterator. */
+		template <
+			typename OtherIterator, typename OtherValue,
+			typename = typename std::enable_if<std::is_convertible<
+				OtherIterator, SlotIterator>::value>::type>
+		iterator_impl(
+			const iterator_impl<OtherIterator, OtherValue> &rhs)
+		    : it(rhs.it)
+		{
+		}
+
+		reference operator*() const
+		{
+			return it->value;
+		}
+
+		pointer operator->() const
+		{
+			return &it->value;
+		}
+
+		iterator_impl &
+		operator++()
+		{
+			++it;
+			return *this;
+		}
+
+		iterator_impl
+		operator++(int)
+		{
+			iterator_impl tmp = *this;
+			++it;
+			return tmp;
+		}
+
+		bool
+		operator==(const iterator_impl &rhs) const
+		{
+			return it == rhs.it;
+		}
+
+		bool
+		operator!=(const iterator_impl &rhs) const
+		{
+			return it != rhs.it;
+		}
+
+	private:
+		template <typename, typename>
+		friend class iterator_impl;
+
+		SlotIterator it;
+	};
+
+public:
+	using value_type = T;
+	using size_type = typename slots_type::size_type;
+	using difference_type = typename slots_type::difference_type;
+	using reference = value_type &;
+	using const_reference = const value_type &;
+	using iterator = iterator_impl<typename slots_type::iterator, T>;
+	using const_iterator =
+		iterator_impl<typename slots_type::const_iterator, const T>;
+
+	template <typename... Args>
+	reference
+	emplace_back(Args &&... args)
+	{
+		return slots
+			.emplace_back(
+				slot_type{T(std::forward<Args>(args)...), {}})
+			.value;
+	}
+
+	void
+	resize(size_type count)
+	{
+		slots.resize(count);
+	}
+
+	reference operator[](size_type n)
+	{
+		return slots[n].value;
+	}
+
+	const_reference operator[](size_type n) const
+	{
+		return slots[n].value;
+	}
+
+	size_type
+	size() const noexcept
+	{
+		return slots.size();
+	}
+
+	bool
+	empty() const noexcept
+	{
+		return slots.empty();
+	}
+
+	void
+	clear()
+	{
+		slots.clear();
+	}
+
+	iterator
+	begin()
+	{
+		return iterator(slots.begin());
+	}
+
+	iterator
+	end()
+	{
+		return iterator(slots.end());
+	}
+
+	const_iterator
+	begin() const
+	{
+		return const_iterator(slots.begin());
+	}
+
+	const_iterator
+	end() const
+	{
+		return const_iterator(slots.end());
+	}
+
+private:
+	slots_type slots;
+};
+
+/**
+ * enumerable_thread_specific which keeps elements of different threads in
+ * separate cache lines.
+ *
+ * It uses more memory per thread than the default storage, but threads
+ * which frequently modify their elements do not invalidate cache lines of
+ * each other. The layout is not compatible with the default
+ * enumerable_thread_specific.
+ */
+template <typename T, typename Mutex = obj::shared_mutex>
+using padded_enumerable_thread_specific =
+	enumerable_thread_specific<T, Mutex, padded_segment_storage<T>>;
+
 } /* namespace detail */
 } /* namespace pmem */
 
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/**
+ * @file
+ * Splitting of a range of indexes between threads.
+ */
+
+#ifndef LIBPMEMOBJ_CPP_PARALLEL_FOR_HPP
+#define LIBPMEMOBJ_CPP_PARALLEL_FOR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace pmem
+{
+
+namespace detail
+{
+
+/*
+ * Splits [0, n) into (at most) concurrency ranges and calls f(first, last)
+ * for each of them in a separate thread. If there is only one range, f is
+ * called in the calling thread. After all threads finish, rethrows the
+ * exception thrown by f for the first range which failed.
+ *
+ * If a thread cannot be created, waits for the threads which were already
+ * started and throws std::system_error.
+ */
+template <typename F>
+void
+parallel_for(std::size_t concurrency, std::size_t n, F &&f)
+{
+	concurrency = (std::max)(std::size_t(1), (std::min)(concurrency, n));
+	if (concurrency == 1) {
+		f(std::size_t(0), n);
+		return;
+	}
+
+	std::vector<std::exception_ptr> errors(concurrency);
+	std::vector<std::thread> threads;
+	threads.reserve(concurrency);
+
+	try {
+		for (std::size_t i = 0; i < concurrency; ++i) {
+			threads.emplace_back([&, i] {
+				try {
+					f(n * i / concurrency,
+					  n * (i + 1) / concurrency);
+				} catch (...) {
+					errors[i] = std::current_exception();
+				}
+			});
+		}
+	} catch (...) {
+		/* joinable threads must not be destroyed */
+		for (auto &t : threads)
+			t.join();
+		throw;
+	}
+
+	for (auto &t : threads)
+		t.join();
+
+	for (auto &e : errors) {
+		if (e)
+			std::rethrow_exception(e);
+	}
+}
+
+} /* namespace detail */
+
+} /* namespace pmem */
+
+#endif /* LIBPMEMOBJ_CPP_PARALLEL_FOR_HPP */
@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/**
+ * @file
+ * Per-thread caches of pool handles and pool base addresses.
+ */
+
+#ifndef LIBPMEMOBJ_CPP_POOL_LOOKUP_CACHE_HPP
+#define LIBPMEMOBJ_CPP_POOL_LOOKUP_CACHE_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#include <libpmemobj/base.h>
+#include <libpmemobj/pool_base.h>
+
+namespace pmem
+{
+
+namespace detail
+{
+
+/**
+ * Counter of pools closed by this process. Changing it invalidates all
+ * per-thread pool lookup caches, because a closed pool's address range may
+ * be reused by a pool opened later.
+ */
+inline std::atomic<uint64_t> &
+pool_close_generation()
+{
+	static std::atomic<uint64_t> generation(0);
+	return generation;
+}
+
+/**
+ * Invalidates pool lookup caches of all threads. Must be called before a
+ * pool is closed.
+ */
+inline void
+invalidate_pool_lookup_cache()
+{
+	pool_close_generation().fetch_add(1, std::memory_order_acq_rel);
+}
+
+/**
+ * Returns a value which changes whenever a pool may have been closed.
+ *
+ * Where libpmemobj inlines pmemobj_direct(), every pmemobj_close()
+ * increments the counter of its own per-thread cache, so pools closed in
+ * any way (also from C code or from another shared object) are noticed.
+ * Elsewhere only pools closed by pmem::obj::pool_base::close() are.
+ */
+inline uint64_t
+pool_close_stamp() noexcept
+{
+#ifndef _WIN32
+	return static_cast<uint64_t>(
+		static_cast<unsigned>(_pobj_cache_invalidate));
+#else
+	return pool_close_generation().load(std::memory_order_acquire);
+#endif
+}
+
+/**
+ * Returns a handle to the pool which contains ptr, like
+ * pmemobj_pool_by_ptr().
+ *
+ * Each thread remembers the last pool it has resolved together with the
+ * range of addresses which were already found to belong to it. Pools are
+ * mapped contiguously, so any address within that range belongs to the same
+ * pool and the lookup is skipped. This makes repeated calls for objects from
+ * a single pool (e.g. locking mutexes of a concurrent container) cheap.
+ *
+ * The cache is invalidated when a pool is closed, see pool_close_stamp().
+ *
+ * @return handle to the pool or nullptr if ptr is not from a pool.
+ */
+inline PMEMobjpool *
+pool_by_ptr_cached(const void *ptr)
+{
+	struct cache_entry {
+		PMEMobjpool *pop;
+		uintptr_t lo;
+		uintptr_t hi;
+		uint64_t generation;
+	};
+
+	static thread_local cache_entry cache = {nullptr, 0, 0, 0};
+
+	auto addr = reinterpret_cast<uintptr_t>(ptr);
+	auto generation = pool_close_stamp();
+
+	if (cache.pop != nullptr && cache.generation == generation &&
+	    addr >= cache.lo && addr <= cache.hi)
+		return cache.pop;
+
+	PMEMobjpool *pop = pmemobj_pool_by_ptr(ptr);
+	if (pop == nullptr)
+		return nullptr;
+
+	if (pop == cache.pop && cache.generation == generation) {
+		if (addr < cache.lo)
+			cache.lo = addr;
+		else
+			cache.hi = addr;
+	} else {
+		cache = {pop, addr, addr, generation};
+	}
+
+	return pop;
+}
+
+/**
+ * Returns a direct pointer to the object identified by oid, like
+ * pmemobj_direct().
+ *
+ * Where libpmemobj inlines pmemobj_direct(), the inline function already
+ * keeps a per-thread cache of the last pool, so it is simply called. On
+ * Windows, pmemobj_direct() looks the pool up on every call, so each thread
+ * remembers the base address of the last pool it has accessed and for
+ * objects from that pool the result is computed as base + offset. The
+ * cache has the same invalidation rules as pool_by_ptr_cached().
+ *
+ * @return direct pointer or nullptr if oid is null or its pool is not open.
+ */
+inline void *
+pmemobj_direct_cached(PMEMoid oid) noexcept
+{
+#ifndef _WIN32
+	return pmemobj_direct(oid);
+#else
+	struct cache_entry {
+		uint64_t pool_uuid_lo;
+		char *base;
+		uint64_t generation;
+	};
+
+	static thread_local cache_entry cache = {0, nullptr, 0};
+
+	if (oid.off == 0)
+		return nullptr;
+
+	auto generation = pool_close_stamp();
+
+	if (oid.pool_uuid_lo == cache.pool_uuid_lo &&
+	    cache.generation == generation && cache.base != nullptr)
+		return cache.base + oid.off;
+
+	auto *ptr = static_cast<char *>(pmemobj_direct(oid));
+	if (ptr == nullptr)
+		return nullptr;
+
+	cache = {oid.pool_uuid_lo, ptr - oid.off, generation};
+
+	return ptr;
+#endif
+}
+
+} /* namespace detail */
+
+} /* namespace pmem */
+
+#endif /* LIBPMEMOBJ_CPP_POOL_LOOKUP_CACHE_HPP */
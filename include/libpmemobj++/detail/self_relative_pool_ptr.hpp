@@ -0,0 +1,264 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/**
+ * @file
+ * Self-relative pointer with the persistent_pool_ptr interface.
+ */
+
+#ifndef PMEMOBJ_SELF_RELATIVE_POOL_PTR_HPP
+#define PMEMOBJ_SELF_RELATIVE_POOL_PTR_HPP
+
+#include <cstddef>
+#include <type_traits>
+
+#include <libpmemobj++/detail/persistent_pool_ptr.hpp>
+#include <libpmemobj++/experimental/self_relative_ptr.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+
+namespace pmem
+{
+namespace detail
+{
+
+/**
+ * Drop-in replacement for persistent_pool_ptr which stores a
+ * self_relative_ptr.
+ *
+ * It has the same size as persistent_pool_ptr, but dereferencing it does not
+ * involve a pool lookup - the address is computed from the location of the
+ * pointer itself. The pool_uuid arguments are accepted only to keep the
+ * interface compatible and are ignored.
+ *
+ * Used by containers (e.g. concurrent_hash_map) which can be parametrized by
+ * the type of their internal node pointers.
+ */
+template <typename T>
+class self_relative_pool_ptr {
+	template <typename Y>
+	friend class self_relative_pool_ptr;
+
+	using ptr_type = pmem::obj::experimental::self_relative_ptr<T>;
+
+public:
+	/**
+	 * Type of an actual object with all qualifier removed,
+	 * used for easy underlying type access
+	 */
+	using element_type = typename ptr_type::element_type;
+
+	self_relative_pool_ptr() noexcept : ptr(nullptr)
+	{
+	}
+
+	/**
+	 * Default null constructor.
+	 */
+	self_relative_pool_ptr(std::nullptr_t) noexcept : ptr(nullptr)
+	{
+	}
+
+	/**
+	 * Copy constructor.
+	 */
+	self_relative_pool_ptr(const self_relative_pool_ptr &r) noexcept
+	    : ptr(r.ptr)
+	{
+	}
+
+	/**
+	 * Copy constructor from a different self_relative_pool_ptr<>.
+	 *
+	 * Available only for convertible types.
+	 */
+	template <typename Y,
+		  typename = typename std::enable_if<
+			  std::is_convertible<Y *, T *>::value>::type>
+	self_relative_pool_ptr(const self_relative_pool_ptr<Y> &r) noexcept
+	    : ptr(r.ptr)
+	{
+	}
+
+	/**
+	 * Copy constructor from a persistent_ptr.
+	 */
+	self_relative_pool_ptr(const pmem::obj::persistent_ptr<T> &r) noexcept
+	    : ptr(r)
+	{
+	}
+
+	/**
+	 * Assignment operator.
+	 *
+	 * Pointer assignment within a transaction automatically registers
+	 * this operation so that a rollback is possible.
+	 *
+	 * @throw pmem::transaction_error when adding the object to the
+	 *	transaction failed.
+	 */
+	self_relative_pool_ptr &
+	operator=(const self_relative_pool_ptr &r)
+	{
+		ptr = r.ptr;
+
+		return *this;
+	}
+
+	/**
+	 * Assignment operator from a persistent_ptr.
+	 *
+	 * @throw pmem::transaction_error when adding the object to the
+	 *	transaction failed.
+	 */
+	self_relative_pool_ptr &
+	operator=(const pmem::obj::persistent_ptr<T> &r)
+	{
+		ptr = r;
+
+		return *this;
+	}
+
+	self_relative_pool_ptr &
+	operator=(std::nullptr_t)
+	{
+		ptr = nullptr;
+
+		return *this;
+	}
+
+	/**
+	 * Get a direct pointer.
+	 *
+	 * @return a direct pointer to the object.
+	 */
+	element_type *
+	get(uint64_t) const noexcept
+	{
+		return ptr.get();
+	}
+
+	element_type *
+	operator()(uint64_t pool_uuid) const noexcept
+	{
+		return get(pool_uuid);
+	}
+
+	/**
+	 * Get a persistent pointer.
+	 *
+	 * @return a persistent pointer to the object.
+	 */
+	pmem::obj::persistent_ptr<T>
+	get_persistent_ptr(uint64_t) const noexcept
+	{
+		return ptr.to_persistent_ptr();
+	}
+
+	/**
+	 * Swaps two self_relative_pool_ptr objects of the same type.
+	 */
+	void
+	swap(self_relative_pool_ptr &other)
+	{
+		ptr.swap(other.ptr);
+	}
+
+	/*
+	 * Bool conversion operator.
+	 */
+	explicit operator bool() const noexcept
+	{
+		return static_cast<bool>(ptr);
+	}
+
+private:
+	ptr_type ptr;
+};
+
+/**
+ * Equality operator.
+ *
+ * @relates self_relative_pool_ptr
+ */
+template <typename T, typename Y>
+inline bool
+operator==(const self_relative_pool_ptr<T> &lhs,
+	   const self_relative_pool_ptr<Y> &rhs) noexcept
+{
+	return lhs.get(0) == rhs.get(0);
+}
+
+/**
+ * Inequality operator.
+ *
+ * @relates self_relative_pool_ptr
+ */
+template <typename T, typename Y>
+inline bool
+operator!=(const self_relative_pool_ptr<T> &lhs,
+	   const self_relative_pool_ptr<Y> &rhs) noexcept
+{
+	return !(lhs == rhs);
+}
+
+/**
+ * Inequality operator with nullptr.
+ *
+ * @relates self_relative_pool_ptr
+ */
+template <typename T>
+inline bool
+operator!=(const self_relative_pool_ptr<T> &lhs, std::nullptr_t) noexcept
+{
+	return static_cast<bool>(lhs);
+}
+
+/**
+ * Inequality operator with nullptr.
+ *
+ * @relates self_relative_pool_ptr
+ */
+template <typename T>
+inline bool
+operator!=(std::nullptr_t, const self_relative_pool_ptr<T> &lhs) noexcept
+{
+	return static_cast<bool>(lhs);
+}
+
+/**
+ * Equality operator with nullptr.
+ *
+ * @relates self_relative_pool_ptr
+ */
+template <typename T>
+inline bool
+operator==(const self_relative_pool_ptr<T> &lhs, std::nullptr_t) noexcept
+{
+	return !lhs;
+}
+
+/**
+ * Equality operator with nullptr.
+ *
+ * @relates self_relative_pool_ptr
+ */
+template <typename T>
+inline bool
+operator==(std::nullptr_t, const self_relative_pool_ptr<T> &lhs) noexcept
+{
+	return !lhs;
+}
+
+template <class T, class U>
+self_relative_pool_ptr<T>
+static_persistent_pool_pointer_cast(const self_relative_pool_ptr<U> &r)
+{
+	static_assert(std::is_convertible<T *, U *>::value,
+		      "Cannot cast self_relative_pool_ptr");
+	return self_relative_pool_ptr<T>(r);
+}
+
+} // namespace detail
+} // namespace pmem
+
+#endif // PMEMOBJ_SELF_RELATIVE_POOL_PTR_HPP
@@ -9,7 +9,10 @@
 #ifndef LIBPMEMOBJ_CPP_SELF_RELATIVE_PTR_BASE_IMPL_HPP
 #define LIBPMEMOBJ_CPP_SELF_RELATIVE_PTR_BASE_IMPL_HPP
 
+#include <atomic>
+#include <cassert>
 #include <cstdint>
+#include <stdexcept>
 #include <type_traits>
 
 #include <libpmemobj++/detail/common.hpp>
@@ -21,6 +24,67 @@ namespace pmem
 namespace detail
 {
 
+/**
+ * Underlying integer type of the offset stored in self_relative_ptr_base_impl
+ * (OffsetType itself or T for std::atomic<T>).
+ */
+template <typename OffsetType>
+struct self_relative_offset_value {
+	using type = OffsetType;
+};
+
+template <typename T>
+struct self_relative_offset_value<std::atomic<T>> {
+	using type = T;
+};
+
+/**
+ * True if the offset type is narrower than std::ptrdiff_t, so not every
+ * offset can be stored in it.
+ */
+template <typename OffsetType>
+struct is_narrow_self_relative_offset
+    : std::integral_constant<
+	      bool,
+	      (sizeof(typename self_relative_offset_value<OffsetType>::type) <
+	       sizeof(std::ptrdiff_t))> {
+};
+
+template <typename T>
+T
+narrow_self_relative_offset(std::ptrdiff_t offset, std::false_type) noexcept
+{
+	return static_cast<T>(offset);
+}
+
+template <typename T>
+T
+narrow_self_relative_offset(std::ptrdiff_t offset, std::true_type)
+{
+	if (static_cast<std::ptrdiff_t>(static_cast<T>(offset)) != offset)
+		throw std::out_of_range(
+			"self-relative offset does not fit in the offset type");
+
+	return static_cast<T>(offset);
+}
+
+/**
+ * Converts the offset to the type in which it is stored. For offset types
+ * narrower than std::ptrdiff_t the distance between the pointer and the
+ * pointed-to object must be representable in that type.
+ *
+ * @throw std::out_of_range if the offset does not fit in the offset type.
+ */
+template <typename OffsetType>
+typename self_relative_offset_value<OffsetType>::type
+narrow_self_relative_offset(std::ptrdiff_t offset) noexcept(
+	!is_narrow_self_relative_offset<OffsetType>::value)
+{
+	return narrow_self_relative_offset<
+		typename self_relative_offset_value<OffsetType>::type>(
+		offset, is_narrow_self_relative_offset<OffsetType>{});
+}
+
 /**
  * self_relative_ptr base template class
  *
@@ -69,9 +133,13 @@ public:
 	 * Volatile pointer constructor.
 	 *
 	 * @param ptr volatile pointer, pointing to persistent memory.
+	 *
+	 * @throw std::out_of_range if the offset to ptr does not fit in
+	 *	OffsetType.
 	 */
-	self_relative_ptr_base_impl(void *ptr) noexcept
-	    : offset(pointer_to_offset(ptr))
+	self_relative_ptr_base_impl(void *ptr) noexcept(
+		!is_narrow_self_relative_offset<OffsetType>::value)
+	    : offset(narrow_offset(pointer_to_offset(ptr)))
 	{
 	}
 
@@ -79,10 +147,15 @@ public:
 	 * Copy constructor.
 	 *
 	 * @param r pointer to the same type.
+	 *
+	 * @throw std::out_of_range if the offset to the pointed-to object
+	 *	does not fit in OffsetType.
 	 */
 	self_relative_ptr_base_impl(
-		self_relative_ptr_base_impl const &r) noexcept
-	    : offset(pointer_to_offset(r))
+		self_relative_ptr_base_impl const &
+			r) noexcept(!is_narrow_self_relative_offset<OffsetType>::
+					    value)
+	    : offset(narrow_offset(pointer_to_offset(r)))
 	{
 	}
 
@@ -102,7 +175,7 @@ public:
 		if (this == &r)
 			return *this;
 		detail::conditional_add_to_tx(this);
-		offset = pointer_to_offset(r);
+		offset = narrow_offset(pointer_to_offset(r));
 		return *this;
 	}
 
@@ -116,7 +189,7 @@ public:
 	operator=(std::nullptr_t &&)
 	{
 		detail::conditional_add_to_tx(this);
-		offset = pointer_to_offset(nullptr);
+		offset = narrow_offset(pointer_to_offset(nullptr));
 		return *this;
 	}
 
@@ -134,8 +207,8 @@ public:
 		detail::conditional_add_to_tx(&other);
 		auto first = this->to_byte_pointer();
 		auto second = other.to_byte_pointer();
-		this->offset = pointer_to_offset(second);
-		other.offset = other.pointer_to_offset(first);
+		this->offset = narrow_offset(pointer_to_offset(second));
+		other.offset = narrow_offset(other.pointer_to_offset(first));
 	}
 
 	/**
@@ -197,8 +270,9 @@ protected:
 	 *
 	 * @param offset offset from self.
 	 */
-	self_relative_ptr_base_impl(difference_type offset) noexcept
-	    : offset(offset)
+	self_relative_ptr_base_impl(difference_type offset) noexcept(
+		!is_narrow_self_relative_offset<OffsetType>::value)
+	    : offset(narrow_offset(offset))
 	{
 	}
 
@@ -279,6 +353,16 @@ protected:
 		return new_offset;
 	}
 
+	/**
+	 * Conversion of the offset to the stored type
+	 */
+	static typename self_relative_offset_value<OffsetType>::type
+	narrow_offset(difference_type other_offset) noexcept(
+		!is_narrow_self_relative_offset<OffsetType>::value)
+	{
+		return narrow_self_relative_offset<OffsetType>(other_offset);
+	}
+
 	/* The offset from self */
 	offset_type offset;
 
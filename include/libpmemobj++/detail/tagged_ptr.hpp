@@ -46,6 +46,15 @@ struct tagged_ptr_impl {
 		assert(get<P2>() == ptr.get());
 	}
 
+	explicit tagged_ptr_impl(P1 *ptr) : ptr(add_tag(ptr))
+	{
+		assert(get<P1>() == ptr);
+	}
+
+	explicit tagged_ptr_impl(P2 *ptr) : ptr(ptr)
+	{
+	}
+
 	tagged_ptr_impl &operator=(const tagged_ptr_impl &rhs) = default;
 
 	tagged_ptr_impl &operator=(std::nullptr_t)
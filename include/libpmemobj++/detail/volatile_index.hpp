@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/**
+ * @file
+ * A volatile index of a persistent container, rebuilt on demand.
+ *
+ * This feature requires C++14 support.
+ */
+
+#ifndef LIBPMEMOBJ_CPP_VOLATILE_INDEX_HPP
+#define LIBPMEMOBJ_CPP_VOLATILE_INDEX_HPP
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+
+#include <libpmemobj++/detail/volatile_state.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+namespace pmem
+{
+
+namespace detail
+{
+
+/**
+ * Volatile part of a persistent container, kept in
+ * pmem::detail::volatile_state under the oid of the container.
+ *
+ * Data holds what the container derives from its persistent data, e.g.
+ * inner nodes or counters. The mutex serializes modifications of the
+ * container with respect to readers. When the index is not valid (it was
+ * just created, e.g. after the pool was reopened, or a transaction which
+ * modified the container aborted), it is rebuilt by the container, which
+ * must provide a rebuild(volatile_index &) const method accessible to this
+ * class.
+ */
+template <typename Data>
+struct volatile_index : Data {
+	using rwlock_type = std::shared_timed_mutex;
+	using shared_lock_type = std::shared_lock<rwlock_type>;
+	using unique_lock_type = std::unique_lock<rwlock_type>;
+
+	/**
+	 * Returns the index of the container, creates it on the first use.
+	 *
+	 * @throw pmem::transaction_scope_error if the index does not exist
+	 * yet and this function is called in a transaction.
+	 */
+	static volatile_index &
+	get(const void *container)
+	{
+		return *volatile_state::get<volatile_index>(
+			pmemobj_oid(container));
+	}
+
+	/**
+	 * Returns the index of the container or nullptr if it was not
+	 * created yet.
+	 */
+	static volatile_index *
+	get_if_exists(const void *container)
+	{
+		return volatile_state::get_if_exists<volatile_index>(
+			pmemobj_oid(container));
+	}
+
+	/**
+	 * Frees the index of the container, when the current transaction
+	 * commits if called in a transaction.
+	 */
+	static void
+	destroy(const void *container)
+	{
+		volatile_state::destroy(pmemobj_oid(container));
+	}
+
+	/** Rebuilds the index if it's not valid, called with exclusive lock */
+	template <typename Container>
+	void
+	validate(const Container &c)
+	{
+		if (!valid)
+			c.rebuild(*this);
+	}
+
+	/** Takes the shared lock of a valid index */
+	template <typename Container>
+	shared_lock_type
+	lock_shared(const Container &c)
+	{
+		shared_lock_type lock(mutex);
+		while (!valid) {
+			lock.unlock();
+			{
+				unique_lock_type ulock(mutex);
+				validate(c);
+			}
+			lock.lock();
+		}
+
+		return lock;
+	}
+
+	/**
+	 * If the container is modified in an outer transaction, the index
+	 * may not match the persistent data after that transaction aborts.
+	 */
+	void
+	invalidate_on_abort()
+	{
+		if (pmemobj_tx_stage() != TX_STAGE_WORK)
+			return;
+
+		obj::flat_transaction::register_callback(
+			obj::flat_transaction::stage::onabort,
+			[this] { valid = false; });
+	}
+
+	rwlock_type mutex;
+
+	/* cleared without the lock when a transaction aborts */
+	std::atomic<bool> valid{false};
+};
+
+} /* namespace detail */
+
+} /* namespace pmem */
+
+#endif /* LIBPMEMOBJ_CPP_VOLATILE_INDEX_HPP */
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: BSD-3-Clause
-/* Copyright 2019-2020, Intel Corporation */
+/* Copyright 2019-2021, Intel Corporation */
 
 /**
  * @file
@@ -11,7 +11,9 @@
 #ifndef LIBPMEMOBJ_CPP_VOLATILE_STATE_HPP
 #define LIBPMEMOBJ_CPP_VOLATILE_STATE_HPP
 
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -34,6 +36,13 @@ namespace detail
  * Global key value store which allows persistent objects to
  * use volatile memory. Entries in this kv store are indexed
  * by PMEMoids.
+ *
+ * The store is split into shards, each protected by its own lock, so
+ * that lookups of different objects do not contend on a single lock.
+ * Additionally, every thread keeps a small cache of recently found
+ * entries. A cached entry is validated against a per-shard generation
+ * counter, which is incremented whenever entries are removed from the
+ * shard, so repeated lookups of the same object take no lock at all.
  */
 class volatile_state {
 public:
@@ -41,15 +50,27 @@ public:
 	static T *
 	get_if_exists(const PMEMoid &oid)
 	{
-		auto &map = get_map();
+		auto &s = get_shard(oid);
+		auto &entry = get_cache_entry(oid);
+
+		if (entry.ptr != nullptr &&
+		    entry.oid.pool_uuid_lo == oid.pool_uuid_lo &&
+		    entry.oid.off == oid.off &&
+		    entry.generation ==
+			    s.generation.load(std::memory_order_acquire))
+			return static_cast<T *>(entry.ptr);
 
 		{
-			std::shared_lock<rwlock_type> lock(get_rwlock());
-			auto it = map.find(oid);
-			if (it != map.end())
-				return static_cast<T *>(it->second.get());
-			else
+			std::shared_lock<rwlock_type> lock(s.rwlock);
+			auto it = s.map.find(oid);
+			if (it == s.map.end())
 				return nullptr;
+
+			/* generation is modified only under exclusive lock */
+			entry = {oid, it->second.get(),
+				 s.generation.load(std::memory_order_relaxed)};
+
+			return static_cast<T *>(it->second.get());
 		}
 	}
 
@@ -57,8 +78,6 @@ public:
 	static T *
 	get(const PMEMoid &oid)
 	{
-		auto &map = get_map();
-
 		auto element = get_if_exists<T>(oid);
 		if (element)
 			return element;
@@ -67,17 +86,19 @@ public:
 			throw pmem::transaction_scope_error(
 				"volatile_state::get() cannot be called in a transaction");
 
+		auto &s = get_shard(oid);
+
 		{
-			std::unique_lock<rwlock_type> lock(get_rwlock());
+			std::unique_lock<rwlock_type> lock(s.rwlock);
 
 			auto deleter = [](void const *data) {
 				T const *p = static_cast<T const *>(data);
 				delete p;
 			};
 
-			auto it = map.find(oid);
-			if (it == map.end()) {
-				auto ret = map.emplace(
+			auto it = s.map.find(oid);
+			if (it == s.map.end()) {
+				auto ret = s.map.emplace(
 					std::piecewise_construct,
 					std::forward_as_tuple(oid),
 					std::forward_as_tuple(new T, deleter));
@@ -108,14 +129,10 @@ public:
 	{
 		if (pmemobj_tx_stage() == TX_STAGE_WORK) {
 			obj::flat_transaction::register_callback(
-				obj::flat_transaction::stage::oncommit, [oid] {
-					std::unique_lock<rwlock_type> lock(
-						get_rwlock());
-					get_map().erase(oid);
-				});
+				obj::flat_transaction::stage::oncommit,
+				[oid] { erase(oid); });
 		} else {
-			std::unique_lock<rwlock_type> lock(get_rwlock());
-			get_map().erase(oid);
+			erase(oid);
 		}
 	}
 
@@ -147,32 +164,77 @@ private:
 
 	using rwlock_type = std::shared_timed_mutex;
 
+	static constexpr std::size_t shards_number = 64;
+
+	static constexpr std::size_t thread_cache_size = 8;
+
+	struct shard {
+		/* read by every lookup, kept apart from the lock and map */
+		alignas(CACHELINE_SIZE) std::atomic<uint64_t> generation;
+
+		alignas(CACHELINE_SIZE) rwlock_type rwlock;
+		map_type map;
+	};
+
+	struct cache_entry {
+		PMEMoid oid;
+		void *ptr;
+		uint64_t generation;
+	};
+
+	static std::size_t
+	shard_index(const PMEMoid &oid)
+	{
+		/* objects are at least 16-byte aligned */
+		return ((oid.off >> 4) ^ oid.pool_uuid_lo) % shards_number;
+	}
+
+	static shard &
+	get_shard(const PMEMoid &oid)
+	{
+		return get_shards()[shard_index(oid)];
+	}
+
+	static cache_entry &
+	get_cache_entry(const PMEMoid &oid)
+	{
+		static thread_local cache_entry cache[thread_cache_size] = {};
+
+		return cache[shard_index(oid) % thread_cache_size];
+	}
+
 	static void
-	clear_from_pool(uint64_t pool_id)
+	erase(const PMEMoid &oid)
 	{
-		std::unique_lock<rwlock_type> lock(get_rwlock());
-		auto &map = get_map();
-
-		for (auto it = map.begin(); it != map.end();) {
-			if (it->first.pool_uuid_lo == pool_id)
-				it = map.erase(it);
-			else
-				++it;
-		}
+		auto &s = get_shard(oid);
+
+		std::unique_lock<rwlock_type> lock(s.rwlock);
+
+		s.generation.fetch_add(1, std::memory_order_release);
+		s.map.erase(oid);
 	}
 
-	static map_type &
-	get_map()
+	static void
+	clear_from_pool(uint64_t pool_id)
 	{
-		static map_type map;
-		return map;
+		for (auto &s : get_shards()) {
+			std::unique_lock<rwlock_type> lock(s.rwlock);
+
+			s.generation.fetch_add(1, std::memory_order_release);
+
+			for (auto it = s.map.begin(); it != s.map.end();) {
+				if (it->first.pool_uuid_lo == pool_id)
+					it = s.map.erase(it);
+				else
+					++it;
+			}
+		}
 	}
 
-	static rwlock_type &
-	get_rwlock()
+	static shard (&get_shards())[shards_number]
 	{
-		static rwlock_type rwlock;
-		return rwlock;
+		static shard shards[shards_number];
+		return shards;
 	}
 };
 
@@ -0,0 +1,278 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/**
+ * @file
+ * Pmem-resident shared mutex which spins before blocking.
+ */
+
+#ifndef LIBPMEMOBJ_CPP_ADAPTIVE_SHARED_MUTEX_HPP
+#define LIBPMEMOBJ_CPP_ADAPTIVE_SHARED_MUTEX_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#include <libpmemobj++/detail/atomic_backoff.hpp>
+#include <libpmemobj++/pexceptions.hpp>
+#include <libpmemobj++/shared_mutex.hpp>
+
+namespace pmem
+{
+
+namespace obj
+{
+
+namespace experimental
+{
+
+/**
+ * Contention counters of a class of locks.
+ */
+struct lock_contention_stats {
+	/** Number of acquisitions which did not succeed at the first try. */
+	uint64_t contended;
+
+	/** Number of contended acquisitions which succeeded while spinning. */
+	uint64_t spin_acquired;
+
+	/** Number of contended acquisitions which had to block. */
+	uint64_t parked;
+};
+
+/**
+ * Persistent memory resident shared_mutex which spins before blocking.
+ *
+ * When the lock is taken, the calling thread retries with a bounded
+ * exponential backoff (see detail::atomic_backoff) and only if the lock is
+ * still not available it blocks in the underlying pmem::obj::shared_mutex.
+ * This is beneficial for locks protecting very short critical sections,
+ * e.g. buckets of concurrent_hash_map, where putting a thread to sleep costs
+ * much more than the critical section itself.
+ *
+ * All locks with the same Tag share contention counters, which can be read
+ * by stats(). Only contended acquisitions update the counters, so the
+ * uncontended path has the same cost as for pmem::obj::shared_mutex.
+ *
+ * The layout is the same as of pmem::obj::shared_mutex. It satisfies the
+ * SharedMutex and StandardLayoutType concepts and can be used as the
+ * MutexType of concurrent_hash_map:
+ * @code
+ * struct bucket_lock_tag;
+ * using map_type = pmem::obj::concurrent_hash_map<
+ *	Key, T, std::hash<Key>, std::equal_to<Key>,
+ *	pmem::obj::experimental::adaptive_shared_mutex<bucket_lock_tag>>;
+ * @endcode
+ * @ingroup synchronization
+ */
+template <typename Tag = void>
+class adaptive_shared_mutex {
+public:
+	/** Implementation defined handle to the native type. */
+	using native_handle_type = pmem::obj::shared_mutex::native_handle_type;
+
+	/**
+	 * Default constructor.
+	 *
+	 * @throw lock_error when the mutex is not from persistent memory.
+	 */
+	adaptive_shared_mutex() = default;
+
+	/**
+	 * Defaulted destructor.
+	 */
+	~adaptive_shared_mutex() = default;
+
+	/**
+	 * Lock the mutex for exclusive access.
+	 *
+	 * @throw lock_error when an error occurs, this includes all
+	 * system related errors with the underlying implementation of
+	 * the mutex.
+	 */
+	void
+	lock()
+	{
+		if (mtx.try_lock())
+			return;
+
+		if (spin([&] { return mtx.try_lock(); }))
+			return;
+
+		mtx.lock();
+	}
+
+	/**
+	 * Lock the mutex for shared access.
+	 *
+	 * @throw lock_error when an error occurs, this includes all
+	 * system related errors with the underlying implementation of
+	 * the mutex.
+	 */
+	void
+	lock_shared()
+	{
+		if (mtx.try_lock_shared())
+			return;
+
+		if (spin([&] { return mtx.try_lock_shared(); }))
+			return;
+
+		mtx.lock_shared();
+	}
+
+	/**
+	 * Try to lock the mutex for exclusive access, returns
+	 * regardless if the lock succeeds. Does not spin.
+	 *
+	 * @return `true` on successful lock acquisition, `false`
+	 * otherwise.
+	 *
+	 * @throw lock_error when an error occurs.
+	 */
+	bool
+	try_lock()
+	{
+		return mtx.try_lock();
+	}
+
+	/**
+	 * Try to lock the mutex for shared access, returns
+	 * regardless if the lock succeeds. Does not spin.
+	 *
+	 * @return `true` on successful lock acquisition, `false`
+	 * otherwise.
+	 *
+	 * @throw lock_error when an error occurs.
+	 */
+	bool
+	try_lock_shared()
+	{
+		return mtx.try_lock_shared();
+	}
+
+	/**
+	 * Unlocks the mutex locked for exclusive access.
+	 */
+	void
+	unlock()
+	{
+		mtx.unlock();
+	}
+
+	/**
+	 * Unlocks the mutex locked for shared access.
+	 */
+	void
+	unlock_shared()
+	{
+		mtx.unlock_shared();
+	}
+
+	/**
+	 * Access a native handle to this shared mutex.
+	 *
+	 * @return a pointer to PMEMrwlock.
+	 */
+	native_handle_type
+	native_handle() noexcept
+	{
+		return mtx.native_handle();
+	}
+
+	/**
+	 * The type of lock needed for the transaction API.
+	 *
+	 * @return TX_PARAM_RWLOCK
+	 */
+	enum pobj_tx_param
+	lock_type() const noexcept
+	{
+		return mtx.lock_type();
+	}
+
+	/**
+	 * Returns contention counters of all locks with the same Tag.
+	 */
+	static lock_contention_stats
+	stats() noexcept
+	{
+		auto &c = counters();
+		return {c.contended.load(std::memory_order_relaxed),
+			c.spin_acquired.load(std::memory_order_relaxed),
+			c.parked.load(std::memory_order_relaxed)};
+	}
+
+	/**
+	 * Zeroes contention counters of all locks with the same Tag.
+	 */
+	static void
+	reset_stats() noexcept
+	{
+		auto &c = counters();
+		c.contended.store(0, std::memory_order_relaxed);
+		c.spin_acquired.store(0, std::memory_order_relaxed);
+		c.parked.store(0, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Deleted assignment operator.
+	 */
+	adaptive_shared_mutex &
+	operator=(const adaptive_shared_mutex &) = delete;
+
+	/**
+	 * Deleted copy constructor.
+	 */
+	adaptive_shared_mutex(const adaptive_shared_mutex &) = delete;
+
+private:
+	struct atomic_counters {
+		std::atomic<uint64_t> contended;
+		std::atomic<uint64_t> spin_acquired;
+		std::atomic<uint64_t> parked;
+	};
+
+	static atomic_counters &
+	counters() noexcept
+	{
+		static atomic_counters c = {{0}, {0}, {0}};
+		return c;
+	}
+
+	/*
+	 * Retries try_acquire with an exponential backoff. Returns false if
+	 * the lock was not acquired before the backoff got saturated.
+	 */
+	template <typename F>
+	static bool
+	spin(F &&try_acquire)
+	{
+		auto &c = counters();
+		c.contended.fetch_add(1, std::memory_order_relaxed);
+
+		pmem::detail::atomic_backoff backoff;
+		bool saturated = false;
+		while (!saturated) {
+			saturated = !backoff.bounded_pause();
+
+			if (try_acquire()) {
+				c.spin_acquired.fetch_add(
+					1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+
+		c.parked.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	pmem::obj::shared_mutex mtx;
+};
+
+} /* namespace experimental */
+
+} /* namespace obj */
+
+} /* namespace pmem */
+
+#endif /* LIBPMEMOBJ_CPP_ADAPTIVE_SHARED_MUTEX_HPP */
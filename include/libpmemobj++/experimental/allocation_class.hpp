@@ -0,0 +1,317 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/**
+ * @file
+ * Typed helpers for custom allocation classes and arenas.
+ */
+
+#ifndef LIBPMEMOBJ_CPP_ALLOCATION_CLASS_HPP
+#define LIBPMEMOBJ_CPP_ALLOCATION_CLASS_HPP
+
+#include <cstddef>
+#include <string>
+
+#include <libpmemobj++/allocation_flag.hpp>
+#include <libpmemobj++/detail/ctl.hpp>
+#include <libpmemobj++/pexceptions.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj/ctl.h>
+
+namespace pmem
+{
+
+namespace obj
+{
+
+namespace experimental
+{
+
+/**
+ * Custom allocation class of a pool.
+ *
+ * Objects of a single size can be allocated from a class with a unit
+ * exactly matching that size, without padding to the nearest generic size
+ * class. It is especially useful for nodes of containers, e.g.:
+ * @code
+ * auto cls = pmem::obj::experimental::allocation_class::create(
+ *	pop, map_type::node_allocation_size());
+ * map.set_node_allocation_flag(cls.flag());
+ * @endcode
+ *
+ * Allocation classes are not persistent, they have to be registered every
+ * time the pool is opened.
+ */
+class allocation_class {
+public:
+	/** Default number of units in a single run of the class. */
+	static constexpr unsigned default_units_per_block = 1000;
+
+	/**
+	 * Registers a new allocation class, which serves objects of the
+	 * given size.
+	 *
+	 * @param[in] pop pool in which the class is registered.
+	 * @param[in] size size of objects allocated from the class, the
+	 *	unit size is extended by the size of the object header.
+	 * @param[in] units_per_block number of units in a single run.
+	 * @param[in] header type of the object header.
+	 * @param[in] alignment required alignment of objects or 0 for the
+	 *	default one.
+	 *
+	 * @throw pmem::ctl_error if the class cannot be registered.
+	 */
+	static allocation_class
+	create(pool_base &pop, size_t size,
+	       unsigned units_per_block = default_units_per_block,
+	       pobj_header_type header = POBJ_HEADER_COMPACT,
+	       size_t alignment = 0)
+	{
+		pobj_alloc_class_desc desc;
+		desc.unit_size = unit_size_for(size, header);
+		desc.alignment = alignment;
+		desc.units_per_block = units_per_block;
+		desc.header_type = header;
+		desc.class_id = 0;
+
+		desc = ctl_set_detail(pop.handle(), "heap.alloc_class.new.desc",
+				      desc);
+
+		return allocation_class(desc.class_id, desc.unit_size);
+	}
+
+	/**
+	 * Registers a new allocation class, which serves objects of type T.
+	 *
+	 * @throw pmem::ctl_error if the class cannot be registered.
+	 */
+	template <typename T>
+	static allocation_class
+	create_for(pool_base &pop,
+		   unsigned units_per_block = default_units_per_block,
+		   pobj_header_type header = POBJ_HEADER_COMPACT)
+	{
+		return create(pop, sizeof(T), units_per_block, header,
+			      alignof(T) > alignof(std::max_align_t)
+				      ? alignof(T)
+				      : 0);
+	}
+
+	/**
+	 * @return id of the class.
+	 */
+	unsigned
+	id() const noexcept
+	{
+		return class_id;
+	}
+
+	/**
+	 * @return size of a single unit of the class, including the object
+	 *	header.
+	 */
+	size_t
+	unit_size() const noexcept
+	{
+		return size;
+	}
+
+	/**
+	 * @return flag which makes make_persistent allocate from the class.
+	 */
+	allocation_flag
+	flag() const
+	{
+		return allocation_flag::class_id(class_id);
+	}
+
+	/**
+	 * @return flag which makes make_persistent_atomic allocate from the
+	 *	class.
+	 */
+	allocation_flag_atomic
+	flag_atomic() const
+	{
+		return allocation_flag_atomic::class_id(class_id);
+	}
+
+private:
+	allocation_class(unsigned id, size_t unit_size) noexcept
+	    : class_id(id), size(unit_size)
+	{
+	}
+
+	static size_t
+	unit_size_for(size_t size, pobj_header_type header) noexcept
+	{
+		/* see pmemobj_ctl_get(3) */
+		size_t header_size = header == POBJ_HEADER_LEGACY
+			? 64
+			: (header == POBJ_HEADER_COMPACT ? 16 : 0);
+
+		/* keep objects 8-byte aligned */
+		return (size + header_size + 7) & ~size_t(7);
+	}
+
+	unsigned class_id;
+	size_t size;
+};
+
+/**
+ * Arena of a pool.
+ *
+ * Every arena has its own runs, so threads (or containers) which allocate
+ * from different arenas do not contend with each other. A thread can be
+ * bound to an arena with scoped_thread_arena, a single allocation can be
+ * directed to an arena with flag().
+ */
+class arena {
+public:
+	/**
+	 * Binds the object with an existing arena.
+	 */
+	arena(pool_base p, unsigned id) noexcept : pop(p), arena_id(id)
+	{
+	}
+
+	/**
+	 * Creates a new arena. It is not used by threads automatically.
+	 *
+	 * @throw pmem::ctl_error if the arena cannot be created.
+	 */
+	static arena
+	create(pool_base &pop)
+	{
+		unsigned id = ctl_exec_detail<unsigned>(pop.handle(),
+							"heap.arena.create", 0);
+		return arena(pop, id);
+	}
+
+	/**
+	 * Returns the arena the calling thread allocates from.
+	 *
+	 * @throw pmem::ctl_error if the arena cannot be read.
+	 */
+	static arena
+	current(pool_base &pop)
+	{
+		return arena(pop,
+			     ctl_get_detail<unsigned>(pop.handle(),
+						      "heap.thread.arena_id"));
+	}
+
+	/**
+	 * @return id of the arena.
+	 */
+	unsigned
+	id() const noexcept
+	{
+		return arena_id;
+	}
+
+	/**
+	 * @return number of bytes allocated from the arena.
+	 *
+	 * @throw pmem::ctl_error if the size cannot be read.
+	 */
+	size_t
+	size()
+	{
+		return ctl_get_detail<size_t>(pop.handle(), prefix() + ".size");
+	}
+
+	/**
+	 * Enables or disables assigning the arena to threads automatically.
+	 *
+	 * @throw pmem::ctl_error if the setting cannot be changed.
+	 */
+	void
+	set_automatic(bool automatic)
+	{
+		ctl_set_detail<int>(pop.handle(), prefix() + ".automatic",
+				    automatic ? 1 : 0);
+	}
+
+	/**
+	 * @return flag which makes make_persistent allocate from the arena.
+	 */
+	allocation_flag
+	flag() const
+	{
+		return allocation_flag::arena_id(arena_id);
+	}
+
+	/**
+	 * @return flag which makes make_persistent_atomic allocate from the
+	 *	arena.
+	 */
+	allocation_flag_atomic
+	flag_atomic() const
+	{
+		return allocation_flag_atomic::arena_id(arena_id);
+	}
+
+	/**
+	 * Binds the calling thread with the arena.
+	 *
+	 * @throw pmem::ctl_error if the arena cannot be set.
+	 */
+	void
+	bind_thread()
+	{
+		ctl_set_detail<unsigned>(pop.handle(), "heap.thread.arena_id",
+					 arena_id);
+	}
+
+private:
+	friend class scoped_thread_arena;
+
+	std::string
+	prefix() const
+	{
+		return "heap.arena." + std::to_string(arena_id);
+	}
+
+	pool_base pop;
+	unsigned arena_id;
+};
+
+/**
+ * Binds the calling thread with an arena for the lifetime of the object
+ * and restores the previous arena at destruction.
+ */
+class scoped_thread_arena {
+public:
+	/**
+	 * @throw pmem::ctl_error if the arena cannot be set.
+	 */
+	explicit scoped_thread_arena(arena a) : previous(arena::current(a.pop))
+	{
+		a.bind_thread();
+	}
+
+	/**
+	 * Restores the previous arena, errors are ignored.
+	 */
+	~scoped_thread_arena()
+	{
+		try {
+			previous.bind_thread();
+		} catch (...) {
+		}
+	}
+
+	scoped_thread_arena(const scoped_thread_arena &) = delete;
+	scoped_thread_arena &operator=(const scoped_thread_arena &) = delete;
+
+private:
+	arena previous;
+};
+
+} /* namespace experimental */
+
+} /* namespace obj */
+
+} /* namespace pmem */
+
+#endif /* LIBPMEMOBJ_CPP_ALLOCATION_CLASS_HPP */
@@ -0,0 +1,265 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/**
+ * @file
+ * Atomic self-relative pointer with 32-bit offset.
+ */
+
+#ifndef LIBPMEMOBJ_CPP_ATOMIC_SELF_RELATIVE_PTR32_HPP
+#define LIBPMEMOBJ_CPP_ATOMIC_SELF_RELATIVE_PTR32_HPP
+
+#include <libpmemobj++/detail/common.hpp>
+#include <libpmemobj++/detail/self_relative_ptr_base_impl.hpp>
+#include <libpmemobj++/experimental/self_relative_ptr32.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include <atomic>
+#include <cstdint>
+
+namespace pmem
+{
+namespace obj
+{
+namespace experimental
+{
+
+/**
+ * Atomic counterpart of self_relative_ptr32.
+ *
+ * It occupies 4 bytes and has the same range restrictions as
+ * self_relative_ptr32: it must reside in the same pool as the objects it
+ * points to. Since a self_relative_ptr32 cannot be returned by value, all
+ * operations take and return raw pointers. Operations which store a pointer
+ * throw std::out_of_range if it is more than 2 GiB away.
+ *
+ * Doesn't automatically add itself to the transaction.
+ * The user is responsible for persisting the data.
+ */
+template <typename T>
+class atomic_self_relative_ptr32 {
+private:
+	using offset_type = std::atomic<int32_t>;
+	using ptr_type = pmem::detail::self_relative_ptr_base_impl<offset_type>;
+	using accessor = pmem::detail::self_relative_accessor<offset_type>;
+
+public:
+	using this_type = atomic_self_relative_ptr32;
+	using value_type = T *;
+	using difference_type = std::ptrdiff_t;
+
+	constexpr atomic_self_relative_ptr32() noexcept = default;
+	atomic_self_relative_ptr32(value_type value) : ptr()
+	{
+		store(value);
+	}
+	atomic_self_relative_ptr32(const atomic_self_relative_ptr32 &) = delete;
+
+	void
+	store(value_type desired,
+	      std::memory_order order = std::memory_order_seq_cst)
+	{
+		auto offset = to_offset(desired);
+		LIBPMEMOBJ_CPP_ANNOTATE_HAPPENS_BEFORE(order, &ptr);
+		accessor::get_offset(ptr).store(offset, order);
+	}
+
+	value_type
+	load(std::memory_order order = std::memory_order_seq_cst) const noexcept
+	{
+		auto offset = accessor::get_offset(ptr).load(order);
+		LIBPMEMOBJ_CPP_ANNOTATE_HAPPENS_AFTER(order, &ptr);
+		return to_pointer(offset);
+	}
+
+	value_type
+	exchange(value_type desired,
+		 std::memory_order order = std::memory_order_seq_cst)
+	{
+		auto old_offset = accessor::get_offset(ptr).exchange(
+			to_offset(desired), order);
+		return to_pointer(old_offset);
+	}
+
+	bool
+	compare_exchange_weak(value_type &expected, value_type desired,
+			      std::memory_order success,
+			      std::memory_order failure)
+	{
+		auto expected_offset = to_offset(expected);
+
+		bool result = accessor::get_offset(ptr).compare_exchange_weak(
+			expected_offset, to_offset(desired), success, failure);
+		if (!result)
+			expected = to_pointer(expected_offset);
+		return result;
+	}
+
+	bool
+	compare_exchange_weak(
+		value_type &expected, value_type desired,
+		std::memory_order order = std::memory_order_seq_cst)
+	{
+		auto expected_offset = to_offset(expected);
+
+		bool result = accessor::get_offset(ptr).compare_exchange_weak(
+			expected_offset, to_offset(desired), order);
+		if (!result)
+			expected = to_pointer(expected_offset);
+		return result;
+	}
+
+	bool
+	compare_exchange_strong(value_type &expected, value_type desired,
+				std::memory_order success,
+				std::memory_order failure)
+	{
+		auto expected_offset = to_offset(expected);
+
+		bool result = accessor::get_offset(ptr).compare_exchange_strong(
+			expected_offset, to_offset(desired), success, failure);
+		if (!result)
+			expected = to_pointer(expected_offset);
+		return result;
+	}
+
+	bool
+	compare_exchange_strong(
+		value_type &expected, value_type desired,
+		std::memory_order order = std::memory_order_seq_cst)
+	{
+		auto expected_offset = to_offset(expected);
+
+		bool result = accessor::get_offset(ptr).compare_exchange_strong(
+			expected_offset, to_offset(desired), order);
+		if (!result)
+			expected = to_pointer(expected_offset);
+		return result;
+	}
+
+	value_type
+	fetch_add(difference_type val,
+		  std::memory_order order = std::memory_order_seq_cst)
+	{
+		auto offset = accessor::get_offset(ptr).fetch_add(
+			byte_offset(val), order);
+		return to_pointer(offset);
+	}
+
+	value_type
+	fetch_sub(difference_type val,
+		  std::memory_order order = std::memory_order_seq_cst)
+	{
+		auto offset = accessor::get_offset(ptr).fetch_sub(
+			byte_offset(val), order);
+		return to_pointer(offset);
+	}
+
+	bool
+	is_lock_free() const noexcept
+	{
+		return accessor::get_offset(ptr).is_lock_free();
+	}
+
+	operator value_type() const noexcept
+	{
+		return load();
+	}
+
+	atomic_self_relative_ptr32 &
+	operator=(const atomic_self_relative_ptr32 &) = delete;
+
+	value_type
+	operator=(value_type desired)
+	{
+		store(desired);
+		return desired;
+	}
+
+	value_type
+	operator++()
+	{
+		return this->fetch_add(1) + 1;
+	}
+
+	value_type
+	operator++(int)
+	{
+		return this->fetch_add(1);
+	}
+
+	value_type
+	operator--()
+	{
+		return this->fetch_sub(1) - 1;
+	}
+
+	value_type
+	operator--(int)
+	{
+		return this->fetch_sub(1);
+	}
+
+	value_type
+	operator+=(difference_type diff)
+	{
+		return this->fetch_add(diff) + diff;
+	}
+
+	value_type
+	operator-=(difference_type diff)
+	{
+		return this->fetch_sub(diff) - diff;
+	}
+
+private:
+	int32_t
+	to_offset(value_type p) const
+	{
+		return pmem::detail::narrow_self_relative_offset<offset_type>(
+			accessor::pointer_to_offset(ptr, p));
+	}
+
+	value_type
+	to_pointer(int32_t offset) const noexcept
+	{
+		return accessor::template offset_to_pointer<T>(offset, ptr);
+	}
+
+	static int32_t
+	byte_offset(difference_type val)
+	{
+		return pmem::detail::narrow_self_relative_offset<offset_type>(
+			val * static_cast<difference_type>(sizeof(T)));
+	}
+
+	ptr_type ptr;
+};
+
+} /* namespace experimental */
+
+} /* namespace obj */
+
+namespace detail
+{
+
+/**
+ * pmem::detail::can_do_snapshot specialization for atomic_self_relative_ptr32.
+ * Not thread safe.
+ *
+ * Use in a single-threaded environment only.
+ */
+template <typename T>
+struct can_do_snapshot<obj::experimental::atomic_self_relative_ptr32<T>> {
+	static constexpr bool value =
+		sizeof(obj::experimental::atomic_self_relative_ptr32<T>) ==
+		sizeof(int32_t);
+	static_assert(value,
+		      "atomic_self_relative_ptr32 should be the same size");
+};
+
+} /* namespace detail */
+
+} /* namespace pmem */
+
+#endif /* LIBPMEMOBJ_CPP_ATOMIC_SELF_RELATIVE_PTR32_HPP */
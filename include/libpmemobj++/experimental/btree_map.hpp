@@ -0,0 +1,2081 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/**
+ * @file
+ * Implementation of persistent ordered map based on a B+-tree.
+ */
+
+#ifndef LIBPMEMOBJ_CPP_BTREE_MAP_HPP
+#define LIBPMEMOBJ_CPP_BTREE_MAP_HPP
+
+#include <libpmemobj++/detail/common.hpp>
+#include <libpmemobj++/detail/life.hpp>
+#include <libpmemobj++/detail/pair.hpp>
+#include <libpmemobj++/detail/template_helpers.hpp>
+#include <libpmemobj++/detail/volatile_index.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace pmem
+{
+
+namespace detail
+{
+
+/* Checks if Fingerprint can compute a fingerprint of K */
+template <typename Fingerprint, typename K, typename = void>
+struct is_fingerprintable : std::false_type {
+};
+
+template <typename Fingerprint, typename K>
+struct is_fingerprintable<Fingerprint, K,
+			  void_t<decltype(std::declval<const Fingerprint &>()(
+				  std::declval<const K &>()))>>
+    : std::true_type {
+};
+
+/* Checks if S is a string of bytes, e.g. std::string or obj::string_view */
+template <typename S, typename = void>
+struct is_byte_string : std::false_type {
+};
+
+template <typename S>
+struct is_byte_string<S,
+		      void_t<decltype(std::declval<const S &>().data()),
+			     decltype(std::declval<const S &>().size())>>
+    : std::integral_constant<bool,
+			     std::is_integral<typename S::value_type>::value &&
+				     sizeof(typename S::value_type) == 1> {
+};
+
+/* Padding which makes btree_map leaves span whole XPLines */
+template <std::size_t Size>
+struct btree_leaf_padding {
+	char padding[Size];
+};
+
+template <>
+struct btree_leaf_padding<0> {
+};
+
+/*
+ * Separator key stored in volatile inner nodes of btree_map. Keys which do not
+ * own any resources are copied to DRAM, other keys are referenced by a pointer
+ * to the lowest key of a leaf.
+ */
+template <typename Key, bool Copy>
+struct btree_separator {
+	void
+	set(const Key *k)
+	{
+		key = *k;
+	}
+
+	const Key &
+	get() const
+	{
+		return key;
+	}
+
+	Key key;
+};
+
+template <typename Key>
+struct btree_separator<Key, false> {
+	void
+	set(const Key *k)
+	{
+		key = k;
+	}
+
+	const Key &
+	get() const
+	{
+		return *key;
+	}
+
+	const Key *key = nullptr;
+};
+
+} /* namespace detail */
+
+namespace obj
+{
+
+namespace experimental
+{
+
+/**
+ * Default fingerprint function of btree_map.
+ *
+ * Computes a one-byte hash of integral keys (also wrapped in obj::p) and of
+ * strings of bytes. Keys of other types have no fingerprints and are always
+ * compared with the comparator.
+ *
+ * Keys which are equivalent according to the comparator of btree_map must
+ * have equal fingerprints, so a custom fingerprint function (or a function
+ * without any call operator) has to be used with comparators which are not
+ * based on the value of the whole key, e.g. case-insensitive ones.
+ */
+struct btree_fingerprint {
+	template <typename T,
+		  typename Enable =
+			  typename std::enable_if<std::is_integral<T>::value ||
+						  std::is_enum<T>::value>::type>
+	uint8_t
+	operator()(T key) const noexcept
+	{
+		return mix(static_cast<uint64_t>(key));
+	}
+
+	template <typename T,
+		  typename Enable =
+			  typename std::enable_if<std::is_integral<T>::value ||
+						  std::is_enum<T>::value>::type>
+	uint8_t
+	operator()(const obj::p<T> &key) const noexcept
+	{
+		return mix(static_cast<uint64_t>(key.get_ro()));
+	}
+
+	template <typename S,
+		  typename Enable = typename std::enable_if<
+			  pmem::detail::is_byte_string<S>::value>::type>
+	uint8_t
+	operator()(const S &key) const noexcept
+	{
+		/* FNV-1a */
+		uint64_t hash = 14695981039346656037ULL;
+		auto data = key.data();
+		for (std::size_t i = 0; i < key.size(); ++i) {
+			hash ^= static_cast<unsigned char>(data[i]);
+			hash *= 1099511628211ULL;
+		}
+
+		return mix(hash);
+	}
+
+private:
+	static uint8_t
+	mix(uint64_t value) noexcept
+	{
+		return static_cast<uint8_t>((value * 0x9E3779B97F4A7C15ULL) >>
+					    56);
+	}
+};
+
+/**
+ * Persistent memory aware implementation of an ordered map based on
+ * a B+-tree.
+ *
+ * Elements are stored in persistent leaves, linked in the order of keys.
+ * A leaf holds up to leaf_capacity elements and its size is a multiple of
+ * the 256-byte internal access granularity of persistent memory (XPLine).
+ * Elements in a leaf are not sorted: insert writes an element to a free slot
+ * and sets its bit in the bitmap of the leaf, and a one-byte fingerprint of
+ * every key lets lookups compare only the keys with a matching fingerprint.
+ *
+ * Inner nodes are kept in DRAM only. They are rebuilt from the list of
+ * leaves by runtime_initialize() (or by the first operation after the pool
+ * was opened), so lookups touch persistent memory only in the final leaf.
+ *
+ * The interface follows concurrent_map. All methods are thread-safe with
+ * respect to each other: lookups run concurrently under a shared lock while
+ * modifications take the lock exclusively. Unlike in concurrent_map, an
+ * insert may move half of the elements of a full leaf to a new leaf and an
+ * erase may free an empty leaf, so iterators, pointers and references are
+ * invalidated by concurrent modifications of the map. Iterating over the map
+ * is not thread-safe with respect to modifications.
+ *
+ * The runtime_initialize() method must be called (outside of a transaction)
+ * before the map is used in a transaction for the first time after the pool
+ * was opened. Methods which modify the map start a transaction; if they are
+ * called in a transaction which is later aborted, the inner nodes are rebuilt
+ * by the next operation.
+ *
+ * @ingroup experimental_containers
+ */
+template <typename Key, typename Value, typename Compare = std::less<Key>,
+	  typename Fingerprint = btree_fingerprint>
+class btree_map {
+	template <bool IsConst>
+	class btree_map_iterator;
+
+public:
+	using key_type = Key;
+	using mapped_type = Value;
+	using value_type = pmem::detail::pair<const key_type, mapped_type>;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using key_compare = Compare;
+	using fingerprint_type = Fingerprint;
+	using reference = value_type &;
+	using const_reference = const value_type &;
+	using pointer = value_type *;
+	using const_pointer = const value_type *;
+	using iterator = btree_map_iterator<false>;
+	using const_iterator = btree_map_iterator<true>;
+
+	/** Size of the internal access unit of persistent memory. */
+	static constexpr size_type xpline_size = 256;
+
+	/**
+	 * Maximum number of elements in a leaf: as many as fit in 2 KiB, but
+	 * at least 8 and at most 64 (the size of the bitmap).
+	 */
+	static constexpr size_type leaf_capacity =
+		(std::min)(size_type(64),
+			   (std::max)(size_type(8),
+				      (2048 - sizeof(uint64_t) -
+				       sizeof(obj::persistent_ptr<void>) -
+				       sizeof(key_type)) /
+					      (sizeof(value_type) + 1)));
+
+	/** Maximum number of children of an inner node. */
+	static constexpr size_type inner_node_capacity = 32;
+
+private:
+	static constexpr uint64_t LEAF_FULL_MASK =
+		(uint64_t(2) << (leaf_capacity - 1)) - 1;
+
+	/* inner nodes built by runtime_initialize() are 3/4 full */
+	static constexpr size_type REBUILD_FILL = inner_node_capacity * 3 / 4;
+
+	static constexpr size_type MAX_HEIGHT = 32;
+
+	static constexpr size_type npos = leaf_capacity;
+
+	struct leaf;
+
+	struct leaf_fields {
+		/* bit i is set if slot i holds an element */
+		obj::p<uint64_t> bitmap;
+		obj::persistent_ptr<leaf> next;
+		uint8_t fingerprints[leaf_capacity];
+		/* lowest key which may be stored in the leaf (all but the
+		 * first leaf) */
+		alignas(key_type) unsigned char low_key_storage[sizeof(
+			key_type)];
+		alignas(value_type) unsigned char slots[sizeof(value_type) *
+							leaf_capacity];
+	};
+
+	struct leaf
+	    : leaf_fields,
+	      pmem::detail::btree_leaf_padding<
+		      pmem::detail::align_up(sizeof(leaf_fields), xpline_size) -
+		      sizeof(leaf_fields)> {
+		value_type *
+		slot(size_type i)
+		{
+			return reinterpret_cast<value_type *>(this->slots) + i;
+		}
+
+		const value_type *
+		slot(size_type i) const
+		{
+			return reinterpret_cast<const value_type *>(
+				       this->slots) +
+				i;
+		}
+
+		key_type *
+		low_key()
+		{
+			return reinterpret_cast<key_type *>(
+				this->low_key_storage);
+		}
+
+		const key_type *
+		low_key() const
+		{
+			return reinterpret_cast<const key_type *>(
+				this->low_key_storage);
+		}
+
+		bool
+		full() const
+		{
+			return this->bitmap.get_ro() == LEAF_FULL_MASK;
+		}
+	};
+
+	using copy_separators = std::integral_constant<
+		bool,
+		std::is_trivially_destructible<key_type>::value &&
+			std::is_default_constructible<key_type>::value &&
+			std::is_copy_assignable<key_type>::value>;
+
+	using separator_type =
+		pmem::detail::btree_separator<key_type, copy_separators::value>;
+
+	/*
+	 * Volatile inner node. keys[i] is the lowest key of the leftmost leaf
+	 * in the subtree of children[i + 1]. Children of the inner nodes
+	 * directly above the leaves are leaves.
+	 */
+	struct inner_node {
+		size_type size = 0;
+		separator_type keys[inner_node_capacity - 1];
+		void *children[inner_node_capacity];
+
+		void
+		insert(size_type pos, void *child, const key_type *sep)
+		{
+			assert(pos > 0 && size < inner_node_capacity);
+
+			std::move_backward(children + pos, children + size,
+					   children + size + 1);
+			std::move_backward(keys + pos - 1, keys + size - 1,
+					   keys + size);
+			children[pos] = child;
+			keys[pos - 1].set(sep);
+			++size;
+		}
+
+		void
+		remove(size_type pos)
+		{
+			assert(pos < size);
+
+			std::move(children + pos + 1, children + size,
+				  children + pos);
+			if (size > 1) {
+				auto key = pos > 0 ? pos - 1 : 0;
+				std::move(keys + key + 1, keys + size - 1,
+					  keys + key);
+			}
+			--size;
+		}
+	};
+
+	/* Inner nodes of the map, kept in its volatile index */
+	struct index_data {
+		index_data() = default;
+		index_data(const index_data &) = delete;
+		index_data &operator=(const index_data &) = delete;
+
+		~index_data()
+		{
+			free_nodes();
+		}
+
+		void
+		free_nodes()
+		{
+			free_nodes(root, height);
+			root = nullptr;
+			height = 0;
+		}
+
+		static void
+		free_nodes(void *node, size_type height)
+		{
+			if (height == 0)
+				return;
+
+			auto n = static_cast<inner_node *>(node);
+			for (size_type i = 0; i < n->size; ++i)
+				free_nodes(n->children[i], height - 1);
+
+			delete n;
+		}
+
+		void *root = nullptr;
+		size_type height = 0;
+	};
+
+	using index_type = pmem::detail::volatile_index<index_data>;
+	friend index_type;
+
+	struct path_entry {
+		inner_node *node;
+		size_type pos;
+	};
+
+	using path_type = std::array<path_entry, MAX_HEIGHT>;
+
+	using shared_lock_type = typename index_type::shared_lock_type;
+	using unique_lock_type = typename index_type::unique_lock_type;
+
+	template <typename K>
+	using use_fingerprints = std::integral_constant<
+		bool,
+		pmem::detail::is_fingerprintable<fingerprint_type,
+						 key_type>::value &&
+			pmem::detail::is_fingerprintable<fingerprint_type,
+							 K>::value>;
+
+	template <typename K>
+	using if_transparent = typename std::enable_if<
+		pmem::detail::has_is_transparent<key_compare>::value, K>::type;
+
+public:
+	/**
+	 * Default constructor. Constructs an empty map.
+	 *
+	 * @pre must be called in transaction scope.
+	 *
+	 * @throw pmem::transaction_scope_error if constructor wasn't called in
+	 * transaction.
+	 * @throw pmem::transaction_alloc_error when allocating memory for the
+	 * first leaf failed.
+	 */
+	btree_map()
+	{
+		check_tx_stage_work();
+		init();
+	}
+
+	/**
+	 * Constructs an empty map which uses comp for all comparisons of keys.
+	 *
+	 * @pre must be called in transaction scope.
+	 *
+	 * @throw pmem::transaction_scope_error if constructor wasn't called in
+	 * transaction.
+	 * @throw pmem::transaction_alloc_error when allocating memory for the
+	 * first leaf failed.
+	 */
+	explicit btree_map(const key_compare &comp) : _compare(comp)
+	{
+		check_tx_stage_work();
+		init();
+	}
+
+	/**
+	 * Constructs the map with the contents of the range [first, last).
+	 * If multiple elements in the range have keys that compare
+	 * equivalent, only the first of them is inserted.
+	 *
+	 * @pre must be called in transaction scope.
+	 *
+	 * @throw pmem::transaction_scope_error if constructor wasn't called in
+	 * transaction.
+	 * @throw pmem::transaction_alloc_error when allocating memory for
+	 * inserted elements in transaction failed.
+	 */
+	template <typename InputIt>
+	btree_map(InputIt first, InputIt last,
+		  const key_compare &comp = key_compare())
+	    : _compare(comp)
+	{
+		check_tx_stage_work();
+		init();
+
+		index_type idx;
+		rebuild(idx);
+		for (; first != last; ++first)
+			internal_emplace(idx, *first);
+	}
+
+	/**
+	 * Constructs the map with the contents of the initializer list.
+	 *
+	 * @pre must be called in transaction scope.
+	 *
+	 * @throw pmem::transaction_scope_error if constructor wasn't called in
+	 * transaction.
+	 * @throw pmem::transaction_alloc_error when allocating memory for
+	 * inserted elements in transaction failed.
+	 */
+	btree_map(std::initializer_list<value_type> ilist,
+		  const key_compare &comp = key_compare())
+	    : btree_map(ilist.begin(), ilist.end(), comp)
+	{
+	}
+
+	/**
+	 * Copy constructor. Constructs the map with the copy of the contents
+	 * of other. Must not be called concurrently with modifications of
+	 * other.
+	 *
+	 * @pre must be called in transaction scope.
+	 *
+	 * @throw pmem::transaction_scope_error if constructor wasn't called in
+	 * transaction.
+	 * @throw pmem::transaction_alloc_error when allocating memory for
+	 * inserted elements in transaction failed.
+	 */
+	btree_map(const btree_map &other)
+	    : btree_map(other.begin(), other.end(), other._compare)
+	{
+	}
+
+	/**
+	 * Copy assignment operator. Replaces the contents with a copy of the
+	 * contents of other transactionally. Must not be called concurrently
+	 * with modifications of other.
+	 *
+	 * @throw pmem::transaction_alloc_error when allocating new memory
+	 * failed.
+	 * @throw pmem::transaction_free_error when freeing old elements
+	 * failed.
+	 */
+	btree_map &
+	operator=(const btree_map &other)
+	{
+		if (this == &other)
+			return *this;
+
+		auto &idx = index_type::get(this);
+		unique_lock_type lock(idx.mutex);
+
+		idx.invalidate_on_abort();
+
+		auto pop = get_pool_base();
+		obj::flat_transaction::run(pop, [&] {
+			internal_clear();
+			pmem::detail::conditional_add_to_tx(&_compare);
+			_compare = other._compare;
+
+			rebuild(idx);
+			for (auto it = other.begin(); it != other.end(); ++it)
+				internal_emplace(idx, *it);
+		});
+
+		return *this;
+	}
+
+	/**
+	 * Destructor. Frees all elements and leaves of the map.
+	 */
+	~btree_map()
+	{
+		try {
+			free_data();
+		} catch (...) {
+			std::terminate();
+		}
+	}
+
+	/**
+	 * Rebuilds the volatile inner nodes from the list of leaves. Should be
+	 * called once after the pool is opened, it is a no-op for the
+	 * persistent data.
+	 *
+	 * @throw pmem::transaction_scope_error if called in a transaction.
+	 */
+	void
+	runtime_initialize()
+	{
+		check_outside_tx();
+
+		auto &idx = index_type::get(this);
+		unique_lock_type lock(idx.mutex);
+		rebuild(idx);
+	}
+
+	/**
+	 * Transactionally frees all memory allocated by the map. The map can
+	 * NOT be used after free_data() was called (unless it was called in
+	 * a transaction and that transaction aborted).
+	 *
+	 * @throw pmem::transaction_free_error when freeing memory failed.
+	 */
+	void
+	free_data()
+	{
+		if (_head == nullptr)
+			return;
+
+		auto pop = get_pool_base();
+		obj::flat_transaction::run(pop, [&] {
+			internal_clear();
+			obj::delete_persistent<leaf>(_head);
+			_head = nullptr;
+			index_type::destroy(this);
+		});
+	}
+
+	/**
+	 * Returns an iterator to the first element of the map.
+	 */
+	iterator
+	begin()
+	{
+		return first_in<iterator>(_head.get());
+	}
+
+	/**
+	 * Returns a const iterator to the first element of the map.
+	 */
+	const_iterator
+	begin() const
+	{
+		return first_in<const_iterator>(_head.get());
+	}
+
+	/**
+	 * Returns a const iterator to the first element of the map.
+	 */
+	const_iterator
+	cbegin() const
+	{
+		return begin();
+	}
+
+	/**
+	 * Returns an iterator to the element following the last element of
+	 * the map.
+	 */
+	iterator
+	end()
+	{
+		return iterator(nullptr, 0, &_compare);
+	}
+
+	/**
+	 * Returns a const iterator to the element following the last element
+	 * of the map.
+	 */
+	const_iterator
+	end() const
+	{
+		return const_iterator(nullptr, 0, &_compare);
+	}
+
+	/**
+	 * Returns a const iterator to the element following the last element
+	 * of the map.
+	 */
+	const_iterator
+	cend() const
+	{
+		return end();
+	}
+
+	/**
+	 * Checks if the map has no elements.
+	 */
+	bool
+	empty() const
+	{
+		return size() == 0;
+	}
+
+	/**
+	 * Returns the number of elements in the map.
+	 */
+	size_type
+	size() const
+	{
+		auto &idx = index_type::get(this);
+		shared_lock_type lock(idx.mutex);
+
+		return static_cast<size_type>(_size.get_ro());
+	}
+
+	/**
+	 * Returns the maximum number of elements the map is able to hold.
+	 */
+	size_type
+	max_size() const
+	{
+		return (std::numeric_limits<size_type>::max)();
+	}
+
+	/**
+	 * Inserts value if the map doesn't already contain an element with an
+	 * equivalent key.
+	 *
+	 * @return a pair consisting of an iterator to the inserted element
+	 * (or to the element that prevented the insertion) and a bool value
+	 * set to true if the insertion took place.
+	 *
+	 * @throw pmem::transaction_alloc_error when allocating memory for the
+	 * element or a new leaf failed.
+	 */
+	std::pair<iterator, bool>
+	insert(const value_type &value)
+	{
+		return try_emplace(value.first, value.second);
+	}
+
+	/**
+	 * Inserts a value constructed from p if the map doesn't already
+	 * contain an element with an equivalent key. Participates in overload
+	 * resolution only if value_type is constructible from P.
+	 *
+	 * @return a pair consisting of an iterator to the inserted element
+	 * (or to the element that prevented the insertion) and a bool value
+	 * set to true if the insertion took place.
+	 *
+	 * @throw pmem::transaction_alloc_error when allocating memory for the
+	 * element or a new leaf failed.
+	 */
+	template <typename P,
+		  typename = typename std::enable_if<
+			  std::is_constructible<value_type, P &&>::value>::type>
+	std::pair<iterator, bool>
+	insert(P &&p)
+	{
+		return emplace(std::forward<P>(p));
+	}
+
+	/**
+	 * Inserts elements from the range [first, last). Each element is
+	 * inserted in a separate transaction.
+	 *
+	 * @throw pmem::transaction_alloc_error when allocating memory for an
+	 * element or a new leaf failed.
+	 */
+	template <typename InputIterator>
+	void
+	insert(InputIterator first, InputIterator last)
+	{
+		for (; first != last; ++first)
+			emplace(*first);
+	}
+
+	/**
+	 * Inserts elements from the initializer list.
+	 *
+	 * @throw pmem::transaction_alloc_error when allocating memory for an
+	 * element or a new leaf failed.
+	 */
+	void
+	insert(std::initializer_list<value_type> ilist)
+	{
+		insert(ilist.begin(), ilist.end());
+	}
+
+	/**
+	 * Inserts an element constructed from a pair-like object p (with
+	 * first and second members) if the map doesn't already contain an
+	 * element with an equivalent key.
+	 *
+	 * @return a pair consisting of an iterator to the inserted element
+	 * (or to the element that prevented the insertion) and a bool value
+	 * set to true if the insertion took place.
+	 *
+	 * @throw pmem::transaction_alloc_error when allocating memory for the
+	 * element or a new leaf failed.
+	 */
+	template <typename P>
+	std::pair<iterator, bool>
+	emplace(P &&p)
+	{
+		return try_emplace(std::forward<P>(p).first,
+				   std::forward<P>(p).second);
+	}
+
+	/**
+	 * Inserts an element with key constructed from k and value
+	 * constructed from m if the map doesn't already contain an element
+	 * with an equivalent key.
+	 *
+	 * @return a pair consisting of an iterator to the inserted element
+	 * (or to the element that prevented the insertion) and a bool value
+	 * set to true if the insertion took place.
+	 *
+	 * @throw pmem::transaction_alloc_error when allocating memory for the
+	 * element or a new leaf failed.
+	 */
+	template <typename K, typename M>
+	std::pair<iterator, bool>
+	emplace(K &&k, M &&m)
+	{
+		return try_emplace(std::forward<K>(k), std::forward<M>(m));
+	}
+
+	/**
+	 * If a key equivalent to k already exists in the map, does nothing.
+	 * Otherwise, inserts an element with key k and value constructed
+	 * from args.
+	 *
+	 * @return a pair consisting of an iterator to the inserted element
+	 * (or to the element that prevented the insertion) and a bool value
+	 * set to true if the insertion took place.
+	 *
+	 * @throw pmem::transaction_alloc_error when allocating memory for the
+	 * element or a new leaf failed.
+	 */
+	template <typename... Args>
+	std::pair<iterator, bool>
+	try_emplace(const key_type &k, Args &&... args)
+	{
+		return locked_try_emplace(k, std::forward<Args>(args)...);
+	}
+
+	/**
+	 * If a key equivalent to k already exists in the map, does nothing.
+	 * Otherwise, inserts an element with key moved from k and value
+	 * constructed from args.
+	 *
+	 * @return a pair consisting of an iterator to the inserted element
+	 * (or to the element that prevented the insertion) and a bool value
+	 * set to true if the insertion took place.
+	 *
+	 * @throw pmem::transaction_alloc_error when allocating memory for the
+	 * element or a new leaf failed.
+	 */
+	template <typename... Args>
+	std::pair<iterator, bool>
+	try_emplace(key_type &&k, Args &&... args)
+	{
+		return locked_try_emplace(std::move(k),
+					  std::forward<Args>(args)...);
+	}
+
+	/**
+	 * If a key equivalent to k already exists in the map, does nothing.
+	 * Otherwise, inserts an element with key constructed from k and value
+	 * constructed from args. This overload only participates in overload
+	 * resolution if Compare::is_transparent is valid and denotes a type
+	 * and K is not convertible to iterator or const_iterator.
+	 *
+	 * @return a pair consisting of an iterator to the inserted element
+	 * (or to the element that prevented the insertion) and a bool value
+	 * set to true if the insertion took place.
+	 *
+	 * @throw pmem::transaction_alloc_error when allocating memory for the
+	 * element or a new leaf failed.
+	 */
+	template <
+		typename K, typename... Args,
+		typename = typename std::enable_if<
+			pmem::detail::has_is_transparent<key_compare>::value &&
+			!std::is_convertible<K, iterator>::value &&
+			!std::is_convertible<K, const_iterator>::value &&
+			!std::is_same<typename std::decay<K>::type,
+				      key_type>::value>::type>
+	std::pair<iterator, bool>
+	try_emplace(K &&k, Args &&... args)
+	{
+		return locked_try_emplace(std::forward<K>(k),
+					  std::forward<Args>(args)...);
+	}
+
+	/**
+	 * If a key equivalent to k already exists in the map, assigns
+	 * std::forward<M>(obj) to its value. Otherwise, inserts a new element.
+	 *
+	 * @return a pair consisting of an iterator to the inserted or updated
+	 * element and a bool value set to true if the insertion took place.
+	 *
+	 * @throw pmem::transaction_alloc_error when allocating memory for the
+	 * element or a new leaf failed.
+	 */
+	template <typename M>
+	std::pair<iterator, bool>
+	insert_or_assign(const key_type &k, M &&obj)
+	{
+		return locked_insert_or_assign(k, std::forward<M>(obj));
+	}
+
+	/**
+	 * If a key equivalent to k already exists in the map, assigns
+	 * std::forward<M>(obj) to its value. Otherwise, inserts a new element
+	 * with key moved from k.
+	 *
+	 * @return a pair consisting of an iterator to the inserted or updated
+	 * element and a bool value set to true if the insertion took place.
+	 *
+	 * @throw pmem::transaction_alloc_error when allocating memory for the
+	 * element or a new leaf failed.
+	 */
+	template <typename M>
+	std::pair<iterator, bool>
+	insert_or_assign(key_type &&k, M &&obj)
+	{
+		return locked_insert_or_assign(std::move(k),
+					       std::forward<M>(obj));
+	}
+
+	/**
+	 * If a key equivalent to k already exists in the map, assigns
+	 * std::forward<M>(obj) to its value. Otherwise, inserts a new element
+	 * with key constructed from k. This overload only participates in
+	 * overload resolution if Compare::is_transparent is valid and denotes
+	 * a type.
+	 *
+	 * @return a pair consisting of an iterator to the inserted or updated
+	 * element and a bool value set to true if the insertion took place.
+	 *
+	 * @throw pmem::transaction_alloc_error when allocating memory for the
+	 * element or a new leaf failed.
+	 */
+	template <
+		typename K, typename M,
+		typename = typename std::enable_if<
+			pmem::detail::has_is_transparent<key_compare>::value &&
+			!std::is_same<typename std::decay<K>::type,
+				      key_type>::value>::type>
+	std::pair<iterator, bool>
+	insert_or_assign(K &&k, M &&obj)
+	{
+		return locked_insert_or_assign(std::forward<K>(k),
+					       std::forward<M>(obj));
+	}
+
+	/**
+	 * Finds an element with key equivalent to key.
+	 *
+	 * @return an iterator to the element or end() if there is no such
+	 * element.
+	 */
+	iterator
+	find(const key_type &key)
+	{
+		return locked_find<iterator>(key);
+	}
+
+	/**
+	 * Finds an element with key equivalent to key.
+	 *
+	 * @return a const iterator to the element or end() if there is no
+	 * such element.
+	 */
+	const_iterator
+	find(const key_type &key) const
+	{
+		return locked_find<const_iterator>(key);
+	}
+
+	/**
+	 * Finds an element with key that compares equivalent to the value x.
+	 * This overload only participates in overload resolution if
+	 * Compare::is_transparent is valid and denotes a type.
+	 *
+	 * @return an iterator to the element or end() if there is no such
+	 * element.
+	 */
+	template <typename K, typename = if_transparent<K>>
+	iterator
+	find(const K &x)
+	{
+		return locked_find<iterator>(x);
+	}
+
+	/**
+	 * Finds an element with key that compares equivalent to the value x.
+	 * This overload only participates in overload resolution if
+	 * Compare::is_transparent is valid and denotes a type.
+	 *
+	 * @return a const iterator to the element or end() if there is no
+	 * such element.
+	 */
+	template <typename K, typename = if_transparent<K>>
+	const_iterator
+	find(const K &x) const
+	{
+		return locked_find<const_iterator>(x);
+	}
+
+	/**
+	 * Returns the number of elements with key equivalent to key (0 or 1).
+	 */
+	size_type
+	count(const key_type &key) const
+	{
+		return find(key) == end() ? 0 : 1;
+	}
+
+	/**
+	 * Returns the number of elements with key that compares equivalent to
+	 * the value x (0 or 1). This overload only participates in overload
+	 * resolution if Compare::is_transparent is valid and denotes a type.
+	 */
+	template <typename K, typename = if_transparent<K>>
+	size_type
+	count(const K &x) const
+	{
+		return find(x) == end() ? 0 : 1;
+	}
+
+	/**
+	 * Checks if there is an element with key equivalent to key.
+	 */
+	bool
+	contains(const key_type &key) const
+	{
+		return find(key) != end();
+	}
+
+	/**
+	 * Checks if there is an element with key that compares equivalent to
+	 * the value x. This overload only participates in overload resolution
+	 * if Compare::is_transparent is valid and denotes a type.
+	 */
+	template <typename K, typename = if_transparent<K>>
+	bool
+	contains(const K &x) const
+	{
+		return find(x) != end();
+	}
+
+	/**
+	 * Returns an iterator to the first element with key not less than
+	 * key, or end() if there is no such element.
+	 */
+	iterator
+	lower_bound(const key_type &key)
+	{
+		return locked_bound<iterator, false>(key);
+	}
+
+	/**
+	 * Returns a const iterator to the first element with key not less
+	 * than key, or end() if there is no such element.
+	 */
+	const_iterator
+	lower_bound(const key_type &key) const
+	{
+		return locked_bound<const_iterator, false>(key);
+	}
+
+	/**
+	 * Returns an iterator to the first element with key that compares not
+	 * less than the value x, or end() if there is no such element. This
+	 * overload only participates in overload resolution if
+	 * Compare::is_transparent is valid and denotes a type.
+	 */
+	template <typename K, typename = if_transparent<K>>
+	iterator
+	lower_bound(const K &x)
+	{
+		return locked_bound<iterator, false>(x);
+	}
+
+	/**
+	 * Returns a const iterator to the first element with key that
+	 * compares not less than the value x, or end() if there is no such
+	 * element. This overload only participates in overload resolution if
+	 * Compare::is_transparent is valid and denotes a type.
+	 */
+	template <typename K, typename = if_transparent<K>>
+	const_iterator
+	lower_bound(const K &x) const
+	{
+		return locked_bound<const_iterator, false>(x);
+	}
+
+	/**
+	 * Returns an iterator to the first element with key greater than
+	 * key, or end() if there is no such element.
+	 */
+	iterator
+	upper_bound(const key_type &key)
+	{
+		return locked_bound<iterator, true>(key);
+	}
+
+	/**
+	 * Returns a const iterator to the first element with key greater
+	 * than key, or end() if there is no such element.
+	 */
+	const_iterator
+	upper_bound(const key_type &key) const
+	{
+		return locked_bound<const_iterator, true>(key);
+	}
+
+	/**
+	 * Returns an iterator to the first element with key that compares
+	 * greater than the value x, or end() if there is no such element.
+	 * This overload only participates in overload resolution if
+	 * Compare::is_transparent is valid and denotes a type.
+	 */
+	template <typename K, typename = if_transparent<K>>
+	iterator
+	upper_bound(const K &x)
+	{
+		return locked_bound<iterator, true>(x);
+	}
+
+	/**
+	 * Returns a const iterator to the first element with key that
+	 * compares greater than the value x, or end() if there is no such
+	 * element. This overload only participates in overload resolution if
+	 * Compare::is_transparent is valid and denotes a type.
+	 */
+	template <typename K, typename = if_transparent<K>>
+	const_iterator
+	upper_bound(const K &x) const
+	{
+		return locked_bound<const_iterator, true>(x);
+	}
+
+	/**
+	 * Returns a range containing the element with key equivalent to key.
+	 */
+	std::pair<iterator, iterator>
+	equal_range(const key_type &key)
+	{
+		return {lower_bound(key), upper_bound(key)};
+	}
+
+	/**
+	 * Returns a range containing the element with key equivalent to key.
+	 */
+	std::pair<const_iterator, const_iterator>
+	equal_range(const key_type &key) const
+	{
+		return {lower_bound(key), upper_bound(key)};
+	}
+
+	/**
+	 * Returns a range containing the element with key that compares
+	 * equivalent to the value x. This overload only participates in
+	 * overload resolution if Compare::is_transparent is valid and denotes
+	 * a type.
+	 */
+	template <typename K, typename = if_transparent<K>>
+	std::pair<iterator, iterator>
+	equal_range(const K &x)
+	{
+		return {lower_bound(x), upper_bound(x)};
+	}
+
+	/**
+	 * Returns a range containing the element with key that compares
+	 * equivalent to the value x. This overload only participates in
+	 * overload resolution if Compare::is_transparent is valid and denotes
+	 * a type.
+	 */
+	template <typename K, typename = if_transparent<K>>
+	std::pair<const_iterator, const_iterator>
+	equal_range(const K &x) const
+	{
+		return {lower_bound(x), upper_bound(x)};
+	}
+
+	/**
+	 * Removes the element with key equivalent to key (if one exists).
+	 * A leaf which becomes empty is freed. Named after
+	 * concurrent_map::unsafe_erase(), it may be called concurrently with
+	 * other methods, but it invalidates iterators to the erased element
+	 * and to the elements of a freed leaf.
+	 *
+	 * @return the number of elements removed (0 or 1).
+	 *
+	 * @throw pmem::transaction_free_error when freeing the element failed.
+	 */
+	size_type
+	unsafe_erase(const key_type &key)
+	{
+		return locked_erase(key);
+	}
+
+	/**
+	 * Removes the element with key that compares equivalent to the value
+	 * x (if one exists). This overload only participates in overload
+	 * resolution if Compare::is_transparent is valid and denotes a type
+	 * and K is not convertible to iterator or const_iterator.
+	 *
+	 * @return the number of elements removed (0 or 1).
+	 *
+	 * @throw pmem::transaction_free_error when freeing the element failed.
+	 */
+	template <
+		typename K,
+		typename = typename std::enable_if<
+			pmem::detail::has_is_transparent<key_compare>::value &&
+			!std::is_convertible<K, iterator>::value &&
+			!std::is_convertible<K, const_iterator>::value>::type>
+	size_type
+	unsafe_erase(const K &x)
+	{
+		return locked_erase(x);
+	}
+
+	/**
+	 * Removes the element at pos.
+	 *
+	 * @return an iterator following the removed element.
+	 *
+	 * @throw pmem::transaction_free_error when freeing the element failed.
+	 */
+	iterator
+	unsafe_erase(const_iterator pos)
+	{
+		assert(pos != end());
+
+		auto next = std::next(pos);
+		locked_erase(pos->first);
+
+		return iterator(const_cast<leaf *>(next.node), next.slot,
+				&_compare);
+	}
+
+	/**
+	 * Removes the element at pos.
+	 *
+	 * @return an iterator following the removed element.
+	 *
+	 * @throw pmem::transaction_free_error when freeing the element failed.
+	 */
+	iterator
+	unsafe_erase(iterator pos)
+	{
+		return unsafe_erase(const_iterator(pos));
+	}
+
+	/**
+	 * Removes the elements in the range [first, last).
+	 *
+	 * @return an iterator following the last removed element.
+	 *
+	 * @throw pmem::transaction_free_error when freeing an element failed.
+	 */
+	iterator
+	unsafe_erase(const_iterator first, const_iterator last)
+	{
+		while (first != last)
+			first = unsafe_erase(first);
+
+		return iterator(const_cast<leaf *>(last.node), last.slot,
+				&_compare);
+	}
+
+	/**
+	 * Transactionally removes all elements from the map. Leaves all but
+	 * the first one are freed.
+	 *
+	 * @throw pmem::transaction_free_error when freeing the elements
+	 * failed.
+	 */
+	void
+	clear()
+	{
+		auto idx = index_type::get_if_exists(this);
+		if (idx == nullptr) {
+			auto pop = get_pool_base();
+			obj::flat_transaction::run(pop,
+						   [&] { internal_clear(); });
+			return;
+		}
+
+		unique_lock_type lock(idx->mutex);
+		idx->invalidate_on_abort();
+
+		auto pop = get_pool_base();
+		obj::flat_transaction::run(pop, [&] { internal_clear(); });
+
+		rebuild(*idx);
+	}
+
+	/**
+	 * Returns a copy of the comparison function object.
+	 */
+	key_compare
+	key_comp() const
+	{
+		return _compare;
+	}
+
+private:
+	/* Forward iterator over the elements of the leaves */
+	template <bool IsConst>
+	class btree_map_iterator {
+		using leaf_ptr =
+			typename std::conditional<IsConst, const leaf *,
+						  leaf *>::type;
+
+		friend class btree_map;
+
+		template <bool>
+		friend class btree_map_iterator;
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = typename btree_map::value_type;
+		using difference_type = typename btree_map::difference_type;
+		using reference =
+			typename std::conditional<IsConst, const value_type &,
+						  value_type &>::type;
+		using pointer =
+			typename std::conditional<IsConst, const value_type *,
+						  value_type *>::type;
+
+		btree_map_iterator() = default;
+
+		/** Conversion from iterator to const_iterator. */
+		template <bool C = IsConst,
+			  typename Enable = typename std::enable_if<C>::type>
+		btree_map_iterator(const btree_map_iterator<false> &other)
+		    : node(other.node),
+		      slot(other.slot),
+		      compare(other.compare),
+		      order(other.order),
+		      order_size(other.order_size),
+		      pos(other.pos)
+		{
+		}
+
+		reference
+		operator*() const
+		{
+			return *node->slot(slot);
+		}
+
+		pointer
+		operator->() const
+		{
+			return node->slot(slot);
+		}
+
+		btree_map_iterator &
+		operator++()
+		{
+			assert(node != nullptr);
+
+			if (order_size == 0)
+				sort_leaf();
+
+			if (++pos < order_size) {
+				slot = order[pos];
+				return *this;
+			}
+
+			node = node->next.get();
+			while (node != nullptr && node->bitmap.get_ro() == 0)
+				node = node->next.get();
+
+			if (node == nullptr) {
+				slot = 0;
+				order_size = 0;
+			} else {
+				order_size =
+					sorted_slots(*node, order, *compare);
+				pos = 0;
+				slot = order[0];
+			}
+
+			return *this;
+		}
+
+		btree_map_iterator
+		operator++(int)
+		{
+			auto tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		bool
+		operator==(const btree_map_iterator &rhs) const
+		{
+			return node == rhs.node && slot == rhs.slot;
+		}
+
+		bool
+		operator!=(const btree_map_iterator &rhs) const
+		{
+			return !(*this == rhs);
+		}
+
+	private:
+		btree_map_iterator(leaf_ptr n, size_type s,
+				   const key_compare *comp)
+		    : node(n), slot(s), compare(comp)
+		{
+		}
+
+		/* Sorts the elements of the leaf, sets pos to the current
+		 * slot */
+		void
+		sort_leaf()
+		{
+			order_size = sorted_slots(*node, order, *compare);
+
+			pos = 0;
+			while (pos < order_size && order[pos] != slot)
+				++pos;
+		}
+
+		leaf_ptr node = nullptr;
+		size_type slot = 0;
+		const key_compare *compare = nullptr;
+
+		/* slots of the elements of the leaf in the order of keys,
+		 * filled on the first increment in a leaf */
+		std::array<uint8_t, leaf_capacity> order;
+		size_type order_size = 0;
+		size_type pos = 0;
+	};
+
+	void
+	check_tx_stage_work() const
+	{
+		if (pmemobj_tx_stage() != TX_STAGE_WORK)
+			throw pmem::transaction_scope_error(
+				"Function called out of transaction scope.");
+	}
+
+	static void
+	check_outside_tx()
+	{
+		if (pmemobj_tx_stage() != TX_STAGE_NONE)
+			throw pmem::transaction_scope_error(
+				"Function called inside transaction scope.");
+	}
+
+	obj::pool_base
+	get_pool_base() const
+	{
+		PMEMobjpool *pop = pmemobj_pool_by_ptr(this);
+		return obj::pool_base(pop);
+	}
+
+	void
+	init()
+	{
+		_head = obj::make_persistent<leaf>();
+		_size = 0;
+	}
+
+	/* Builds inner nodes bottom-up from the list of leaves */
+	void
+	rebuild(index_type &idx) const
+	{
+		idx.free_nodes();
+		idx.valid = false;
+
+		std::vector<void *> level;
+		std::vector<const key_type *> separators;
+		for (auto l = _head.get(); l != nullptr; l = l->next.get()) {
+			level.push_back(l);
+			separators.push_back(l == _head.get() ? nullptr
+							      : l->low_key());
+		}
+
+		size_type height = 0;
+		try {
+			while (level.size() > 1) {
+				std::vector<void *> parents;
+				std::vector<const key_type *> parent_separators;
+
+				for (size_type i = 0; i < level.size();
+				     i += REBUILD_FILL) {
+					auto n = new inner_node();
+					parents.push_back(n);
+					parent_separators.push_back(
+						separators[i]);
+
+					auto last = (std::min)(i + REBUILD_FILL,
+							       level.size());
+					for (size_type j = i; j < last; ++j) {
+						n->children[j - i] = level[j];
+						if (j > i)
+							n->keys[j - i - 1].set(
+								separators[j]);
+					}
+					n->size = last - i;
+				}
+
+				level.swap(parents);
+				separators.swap(parent_separators);
+				++height;
+			}
+		} catch (...) {
+			for (auto n : level)
+				index_data::free_nodes(n, height);
+			throw;
+		}
+
+		idx.root = level[0];
+		idx.height = height;
+		idx.valid = true;
+	}
+
+	/* Returns the index of the child of n whose subtree may contain key */
+	template <typename K>
+	size_type
+	child_index(const inner_node *n, const K &key) const
+	{
+		size_type first = 0, last = n->size - 1;
+		while (first < last) {
+			auto mid = (first + last) / 2;
+			if (_compare(key, n->keys[mid].get()))
+				last = mid;
+			else
+				first = mid + 1;
+		}
+
+		return first;
+	}
+
+	/*
+	 * Returns the leaf which may contain key. If path is not null, it is
+	 * filled with the inner nodes on the way to the leaf (path[0] is
+	 * directly above the leaf).
+	 */
+	template <typename K>
+	leaf *
+	find_leaf(const index_type &idx, const K &key,
+		  path_type *path = nullptr) const
+	{
+		void *node = idx.root;
+		for (size_type level = idx.height; level > 0; --level) {
+			auto n = static_cast<inner_node *>(node);
+			auto i = child_index(n, key);
+			if (path)
+				(*path)[level - 1] = {n, i};
+			node = n->children[i];
+		}
+
+		return static_cast<leaf *>(node);
+	}
+
+	static leaf *
+	leftmost_leaf(void *node, size_type height)
+	{
+		for (; height > 0; --height)
+			node = static_cast<inner_node *>(node)->children[0];
+
+		return static_cast<leaf *>(node);
+	}
+
+	static leaf *
+	rightmost_leaf(void *node, size_type height)
+	{
+		for (; height > 0; --height) {
+			auto n = static_cast<inner_node *>(node);
+			node = n->children[n->size - 1];
+		}
+
+		return static_cast<leaf *>(node);
+	}
+
+	static size_type
+	lowest_bit(uint64_t value)
+	{
+		return pmem::detail::mssb_index64(value & (~value + 1));
+	}
+
+	template <typename K>
+	bool
+	equal(const key_type &lhs, const K &rhs) const
+	{
+		return !_compare(lhs, rhs) && !_compare(rhs, lhs);
+	}
+
+	uint8_t
+	fingerprint(const key_type &key, std::true_type) const
+	{
+		return fingerprint_type()(key);
+	}
+
+	uint8_t
+	fingerprint(const key_type &, std::false_type) const
+	{
+		return 0;
+	}
+
+	/* Slots of the leaf whose fingerprint matches the fingerprint of key */
+	template <typename K>
+	uint64_t
+	candidates(const leaf &l, const K &key, std::true_type) const
+	{
+		auto f = fingerprint_type()(key);
+
+		uint64_t mask = 0;
+		for (size_type i = 0; i < leaf_capacity; ++i)
+			mask |= uint64_t(l.fingerprints[i] == f) << i;
+
+		return mask & l.bitmap.get_ro();
+	}
+
+	template <typename K>
+	uint64_t
+	candidates(const leaf &l, const K &, std::false_type) const
+	{
+		return l.bitmap.get_ro();
+	}
+
+	/* Returns the slot of the element with key equivalent to key or npos */
+	template <typename K>
+	size_type
+	find_in_leaf(const leaf &l, const K &key) const
+	{
+		auto mask = candidates(l, key, use_fingerprints<K>{});
+		while (mask) {
+			auto i = lowest_bit(mask);
+			if (equal(l.slot(i)->first, key))
+				return i;
+			mask &= mask - 1;
+		}
+
+		return npos;
+	}
+
+	/*
+	 * Returns the slot of the smallest element not less than (or greater
+	 * than, if Upper) key or npos.
+	 */
+	template <bool Upper, typename K>
+	size_type
+	bound_in_leaf(const leaf &l, const K &key) const
+	{
+		size_type result = npos;
+		auto mask = l.bitmap.get_ro();
+		while (mask) {
+			auto i = lowest_bit(mask);
+			mask &= mask - 1;
+
+			auto &k = l.slot(i)->first;
+			if (Upper ? !_compare(key, k) : _compare(k, key))
+				continue;
+			if (result == npos ||
+			    _compare(k, l.slot(result)->first))
+				result = i;
+		}
+
+		return result;
+	}
+
+	/* Fills order with the occupied slots of l in the order of keys */
+	static size_type
+	sorted_slots(const leaf &l, std::array<uint8_t, leaf_capacity> &order,
+		     const key_compare &comp)
+	{
+		size_type n = 0;
+		auto mask = l.bitmap.get_ro();
+		while (mask) {
+			order[n++] = static_cast<uint8_t>(lowest_bit(mask));
+			mask &= mask - 1;
+		}
+
+		std::sort(order.begin(),
+			  order.begin() + static_cast<difference_type>(n),
+			  [&](uint8_t a, uint8_t b) {
+				  return comp(l.slot(a)->first,
+					      l.slot(b)->first);
+			  });
+
+		return n;
+	}
+
+	/* Returns an iterator to the first element in l or in later leaves */
+	template <typename Iterator>
+	Iterator
+	first_in(leaf *l) const
+	{
+		while (l != nullptr && l->bitmap.get_ro() == 0)
+			l = l->next.get();
+
+		Iterator it(l, 0, &_compare);
+		if (l != nullptr) {
+			it.order_size = sorted_slots(*l, it.order, _compare);
+			it.slot = it.order[0];
+		}
+
+		return it;
+	}
+
+	template <typename Iterator, typename K>
+	Iterator
+	locked_find(const K &key) const
+	{
+		auto &idx = index_type::get(this);
+		auto lock = idx.lock_shared(*this);
+
+		auto l = find_leaf(idx, key);
+		auto slot = find_in_leaf(*l, key);
+		if (slot == npos)
+			return Iterator(nullptr, 0, &_compare);
+
+		return Iterator(l, slot, &_compare);
+	}
+
+	template <typename Iterator, bool Upper, typename K>
+	Iterator
+	locked_bound(const K &key) const
+	{
+		auto &idx = index_type::get(this);
+		auto lock = idx.lock_shared(*this);
+
+		auto l = find_leaf(idx, key);
+		auto slot = bound_in_leaf<Upper>(*l, key);
+		if (slot == npos)
+			return first_in<Iterator>(l->next.get());
+
+		return Iterator(l, slot, &_compare);
+	}
+
+	template <typename K, typename... Args>
+	std::pair<iterator, bool>
+	locked_try_emplace(K &&key, Args &&... args)
+	{
+		auto &idx = index_type::get(this);
+		unique_lock_type lock(idx.mutex);
+		idx.validate(*this);
+		idx.invalidate_on_abort();
+
+		return internal_try_emplace(idx, std::forward<K>(key),
+					    std::forward<Args>(args)...);
+	}
+
+	template <typename K, typename M>
+	std::pair<iterator, bool>
+	locked_insert_or_assign(K &&key, M &&obj)
+	{
+		auto &idx = index_type::get(this);
+		unique_lock_type lock(idx.mutex);
+		idx.validate(*this);
+		idx.invalidate_on_abort();
+
+		auto l = find_leaf(idx, key);
+		auto slot = find_in_leaf(*l, key);
+		if (slot == npos)
+			return internal_try_emplace(idx, std::forward<K>(key),
+						    std::forward<M>(obj));
+
+		auto pop = get_pool_base();
+		obj::flat_transaction::run(pop, [&] {
+			l->slot(slot)->second = std::forward<M>(obj);
+		});
+
+		return {iterator(l, slot, &_compare), false};
+	}
+
+	template <typename P>
+	void
+	internal_emplace(index_type &idx, P &&p)
+	{
+		internal_try_emplace(idx, std::forward<P>(p).first,
+				     std::forward<P>(p).second);
+	}
+
+	/* Inserts an element if there is no equivalent key, called with
+	 * exclusive lock */
+	template <typename K, typename... Args>
+	std::pair<iterator, bool>
+	internal_try_emplace(index_type &idx, K &&key, Args &&... args)
+	{
+		path_type path;
+		auto l = find_leaf(idx, key, &path);
+		auto slot = find_in_leaf(*l, key);
+		if (slot != npos)
+			return {iterator(l, slot, &_compare), false};
+
+		leaf *new_leaf = nullptr;
+		auto pop = get_pool_base();
+		obj::flat_transaction::run(pop, [&] {
+			if (l->full()) {
+				new_leaf = split_leaf(*l, key);
+				if (!_compare(key, *new_leaf->low_key()))
+					l = new_leaf;
+			}
+
+			slot = insert_in_leaf(
+				*l, std::piecewise_construct,
+				std::forward_as_tuple(std::forward<K>(key)),
+				std::forward_as_tuple(
+					std::forward<Args>(args)...));
+			_size = _size + 1;
+		});
+
+		if (new_leaf != nullptr) {
+			/* the leaf is already linked, the index is rebuilt
+			 * from the list of leaves if it cannot be updated */
+			try {
+				insert_child(idx, path, 0, new_leaf,
+					     new_leaf->low_key());
+			} catch (...) {
+				idx.valid = false;
+				throw;
+			}
+		}
+
+		return {iterator(l, slot, &_compare), true};
+	}
+
+	/* Constructs an element in a free slot of l, called in a transaction */
+	template <typename... Args>
+	size_type
+	insert_in_leaf(leaf &l, Args &&... args)
+	{
+		assert(!l.full());
+
+		auto i = lowest_bit(~l.bitmap.get_ro());
+
+		/* the slot and its fingerprint are not used until the bit is
+		 * set, they only have to be flushed on commit (unless they were
+		 * freed and snapshotted in this transaction) */
+		pmem::detail::conditional_add_to_tx(l.slot(i), 1,
+						    POBJ_XADD_NO_SNAPSHOT);
+		pmem::detail::conditional_add_to_tx(&l.fingerprints[i], 1,
+						    POBJ_XADD_NO_SNAPSHOT);
+
+		pmem::detail::create<value_type>(l.slot(i),
+						 std::forward<Args>(args)...);
+		l.fingerprints[i] = fingerprint(
+			l.slot(i)->first,
+			pmem::detail::is_fingerprintable<fingerprint_type,
+							 key_type>{});
+		l.bitmap = l.bitmap | (uint64_t(1) << i);
+
+		return i;
+	}
+
+	/*
+	 * Destroys the element in slot i, called in a transaction. The slot is
+	 * snapshotted, because it may be reused by an insert in the same
+	 * transaction.
+	 */
+	void
+	destroy_slot(leaf &l, size_type i)
+	{
+		pmem::detail::conditional_add_to_tx(l.slot(i));
+		pmem::detail::conditional_add_to_tx(&l.fingerprints[i]);
+		pmem::detail::destroy<value_type>(*l.slot(i));
+	}
+
+	/*
+	 * Moves the upper half of the elements of the full leaf l to a new
+	 * leaf, which is linked after l, called in a transaction. If key is
+	 * greater than all keys of the last leaf, the new leaf is left empty
+	 * (so ascending inserts fill whole leaves).
+	 */
+	template <typename K>
+	leaf *
+	split_leaf(leaf &l, const K &key)
+	{
+		std::array<uint8_t, leaf_capacity> order;
+		auto n = sorted_slots(l, order, _compare);
+
+		auto right = obj::make_persistent<leaf>();
+
+		if (l.next == nullptr &&
+		    _compare(l.slot(order[n - 1])->first, key)) {
+			pmem::detail::create<key_type>(right->low_key(), key);
+		} else {
+			uint64_t moved = 0;
+			for (size_type j = n / 2; j < n; ++j) {
+				auto s = order[j];
+				auto d = j - n / 2;
+
+				/* the move modifies the source, which has to
+				 * be snapshotted before */
+				pmem::detail::conditional_add_to_tx(l.slot(s));
+				pmem::detail::conditional_add_to_tx(
+					&l.fingerprints[s]);
+				pmem::detail::create<value_type>(
+					right->slot(d), std::move(*l.slot(s)));
+				pmem::detail::destroy<value_type>(*l.slot(s));
+				right->fingerprints[d] = l.fingerprints[s];
+
+				moved |= uint64_t(1) << s;
+			}
+
+			right->bitmap = (uint64_t(1) << (n - n / 2)) - 1;
+			l.bitmap = l.bitmap & ~moved;
+
+			pmem::detail::create<key_type>(right->low_key(),
+						       right->slot(0)->first);
+		}
+
+		right->next = l.next;
+		l.next = right;
+
+		return right.get();
+	}
+
+	/*
+	 * Inserts child (with separator sep) to the right of the child at
+	 * path[level] and splits inner nodes which are full. Adds a new root
+	 * if level is equal to the height of the tree.
+	 */
+	void
+	insert_child(index_type &idx, path_type &path, size_type level,
+		     void *child, const key_type *sep)
+	{
+		if (level == idx.height) {
+			assert(idx.height < MAX_HEIGHT);
+
+			auto root = new inner_node();
+			root->children[0] = idx.root;
+			root->children[1] = child;
+			root->keys[0].set(sep);
+			root->size = 2;
+
+			idx.root = root;
+			++idx.height;
+			return;
+		}
+
+		auto n = path[level].node;
+		auto pos = path[level].pos + 1;
+
+		if (n->size < inner_node_capacity) {
+			n->insert(pos, child, sep);
+			return;
+		}
+
+		auto right = new inner_node();
+		auto mid = inner_node_capacity / 2;
+		for (size_type i = mid; i < inner_node_capacity; ++i) {
+			right->children[i - mid] = n->children[i];
+			if (i > mid)
+				right->keys[i - mid - 1] = n->keys[i - 1];
+		}
+		right->size = inner_node_capacity - mid;
+		n->size = mid;
+
+		auto right_sep = leftmost_leaf(right, level + 1)->low_key();
+
+		if (pos <= mid)
+			n->insert(pos, child, sep);
+		else
+			right->insert(pos - mid, child, sep);
+
+		insert_child(idx, path, level + 1, right, right_sep);
+	}
+
+	/* Removes an element with key equivalent to key, frees the leaf if it
+	 * becomes empty */
+	template <typename K>
+	size_type
+	locked_erase(const K &key)
+	{
+		auto &idx = index_type::get(this);
+		unique_lock_type lock(idx.mutex);
+		idx.validate(*this);
+		idx.invalidate_on_abort();
+
+		path_type path;
+		auto l = find_leaf(idx, key, &path);
+		auto slot = find_in_leaf(*l, key);
+		if (slot == npos)
+			return 0;
+
+		auto bit = uint64_t(1) << slot;
+		bool free_leaf =
+			l != _head.get() && (l->bitmap.get_ro() & ~bit) == 0;
+
+		/* lowest level at which the leaf is not the leftmost child */
+		size_type level = 0;
+		leaf *prev = nullptr;
+		if (free_leaf) {
+			while (path[level].pos == 0)
+				++level;
+
+			auto n = path[level].node;
+			prev = rightmost_leaf(n->children[path[level].pos - 1],
+					      level);
+		}
+
+		auto pop = get_pool_base();
+		obj::flat_transaction::run(pop, [&] {
+			destroy_slot(*l, slot);
+			l->bitmap = l->bitmap & ~bit;
+			_size = _size - 1;
+
+			if (free_leaf) {
+				auto ptr = prev->next;
+				prev->next = l->next;
+				pmem::detail::destroy<key_type>(*l->low_key());
+				obj::delete_persistent<leaf>(ptr);
+			}
+		});
+
+		if (free_leaf)
+			remove_leaf(idx, path, level);
+
+		return 1;
+	}
+
+	/*
+	 * Removes a freed leaf from the inner nodes. The leaf is the leftmost
+	 * leaf of the subtree of the child at path[level], its range of keys
+	 * is taken over by the previous leaf.
+	 */
+	void
+	remove_leaf(index_type &idx, path_type &path, size_type level)
+	{
+		size_type i = 0;
+		for (;; ++i) {
+			auto n = path[i].node;
+			n->remove(path[i].pos);
+			if (n->size > 0)
+				break;
+
+			delete n;
+		}
+
+		if (i < level) {
+			/* the subtree lost its leftmost leaf */
+			auto n = path[level].node;
+			auto pos = path[level].pos;
+			n->keys[pos - 1].set(
+				leftmost_leaf(n->children[pos], level)
+					->low_key());
+		}
+
+		while (idx.height > 0) {
+			auto root = static_cast<inner_node *>(idx.root);
+			if (root->size > 1)
+				break;
+
+			idx.root = root->children[0];
+			--idx.height;
+			delete root;
+		}
+	}
+
+	/* Removes all elements and frees all leaves but the first one, called
+	 * in a transaction */
+	void
+	internal_clear()
+	{
+		for (auto l = _head; l != nullptr;) {
+			auto mask = l->bitmap.get_ro();
+			while (mask) {
+				if (l == _head)
+					destroy_slot(*l, lowest_bit(mask));
+				else
+					pmem::detail::destroy<value_type>(
+						*l->slot(lowest_bit(mask)));
+				mask &= mask - 1;
+			}
+
+			auto next = l->next;
+			if (l == _head) {
+				l->bitmap = 0;
+				l->next = nullptr;
+			} else {
+				pmem::detail::destroy<key_type>(*l->low_key());
+				obj::delete_persistent<leaf>(l);
+			}
+			l = next;
+		}
+
+		_size = 0;
+	}
+
+	obj::persistent_ptr<leaf> _head;
+	obj::p<uint64_t> _size;
+	key_compare _compare;
+};
+
+} /* namespace experimental */
+
+} /* namespace obj */
+
+} /* namespace pmem */
+
+#endif /* LIBPMEMOBJ_CPP_BTREE_MAP_HPP */
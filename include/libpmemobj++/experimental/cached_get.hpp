@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/**
+ * @file
+ * Dereference of persistent_ptr through a per-thread pool base cache.
+ */
+
+#ifndef LIBPMEMOBJ_CPP_CACHED_GET_HPP
+#define LIBPMEMOBJ_CPP_CACHED_GET_HPP
+
+#include <limits>
+
+#include <libpmemobj++/detail/pool_lookup_cache.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+
+namespace pmem
+{
+
+namespace obj
+{
+
+namespace experimental
+{
+
+/**
+ * Get the direct pointer to the object pointed by ptr.
+ *
+ * Returns the same value as ptr.get(). Except on Windows, ptr.get() is
+ * already cached: libpmemobj keeps the last pool of each thread in its
+ * inline pmemobj_direct(), and cached_get() simply calls it.
+ *
+ * On Windows, pmemobj_direct() resolves the pool by its uuid on every call.
+ * There each thread caches the base address of the last pool it has
+ * dereferenced a pointer into, and when the pointer belongs to that pool,
+ * the dereference is a single addition. That cache is invalidated by
+ * pmem::obj::pool_base::close(), pools must not be closed with
+ * pmemobj_close() directly while cached_get() is in use.
+ *
+ * @return the direct pointer to the object or nullptr if ptr is null.
+ */
+template <typename T>
+inline typename persistent_ptr<T>::element_type *
+cached_get(const persistent_ptr<T> &ptr) noexcept
+{
+	using element_type = typename persistent_ptr<T>::element_type;
+
+	const PMEMoid &oid = ptr.raw();
+
+	/* volatile pointers are stored as-is, see persistent_ptr::get() */
+	if (oid.pool_uuid_lo ==
+	    std::numeric_limits<decltype(oid.pool_uuid_lo)>::max())
+		return reinterpret_cast<element_type *>(oid.off);
+
+	return static_cast<element_type *>(
+		pmem::detail::pmemobj_direct_cached(oid));
+}
+
+} /* namespace experimental */
+
+} /* namespace obj */
+
+} /* namespace pmem */
+
+#endif /* LIBPMEMOBJ_CPP_CACHED_GET_HPP */
@@ -0,0 +1,512 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/**
+ * @file
+ * Pmem-resident mutexes which cache the lookup of their pool.
+ */
+
+#ifndef LIBPMEMOBJ_CPP_CACHED_MUTEX_HPP
+#define LIBPMEMOBJ_CPP_CACHED_MUTEX_HPP
+
+#include <chrono>
+
+#include <libpmemobj++/detail/conversions.hpp>
+#include <libpmemobj++/detail/pool_lookup_cache.hpp>
+#include <libpmemobj++/mutex.hpp>
+#include <libpmemobj++/pexceptions.hpp>
+#include <libpmemobj++/shared_mutex.hpp>
+#include <libpmemobj++/timed_mutex.hpp>
+#include <libpmemobj/thread.h>
+#include <libpmemobj/tx_base.h>
+
+namespace pmem
+{
+
+namespace obj
+{
+
+namespace experimental
+{
+
+/**
+ * Persistent memory resident mutex which caches the lookup of its pool.
+ *
+ * pmem::obj::mutex resolves its pool with pmemobj_pool_by_ptr() on every
+ * lock and unlock. This mutex uses a per-thread cache instead (see
+ * pmem::detail::pool_by_ptr_cached()), which makes uncontended locking of
+ * many mutexes from one pool cheaper. On Windows, the cache is valid only
+ * as long as pools are closed by pmem::obj::pool_base::close().
+ *
+ * The layout is the same as of pmem::obj::mutex. It satisfies the Mutex and
+ * StandardLayoutType concepts and can be used as the mutex type of
+ * containers, e.g. concurrent_map.
+ * @ingroup synchronization
+ */
+class cached_mutex {
+public:
+	/** Implementation defined handle to the native type. */
+	using native_handle_type = pmem::obj::mutex::native_handle_type;
+
+	/**
+	 * Default constructor.
+	 *
+	 * @throw lock_error when the mutex is not from persistent memory.
+	 */
+	cached_mutex() = default;
+
+	/**
+	 * Defaulted destructor.
+	 */
+	~cached_mutex() = default;
+
+	/**
+	 * Locks the mutex, blocks if already locked.
+	 *
+	 * @throw lock_error when an error occurs, this includes all
+	 * system related errors with the underlying implementation of
+	 * the mutex.
+	 */
+	void
+	lock()
+	{
+		if (int ret = pmemobj_mutex_lock(pool(), native_handle()))
+			throw pmem::detail::exception_with_errormsg<lock_error>(
+				ret, std::system_category(),
+				"Failed to lock a mutex.");
+	}
+
+	/**
+	 * Tries to lock the mutex, returns regardless if the lock
+	 * succeeds.
+	 *
+	 * @return `true` on successful lock acquisition, `false`
+	 * otherwise.
+	 *
+	 * @throw lock_error when an error occurs.
+	 */
+	bool
+	try_lock()
+	{
+		int ret = pmemobj_mutex_trylock(pool(), native_handle());
+
+		if (ret == 0)
+			return true;
+		else if (ret == EBUSY)
+			return false;
+		else
+			throw pmem::detail::exception_with_errormsg<lock_error>(
+				ret, std::system_category(),
+				"Failed to lock a mutex.");
+	}
+
+	/**
+	 * Unlocks a previously locked mutex.
+	 */
+	void
+	unlock()
+	{
+		int ret = pmemobj_mutex_unlock(pool(), native_handle());
+		if (ret)
+			throw pmem::detail::exception_with_errormsg<lock_error>(
+				ret, std::system_category(),
+				"Failed to unlock a mutex.");
+	}
+
+	/**
+	 * Access a native handle to this mutex.
+	 *
+	 * @return a pointer to PMEMmutex.
+	 */
+	native_handle_type
+	native_handle() noexcept
+	{
+		return mtx.native_handle();
+	}
+
+	/**
+	 * The type of lock needed for the transaction API.
+	 *
+	 * @return TX_PARAM_MUTEX
+	 */
+	enum pobj_tx_param
+	lock_type() const noexcept
+	{
+		return mtx.lock_type();
+	}
+
+	/**
+	 * Deleted assignment operator.
+	 */
+	cached_mutex &operator=(const cached_mutex &) = delete;
+
+	/**
+	 * Deleted copy constructor.
+	 */
+	cached_mutex(const cached_mutex &) = delete;
+
+private:
+	PMEMobjpool *
+	pool() const
+	{
+		return pmem::detail::pool_by_ptr_cached(&mtx);
+	}
+
+	pmem::obj::mutex mtx;
+};
+
+/**
+ * Persistent memory resident shared_mutex which caches the lookup of its
+ * pool.
+ *
+ * It differs from pmem::obj::shared_mutex the same way as cached_mutex
+ * differs from pmem::obj::mutex. The layout is the same as of
+ * pmem::obj::shared_mutex. It satisfies the SharedMutex and
+ * StandardLayoutType concepts and can be used as the MutexType of
+ * concurrent_hash_map.
+ * @ingroup synchronization
+ */
+class cached_shared_mutex {
+public:
+	/** Implementation defined handle to the native type. */
+	using native_handle_type = pmem::obj::shared_mutex::native_handle_type;
+
+	/**
+	 * Default constructor.
+	 *
+	 * @throw lock_error when the mutex is not from persistent memory.
+	 */
+	cached_shared_mutex() = default;
+
+	/**
+	 * Defaulted destructor.
+	 */
+	~cached_shared_mutex() = default;
+
+	/**
+	 * Lock the mutex for exclusive access.
+	 *
+	 * @throw lock_error when an error occurs, this includes all
+	 * system related errors with the underlying implementation of
+	 * the mutex.
+	 */
+	void
+	lock()
+	{
+		if (int ret = pmemobj_rwlock_wrlock(pool(), native_handle()))
+			throw pmem::detail::exception_with_errormsg<lock_error>(
+				ret, std::system_category(),
+				"Failed to lock a shared mutex.");
+	}
+
+	/**
+	 * Lock the mutex for shared access.
+	 *
+	 * @throw lock_error when an error occurs, this includes all
+	 * system related errors with the underlying implementation of
+	 * the mutex.
+	 */
+	void
+	lock_shared()
+	{
+		if (int ret = pmemobj_rwlock_rdlock(pool(), native_handle()))
+			throw pmem::detail::exception_with_errormsg<lock_error>(
+				ret, std::system_category(),
+				"Failed to shared lock a shared mutex.");
+	}
+
+	/**
+	 * Try to lock the mutex for exclusive access, returns
+	 * regardless if the lock succeeds.
+	 *
+	 * @return `true` on successful lock acquisition, `false`
+	 * otherwise.
+	 *
+	 * @throw lock_error when an error occurs.
+	 */
+	bool
+	try_lock()
+	{
+		return try_lock(pmemobj_rwlock_trywrlock);
+	}
+
+	/**
+	 * Try to lock the mutex for shared access, returns
+	 * regardless if the lock succeeds.
+	 *
+	 * @return `false` if a different thread already locked the
+	 * mutex for exclusive access, `true` otherwise.
+	 *
+	 * @throw lock_error when an error occurs.
+	 */
+	bool
+	try_lock_shared()
+	{
+		return try_lock(pmemobj_rwlock_tryrdlock);
+	}
+
+	/**
+	 * Unlocks the mutex locked for exclusive access.
+	 */
+	void
+	unlock()
+	{
+		int ret = pmemobj_rwlock_unlock(pool(), native_handle());
+		if (ret)
+			throw pmem::detail::exception_with_errormsg<lock_error>(
+				ret, std::system_category(),
+				"Failed to unlock a shared mutex.");
+	}
+
+	/**
+	 * Unlocks the mutex locked for shared access.
+	 */
+	void
+	unlock_shared()
+	{
+		this->unlock();
+	}
+
+	/**
+	 * Access a native handle to this shared mutex.
+	 *
+	 * @return a pointer to PMEMrwlock.
+	 */
+	native_handle_type
+	native_handle() noexcept
+	{
+		return mtx.native_handle();
+	}
+
+	/**
+	 * The type of lock needed for the transaction API.
+	 *
+	 * @return TX_PARAM_RWLOCK
+	 */
+	enum pobj_tx_param
+	lock_type() const noexcept
+	{
+		return mtx.lock_type();
+	}
+
+	/**
+	 * Deleted assignment operator.
+	 */
+	cached_shared_mutex &operator=(const cached_shared_mutex &) = delete;
+
+	/**
+	 * Deleted copy constructor.
+	 */
+	cached_shared_mutex(const cached_shared_mutex &) = delete;
+
+private:
+	PMEMobjpool *
+	pool() const
+	{
+		return pmem::detail::pool_by_ptr_cached(&mtx);
+	}
+
+	template <typename F>
+	bool
+	try_lock(F &&try_lock_func)
+	{
+		int ret = try_lock_func(pool(), native_handle());
+
+		if (ret == 0)
+			return true;
+		else if (ret == EBUSY)
+			return false;
+		else
+			throw pmem::detail::exception_with_errormsg<lock_error>(
+				ret, std::system_category(),
+				"Failed to lock a shared mutex.");
+	}
+
+	pmem::obj::shared_mutex mtx;
+};
+
+/**
+ * Persistent memory resident timed_mutex which caches the lookup of its
+ * pool.
+ *
+ * It differs from pmem::obj::timed_mutex the same way as cached_mutex
+ * differs from pmem::obj::mutex. The layout is the same as of
+ * pmem::obj::timed_mutex. It satisfies the TimedMutex and
+ * StandardLayoutType concepts.
+ * @ingroup synchronization
+ */
+class cached_timed_mutex {
+	typedef std::chrono::system_clock clock_type;
+
+public:
+	/** Implementation defined handle to the native type. */
+	using native_handle_type = pmem::obj::timed_mutex::native_handle_type;
+
+	/**
+	 * Default constructor.
+	 *
+	 * @throw lock_error when the mutex is not from persistent memory.
+	 */
+	cached_timed_mutex() = default;
+
+	/**
+	 * Defaulted destructor.
+	 */
+	~cached_timed_mutex() = default;
+
+	/**
+	 * Locks the mutex, blocks if already locked.
+	 *
+	 * @throw lock_error when an error occurs, this includes all
+	 * system related errors with the underlying implementation of
+	 * the mutex.
+	 */
+	void
+	lock()
+	{
+		if (int ret = pmemobj_mutex_lock(pool(), native_handle()))
+			throw pmem::detail::exception_with_errormsg<lock_error>(
+				ret, std::system_category(),
+				"Failed to lock a mutex.");
+	}
+
+	/**
+	 * Tries to lock the mutex, returns regardless if the lock
+	 * succeeds.
+	 *
+	 * @return `true` on successful lock acquisition, `false`
+	 * otherwise.
+	 *
+	 * @throw lock_error when an error occurs.
+	 */
+	bool
+	try_lock()
+	{
+		int ret = pmemobj_mutex_trylock(pool(), native_handle());
+
+		if (ret == 0)
+			return true;
+		else if (ret == EBUSY)
+			return false;
+		else
+			throw pmem::detail::exception_with_errormsg<lock_error>(
+				ret, std::system_category(),
+				"Failed to lock a mutex.");
+	}
+
+	/**
+	 * Makes the current thread block until the lock is acquired or a
+	 * specific time is reached.
+	 *
+	 * @param[in] timeout_time a specific point in time, which when
+	 * reached unblocks the thread.
+	 *
+	 * @return `true` on successful lock acquisition, `false`
+	 * otherwise.
+	 *
+	 * @throw lock_error when an error occurs.
+	 */
+	template <typename Clock, typename Duration>
+	bool
+	try_lock_until(
+		const std::chrono::time_point<Clock, Duration> &timeout_time)
+	{
+		return timedlock_impl(timeout_time);
+	}
+
+	/**
+	 * Makes the current thread block until the lock is acquired or a
+	 * specified amount of time passes.
+	 *
+	 * @param[in] timeout_duration a specific duration, which when
+	 * expired unblocks the thread.
+	 *
+	 * @return `true` on successful lock acquisition, `false`
+	 * otherwise.
+	 *
+	 * @throw lock_error when an error occurs.
+	 */
+	template <typename Rep, typename Period>
+	bool
+	try_lock_for(const std::chrono::duration<Rep, Period> &timeout_duration)
+	{
+		return timedlock_impl(clock_type::now() + timeout_duration);
+	}
+
+	/**
+	 * Unlocks a previously locked mutex.
+	 */
+	void
+	unlock()
+	{
+		int ret = pmemobj_mutex_unlock(pool(), native_handle());
+		if (ret)
+			throw pmem::detail::exception_with_errormsg<lock_error>(
+				ret, std::system_category(),
+				"Failed to unlock a mutex.");
+	}
+
+	/**
+	 * Access a native handle to this mutex.
+	 *
+	 * @return a pointer to PMEMmutex.
+	 */
+	native_handle_type
+	native_handle() noexcept
+	{
+		return mtx.native_handle();
+	}
+
+	/**
+	 * Deleted assignment operator.
+	 */
+	cached_timed_mutex &operator=(const cached_timed_mutex &) = delete;
+
+	/**
+	 * Deleted copy constructor.
+	 */
+	cached_timed_mutex(const cached_timed_mutex &) = delete;
+
+private:
+	PMEMobjpool *
+	pool() const
+	{
+		return pmem::detail::pool_by_ptr_cached(&mtx);
+	}
+
+	template <typename Clock, typename Duration>
+	bool
+	timedlock_impl(const std::chrono::time_point<Clock, Duration> &abs_time)
+	{
+		/* convert to my clock */
+		const typename Clock::time_point their_now = Clock::now();
+		const clock_type::time_point my_now = clock_type::now();
+		const auto delta = abs_time - their_now;
+		const auto my_abs = my_now + delta;
+
+		struct timespec ts =
+			pmem::detail::timepoint_to_timespec(my_abs);
+
+		auto ret = pmemobj_mutex_timedlock(pool(), native_handle(),
+						   &ts);
+
+		if (ret == 0)
+			return true;
+		else if (ret == ETIMEDOUT)
+			return false;
+		else
+			throw pmem::detail::exception_with_errormsg<lock_error>(
+				ret, std::system_category(),
+				"Failed to lock a mutex");
+	}
+
+	pmem::obj::timed_mutex mtx;
+};
+
+} /* namespace experimental */
+
+} /* namespace obj */
+
+} /* namespace pmem */
+
+#endif /* LIBPMEMOBJ_CPP_CACHED_MUTEX_HPP */
@@ -12,6 +12,9 @@
 #include <libpmemobj++/allocator.hpp>
 #include <libpmemobj++/container/detail/concurrent_skip_list_impl.hpp>
 #include <libpmemobj++/detail/pair.hpp>
+#include <libpmemobj++/string_view.hpp>
+
+#include <cstdint>
 
 namespace pmem
 {
@@ -20,6 +23,92 @@ namespace obj
 namespace experimental
 {
 
+/**
+ * Mutex policy for a concurrent_map which is only ever accessed by a single
+ * thread at a time (e.g. a map owned by one worker or built up front and then
+ * only read). Locking and unlocking do nothing, and the nodes do not carry
+ * a persistent mutex, so they are smaller.
+ *
+ * A map with this policy must not be modified concurrently.
+ * @ingroup experimental_containers
+ */
+struct null_mutex {
+	void
+	lock() noexcept
+	{
+	}
+
+	bool
+	try_lock() noexcept
+	{
+		return true;
+	}
+
+	void
+	unlock() noexcept
+	{
+	}
+};
+
+/**
+ * Transparent lexicographic comparator for string keys (pmem::obj::string,
+ * std::string, pmem::obj::string_view or any type with data() and size()
+ * members, and C strings), which makes concurrent_map store the first
+ * eight bytes of every key next to the node's pointers.
+ *
+ * During a search most nodes are passed or rejected by comparing the
+ * prefixes, without loading the key itself, whose characters may be
+ * stored out of line. Only keys with a common prefix of eight bytes are
+ * compared in full. The order is the same as the order of
+ * std::less<std::string>.
+ * @ingroup experimental_containers
+ */
+struct key_prefix_less {
+	using is_transparent = void;
+	using prefix_type = uint64_t;
+
+	template <typename K1, typename K2>
+	bool
+	operator()(const K1 &lhs, const K2 &rhs) const
+	{
+		return view(lhs).compare(view(rhs)) < 0;
+	}
+
+	/**
+	 * @return first bytes of the key as a big-endian number, padded
+	 * with zeros.
+	 */
+	template <typename K>
+	prefix_type
+	prefix(const K &key) const
+	{
+		string_view v = view(key);
+		prefix_type p = 0;
+
+		for (std::size_t i = 0; i < sizeof(prefix_type); ++i) {
+			p <<= 8;
+			if (i < v.size())
+				p |= static_cast<unsigned char>(v[i]);
+		}
+
+		return p;
+	}
+
+private:
+	template <typename K>
+	static string_view
+	view(const K &key)
+	{
+		return string_view(key.data(), key.size());
+	}
+
+	static string_view
+	view(const char *key)
+	{
+		return string_view(key);
+	}
+};
+
 /**
  * Persistent memory aware implementation of Intel TBB
  * [concurrent_map](https://spec.oneapi.io/versions/latest/elements/oneTBB/source/containers/concurrent_map_cls.html)
@@ -48,18 +137,23 @@ namespace experimental
  * types. Allocator type should satisfy the named requirements
  * (https://en.cppreference.com/w/cpp/named_req/Allocator). The allocate() and
  * deallocate() methods are called inside transactions.
+ *
+ * Mutex is the type of the lock embedded in every node. The default
+ * pmem::obj::mutex makes the map safe for concurrent inserts, null_mutex
+ * drops the locking for maps which are used by a single thread.
  * @ingroup experimental_containers
  */
 template <typename Key, typename Value, typename Comp = std::less<Key>,
 	  typename Allocator =
-		  pmem::obj::allocator<detail::pair<const Key, Value>>>
+		  pmem::obj::allocator<detail::pair<const Key, Value>>,
+	  typename Mutex = pmem::obj::mutex>
 class concurrent_map
     : public detail::concurrent_skip_list<detail::map_traits<
 	      Key, Value, Comp, detail::default_random_generator, Allocator,
-	      false, 64>> {
+	      false, 64, Mutex>> {
 	using traits_type = detail::map_traits<Key, Value, Comp,
 					       detail::default_random_generator,
-					       Allocator, false, 64>;
+					       Allocator, false, 64, Mutex>;
 	using base_type = pmem::detail::concurrent_skip_list<traits_type>;
 
 public:
@@ -76,6 +170,8 @@ public:
 	using const_pointer = typename base_type::const_pointer;
 	using iterator = typename base_type::iterator;
 	using const_iterator = typename base_type::const_iterator;
+	using for_each_ptr_function = typename base_type::for_each_ptr_function;
+	using scan_batch_type = typename base_type::scan_batch_type;
 
 	/**
 	 * Default constructor.
@@ -158,10 +254,11 @@ public:
 /** Non-member swap
  * @relates concurrent_map
  */
-template <typename Key, typename Value, typename Comp, typename Allocator>
+template <typename Key, typename Value, typename Comp, typename Allocator,
+	  typename Mutex>
 void
-swap(concurrent_map<Key, Value, Comp, Allocator> &lhs,
-     concurrent_map<Key, Value, Comp, Allocator> &rhs)
+swap(concurrent_map<Key, Value, Comp, Allocator, Mutex> &lhs,
+     concurrent_map<Key, Value, Comp, Allocator, Mutex> &rhs)
 {
 	lhs.swap(rhs);
 }
@@ -0,0 +1,1118 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/**
+ * @file
+ * Implementation of persistent hash map with open addressing.
+ */
+
+#ifndef LIBPMEMOBJ_CPP_FLAT_HASH_MAP_HPP
+#define LIBPMEMOBJ_CPP_FLAT_HASH_MAP_HPP
+
+#include <libpmemobj++/detail/common.hpp>
+#include <libpmemobj++/detail/pair.hpp>
+#include <libpmemobj++/detail/volatile_index.hpp>
+#include <libpmemobj++/make_persistent_array.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIBPMEMOBJ_CPP_FLAT_HASH_MAP_SSE2 1
+#include <emmintrin.h>
+#else
+#define LIBPMEMOBJ_CPP_FLAT_HASH_MAP_SSE2 0
+#endif
+
+namespace pmem
+{
+
+namespace detail
+{
+
+/* Number of control bytes compared at once, the size of an SSE2 register */
+static constexpr std::size_t FLAT_HASH_GROUP_SIZE = 16;
+
+/* Returns a bitmask of the control bytes of a group which are equal to value */
+inline uint32_t
+flat_hash_match(const uint8_t *ctrl, uint8_t value)
+{
+#if LIBPMEMOBJ_CPP_FLAT_HASH_MAP_SSE2
+	auto group = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+	auto match =
+		_mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(value)));
+	return static_cast<uint32_t>(_mm_movemask_epi8(match));
+#else
+	uint32_t mask = 0;
+	for (std::size_t i = 0; i < FLAT_HASH_GROUP_SIZE; ++i)
+		mask |= static_cast<uint32_t>(ctrl[i] == value) << i;
+	return mask;
+#endif
+}
+
+/*
+ * Returns a bitmask of the control bytes of a group which have the most
+ * significant bit set.
+ */
+inline uint32_t
+flat_hash_match_high_bit(const uint8_t *ctrl)
+{
+#if LIBPMEMOBJ_CPP_FLAT_HASH_MAP_SSE2
+	auto group = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+	return static_cast<uint32_t>(_mm_movemask_epi8(group));
+#else
+	uint32_t mask = 0;
+	for (std::size_t i = 0; i < FLAT_HASH_GROUP_SIZE; ++i)
+		mask |= static_cast<uint32_t>(ctrl[i] >> 7) << i;
+	return mask;
+#endif
+}
+
+} /* namespace detail */
+
+namespace obj
+{
+
+namespace experimental
+{
+
+/**
+ * Persistent memory aware implementation of a hash map with open addressing.
+ *
+ * Elements are stored inline in an array of groups. Each group holds
+ * group_size slots and one control byte per slot: a free slot is either
+ * empty or deleted, and the control byte of a full slot keeps 7 bits of the
+ * hash of its key. A lookup compares the control bytes of a whole group at
+ * once (with SSE2 instructions, if available) and compares only the keys of
+ * the slots with a matching control byte, so finding an element usually
+ * touches one group and there is no allocation per element.
+ *
+ * An element is inserted without a transaction: it is written to a free
+ * slot and persisted first, and then it is published by a single store of
+ * its control byte. Erase stores the control byte of the slot only. Growing
+ * the map rehashes all elements to a new array in a transaction. The size of
+ * the map is kept in DRAM and recounted by runtime_initialize() (or by the
+ * first operation after the pool was opened).
+ *
+ * The interface is a subset of the one of concurrent_hash_map, for keys and
+ * values which are small and trivially destructible (e.g. integers or
+ * obj::p<>). All methods are thread-safe with respect to each other:
+ * lookups run concurrently under a shared lock while modifications take the
+ * lock exclusively. An accessor keeps the lock until it is released, so a
+ * thread must release its accessor before it modifies the map. Iterating over
+ * the map is not thread-safe with respect to modifications.
+ *
+ * Apart from constructors, the destructor and free_data(), methods of the map
+ * must not be called in a transaction.
+ *
+ * @ingroup experimental_containers
+ */
+template <typename Key, typename T, typename Hash = std::hash<Key>,
+	  typename KeyEqual = std::equal_to<Key>>
+class flat_hash_map {
+	template <bool IsConst>
+	class flat_hash_map_iterator;
+
+public:
+	using key_type = Key;
+	using mapped_type = T;
+	using value_type = pmem::detail::pair<const key_type, mapped_type>;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using hasher = Hash;
+	using key_equal = KeyEqual;
+	using reference = value_type &;
+	using const_reference = const value_type &;
+	using pointer = value_type *;
+	using const_pointer = const value_type *;
+	using iterator = flat_hash_map_iterator<false>;
+	using const_iterator = flat_hash_map_iterator<true>;
+
+	/** Number of slots in a group. */
+	static constexpr size_type group_size =
+		pmem::detail::FLAT_HASH_GROUP_SIZE;
+
+	static_assert(
+		std::is_trivially_destructible<key_type>::value &&
+			std::is_trivially_destructible<mapped_type>::value,
+		"flat_hash_map supports only trivially destructible keys "
+		"and values.");
+
+private:
+	/* control bytes, a zeroed group consists of empty slots */
+	static constexpr uint8_t EMPTY = 0x00;
+	static constexpr uint8_t DELETED = 0x01;
+	static constexpr uint8_t FULL = 0x80;
+
+	static constexpr uint32_t GROUP_MASK = (1U << group_size) - 1;
+
+	struct group {
+		uint8_t ctrl[group_size];
+		alignas(value_type) unsigned char slots[sizeof(value_type) *
+							group_size];
+
+		value_type *
+		slot(size_type i)
+		{
+			return reinterpret_cast<value_type *>(slots) + i;
+		}
+
+		uint32_t
+		match(uint8_t value) const
+		{
+			return pmem::detail::flat_hash_match(ctrl, value);
+		}
+
+		uint32_t
+		match_full() const
+		{
+			return pmem::detail::flat_hash_match_high_bit(ctrl);
+		}
+	};
+
+	/* position of an element, g is nullptr if it was not found */
+	struct position {
+		group *g;
+		size_type slot;
+
+		value_type *
+		get() const
+		{
+			return g->slot(slot);
+		}
+	};
+
+	/* Counters of the map, kept in its volatile index */
+	struct index_data {
+		size_type size = 0;
+		size_type tombstones = 0;
+	};
+
+	using index_type = pmem::detail::volatile_index<index_data>;
+	friend index_type;
+
+	using shared_lock_type = typename index_type::shared_lock_type;
+	using unique_lock_type = typename index_type::unique_lock_type;
+
+public:
+	/**
+	 * Gives read-only access to an element and holds a shared lock of the
+	 * map until it is released.
+	 */
+	class const_accessor {
+		friend class flat_hash_map;
+
+	public:
+		/** Type of value. */
+		using value_type = const typename flat_hash_map::value_type;
+
+		/**
+		 * Creates an empty accessor. Cannot be used in a transaction.
+		 */
+		const_accessor()
+		{
+			check_outside_tx();
+		}
+
+		const_accessor(const const_accessor &) = delete;
+		const_accessor &operator=(const const_accessor &) = delete;
+
+		/**
+		 * @returns true if accessor does not hold any element, false
+		 * otherwise.
+		 */
+		bool
+		empty() const
+		{
+			return my_value == nullptr;
+		}
+
+		/**
+		 * Releases the element and the lock of the map.
+		 *
+		 * @throw transaction_scope_error if called inside transaction
+		 */
+		void
+		release()
+		{
+			check_outside_tx();
+
+			my_value = nullptr;
+			if (my_shared_lock.owns_lock())
+				my_shared_lock.unlock();
+			if (my_lock.owns_lock())
+				my_lock.unlock();
+		}
+
+		/**
+		 * @return reference to the element.
+		 */
+		const_reference
+		operator*() const
+		{
+			assert(my_value);
+
+			return *my_value;
+		}
+
+		/**
+		 * @return pointer to the element.
+		 */
+		const_pointer
+		operator->() const
+		{
+			return &operator*();
+		}
+
+	protected:
+		pointer my_value = nullptr;
+		shared_lock_type my_shared_lock;
+		unique_lock_type my_lock;
+	};
+
+	/**
+	 * Gives write access to an element and holds an exclusive lock of the
+	 * map until it is released. Changes of the element are not persisted
+	 * nor added to a transaction by the map.
+	 */
+	class accessor : public const_accessor {
+	public:
+		/** Type of value. */
+		using value_type = typename flat_hash_map::value_type;
+
+		/** @return reference to the element. */
+		reference
+		operator*() const
+		{
+			assert(this->my_value);
+
+			return *this->my_value;
+		}
+
+		/** @return pointer to the element. */
+		pointer
+		operator->() const
+		{
+			return &operator*();
+		}
+	};
+
+	/**
+	 * Default constructor. Constructs an empty map.
+	 *
+	 * @pre must be called in transaction scope.
+	 *
+	 * @throw pmem::transaction_scope_error if constructor wasn't called in
+	 * transaction.
+	 * @throw pmem::transaction_alloc_error when allocating memory for the
+	 * groups failed.
+	 */
+	flat_hash_map()
+	{
+		check_tx_stage_work();
+		init(1);
+	}
+
+	/**
+	 * Constructs an empty map with enough groups to hold n elements
+	 * without growing.
+	 *
+	 * @pre must be called in transaction scope.
+	 *
+	 * @throw pmem::transaction_scope_error if constructor wasn't called in
+	 * transaction.
+	 * @throw pmem::transaction_alloc_error when allocating memory for the
+	 * groups failed.
+	 */
+	explicit flat_hash_map(size_type n)
+	{
+		check_tx_stage_work();
+		init(groups_for(n));
+	}
+
+	/**
+	 * Constructs the map with the contents of the range [first, last).
+	 * If multiple elements in the range have equivalent keys, only the
+	 * first one is inserted.
+	 *
+	 * @pre must be called in transaction scope.
+	 *
+	 * @throw pmem::transaction_scope_error if constructor wasn't called in
+	 * transaction.
+	 * @throw pmem::transaction_alloc_error when allocating memory for the
+	 * groups failed.
+	 */
+	template <typename I>
+	flat_hash_map(I first, I last)
+	{
+		check_tx_stage_work();
+		init(groups_for(
+			static_cast<size_type>(std::distance(first, last))));
+
+		for (; first != last; ++first) {
+			auto h = hash_of(first->first);
+			if (internal_find(first->first, h).g == nullptr)
+				construct(find_free(h), h, *first);
+		}
+	}
+
+	/**
+	 * Constructs the map with the contents of the initializer list il.
+	 *
+	 * @pre must be called in transaction scope.
+	 *
+	 * @throw pmem::transaction_scope_error if constructor wasn't called in
+	 * transaction.
+	 * @throw pmem::transaction_alloc_error when allocating memory for the
+	 * groups failed.
+	 */
+	flat_hash_map(std::initializer_list<value_type> il)
+	    : flat_hash_map(il.begin(), il.end())
+	{
+	}
+
+	flat_hash_map(const flat_hash_map &) = delete;
+	flat_hash_map &operator=(const flat_hash_map &) = delete;
+
+	/**
+	 * Destructor. Frees the groups of the map.
+	 */
+	~flat_hash_map()
+	{
+		try {
+			free_data();
+		} catch (...) {
+			std::terminate();
+		}
+	}
+
+	/**
+	 * Recounts the elements of the map. Should be called once after the
+	 * pool is opened, it is a no-op for the persistent data.
+	 *
+	 * @throw pmem::transaction_scope_error if called in a transaction.
+	 */
+	void
+	runtime_initialize()
+	{
+		check_outside_tx();
+
+		auto &idx = index_type::get(this);
+		unique_lock_type lock(idx.mutex);
+		rebuild(idx);
+	}
+
+	/**
+	 * Transactionally frees all memory allocated by the map. The map can
+	 * NOT be used after free_data() was called (unless it was called in
+	 * a transaction and that transaction aborted).
+	 *
+	 * @throw pmem::transaction_free_error when freeing memory failed.
+	 */
+	void
+	free_data()
+	{
+		if (_groups == nullptr)
+			return;
+
+		auto pop = get_pool_base();
+		obj::flat_transaction::run(pop, [&] {
+			obj::delete_persistent<group[]>(
+				_groups,
+				static_cast<size_type>(_group_count.get_ro()));
+			_groups = nullptr;
+			_group_count = 0;
+			index_type::destroy(this);
+		});
+	}
+
+	/**
+	 * Returns an iterator to the first element of the map.
+	 */
+	iterator
+	begin()
+	{
+		return iterator(_groups.get(), groups_end(), 0);
+	}
+
+	/**
+	 * Returns a const iterator to the first element of the map.
+	 */
+	const_iterator
+	begin() const
+	{
+		return const_iterator(_groups.get(), groups_end(), 0);
+	}
+
+	/**
+	 * Returns an iterator to the element following the last element of
+	 * the map.
+	 */
+	iterator
+	end()
+	{
+		return iterator(groups_end(), groups_end(), 0);
+	}
+
+	/**
+	 * Returns a const iterator to the element following the last element
+	 * of the map.
+	 */
+	const_iterator
+	end() const
+	{
+		return const_iterator(groups_end(), groups_end(), 0);
+	}
+
+	/**
+	 * Checks if the map has no elements.
+	 */
+	bool
+	empty() const
+	{
+		return size() == 0;
+	}
+
+	/**
+	 * Returns the number of elements in the map.
+	 */
+	size_type
+	size() const
+	{
+		auto &idx = index_type::get(this);
+		auto lock = idx.lock_shared(*this);
+
+		return idx.size;
+	}
+
+	/**
+	 * Returns the maximum number of elements the map is able to hold.
+	 */
+	size_type
+	max_size() const
+	{
+		return (std::numeric_limits<size_type>::max)() / sizeof(group) *
+			group_size;
+	}
+
+	/**
+	 * Returns the number of slots in the map.
+	 */
+	size_type
+	bucket_count() const
+	{
+		return static_cast<size_type>(_group_count.get_ro()) *
+			group_size;
+	}
+
+	/**
+	 * Inserts value if the map doesn't already contain an element with an
+	 * equivalent key.
+	 *
+	 * @return true if the element was inserted, false otherwise.
+	 *
+	 * @throw pmem::transaction_scope_error if called inside transaction.
+	 * @throw pmem::transaction_alloc_error when growing the map failed.
+	 */
+	bool
+	insert(const value_type &value)
+	{
+		check_outside_tx();
+
+		auto &idx = index_type::get(this);
+		unique_lock_type lock(idx.mutex);
+		idx.validate(*this);
+
+		return internal_insert(idx, value.first, value).second;
+	}
+
+	/**
+	 * Inserts elements from the range [first, last).
+	 *
+	 * @throw pmem::transaction_scope_error if called inside transaction.
+	 * @throw pmem::transaction_alloc_error when growing the map failed.
+	 */
+	template <typename I>
+	void
+	insert(I first, I last)
+	{
+		check_outside_tx();
+
+		auto &idx = index_type::get(this);
+		unique_lock_type lock(idx.mutex);
+		idx.validate(*this);
+
+		for (; first != last; ++first)
+			internal_insert(idx, first->first, *first);
+	}
+
+	/**
+	 * Inserts elements from the initializer list il.
+	 *
+	 * @throw pmem::transaction_scope_error if called inside transaction.
+	 * @throw pmem::transaction_alloc_error when growing the map failed.
+	 */
+	void
+	insert(std::initializer_list<value_type> il)
+	{
+		insert(il.begin(), il.end());
+	}
+
+	/**
+	 * Inserts an element made of key and obj if the map doesn't already
+	 * contain an element with an equivalent key, otherwise assigns obj to
+	 * the value of that element in a transaction.
+	 *
+	 * @return true if the element was inserted, false if it was assigned.
+	 *
+	 * @throw pmem::transaction_scope_error if called inside transaction.
+	 * @throw pmem::transaction_error when snapshotting the value failed.
+	 * @throw pmem::transaction_alloc_error when growing the map failed.
+	 */
+	template <typename M>
+	bool
+	insert_or_assign(const key_type &key, M &&obj)
+	{
+		check_outside_tx();
+
+		auto &idx = index_type::get(this);
+		unique_lock_type lock(idx.mutex);
+		idx.validate(*this);
+
+		auto ret = internal_insert(idx, key, key, obj);
+		if (!ret.second) {
+			auto pop = get_pool_base();
+			obj::flat_transaction::run(pop, [&] {
+				pmem::detail::conditional_add_to_tx(
+					&ret.first->second, 1,
+					POBJ_XADD_ASSUME_INITIALIZED);
+				ret.first->second = std::forward<M>(obj);
+			});
+		}
+
+		return ret.second;
+	}
+
+	/**
+	 * Finds an element with key equivalent to key and acquires it for
+	 * reading.
+	 *
+	 * @return true if the element was found, false otherwise.
+	 *
+	 * @throw pmem::transaction_scope_error if called inside transaction.
+	 */
+	bool
+	find(const_accessor &result, const key_type &key) const
+	{
+		check_outside_tx();
+		result.release();
+
+		auto &idx = index_type::get(this);
+		auto lock = idx.lock_shared(*this);
+
+		auto pos = internal_find(key, hash_of(key));
+		if (pos.g == nullptr)
+			return false;
+
+		result.my_value = pos.get();
+		result.my_shared_lock = std::move(lock);
+
+		return true;
+	}
+
+	/**
+	 * Finds an element with key equivalent to key and acquires it for
+	 * writing.
+	 *
+	 * @return true if the element was found, false otherwise.
+	 *
+	 * @throw pmem::transaction_scope_error if called inside transaction.
+	 */
+	bool
+	find(accessor &result, const key_type &key)
+	{
+		check_outside_tx();
+		result.release();
+
+		auto &idx = index_type::get(this);
+		unique_lock_type lock(idx.mutex);
+		idx.validate(*this);
+
+		auto pos = internal_find(key, hash_of(key));
+		if (pos.g == nullptr)
+			return false;
+
+		result.my_value = pos.get();
+		result.my_lock = std::move(lock);
+
+		return true;
+	}
+
+	/**
+	 * Returns the number of elements with key equivalent to key (either 1
+	 * or 0).
+	 *
+	 * @throw pmem::transaction_scope_error if called inside transaction.
+	 */
+	size_type
+	count(const key_type &key) const
+	{
+		check_outside_tx();
+
+		auto &idx = index_type::get(this);
+		auto lock = idx.lock_shared(*this);
+
+		return internal_find(key, hash_of(key)).g != nullptr;
+	}
+
+	/**
+	 * Removes the element with key equivalent to key, if it exists.
+	 *
+	 * @return true if the element was removed, false otherwise.
+	 *
+	 * @throw pmem::transaction_scope_error if called inside transaction.
+	 */
+	bool
+	erase(const key_type &key)
+	{
+		check_outside_tx();
+
+		auto &idx = index_type::get(this);
+		unique_lock_type lock(idx.mutex);
+		idx.validate(*this);
+
+		auto pos = internal_find(key, hash_of(key));
+		if (pos.g == nullptr)
+			return false;
+
+		/*
+		 * Probing stops at a group with an empty slot, so if this group
+		 * still has one, no probe sequence continues past it and the
+		 * slot may become empty again.
+		 */
+		auto ctrl = pos.g->match(EMPTY) != 0 ? EMPTY : DELETED;
+		pos.g->ctrl[pos.slot] = ctrl;
+		get_pool_base().persist(&pos.g->ctrl[pos.slot], 1);
+
+		--idx.size;
+		if (ctrl == DELETED)
+			++idx.tombstones;
+
+		return true;
+	}
+
+	/**
+	 * Rehashes all elements to a new array of groups, large enough to
+	 * hold max(n, size()) elements without growing. Removes the slots
+	 * of erased elements from the probe sequences.
+	 *
+	 * @throw pmem::transaction_scope_error if called inside transaction.
+	 * @throw pmem::transaction_alloc_error when allocating the new groups
+	 * failed.
+	 */
+	void
+	rehash(size_type n = 0)
+	{
+		check_outside_tx();
+
+		auto &idx = index_type::get(this);
+		unique_lock_type lock(idx.mutex);
+		idx.validate(*this);
+
+		internal_rehash(idx, groups_for((std::max)(n, idx.size)));
+	}
+
+	/**
+	 * Transactionally removes all elements from the map and shrinks it to
+	 * a single group.
+	 *
+	 * @throw pmem::transaction_scope_error if called inside transaction.
+	 * @throw pmem::transaction_alloc_error when allocating the new group
+	 * failed.
+	 */
+	void
+	clear()
+	{
+		check_outside_tx();
+
+		auto &idx = index_type::get(this);
+		unique_lock_type lock(idx.mutex);
+
+		auto pop = get_pool_base();
+		obj::flat_transaction::run(pop, [&] {
+			obj::delete_persistent<group[]>(
+				_groups,
+				static_cast<size_type>(_group_count.get_ro()));
+			init(1);
+		});
+
+		idx.size = 0;
+		idx.tombstones = 0;
+		idx.valid = true;
+	}
+
+private:
+	/* Forward iterator over the full slots of the groups */
+	template <bool IsConst>
+	class flat_hash_map_iterator {
+		friend class flat_hash_map;
+
+		template <bool>
+		friend class flat_hash_map_iterator;
+
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = typename flat_hash_map::value_type;
+		using difference_type = typename flat_hash_map::difference_type;
+		using reference =
+			typename std::conditional<IsConst, const value_type &,
+						  value_type &>::type;
+		using pointer =
+			typename std::conditional<IsConst, const value_type *,
+						  value_type *>::type;
+
+		flat_hash_map_iterator() = default;
+
+		/** Conversion from iterator to const_iterator. */
+		template <bool C = IsConst,
+			  typename Enable = typename std::enable_if<C>::type>
+		flat_hash_map_iterator(
+			const flat_hash_map_iterator<false> &other)
+		    : g(other.g), last(other.last), slot(other.slot)
+		{
+		}
+
+		reference
+		operator*() const
+		{
+			return *g->slot(slot);
+		}
+
+		pointer
+		operator->() const
+		{
+			return g->slot(slot);
+		}
+
+		flat_hash_map_iterator &
+		operator++()
+		{
+			assert(g != last);
+
+			++slot;
+			skip_free();
+
+			return *this;
+		}
+
+		flat_hash_map_iterator
+		operator++(int)
+		{
+			auto tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		bool
+		operator==(const flat_hash_map_iterator &rhs) const
+		{
+			return g == rhs.g && slot == rhs.slot;
+		}
+
+		bool
+		operator!=(const flat_hash_map_iterator &rhs) const
+		{
+			return !(*this == rhs);
+		}
+
+	private:
+		flat_hash_map_iterator(group *first, group *end, size_type s)
+		    : g(first), last(end), slot(s)
+		{
+			skip_free();
+		}
+
+		/* Moves to the first full slot at or after the current one */
+		void
+		skip_free()
+		{
+			while (g != last) {
+				auto full = g->match_full() &
+					(~uint32_t(0) << slot) & GROUP_MASK;
+				if (full != 0) {
+					slot = lowest_bit(full);
+					return;
+				}
+
+				++g;
+				slot = 0;
+			}
+
+			slot = 0;
+		}
+
+		group *g = nullptr;
+		group *last = nullptr;
+		size_type slot = 0;
+	};
+
+	static void
+	check_outside_tx()
+	{
+		if (pmemobj_tx_stage() != TX_STAGE_NONE)
+			throw pmem::transaction_scope_error(
+				"Function called inside transaction scope.");
+	}
+
+	void
+	check_tx_stage_work() const
+	{
+		if (pmemobj_tx_stage() != TX_STAGE_WORK)
+			throw pmem::transaction_scope_error(
+				"Function called out of transaction scope.");
+	}
+
+	obj::pool_base
+	get_pool_base() const
+	{
+		PMEMobjpool *pop = pmemobj_pool_by_ptr(this);
+		return obj::pool_base(pop);
+	}
+
+	void
+	init(size_type groups)
+	{
+		_groups = obj::make_persistent<group[]>(groups);
+		_group_count = groups;
+	}
+
+	/* Recounts the elements of the index */
+	void
+	rebuild(index_type &idx) const
+	{
+		idx.size = 0;
+		idx.tombstones = 0;
+
+		for (auto g = _groups.get(); g != groups_end(); ++g) {
+			idx.size += popcount(g->match_full());
+			idx.tombstones += popcount(g->match(DELETED));
+		}
+
+		idx.valid = true;
+	}
+
+	group *
+	groups_end() const
+	{
+		return _groups.get() + _group_count.get_ro();
+	}
+
+	size_type
+	group_mask() const
+	{
+		return static_cast<size_type>(_group_count.get_ro()) - 1;
+	}
+
+	/* Maximum number of full and deleted slots in the given groups */
+	static size_type
+	max_load(size_type groups)
+	{
+		return groups * group_size * 7 / 8;
+	}
+
+	/* Smallest power of 2 of groups which can hold n elements */
+	static size_type
+	groups_for(size_type n)
+	{
+		size_type groups = 1;
+		while (max_load(groups) < n)
+			groups *= 2;
+
+		return groups;
+	}
+
+	static size_type
+	lowest_bit(uint32_t mask)
+	{
+		return pmem::detail::mssb_index(mask & (~mask + 1));
+	}
+
+	static size_type
+	popcount(uint32_t mask)
+	{
+		size_type n = 0;
+		for (; mask != 0; mask &= mask - 1)
+			++n;
+
+		return n;
+	}
+
+	/* Hash of a key, mixed so that its low and high bits are usable */
+	static uint64_t
+	hash_of(const key_type &key)
+	{
+		auto h = static_cast<uint64_t>(hasher{}(key));
+		h *= 0x9E3779B97F4A7C15ULL;
+		return h ^ (h >> 32);
+	}
+
+	/* Control byte of a full slot, holds the lowest 7 bits of the hash */
+	static uint8_t
+	control_byte(uint64_t h)
+	{
+		return static_cast<uint8_t>(FULL | (h & 0x7F));
+	}
+
+	/*
+	 * Probes groups h >> 7, then 1, 2, 3, ... groups further (which visits
+	 * all groups for a power of 2 of groups), until a group with an empty
+	 * slot.
+	 */
+	position
+	internal_find(const key_type &key, uint64_t h) const
+	{
+		auto groups = _groups.get();
+		auto mask = group_mask();
+		auto tag = control_byte(h);
+		auto pos = static_cast<size_type>(h >> 7) & mask;
+
+		for (size_type step = 1;; ++step) {
+			auto &g = groups[pos];
+			for (auto m = g.match(tag); m != 0; m &= m - 1) {
+				auto i = lowest_bit(m);
+				if (key_equal{}(g.slot(i)->first, key))
+					return {&g, i};
+			}
+
+			if (g.match(EMPTY) != 0)
+				return {nullptr, 0};
+
+			pos = (pos + step) & mask;
+		}
+	}
+
+	/* Returns the first free slot in the probe sequence of h */
+	position
+	find_free(uint64_t h) const
+	{
+		auto groups = _groups.get();
+		auto mask = group_mask();
+		auto pos = static_cast<size_type>(h >> 7) & mask;
+
+		for (size_type step = 1;; ++step) {
+			auto &g = groups[pos];
+			auto free = ~g.match_full() & GROUP_MASK;
+			if (free != 0)
+				return {&g, lowest_bit(free)};
+
+			pos = (pos + step) & mask;
+		}
+	}
+
+	/*
+	 * Constructs an element in a free slot, used only for new groups
+	 * which are persisted when the transaction commits.
+	 */
+	template <typename... Args>
+	void
+	construct(position pos, uint64_t h, Args &&... args)
+	{
+		new (pos.get()) value_type(std::forward<Args>(args)...);
+		pos.g->ctrl[pos.slot] = control_byte(h);
+	}
+
+	/*
+	 * Inserts an element if there is no element with an equivalent key,
+	 * called with exclusive lock. The element is written to a free slot
+	 * and persisted, then it is published by a store of its control byte.
+	 */
+	template <typename... Args>
+	std::pair<value_type *, bool>
+	internal_insert(index_type &idx, const key_type &key, Args &&... args)
+	{
+		auto h = hash_of(key);
+		auto pos = internal_find(key, h);
+		if (pos.g != nullptr)
+			return {pos.get(), false};
+
+		pos = find_free(h);
+
+		/* taking an empty slot makes probe sequences longer */
+		if (pos.g->ctrl[pos.slot] == EMPTY &&
+		    idx.size + idx.tombstones >= max_load(_group_count)) {
+			auto groups = static_cast<size_type>(_group_count);
+			if (idx.size + 1 > max_load(groups) / 2)
+				groups *= 2;
+			internal_rehash(idx, groups);
+
+			pos = find_free(h);
+		}
+
+		if (pos.g->ctrl[pos.slot] == DELETED)
+			--idx.tombstones;
+
+		auto pop = get_pool_base();
+		new (pos.get()) value_type(std::forward<Args>(args)...);
+		pop.persist(pos.get(), sizeof(value_type));
+
+		pos.g->ctrl[pos.slot] = control_byte(h);
+		pop.persist(&pos.g->ctrl[pos.slot], 1);
+
+		++idx.size;
+
+		return {pos.get(), true};
+	}
+
+	/* Moves all elements to a new array of groups in a transaction */
+	void
+	internal_rehash(index_type &idx, size_type groups)
+	{
+		auto old_groups = _groups;
+		auto old_end = groups_end();
+		auto old_count = static_cast<size_type>(_group_count);
+
+		auto pop = get_pool_base();
+		obj::flat_transaction::run(pop, [&] {
+			init(groups);
+
+			for (auto g = old_groups.get(); g != old_end; ++g) {
+				for (auto m = g->match_full(); m != 0;
+				     m &= m - 1) {
+					auto i = lowest_bit(m);
+					auto h = hash_of(g->slot(i)->first);
+					construct(find_free(h), h, *g->slot(i));
+				}
+			}
+
+			obj::delete_persistent<group[]>(old_groups, old_count);
+		});
+
+		idx.tombstones = 0;
+	}
+
+	obj::persistent_ptr<group[]> _groups;
+	obj::p<uint64_t> _group_count;
+};
+
+} /* namespace experimental */
+
+} /* namespace obj */
+
+} /* namespace pmem */
+
+#endif /* LIBPMEMOBJ_CPP_FLAT_HASH_MAP_HPP */
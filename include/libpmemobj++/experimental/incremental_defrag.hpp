@@ -0,0 +1,278 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/**
+ * @file
+ * Online defragmentation performed in bounded time slices.
+ */
+
+#ifndef LIBPMEMOBJ_CPP_INCREMENTAL_DEFRAG_HPP
+#define LIBPMEMOBJ_CPP_INCREMENTAL_DEFRAG_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <libpmemobj++/defrag.hpp>
+#include <libpmemobj++/experimental/pool_stats.hpp>
+#include <libpmemobj++/pexceptions.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj/atomic_base.h>
+
+namespace pmem
+{
+
+namespace obj
+{
+
+namespace experimental
+{
+
+/**
+ * Driver of an online, incremental defragmentation.
+ *
+ * Containers registered with add() are defragmented in slices: every
+ * step() processes slice_percent of one container, so a single step takes
+ * a bounded amount of time and can be interleaved with the application's
+ * work, e.g. run by a background thread with run_for().
+ *
+ * Containers are expected to implement
+ * defragment(double start_percent, double amount_percent) which locks only
+ * the part being processed and skips elements which are in use, like
+ * pmem::obj::concurrent_hash_map::defragment() does. Thanks to that,
+ * other threads can keep reading and modifying the containers while the
+ * defragmentation is in progress.
+ *
+ * One pass goes over all containers once. Heap fragmentation is sampled
+ * when a pass starts and when it completes, see before() and after().
+ *
+ * Steps of a single driver must not be run concurrently.
+ */
+class incremental_defrag {
+public:
+	/**
+	 * Type of a single slice of work: defragments part of a container
+	 * specified by [start_percent, start_percent + amount_percent].
+	 */
+	using slice_function = std::function<pobj_defrag_result(
+		double start_percent, double amount_percent)>;
+
+	/**
+	 * Binds the driver with a pool.
+	 *
+	 * @param[in] p pool in which the containers reside.
+	 * @param[in] slice_percent part of a container processed in a single
+	 *	step.
+	 *
+	 * @throw std::range_error if slice_percent is not in (0, 100].
+	 */
+	incremental_defrag(pool_base p, double slice_percent = 5)
+	    : pop(p), slice_percent(slice_percent)
+	{
+		if (!(slice_percent > 0 && slice_percent <= 100))
+			throw std::range_error("incorrect slice size");
+
+		slices_per_container =
+			static_cast<size_t>(std::ceil(100 / slice_percent));
+	}
+
+	/**
+	 * Registers a container which can be defragmented in parts. The
+	 * container must outlive the driver.
+	 *
+	 * @param[in] c container implementing
+	 *	defragment(double start_percent, double amount_percent).
+	 *
+	 * @throw std::runtime_error when c is not from the pool passed in
+	 *	ctor.
+	 */
+	template <typename Container,
+		  typename = decltype(std::declval<Container &>().defragment(
+			  0.0, 0.0))>
+	void
+	add(Container &c)
+	{
+		if (pmemobj_pool_by_ptr(&c) != pop.handle())
+			throw std::runtime_error(
+				"object is not from the chosen pool");
+
+		add(slice_function([&c](double start, double amount) {
+			return c.defragment(start, amount);
+		}));
+	}
+
+	/**
+	 * Registers a custom slice function.
+	 */
+	void
+	add(slice_function f)
+	{
+		slices.push_back(std::move(f));
+	}
+
+	/**
+	 * Defragments the next slice.
+	 *
+	 * @return true if the current pass is completed.
+	 *
+	 * @throw rethrows pmem::defrag_error when a failure during
+	 *	defragmentation occurs. The slice is not retried, its partial
+	 *	results are included in result(). If it was the last slice,
+	 *	after() is not sampled.
+	 */
+	bool
+	step()
+	{
+		if (done())
+			return true;
+
+		if (position == 0)
+			before_stats = current_fragmentation();
+
+		size_t container = position / slices_per_container;
+		size_t slice = position % slices_per_container;
+		++position;
+
+		double start = static_cast<double>(slice) * slice_percent;
+		double amount = (std::min)(slice_percent, 100 - start);
+
+		/* possible only due to rounding of the number of slices */
+		if (amount <= 0)
+			return finish_if_done();
+
+		try {
+			accumulate(slices[container](start, amount));
+		} catch (pmem::defrag_error &e) {
+			accumulate(e.result);
+			throw;
+		}
+
+		return finish_if_done();
+	}
+
+	/**
+	 * Runs steps until the pass is completed or the time budget is
+	 * exhausted. The last step may exceed the budget by the time of
+	 * a single slice.
+	 *
+	 * @return true if the current pass is completed.
+	 *
+	 * @throw rethrows pmem::defrag_error, see step().
+	 */
+	template <typename Rep, typename Period>
+	bool
+	run_for(const std::chrono::duration<Rep, Period> &budget)
+	{
+		auto deadline = std::chrono::steady_clock::now() + budget;
+
+		while (!step()) {
+			if (std::chrono::steady_clock::now() >= deadline)
+				return false;
+		}
+
+		return true;
+	}
+
+	/**
+	 * @return true if all slices of the current pass were processed.
+	 */
+	bool
+	done() const noexcept
+	{
+		return position >= slices.size() * slices_per_container;
+	}
+
+	/**
+	 * Starts a new pass. Results of the previous one are discarded.
+	 */
+	void
+	restart() noexcept
+	{
+		position = 0;
+		total_result = {0, 0};
+		before_stats = {0, 0};
+		after_stats = {0, 0};
+	}
+
+	/**
+	 * @return number of relocated and total processed objects in the
+	 *	current pass.
+	 */
+	pobj_defrag_result
+	result() const noexcept
+	{
+		return total_result;
+	}
+
+	/**
+	 * @return fragmentation sampled at the beginning of the current
+	 *	pass.
+	 */
+	fragmentation_stats
+	before() const noexcept
+	{
+		return before_stats;
+	}
+
+	/**
+	 * @return fragmentation sampled at the end of the current pass.
+	 */
+	fragmentation_stats
+	after() const noexcept
+	{
+		return after_stats;
+	}
+
+	/**
+	 * Reads current fragmentation of the pool.
+	 *
+	 * @throw pmem::ctl_error if statistics cannot be read.
+	 */
+	fragmentation_stats
+	current_fragmentation()
+	{
+		return pool_statistics(pop).fragmentation();
+	}
+
+private:
+	void
+	accumulate(const pobj_defrag_result &r) noexcept
+	{
+		total_result.total += r.total;
+		total_result.relocated += r.relocated;
+	}
+
+	bool
+	finish_if_done()
+	{
+		if (!done())
+			return false;
+
+		after_stats = current_fragmentation();
+		return true;
+	}
+
+	pool_base pop;
+	double slice_percent;
+	size_t slices_per_container;
+	std::vector<slice_function> slices;
+
+	size_t position = 0;
+	pobj_defrag_result total_result = {0, 0};
+	fragmentation_stats before_stats = {0, 0};
+	fragmentation_stats after_stats = {0, 0};
+};
+
+} /* namespace experimental */
+
+} /* namespace obj */
+
+} /* namespace pmem */
+
+#endif /* LIBPMEMOBJ_CPP_INCREMENTAL_DEFRAG_HPP */
@@ -15,6 +15,9 @@
 #include <libpmemobj++/string_view.hpp>
 #include <libpmemobj++/transaction.hpp>
 
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
 #include <string>
 
 namespace pmem
@@ -26,8 +29,24 @@ namespace obj
 namespace experimental
 {
 
-template <typename CharT, typename Traits = std::char_traits<CharT>>
+/**
+ * Common part of basic_inline_string and basic_dram_inline_string.
+ *
+ * The header consists of size and capacity, both of type SizeT, and is
+ * followed directly by the characters. The default uint64_t header takes 16
+ * bytes; short keys (e.g. in radix_tree leaves) can use uint32_t (or smaller)
+ * header to save 8 bytes or more per object. Size and capacity are then
+ * limited to std::numeric_limits<SizeT>::max().
+ */
+template <typename CharT, typename Traits = std::char_traits<CharT>,
+	  typename SizeT = uint64_t>
 class basic_inline_string_base {
+	static_assert(std::is_integral<SizeT>::value &&
+			      std::is_unsigned<SizeT>::value,
+		      "SizeT must be an unsigned integral type");
+	static_assert(alignof(SizeT) >= alignof(CharT),
+		      "SizeT alignment must not be smaller than CharT's");
+
 public:
 	using traits_type = Traits;
 	using value_type = CharT;
@@ -48,7 +67,7 @@ public:
 	basic_inline_string_base &
 	operator=(basic_string_view<CharT, Traits> rhs);
 
-	basic_inline_string_base(basic_inline_string_base<CharT> &&) = delete;
+	basic_inline_string_base(basic_inline_string_base &&) = delete;
 
 	basic_inline_string_base &
 	operator=(basic_inline_string_base &&) = delete;
@@ -76,8 +95,10 @@ public:
 protected:
 	pointer snapshotted_data(size_t p, size_t n);
 
-	obj::p<uint64_t> size_;
-	obj::p<uint64_t> capacity_;
+	static SizeT checked_size(size_type n);
+
+	obj::p<SizeT> size_;
+	obj::p<SizeT> capacity_;
 };
 
 /**
@@ -101,9 +122,10 @@ protected:
  * @snippet inline_string/inline_string.cpp inline_string_example
  * @ingroup experimental_containers
  */
-template <typename CharT, typename Traits = std::char_traits<CharT>>
+template <typename CharT, typename Traits = std::char_traits<CharT>,
+	  typename SizeT = uint64_t>
 class basic_dram_inline_string
-    : public basic_inline_string_base<CharT, Traits> {
+    : public basic_inline_string_base<CharT, Traits, SizeT> {
 public:
 	using traits_type = Traits;
 	using value_type = CharT;
@@ -113,19 +135,19 @@ public:
 	using const_reference = const value_type &;
 	using pointer = value_type *;
 	using const_pointer = const value_type *;
-	using basic_inline_string_base<CharT, Traits>::operator=;
+	using basic_inline_string_base<CharT, Traits, SizeT>::operator=;
 
 	basic_dram_inline_string(basic_string_view<CharT, Traits> v)
-	    : basic_inline_string_base<CharT, Traits>(v)
+	    : basic_inline_string_base<CharT, Traits, SizeT>(v)
 	{
 	}
 
 	basic_dram_inline_string(size_type capacity)
-	    : basic_inline_string_base<CharT, Traits>(capacity)
+	    : basic_inline_string_base<CharT, Traits, SizeT>(capacity)
 	{
 	}
 	basic_dram_inline_string(const basic_dram_inline_string &rhs)
-	    : basic_inline_string_base<CharT, Traits>(rhs)
+	    : basic_inline_string_base<CharT, Traits, SizeT>(rhs)
 	{
 	}
 
@@ -134,7 +156,7 @@ public:
 	{
 		return static_cast<basic_dram_inline_string &>(this->operator=(
 			static_cast<const basic_inline_string_base<
-				CharT, Traits> &>(rhs)));
+				CharT, Traits, SizeT> &>(rhs)));
 	}
 };
 
@@ -158,8 +180,10 @@ public:
  * @snippet inline_string/inline_string.cpp inline_string_example
  * @ingroup experimental_containers
  */
-template <typename CharT, typename Traits = std::char_traits<CharT>>
-class basic_inline_string : public basic_inline_string_base<CharT, Traits> {
+template <typename CharT, typename Traits = std::char_traits<CharT>,
+	  typename SizeT = uint64_t>
+class basic_inline_string
+    : public basic_inline_string_base<CharT, Traits, SizeT> {
 public:
 	using traits_type = Traits;
 	using value_type = CharT;
@@ -169,13 +193,13 @@ public:
 	using const_reference = const value_type &;
 	using pointer = value_type *;
 	using const_pointer = const value_type *;
-	using basic_inline_string_base<CharT, Traits>::operator=;
+	using basic_inline_string_base<CharT, Traits, SizeT>::operator=;
 
 	/**
 	 * @throw pool_error if inline string is not on pmem.
 	 */
 	basic_inline_string(basic_string_view<CharT, Traits> v)
-	    : basic_inline_string_base<CharT, Traits>(check_forward(v))
+	    : basic_inline_string_base<CharT, Traits, SizeT>(check_forward(v))
 	{
 	}
 
@@ -183,7 +207,8 @@ public:
 	 * @throw pool_error if inline string is not on pmem.
 	 */
 	basic_inline_string(size_type capacity)
-	    : basic_inline_string_base<CharT, Traits>(check_forward(capacity))
+	    : basic_inline_string_base<CharT, Traits, SizeT>(
+		      check_forward(capacity))
 	{
 	}
 
@@ -191,7 +216,7 @@ public:
 	 * @throw pool_error if inline string is not on pmem.
 	 */
 	basic_inline_string(const basic_inline_string &rhs)
-	    : basic_inline_string_base<CharT, Traits>(check_forward(rhs))
+	    : basic_inline_string_base<CharT, Traits, SizeT>(check_forward(rhs))
 	{
 	}
 
@@ -200,7 +225,7 @@ public:
 	{
 		return static_cast<basic_inline_string &>(this->operator=(
 			static_cast<const basic_inline_string_base<
-				CharT, Traits> &>(rhs)));
+				CharT, Traits, SizeT> &>(rhs)));
 	}
 
 private:
@@ -258,13 +283,28 @@ using inline_u16string = basic_inline_string<char16_t>;
  */
 using inline_u32string = basic_inline_string<char32_t>;
 
+/**
+ * The char specialization with 32-bit size and capacity (8 byte header
+ * instead of 16). Suitable for short keys, e.g. in radix_tree.
+ * @ingroup experimental_containers
+ */
+using compact_inline_string =
+	basic_inline_string<char, std::char_traits<char>, uint32_t>;
+/**
+ * The char specialization of basic_dram_inline_string with 32-bit size and
+ * capacity.
+ * @ingroup experimental_containers
+ */
+using compact_dram_inline_string =
+	basic_dram_inline_string<char, std::char_traits<char>, uint32_t>;
+
 /**
  * Constructs inline string from a string_view.
  */
-template <typename CharT, typename Traits>
-basic_inline_string_base<CharT, Traits>::basic_inline_string_base(
+template <typename CharT, typename Traits, typename SizeT>
+basic_inline_string_base<CharT, Traits, SizeT>::basic_inline_string_base(
 	basic_string_view<CharT, Traits> v)
-    : size_(v.size()), capacity_(v.size())
+    : size_(checked_size(v.size())), capacity_(checked_size(v.size()))
 {
 	std::copy(v.data(), v.data() + static_cast<ptrdiff_t>(size_), data());
 
@@ -274,10 +314,10 @@ basic_inline_string_base<CharT, Traits>::basic_inline_string_base(
 /**
  * Constructs empty inline_string with specified capacity.
  */
-template <typename CharT, typename Traits>
-basic_inline_string_base<CharT, Traits>::basic_inline_string_base(
+template <typename CharT, typename Traits, typename SizeT>
+basic_inline_string_base<CharT, Traits, SizeT>::basic_inline_string_base(
 	size_type capacity)
-    : size_(0), capacity_(capacity)
+    : size_(0), capacity_(checked_size(capacity))
 {
 	data()[static_cast<ptrdiff_t>(size_)] = '\0';
 }
@@ -285,8 +325,8 @@ basic_inline_string_base<CharT, Traits>::basic_inline_string_base(
 /**
  * Copy constructor
  */
-template <typename CharT, typename Traits>
-basic_inline_string_base<CharT, Traits>::basic_inline_string_base(
+template <typename CharT, typename Traits, typename SizeT>
+basic_inline_string_base<CharT, Traits, SizeT>::basic_inline_string_base(
 	const basic_inline_string_base &rhs)
     : size_(rhs.size()), capacity_(rhs.capacity())
 {
@@ -299,9 +339,9 @@ basic_inline_string_base<CharT, Traits>::basic_inline_string_base(
 /**
  * Copy assignment operator
  */
-template <typename CharT, typename Traits>
-basic_inline_string_base<CharT, Traits> &
-basic_inline_string_base<CharT, Traits>::operator=(
+template <typename CharT, typename Traits, typename SizeT>
+basic_inline_string_base<CharT, Traits, SizeT> &
+basic_inline_string_base<CharT, Traits, SizeT>::operator=(
 	const basic_inline_string_base &rhs)
 {
 	if (this == &rhs)
@@ -313,26 +353,26 @@ basic_inline_string_base<CharT, Traits>::operator=(
 /**
  * Assignment operator from string_view.
  */
-template <typename CharT, typename Traits>
-basic_inline_string_base<CharT, Traits> &
-basic_inline_string_base<CharT, Traits>::operator=(
+template <typename CharT, typename Traits, typename SizeT>
+basic_inline_string_base<CharT, Traits, SizeT> &
+basic_inline_string_base<CharT, Traits, SizeT>::operator=(
 	basic_string_view<CharT, Traits> rhs)
 {
 	return assign(rhs);
 }
 
 /** Conversion operator to string_view */
-template <typename CharT, typename Traits>
-basic_inline_string_base<CharT, Traits>::operator basic_string_view<
+template <typename CharT, typename Traits, typename SizeT>
+basic_inline_string_base<CharT, Traits, SizeT>::operator basic_string_view<
 	CharT, Traits>() const
 {
 	return {data(), size()};
 }
 
 /** @return size of the string */
-template <typename CharT, typename Traits>
-typename basic_inline_string_base<CharT, Traits>::size_type
-basic_inline_string_base<CharT, Traits>::size() const noexcept
+template <typename CharT, typename Traits, typename SizeT>
+typename basic_inline_string_base<CharT, Traits, SizeT>::size_type
+basic_inline_string_base<CharT, Traits, SizeT>::size() const noexcept
 {
 	return size_;
 }
@@ -344,9 +384,9 @@ basic_inline_string_base<CharT, Traits>::size() const noexcept
  * sizeof(inline_string) + capacity() + sizeof('\0') and cannot be
  * expanded.
  */
-template <typename CharT, typename Traits>
-typename basic_inline_string_base<CharT, Traits>::size_type
-basic_inline_string_base<CharT, Traits>::capacity() const noexcept
+template <typename CharT, typename Traits, typename SizeT>
+typename basic_inline_string_base<CharT, Traits, SizeT>::size_type
+basic_inline_string_base<CharT, Traits, SizeT>::capacity() const noexcept
 {
 	return capacity_;
 }
@@ -360,17 +400,17 @@ basic_inline_string_base<CharT, Traits>::capacity() const noexcept
  *
  * @throw pmem::transaction_error when snapshotting failed.
  */
-template <typename CharT, typename Traits>
-typename basic_inline_string_base<CharT, Traits>::pointer
-basic_inline_string_base<CharT, Traits>::data()
+template <typename CharT, typename Traits, typename SizeT>
+typename basic_inline_string_base<CharT, Traits, SizeT>::pointer
+basic_inline_string_base<CharT, Traits, SizeT>::data()
 {
 	return snapshotted_data(0, size_);
 }
 
 /** @return const_pointer to the data (equal to (this + 1)) */
-template <typename CharT, typename Traits>
-typename basic_inline_string_base<CharT, Traits>::const_pointer
-basic_inline_string_base<CharT, Traits>::data() const noexcept
+template <typename CharT, typename Traits, typename SizeT>
+typename basic_inline_string_base<CharT, Traits, SizeT>::const_pointer
+basic_inline_string_base<CharT, Traits, SizeT>::data() const noexcept
 {
 	return cdata();
 }
@@ -382,9 +422,9 @@ basic_inline_string_base<CharT, Traits>::data() const noexcept
  *
  * @return const_pointer to the data (equal to (this + 1))
  */
-template <typename CharT, typename Traits>
-typename basic_inline_string_base<CharT, Traits>::const_pointer
-basic_inline_string_base<CharT, Traits>::cdata() const noexcept
+template <typename CharT, typename Traits, typename SizeT>
+typename basic_inline_string_base<CharT, Traits, SizeT>::const_pointer
+basic_inline_string_base<CharT, Traits, SizeT>::cdata() const noexcept
 {
 	return reinterpret_cast<const CharT *>(this + 1);
 }
@@ -397,9 +437,9 @@ basic_inline_string_base<CharT, Traits>::cdata() const noexcept
  *			positive value if this is lexicographically greater than
  * other, negative value if this is lexicographically less than other.
  */
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, typename SizeT>
 int
-basic_inline_string_base<CharT, Traits>::compare(
+basic_inline_string_base<CharT, Traits, SizeT>::compare(
 	basic_string_view<CharT, Traits> rhs) const noexcept
 {
 	return basic_string_view<CharT, Traits>(data(), size()).compare(rhs);
@@ -413,9 +453,9 @@ basic_inline_string_base<CharT, Traits>::compare(
  *
  * @throw pmem::transaction_error when snapshotting failed.
  */
-template <typename CharT, typename Traits>
-typename basic_inline_string_base<CharT, Traits>::reference
-	basic_inline_string_base<CharT, Traits>::operator[](size_type p)
+template <typename CharT, typename Traits, typename SizeT>
+typename basic_inline_string_base<CharT, Traits, SizeT>::reference
+basic_inline_string_base<CharT, Traits, SizeT>::operator[](size_type p)
 {
 	return snapshotted_data(p, 1)[0];
 }
@@ -426,10 +466,10 @@ typename basic_inline_string_base<CharT, Traits>::reference
  *
  * @return const_reference to a CharT
  */
-template <typename CharT, typename Traits>
-typename basic_inline_string_base<CharT, Traits>::const_reference
-	basic_inline_string_base<CharT, Traits>::operator[](size_type p) const
-	noexcept
+template <typename CharT, typename Traits, typename SizeT>
+typename basic_inline_string_base<CharT, Traits, SizeT>::const_reference
+basic_inline_string_base<CharT, Traits, SizeT>::operator[](
+	size_type p) const noexcept
 {
 	return cdata()[p];
 }
@@ -443,9 +483,9 @@ typename basic_inline_string_base<CharT, Traits>::const_reference
  * @throw pmem::transaction_error when snapshotting failed.
  * @throw std::out_of_range if p is not within the range of the container.
  */
-template <typename CharT, typename Traits>
-typename basic_inline_string_base<CharT, Traits>::reference
-basic_inline_string_base<CharT, Traits>::at(size_type p)
+template <typename CharT, typename Traits, typename SizeT>
+typename basic_inline_string_base<CharT, Traits, SizeT>::reference
+basic_inline_string_base<CharT, Traits, SizeT>::at(size_type p)
 {
 	if (p >= size())
 		throw std::out_of_range("basic_inline_string_base::at");
@@ -461,9 +501,9 @@ basic_inline_string_base<CharT, Traits>::at(size_type p)
  *
  * @throw std::out_of_range if p is not within the range of the container.
  */
-template <typename CharT, typename Traits>
-typename basic_inline_string_base<CharT, Traits>::const_reference
-basic_inline_string_base<CharT, Traits>::at(size_type p) const
+template <typename CharT, typename Traits, typename SizeT>
+typename basic_inline_string_base<CharT, Traits, SizeT>::const_reference
+basic_inline_string_base<CharT, Traits, SizeT>::at(size_type p) const
 {
 	if (p >= size())
 		throw std::out_of_range("basic_inline_string_base::at");
@@ -484,9 +524,10 @@ basic_inline_string_base<CharT, Traits>::at(size_type p) const
  * container.
  * @throw pmem::transaction_error when snapshotting failed.
  */
-template <typename CharT, typename Traits>
-slice<typename basic_inline_string_base<CharT, Traits>::pointer>
-basic_inline_string_base<CharT, Traits>::range(size_type start, size_type n)
+template <typename CharT, typename Traits, typename SizeT>
+slice<typename basic_inline_string_base<CharT, Traits, SizeT>::pointer>
+basic_inline_string_base<CharT, Traits, SizeT>::range(size_type start,
+						      size_type n)
 {
 	if (start + n > size())
 		throw std::out_of_range("basic_inline_string_base::range");
@@ -496,13 +537,29 @@ basic_inline_string_base<CharT, Traits>::range(size_type start, size_type n)
 	return {data, data + n};
 }
 
+/**
+ * Converts n to SizeT.
+ *
+ * @throw std::length_error if n cannot be represented by SizeT.
+ */
+template <typename CharT, typename Traits, typename SizeT>
+SizeT
+basic_inline_string_base<CharT, Traits, SizeT>::checked_size(size_type n)
+{
+	if (n > static_cast<size_type>((std::numeric_limits<SizeT>::max)()))
+		throw std::length_error("inline_string size exceeds SizeT");
+
+	return static_cast<SizeT>(n);
+}
+
 /**
  * Return pointer to data at position p and if there is an active transaction
  * snapshot elements from p to p + n.
  */
-template <typename CharT, typename Traits>
-typename basic_inline_string_base<CharT, Traits>::pointer
-basic_inline_string_base<CharT, Traits>::snapshotted_data(size_t p, size_t n)
+template <typename CharT, typename Traits, typename SizeT>
+typename basic_inline_string_base<CharT, Traits, SizeT>::pointer
+basic_inline_string_base<CharT, Traits, SizeT>::snapshotted_data(size_t p,
+								 size_t n)
 {
 	assert(p + n <= size());
 
@@ -518,9 +575,9 @@ basic_inline_string_base<CharT, Traits>::snapshotted_data(size_t p, size_t n)
  * @throw std::out_of_range if rhs is larger than capacity.
  * @throw pool_error if inline string is not on pmem.
  */
-template <typename CharT, typename Traits>
-basic_inline_string_base<CharT, Traits> &
-basic_inline_string_base<CharT, Traits>::assign(
+template <typename CharT, typename Traits, typename SizeT>
+basic_inline_string_base<CharT, Traits, SizeT> &
+basic_inline_string_base<CharT, Traits, SizeT>::assign(
 	basic_string_view<CharT, Traits> rhs)
 {
 	auto cpop = pmemobj_pool_by_ptr(this);
@@ -547,7 +604,7 @@ basic_inline_string_base<CharT, Traits>::assign(
 		std::copy(rhs.data(),
 			  rhs.data() + static_cast<ptrdiff_t>(rhs.size()),
 			  data());
-		size_ = rhs.size();
+		size_ = static_cast<SizeT>(rhs.size());
 
 		data()[static_cast<ptrdiff_t>(size_)] = '\0';
 	});
@@ -578,12 +635,12 @@ struct total_sizeof {
  * Inline_string requires capacity of sizeof(basic_inline_string<CharT>) + size
  * of the data itself.
  */
-template <typename CharT, typename Traits>
-struct total_sizeof<basic_inline_string<CharT, Traits>> {
+template <typename CharT, typename Traits, typename SizeT>
+struct total_sizeof<basic_inline_string<CharT, Traits, SizeT>> {
 	static size_t
 	value(const basic_string_view<CharT, Traits> &s)
 	{
-		return sizeof(basic_inline_string_base<CharT, Traits>) +
+		return sizeof(basic_inline_string_base<CharT, Traits, SizeT>) +
 			(s.size() + 1 /* '\0' */) * sizeof(CharT);
 	}
 };
@@ -595,12 +652,12 @@ struct total_sizeof<basic_inline_string<CharT, Traits>> {
  * Inline_string requires capacity of sizeof(basic_dram_inline_string<CharT>) +
  * size of the data itself.
  */
-template <typename CharT, typename Traits>
-struct total_sizeof<basic_dram_inline_string<CharT, Traits>> {
+template <typename CharT, typename Traits, typename SizeT>
+struct total_sizeof<basic_dram_inline_string<CharT, Traits, SizeT>> {
 	static size_t
 	value(const basic_string_view<CharT, Traits> &s)
 	{
-		return sizeof(basic_dram_inline_string<CharT, Traits>) +
+		return sizeof(basic_dram_inline_string<CharT, Traits, SizeT>) +
 			(s.size() + 1 /* '\0' */) * sizeof(CharT);
 	}
 };
@@ -615,14 +672,15 @@ template <typename>
 struct is_inline_string : std::false_type {
 };
 
-template <typename CharT, typename Traits>
-struct is_inline_string<obj::experimental::basic_inline_string<CharT, Traits>>
+template <typename CharT, typename Traits, typename SizeT>
+struct is_inline_string<
+	obj::experimental::basic_inline_string<CharT, Traits, SizeT>>
     : std::true_type {
 };
 
-template <typename CharT, typename Traits>
+template <typename CharT, typename Traits, typename SizeT>
 struct is_inline_string<
-	obj::experimental::basic_dram_inline_string<CharT, Traits>>
+	obj::experimental::basic_dram_inline_string<CharT, Traits, SizeT>>
     : std::true_type {
 };
 
@@ -0,0 +1,276 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/**
+ * @file
+ * Allocation of many independent objects with a single publication.
+ */
+
+#ifndef LIBPMEMOBJ_CPP_MAKE_PERSISTENT_BATCH_HPP
+#define LIBPMEMOBJ_CPP_MAKE_PERSISTENT_BATCH_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <libpmemobj++/allocation_flag.hpp>
+#include <libpmemobj++/detail/check_persistent_ptr_array.hpp>
+#include <libpmemobj++/detail/common.hpp>
+#include <libpmemobj++/detail/life.hpp>
+#include <libpmemobj++/detail/variadic.hpp>
+#include <libpmemobj++/pexceptions.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj/action_base.h>
+#include <libpmemobj/tx_base.h>
+
+namespace pmem
+{
+
+namespace obj
+{
+
+namespace experimental
+{
+
+namespace detail
+{
+
+/*
+ * Reserves n objects of type T. Flags not accepted by pmemobj_xreserve()
+ * (e.g. POBJ_XALLOC_NO_FLUSH) are ignored, they have to be handled by
+ * the caller. On failure all reservations made so far are cancelled and
+ * false is returned, errno is set by libpmemobj.
+ */
+template <typename T>
+bool
+reserve_batch(pool_base &pop, std::vector<pobj_action> &actv,
+	      std::vector<persistent_ptr<T>> &ptrs, std::size_t n,
+	      uint64_t flags)
+{
+	for (std::size_t i = 0; i < n; ++i) {
+		PMEMoid oid = pmemobj_xreserve(
+			pop.handle(), &actv[i], sizeof(T),
+			pmem::detail::type_num<T>(),
+			flags & POBJ_ACTION_XRESERVE_VALID_FLAGS);
+		if (OID_IS_NULL(oid)) {
+			int err = errno;
+			pmemobj_cancel(pop.handle(), actv.data(), i);
+			errno = err;
+			return false;
+		}
+
+		ptrs.emplace_back(oid);
+	}
+
+	return true;
+}
+
+} /* namespace detail */
+
+/**
+ * Transactionally allocate and construct n independent objects of type T.
+ *
+ * All objects are reserved up front and handed over to the transaction
+ * with a single pmemobj_tx_publish() call. Each object can be freed
+ * separately with delete_persistent(). If the transaction aborts, all of
+ * them are freed. As with make_persistent(), the transaction is aborted
+ * if the objects cannot be allocated.
+ *
+ * Every object is constructed with the same arguments, which are therefore
+ * passed to the constructor as lvalues.
+ *
+ * @param[in,out] pop pool in which the transaction runs.
+ * @param[in] n number of objects to allocate.
+ * @param[in] flag affects behaviour of allocator.
+ * @param[in] args a list of parameters passed to every constructor.
+ *
+ * @return pointers to the allocated objects.
+ *
+ * @throw transaction_scope_error if called outside of an active
+ * transaction
+ * @throw transaction_out_of_memory if there is no free memory for all the
+ * objects.
+ * @throw transaction_alloc_error on transactional allocation failure.
+ * @throw rethrow exception from T constructor
+ * @ingroup allocation
+ */
+template <typename T, typename... Args>
+std::vector<typename pmem::detail::pp_if_not_array<T>::type>
+make_persistent_batch(pool_base &pop, std::size_t n, allocation_flag flag,
+		      Args &&... args)
+{
+	if (pmemobj_tx_stage() != TX_STAGE_WORK)
+		throw pmem::transaction_scope_error(
+			"refusing to allocate memory outside of transaction scope");
+
+	std::vector<persistent_ptr<T>> ptrs;
+	if (n == 0)
+		return ptrs;
+
+	std::vector<pobj_action> actv(n);
+	ptrs.reserve(n);
+
+	if (!detail::reserve_batch(pop, actv, ptrs, n, flag.value)) {
+		int err = errno;
+		pmemobj_tx_abort(err);
+
+		const char *msg =
+			"Failed to allocate persistent memory objects";
+		if (err == ENOMEM)
+			throw pmem::detail::exception_with_errormsg<
+				pmem::transaction_out_of_memory>(msg);
+		else
+			throw pmem::detail::exception_with_errormsg<
+				pmem::transaction_alloc_error>(msg);
+	}
+
+	if (pmemobj_tx_publish(actv.data(), n) != 0) {
+		/* the transaction did not take over the reservations */
+		pmemobj_cancel(pop.handle(), actv.data(), n);
+
+		throw pmem::detail::exception_with_errormsg<
+			pmem::transaction_alloc_error>(
+			"Failed to publish persistent memory objects");
+	}
+
+	/* reserved memory is not flushed on commit unless tracked */
+	bool flush = !flag.is_set(allocation_flag::no_flush());
+	for (auto &ptr : ptrs) {
+		if (flush)
+			pmem::detail::conditional_add_to_tx(
+				ptr.get(), 1, POBJ_XADD_NO_SNAPSHOT);
+		pmem::detail::create<T>(ptr.get(), args...);
+	}
+
+	return ptrs;
+}
+
+/**
+ * Transactionally allocate and construct n independent objects of type T.
+ *
+ * @param[in,out] pop pool in which the transaction runs.
+ * @param[in] n number of objects to allocate.
+ * @param[in] args a list of parameters passed to every constructor.
+ *
+ * @return pointers to the allocated objects.
+ *
+ * @throw transaction_scope_error if called outside of an active
+ * transaction
+ * @throw transaction_out_of_memory if there is no free memory for all the
+ * objects.
+ * @throw transaction_alloc_error on transactional allocation failure.
+ * @throw rethrow exception from T constructor
+ * @ingroup allocation
+ */
+template <typename T, typename... Args>
+typename std::enable_if<
+	!pmem::detail::is_first_arg_same<allocation_flag, Args...>::value,
+	std::vector<typename pmem::detail::pp_if_not_array<T>::type>>::type
+make_persistent_batch(pool_base &pop, std::size_t n, Args &&... args)
+{
+	return make_persistent_batch<T>(pop, n, allocation_flag::none(),
+					std::forward<Args>(args)...);
+}
+
+/**
+ * Atomically allocate and construct n independent objects of type T.
+ *
+ * The objects are reserved and constructed first, then all of them,
+ * together with the pointers in ptrs, are published at once. Either all
+ * objects are allocated and ptrs point to them, or nothing changes. Each
+ * object can be freed separately with delete_persistent_atomic().
+ *
+ * Do *NOT* use this inside transactions, as it might lead to undefined
+ * behavior in the presence of transaction aborts.
+ *
+ * @param[in,out] pop the pool from which the objects will be allocated.
+ * @param[in,out] ptrs array of n persistent pointers, residing in the
+ *	pool, which are set to the allocated objects.
+ * @param[in] n number of objects to allocate.
+ * @param[in] flag affects behaviour of allocator.
+ * @param[in] args a list of parameters passed to every constructor.
+ *
+ * @throw std::bad_alloc on allocation failure.
+ * @throw rethrow exception from T constructor, no object is allocated
+ *	then. Objects constructed so far are not destroyed.
+ * @ingroup allocation
+ */
+template <typename T, typename... Args>
+void
+make_persistent_batch_atomic(
+	pool_base &pop, typename pmem::detail::pp_if_not_array<T>::type *ptrs,
+	std::size_t n, allocation_flag_atomic flag, Args &&... args)
+{
+	if (n == 0)
+		return;
+
+	/* one reservation and two pointer halves per object */
+	std::vector<pobj_action> actv(3 * n);
+	std::vector<persistent_ptr<T>> objs;
+	objs.reserve(n);
+
+	if (!detail::reserve_batch(pop, actv, objs, n, flag.value))
+		throw std::bad_alloc();
+
+	try {
+		for (auto &obj : objs)
+			pmem::detail::create<T>(obj.get(), args...);
+	} catch (...) {
+		pmemobj_cancel(pop.handle(), actv.data(), n);
+		throw;
+	}
+
+	for (std::size_t i = 0; i < n; ++i) {
+		pop.flush(objs[i].get(), sizeof(T));
+
+		PMEMoid *dest = ptrs[i].raw_ptr();
+		pmemobj_set_value(pop.handle(), &actv[n + 2 * i],
+				  &dest->pool_uuid_lo,
+				  objs[i].raw().pool_uuid_lo);
+		pmemobj_set_value(pop.handle(), &actv[n + 2 * i + 1],
+				  &dest->off, objs[i].raw().off);
+	}
+	pop.drain();
+
+	if (pmemobj_publish(pop.handle(), actv.data(), actv.size()) != 0) {
+		pmemobj_cancel(pop.handle(), actv.data(), n);
+		throw std::bad_alloc();
+	}
+}
+
+/**
+ * Atomically allocate and construct n independent objects of type T.
+ *
+ * @param[in,out] pop the pool from which the objects will be allocated.
+ * @param[in,out] ptrs array of n persistent pointers, residing in the
+ *	pool, which are set to the allocated objects.
+ * @param[in] n number of objects to allocate.
+ * @param[in] args a list of parameters passed to every constructor.
+ *
+ * @throw std::bad_alloc on allocation failure.
+ * @throw rethrow exception from T constructor.
+ * @ingroup allocation
+ */
+template <typename T, typename... Args>
+typename std::enable_if<!pmem::detail::is_first_arg_same<allocation_flag_atomic,
+							 Args...>::value>::type
+make_persistent_batch_atomic(
+	pool_base &pop, typename pmem::detail::pp_if_not_array<T>::type *ptrs,
+	std::size_t n, Args &&... args)
+{
+	make_persistent_batch_atomic<T>(pop, ptrs, n,
+					allocation_flag_atomic::none(),
+					std::forward<Args>(args)...);
+}
+
+} /* namespace experimental */
+
+} /* namespace obj */
+
+} /* namespace pmem */
+
+#endif /* LIBPMEMOBJ_CPP_MAKE_PERSISTENT_BATCH_HPP */
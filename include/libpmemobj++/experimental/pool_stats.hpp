@@ -0,0 +1,446 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/**
+ * @file
+ * Typed access to statistics of a pool.
+ */
+
+#ifndef LIBPMEMOBJ_CPP_POOL_STATS_HPP
+#define LIBPMEMOBJ_CPP_POOL_STATS_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <libpmemobj++/detail/ctl.hpp>
+#include <libpmemobj++/pexceptions.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj/ctl.h>
+
+namespace pmem
+{
+
+namespace obj
+{
+
+namespace experimental
+{
+
+/**
+ * Heap fragmentation counters of a pool.
+ *
+ * Values are read from "stats.heap.run_allocated" and
+ * "stats.heap.run_active" ctl entries, which are maintained only if
+ * statistics are enabled for the pool (see "stats.enabled").
+ */
+struct fragmentation_stats {
+	/** Number of bytes allocated in runs (small allocations). */
+	size_t run_allocated;
+
+	/** Number of bytes occupied by runs, including free space in them. */
+	size_t run_active;
+
+	/**
+	 * Part of the memory occupied by runs which is not allocated.
+	 *
+	 * @return value between 0 (no fragmentation) and 1.
+	 */
+	double
+	fragmentation() const noexcept
+	{
+		if (run_active == 0 || run_allocated >= run_active)
+			return 0;
+
+		return 1 -
+			static_cast<double>(run_allocated) /
+			static_cast<double>(run_active);
+	}
+};
+
+/**
+ * Description of an arena, see "heap.arena.[arena_id]" ctl entries.
+ */
+struct arena_stats {
+	/** Identifier of the arena, as used by "heap.thread.arena_id". */
+	unsigned id;
+
+	/** Number of bytes allocated from the arena. */
+	size_t size;
+
+	/** True if the arena is assigned to threads automatically. */
+	bool automatic;
+};
+
+/**
+ * Description of a registered allocation class, see
+ * "heap.alloc_class.[class_id].desc" ctl entry.
+ */
+struct alloc_class_stats {
+	/** Identifier of the class, as used by pmem::obj::allocation_flag. */
+	unsigned id;
+
+	/** Size of a single allocation unit. */
+	size_t unit_size;
+
+	/** Number of units in a single run of this class. */
+	unsigned units_per_block;
+
+	/** Type of the header of objects allocated from this class. */
+	pobj_header_type header_type;
+};
+
+/**
+ * Snapshot of statistics of a pool, see pool_statistics::snapshot().
+ */
+struct pool_stats_snapshot {
+	/** Time at which the snapshot was taken. */
+	std::chrono::steady_clock::time_point timestamp;
+
+	/**
+	 * Number of bytes currently allocated in the heap, including both
+	 * small (run) and huge (chunk) allocations.
+	 */
+	size_t curr_allocated;
+
+	/** Usage of runs, which serve small allocations. */
+	fragmentation_stats runs;
+
+	/** Number of arenas in the pool. */
+	unsigned narenas_total;
+
+	/** Number of arenas assigned to threads automatically. */
+	unsigned narenas_automatic;
+
+	/** Description of every arena. */
+	std::vector<arena_stats> arenas;
+
+	/** Description of every registered allocation class. */
+	std::vector<alloc_class_stats> alloc_classes;
+
+	/**
+	 * @return number of bytes allocated in chunks (huge allocations).
+	 */
+	size_t
+	huge_allocated() const noexcept
+	{
+		return curr_allocated > runs.run_allocated
+			? curr_allocated - runs.run_allocated
+			: 0;
+	}
+
+	/**
+	 * @return part of the memory occupied by runs which is allocated,
+	 *	between 0 and 1.
+	 */
+	double
+	run_utilization() const noexcept
+	{
+		return runs.run_active == 0 ? 0 : 1 - runs.fragmentation();
+	}
+};
+
+/**
+ * Typed facade over statistics related ctl entries of a pool.
+ *
+ * Heap counters (curr_allocated, run_allocated, run_active) are maintained
+ * by libpmemobj only if statistics are enabled, which can be done with
+ * enable(). Otherwise they are reported as zeroes.
+ *
+ * Example:
+ * @code
+ * pmem::obj::experimental::pool_statistics stats(pop);
+ * stats.enable();
+ * ...
+ * auto s = stats.snapshot();
+ * std::cout << s.curr_allocated << " " << s.runs.fragmentation();
+ * @endcode
+ */
+class pool_statistics {
+public:
+	/**
+	 * Binds the facade with a pool.
+	 */
+	explicit pool_statistics(pool_base p) noexcept : pop(p)
+	{
+	}
+
+	/**
+	 * Enables or disables gathering of heap statistics.
+	 *
+	 * @throw pmem::ctl_error if the setting cannot be changed.
+	 */
+	void
+	enable(bool enabled = true)
+	{
+		ctl_set_detail<int>(pop.handle(), "stats.enabled",
+				    enabled ? 1 : 0);
+	}
+
+	/**
+	 * @return true if heap statistics are gathered.
+	 *
+	 * @throw pmem::ctl_error if the setting cannot be read.
+	 */
+	bool
+	enabled()
+	{
+		return ctl_get_detail<int>(pop.handle(), "stats.enabled") != 0;
+	}
+
+	/**
+	 * Reads current fragmentation of the heap.
+	 *
+	 * @throw pmem::ctl_error if statistics cannot be read.
+	 */
+	fragmentation_stats
+	fragmentation()
+	{
+		return {ctl_get_detail<size_t>(pop.handle(),
+					       "stats.heap.run_allocated"),
+			ctl_get_detail<size_t>(pop.handle(),
+					       "stats.heap.run_active")};
+	}
+
+	/**
+	 * Reads all statistics at once.
+	 *
+	 * Entries which are not supported by the libpmemobj in use are
+	 * reported as zeroes. Allocation classes are looked up in all
+	 * possible ids only by the first call, later calls detect only
+	 * classes registered with "heap.alloc_class.new.desc".
+	 *
+	 * @throw pmem::ctl_error if heap statistics cannot be read.
+	 */
+	pool_stats_snapshot
+	snapshot()
+	{
+		pool_stats_snapshot s;
+
+		s.timestamp = std::chrono::steady_clock::now();
+		s.curr_allocated = ctl_get_detail<size_t>(
+			pop.handle(), "stats.heap.curr_allocated");
+		s.runs = fragmentation();
+
+		s.narenas_total = get_or<unsigned>("heap.narenas.total", 0);
+		s.narenas_automatic =
+			get_or<unsigned>("heap.narenas.automatic", 0);
+
+		/* arenas are numbered from 1 */
+		for (unsigned id = 1; id <= s.narenas_total; ++id) {
+			auto prefix = "heap.arena." + std::to_string(id);
+			s.arenas.push_back(
+				{id, get_or<size_t>(prefix + ".size", 0),
+				 get_or<int>(prefix + ".automatic", 0) != 0});
+		}
+
+		update_alloc_classes();
+		s.alloc_classes = alloc_classes;
+
+		return s;
+	}
+
+private:
+	/* see POBJ_MAX_ALLOC_CLASSES in libpmemobj */
+	static constexpr unsigned max_alloc_classes = 255;
+
+	/*
+	 * Allocation classes cannot be changed or removed once registered,
+	 * so all ids are probed only once. Afterwards only the lowest unused
+	 * ids are probed, until the first one which is still unused, since
+	 * "heap.alloc_class.new.desc" registers a class with the lowest
+	 * unused id.
+	 */
+	void
+	update_alloc_classes()
+	{
+		unsigned next = 0;
+		for (auto it = alloc_classes.begin(); next < max_alloc_classes;
+		     ++next) {
+			if (it != alloc_classes.end() && it->id == next) {
+				++it;
+				continue;
+			}
+
+			pobj_alloc_class_desc desc;
+			if (!try_get("heap.alloc_class." +
+					     std::to_string(next) + ".desc",
+				     desc)) {
+				if (alloc_classes_scanned)
+					break;
+				continue;
+			}
+
+			it = alloc_classes.insert(
+				it,
+				alloc_class_stats{next, desc.unit_size,
+						  desc.units_per_block,
+						  desc.header_type});
+			++it;
+		}
+
+		alloc_classes_scanned = true;
+	}
+
+	/*
+	 * Reads an optional entry without throwing, so that probing unused
+	 * allocation classes is cheap.
+	 */
+	template <typename T>
+	bool
+	try_get(const std::string &name, T &value)
+	{
+#ifdef _WIN32
+		return pmemobj_ctl_getU(pop.handle(), name.c_str(), &value) ==
+			0;
+#else
+		return pmemobj_ctl_get(pop.handle(), name.c_str(), &value) == 0;
+#endif
+	}
+
+	template <typename T>
+	T
+	get_or(const std::string &name, T default_value)
+	{
+		T value;
+		return try_get(name, value) ? value : default_value;
+	}
+
+	pool_base pop;
+
+	/* registered allocation classes, sorted by id */
+	std::vector<alloc_class_stats> alloc_classes;
+	bool alloc_classes_scanned = false;
+};
+
+/**
+ * Takes snapshots of pool statistics periodically, in a background thread,
+ * and passes them to a callback, e.g. to export them to a monitoring
+ * system.
+ *
+ * The sampler must be stopped before the pool is closed.
+ */
+class pool_stats_sampler {
+public:
+	/** Type of the function which receives every snapshot. */
+	using callback_type = std::function<void(const pool_stats_snapshot &)>;
+
+	/**
+	 * Starts sampling. The first snapshot is taken immediately, even if
+	 * the sampler is stopped right away.
+	 *
+	 * @param[in] p pool to sample.
+	 * @param[in] interval time between two consecutive snapshots.
+	 * @param[in] callback function called with every snapshot, from
+	 *	the background thread.
+	 */
+	template <typename Rep, typename Period>
+	pool_stats_sampler(pool_base p,
+			   const std::chrono::duration<Rep, Period> &interval,
+			   callback_type callback)
+	    : stats(p),
+	      interval(std::chrono::duration_cast<
+		       std::chrono::steady_clock::duration>(interval)),
+	      callback(std::move(callback))
+	{
+		worker = std::thread([this] { sample(); });
+	}
+
+	/**
+	 * Stops sampling, errors are ignored.
+	 */
+	~pool_stats_sampler()
+	{
+		try {
+			stop();
+		} catch (...) {
+		}
+	}
+
+	/**
+	 * Stops sampling and waits for the background thread. Does nothing
+	 * if the sampler is already stopped.
+	 *
+	 * @throw rethrows an exception which stopped sampling, e.g.
+	 *	pmem::ctl_error or an exception thrown by the callback.
+	 */
+	void
+	stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			stopped = true;
+		}
+		cv.notify_one();
+
+		if (worker.joinable())
+			worker.join();
+
+		if (error) {
+			auto e = error;
+			error = nullptr;
+			std::rethrow_exception(e);
+		}
+	}
+
+	/**
+	 * @return number of snapshots passed to the callback so far.
+	 */
+	size_t
+	samples() const
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		return count;
+	}
+
+	pool_stats_sampler(const pool_stats_sampler &) = delete;
+	pool_stats_sampler &operator=(const pool_stats_sampler &) = delete;
+
+private:
+	void
+	sample()
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+
+		do {
+			lock.unlock();
+			try {
+				callback(stats.snapshot());
+			} catch (...) {
+				lock.lock();
+				error = std::current_exception();
+				return;
+			}
+			lock.lock();
+
+			++count;
+		} while (!cv.wait_for(lock, interval,
+				      [this] { return stopped; }));
+	}
+
+	pool_statistics stats;
+	std::chrono::steady_clock::duration interval;
+	callback_type callback;
+
+	mutable std::mutex mtx;
+	std::condition_variable cv;
+	bool stopped = false;
+	size_t count = 0;
+	std::exception_ptr error;
+
+	std::thread worker;
+};
+
+} /* namespace experimental */
+
+} /* namespace obj */
+
+} /* namespace pmem */
+
+#endif /* LIBPMEMOBJ_CPP_POOL_STATS_HPP */
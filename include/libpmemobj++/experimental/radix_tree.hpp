@@ -13,7 +13,9 @@
 #define LIBPMEMOBJ_CPP_RADIX_HPP
 
 #include <libpmemobj++/allocator.hpp>
+#include <libpmemobj++/container/segment_vector.hpp>
 #include <libpmemobj++/container/string.hpp>
+#include <libpmemobj++/defrag.hpp>
 #include <libpmemobj++/detail/pair.hpp>
 #include <libpmemobj++/detail/template_helpers.hpp>
 #include <libpmemobj++/experimental/inline_string.hpp>
@@ -29,8 +31,15 @@
 #include <libpmemobj++/utils.hpp>
 
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 #if __cpp_lib_endian
 #include <bit>
 #endif
@@ -38,11 +47,153 @@
 #include <libpmemobj++/detail/common.hpp>
 #include <libpmemobj++/detail/ebr.hpp>
 #include <libpmemobj++/detail/integer_sequence.hpp>
+#include <libpmemobj++/detail/parallel_for.hpp>
 #include <libpmemobj++/detail/tagged_ptr.hpp>
+#include <libpmemobj++/detail/volatile_state.hpp>
 
 namespace pmem
 {
 
+namespace detail
+{
+
+/*
+ * Position of a leaf in the leaf directory of a radix_tree with volatile
+ * nodes. Empty (and optimized away) if the nodes are persistent.
+ */
+template <bool VolatileNodes>
+struct radix_leaf_index {
+};
+
+template <>
+struct radix_leaf_index<true> {
+	obj::p<uint64_t> directory_index;
+};
+
+/*
+ * Persistent list of all leaves of a radix_tree with volatile nodes, used to
+ * rebuild the nodes without walking the tree. A leaf is appended when it is
+ * inserted and replaced by the last leaf when it is erased.
+ *
+ * If the nodes are persistent, the directory has no members and all its
+ * methods do nothing.
+ */
+template <bool VolatileNodes>
+class radix_leaf_directory {
+protected:
+	template <typename Leaf>
+	void
+	directory_add(Leaf *)
+	{
+	}
+
+	template <typename Leaf>
+	void
+	directory_remove(Leaf *)
+	{
+	}
+
+	template <typename Leaf>
+	void
+	directory_replace(Leaf *, Leaf *)
+	{
+	}
+
+	template <typename Leaf>
+	void
+	directory_clear()
+	{
+	}
+
+	void
+	directory_swap(radix_leaf_directory &)
+	{
+	}
+
+	size_t
+	directory_size() const
+	{
+		return 0;
+	}
+
+	template <typename Leaf>
+	Leaf *
+	directory_at(size_t) const
+	{
+		return nullptr;
+	}
+};
+
+template <>
+class radix_leaf_directory<true> {
+protected:
+	template <typename Leaf>
+	void
+	directory_add(Leaf *leaf)
+	{
+		leaf->directory_index = leaves.size();
+		leaves.emplace_back(leaf);
+	}
+
+	template <typename Leaf>
+	void
+	directory_remove(Leaf *leaf)
+	{
+		auto last = directory_at<Leaf>(leaves.size() - 1);
+		if (last != leaf) {
+			leaves[leaf->directory_index] = leaf_ptr(last);
+			last->directory_index = leaf->directory_index;
+		}
+
+		leaves.pop_back();
+	}
+
+	template <typename Leaf>
+	void
+	directory_replace(Leaf *old_leaf, Leaf *new_leaf)
+	{
+		new_leaf->directory_index = old_leaf->directory_index;
+		leaves[old_leaf->directory_index] = leaf_ptr(new_leaf);
+	}
+
+	template <typename Leaf>
+	void
+	directory_clear()
+	{
+		for (size_t i = 0; i < leaves.size(); ++i)
+			obj::delete_persistent<Leaf>(obj::persistent_ptr<Leaf>(
+				directory_at<Leaf>(i)));
+
+		leaves.clear();
+	}
+
+	void
+	directory_swap(radix_leaf_directory &other)
+	{
+		leaves.swap(other.leaves);
+	}
+
+	size_t
+	directory_size() const
+	{
+		return leaves.size();
+	}
+
+	template <typename Leaf>
+	Leaf *
+	directory_at(size_t i) const
+	{
+		return static_cast<Leaf *>(leaves.const_at(i).get());
+	}
+
+private:
+	using leaf_ptr = obj::experimental::self_relative_ptr<void>;
+
+	obj::segment_vector<leaf_ptr> leaves;
+};
+
+} /* namespace detail */
+
 namespace obj
 {
 
@@ -97,6 +248,12 @@ struct bytes_view;
  * assigning new value to the element. Using find(K).assign_val("new_value") may
  * invalidate other iterators and references to the element with key K.
  *
+ * Key and value are constructed right after the leaf header, within a single
+ * allocation. For short string keys, using inline string with a 32-bit size
+ * header (e.g. pmem::obj::experimental::compact_inline_string) saves 8 bytes
+ * per leaf and keeps leaves with keys up to ~30 bytes and 8-byte values
+ * within a single cache line.
+ *
  * swap() invalidates all references and iterators.
  *
  * MtMode enables single-writer multiple-readers concurrency with read
@@ -114,13 +271,26 @@ struct bytes_view;
  * @note By default, concurrency is not enabled (it is not allowed to perform
  * concurrent operations on radix tree).
  *
+ * VolatileNodes keeps the internal nodes in DRAM, only the leaves and a
+ * persistent list of them (the leaf directory) are stored in persistent
+ * memory. Inserts and erases allocate, free and modify nodes without
+ * transactions and lookups touch persistent memory only in the final leaf.
+ * The nodes are rebuilt from the leaf directory by runtime_initialize(),
+ * which sorts the leaves and builds the tree bottom-up in several threads,
+ * or by the first operation after the pool was opened (using one thread).
+ * runtime_initialize() (or any other operation) must be called outside of
+ * a transaction before the tree is used in a transaction for the first time
+ * after the pool was opened or the tree was created. If a transaction which
+ * modified the tree aborts, the nodes are rebuilt by the next operation.
+ * VolatileNodes cannot be combined with MtMode.
+ *
  * An example of custom BytesView implementation:
  * @snippet radix_tree/radix_tree_custom_key.cpp bytes_view_example
  * @ingroup experimental_containers
  */
 template <typename Key, typename Value, typename BytesView = bytes_view<Key>,
-	  bool MtMode = false>
-class radix_tree {
+	  bool MtMode = false, bool VolatileNodes = false>
+class radix_tree : private pmem::detail::radix_leaf_directory<VolatileNodes> {
 	template <bool IsConst>
 	struct radix_tree_iterator;
 
@@ -138,6 +308,9 @@ public:
 	using difference_type = std::ptrdiff_t;
 	using ebr = detail::ebr;
 	using worker_type = detail::ebr::worker;
+	/* func argument type definition for 'for_each_ptr' method */
+	using for_each_ptr_function =
+		std::function<void(persistent_ptr_base &)>;
 
 	radix_tree();
 
@@ -292,9 +465,11 @@ public:
 
 	void swap(radix_tree &rhs);
 
-	template <typename K, typename V, typename BV, bool Mt>
-	friend std::ostream &operator<<(std::ostream &os,
-					const radix_tree<K, V, BV, Mt> &tree);
+	void for_each_ptr(for_each_ptr_function func);
+
+	template <typename K, typename V, typename BV, bool Mt, bool Vn>
+	friend std::ostream &
+	operator<<(std::ostream &os, const radix_tree<K, V, BV, Mt, Vn> &tree);
 
 	template <bool Mt = MtMode,
 		  typename Enable = typename std::enable_if<Mt>::type>
@@ -314,6 +489,11 @@ public:
 		  typename Enable = typename std::enable_if<Mt>::type>
 	worker_type register_worker();
 
+	template <bool Vn = VolatileNodes,
+		  typename Enable = typename std::enable_if<Vn>::type>
+	void runtime_initialize(
+		size_t concurrency = std::thread::hardware_concurrency());
+
 private:
 	using byten_t = uint64_t;
 	using bitn_t = uint8_t;
@@ -333,6 +513,7 @@ private:
 
 	struct leaf;
 	struct node;
+	struct volatile_nodes;
 
 	using pointer_type = detail::tagged_ptr<leaf, node>;
 	using atomic_pointer_type =
@@ -361,7 +542,11 @@ private:
 
 	/* helper functions */
 	template <typename K, typename F, class... Args>
-	std::pair<iterator, bool> internal_emplace(const K &, F &&);
+	std::pair<iterator, bool> internal_emplace(volatile_nodes *, const K &,
+						   F &&);
+	template <class... Args>
+	std::pair<iterator, bool> internal_emplace_value(volatile_nodes *,
+							 Args &&... args);
 	template <typename K>
 	leaf *internal_find(const K &k) const;
 
@@ -383,7 +568,8 @@ private:
 	template <typename K1, typename K2>
 	static bitn_t bit_diff(const K1 &leaf_key, const K2 &key, byten_t diff);
 	template <typename K>
-	std::pair<typename radix_tree<Key, Value, BytesView, MtMode>::leaf *,
+	std::pair<typename radix_tree<Key, Value, BytesView, MtMode,
+				      VolatileNodes>::leaf *,
 		  path_type>
 	descend(pointer_type n, const K &key) const;
 	static void print_rec(std::ostream &os, radix_tree::pointer_type n);
@@ -417,13 +603,29 @@ private:
 	void check_pmem();
 	void check_tx_stage_work();
 
+	pointer_type make_node(volatile_nodes *nodes, pointer_type parent,
+			       byten_t byte, bitn_t bit);
+	void free_node(volatile_nodes *nodes, pointer_type n);
+	volatile_nodes *get_volatile_nodes() const;
+	template <bool Vn = VolatileNodes>
+	typename std::enable_if<Vn, volatile_nodes *>::type check_nodes() const;
+	template <bool Vn = VolatileNodes>
+	typename std::enable_if<!Vn, volatile_nodes *>::type
+	check_nodes() const;
+	void rebuild_nodes(volatile_nodes &nodes, size_t concurrency) const;
+	void invalidate_nodes() const;
+	void invalidate_nodes_on_abort() const;
+
 	static_assert(sizeof(node) == 256,
 		      "Internal node should have size equal to 256 bytes.");
+	static_assert(!(MtMode && VolatileNodes),
+		      "VolatileNodes cannot be combined with MtMode.");
 };
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-void swap(radix_tree<Key, Value, BytesView, MtMode> &lhs,
-	  radix_tree<Key, Value, BytesView, MtMode> &rhs);
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+void swap(radix_tree<Key, Value, BytesView, MtMode, VolatileNodes> &lhs,
+	  radix_tree<Key, Value, BytesView, MtMode, VolatileNodes> &rhs);
 
 /**
  * This is the structure which 'holds' key/value pair. The data
@@ -434,9 +636,12 @@ void swap(radix_tree<Key, Value, BytesView, MtMode> &lhs,
  * Constructors of the leaf structure mimics those of std::pair<const Key,
  * Value>.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-struct radix_tree<Key, Value, BytesView, MtMode>::leaf {
-	using tree_type = radix_tree<Key, Value, BytesView, MtMode>;
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+struct radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf
+    : pmem::detail::radix_leaf_index<VolatileNodes> {
+	using tree_type =
+		radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>;
 
 	leaf(const leaf &) = delete;
 	leaf(leaf &&) = delete;
@@ -481,7 +686,7 @@ struct radix_tree<Key, Value, BytesView, MtMode>::leaf {
 					 const leaf &other);
 
 private:
-	friend class radix_tree<Key, Value, BytesView, MtMode>;
+	friend class radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>;
 
 	leaf() = default;
 
@@ -500,8 +705,9 @@ private:
  * This is internal node. It does not hold any values directly, but
  * can contain pointer to an embedded entry (see below).
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-struct radix_tree<Key, Value, BytesView, MtMode>::node {
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+struct radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::node {
 	node(pointer_type parent, byten_t byte, bitn_t bit);
 
 	/**
@@ -550,40 +756,44 @@ struct radix_tree<Key, Value, BytesView, MtMode>::node {
 	template <bool Direction = direction::Forward>
 	typename std::enable_if<
 		Direction ==
-			radix_tree<Key, Value, BytesView,
-				   MtMode>::node::direction::Forward,
-		typename radix_tree<Key, Value, BytesView,
-				    MtMode>::node::forward_iterator>::type
-	begin() const;
+			radix_tree<Key, Value, BytesView, MtMode,
+				   VolatileNodes>::node::direction::Forward,
+		typename radix_tree<Key, Value, BytesView, MtMode,
+				    VolatileNodes>::node::forward_iterator>::
+		type
+		begin() const;
 
 	template <bool Direction = direction::Forward>
 	typename std::enable_if<
 		Direction ==
-			radix_tree<Key, Value, BytesView,
-				   MtMode>::node::direction::Forward,
-		typename radix_tree<Key, Value, BytesView,
-				    MtMode>::node::forward_iterator>::type
-	end() const;
+			radix_tree<Key, Value, BytesView, MtMode,
+				   VolatileNodes>::node::direction::Forward,
+		typename radix_tree<Key, Value, BytesView, MtMode,
+				    VolatileNodes>::node::forward_iterator>::
+		type
+		end() const;
 
 	/* rbegin */
 	template <bool Direction = direction::Forward>
 	typename std::enable_if<
 		Direction ==
-			radix_tree<Key, Value, BytesView,
-				   MtMode>::node::direction::Reverse,
-		typename radix_tree<Key, Value, BytesView,
-				    MtMode>::node::reverse_iterator>::type
-	begin() const;
+			radix_tree<Key, Value, BytesView, MtMode,
+				   VolatileNodes>::node::direction::Reverse,
+		typename radix_tree<Key, Value, BytesView, MtMode,
+				    VolatileNodes>::node::reverse_iterator>::
+		type
+		begin() const;
 
 	/* rend */
 	template <bool Direction = direction::Forward>
 	typename std::enable_if<
 		Direction ==
-			radix_tree<Key, Value, BytesView,
-				   MtMode>::node::direction::Reverse,
-		typename radix_tree<Key, Value, BytesView,
-				    MtMode>::node::reverse_iterator>::type
-	end() const;
+			radix_tree<Key, Value, BytesView, MtMode,
+				   VolatileNodes>::node::direction::Reverse,
+		typename radix_tree<Key, Value, BytesView, MtMode,
+				    VolatileNodes>::node::reverse_iterator>::
+		type
+		end() const;
 
 	template <bool Direction = direction::Forward, typename Ptr>
 	iterator<Direction> find_child(const Ptr &n) const;
@@ -593,8 +803,72 @@ struct radix_tree<Key, Value, BytesView, MtMode>::node {
 			  Direction == direction::Forward>::type>
 	iterator<Direction> make_iterator(const atomic_pointer_type *ptr) const;
 
-	uint8_t padding[256 - sizeof(parent) - sizeof(leaf) - sizeof(child) -
-			sizeof(byte) - sizeof(bit)];
+	uint8_t padding[256 - sizeof(parent) - sizeof(embedded_entry) -
+			sizeof(child) - sizeof(byte) - sizeof(bit)];
+};
+
+/**
+ * Internal nodes of a radix tree with VolatileNodes == true, kept in
+ * pmem::detail::volatile_state. Nodes are allocated from chunks of DRAM,
+ * freed nodes are reused by next inserts.
+ */
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+struct radix_tree<Key, Value, BytesView, MtMode,
+		  VolatileNodes>::volatile_nodes {
+	volatile_nodes() = default;
+	volatile_nodes(const volatile_nodes &) = delete;
+	volatile_nodes &operator=(const volatile_nodes &) = delete;
+
+	node *
+	allocate(pointer_type parent, byten_t byte, bitn_t bit)
+	{
+		void *ptr;
+		if (!free_list.empty()) {
+			ptr = free_list.back();
+			free_list.pop_back();
+		} else {
+			if (chunk_used == NODES_PER_CHUNK) {
+				chunks.emplace_back(
+					new node_storage[NODES_PER_CHUNK]);
+				chunk_used = 0;
+			}
+			ptr = &chunks.back()[chunk_used++];
+		}
+
+		return new (ptr) node(parent, byte, bit);
+	}
+
+	void
+	deallocate(node *n)
+	{
+		n->~node();
+		free_list.push_back(n);
+	}
+
+	/* Frees all nodes */
+	void
+	reset()
+	{
+		chunks.clear();
+		free_list.clear();
+		chunk_used = NODES_PER_CHUNK;
+	}
+
+	std::mutex mutex;
+
+	/* cleared when a transaction which modified the tree aborts */
+	std::atomic<bool> valid{false};
+
+private:
+	using node_storage = typename std::aligned_storage<sizeof(node),
+							   alignof(node)>::type;
+
+	static constexpr size_t NODES_PER_CHUNK = 256;
+
+	std::vector<std::unique_ptr<node_storage[]>> chunks;
+	size_t chunk_used = NODES_PER_CHUNK;
+	std::vector<node *> free_list;
 };
 
 /**
@@ -602,9 +876,11 @@ struct radix_tree<Key, Value, BytesView, MtMode>::node {
  * If Value type is inline_string, calling (*it).second = "new_value"
  * might cause reallocation and invalidate iterators to that element.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool IsConst>
-struct radix_tree<Key, Value, BytesView, MtMode>::radix_tree_iterator {
+struct radix_tree<Key, Value, BytesView, MtMode,
+		  VolatileNodes>::radix_tree_iterator {
 private:
 	using leaf_ptr =
 		typename std::conditional<IsConst, const leaf *, leaf *>::type;
@@ -678,8 +954,10 @@ private:
 	bool try_decrement();
 };
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-struct radix_tree<Key, Value, BytesView, MtMode>::node::forward_iterator {
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+struct radix_tree<Key, Value, BytesView, MtMode,
+		  VolatileNodes>::node::forward_iterator {
 	using difference_type = std::ptrdiff_t;
 	using value_type = atomic_pointer_type;
 	using pointer = const value_type *;
@@ -714,8 +992,9 @@ private:
  * @throw pmem::transaction_scope_error if constructor wasn't called in
  * transaction.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-radix_tree<Key, Value, BytesView, MtMode>::radix_tree()
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::radix_tree()
     : root(nullptr), size_(0)
 {
 	check_pmem();
@@ -741,17 +1020,20 @@ radix_tree<Key, Value, BytesView, MtMode>::radix_tree()
  * inserted elements in transaction failed.
  * @throw rethrows element constructor exception.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <class InputIt>
-radix_tree<Key, Value, BytesView, MtMode>::radix_tree(InputIt first,
-						      InputIt last)
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::radix_tree(
+	InputIt first, InputIt last)
     : root(nullptr), size_(0)
 {
 	check_pmem();
 	check_tx_stage_work();
 
+	/* volatile nodes of the new tree are rebuilt by its first use */
+	volatile_nodes nodes;
 	for (auto it = first; it != last; it++)
-		emplace(*it);
+		internal_emplace_value(&nodes, *it);
 }
 
 /**
@@ -769,15 +1051,28 @@ radix_tree<Key, Value, BytesView, MtMode>::radix_tree(InputIt first,
  * transaction.
  * @throw rethrows element constructor exception.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-radix_tree<Key, Value, BytesView, MtMode>::radix_tree(const radix_tree &m)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::radix_tree(
+	const radix_tree &m)
     : root(nullptr), size_(0)
 {
 	check_pmem();
 	check_tx_stage_work();
 
-	for (auto it = m.cbegin(); it != m.cend(); it++)
-		emplace(*it);
+	volatile_nodes nodes;
+	if (VolatileNodes) {
+		/* nodes of m may not be built yet */
+		for (size_t i = 0; i < m.directory_size(); ++i) {
+			auto leaf_ =
+				m.template directory_at<radix_tree::leaf>(i);
+			internal_emplace_value(&nodes, leaf_->key(),
+					       leaf_->value());
+		}
+	} else {
+		for (auto it = m.cbegin(); it != m.cend(); it++)
+			internal_emplace_value(&nodes, *it);
+	}
 }
 
 /**
@@ -792,13 +1087,23 @@ radix_tree<Key, Value, BytesView, MtMode>::radix_tree(const radix_tree &m)
  * @throw pmem::transaction_scope_error if constructor wasn't called in
  * transaction.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-radix_tree<Key, Value, BytesView, MtMode>::radix_tree(radix_tree &&m)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::radix_tree(
+	radix_tree &&m)
 {
 	check_pmem();
 	check_tx_stage_work();
 
-	store(root, load(m.root));
+	if (VolatileNodes) {
+		m.invalidate_nodes_on_abort();
+		this->directory_swap(m);
+		store(root, nullptr);
+		m.invalidate_nodes();
+	} else {
+		store(root, load(m.root));
+	}
+
 	size_ = m.size_;
 	store(m.root, nullptr);
 	m.size_ = 0;
@@ -818,8 +1123,9 @@ radix_tree<Key, Value, BytesView, MtMode>::radix_tree(radix_tree &&m)
  * transaction.
  * @throw rethrows element constructor exception.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-radix_tree<Key, Value, BytesView, MtMode>::radix_tree(
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::radix_tree(
 	std::initializer_list<value_type> il)
     : radix_tree(il.begin(), il.end())
 {
@@ -834,23 +1140,40 @@ radix_tree<Key, Value, BytesView, MtMode>::radix_tree(
  * @throw pmem::transaction_alloc_error when allocating new memory failed.
  * @throw rethrows constructor's exception.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-radix_tree<Key, Value, BytesView, MtMode> &
-radix_tree<Key, Value, BytesView, MtMode>::operator=(const radix_tree &other)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes> &
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::operator=(
+	const radix_tree &other)
 {
 	check_pmem();
 
 	auto pop = pool_by_vptr(this);
 
 	if (this != &other) {
+		auto nodes = check_nodes();
+
 		flat_transaction::run(pop, [&] {
 			clear();
 
 			store(this->root, nullptr);
 			this->size_ = 0;
 
-			for (auto it = other.cbegin(); it != other.cend(); it++)
-				emplace(*it);
+			if (VolatileNodes) {
+				for (size_t i = 0; i < other.directory_size();
+				     ++i) {
+					auto leaf_ =
+						other.template directory_at<
+							radix_tree::leaf>(i);
+					internal_emplace_value(nodes,
+							       leaf_->key(),
+							       leaf_->value());
+				}
+			} else {
+				for (auto it = other.cbegin();
+				     it != other.cend(); it++)
+					internal_emplace_value(nodes, *it);
+			}
 		});
 	}
 
@@ -865,9 +1188,11 @@ radix_tree<Key, Value, BytesView, MtMode>::operator=(const radix_tree &other)
  * @throw pmem::pool_error if an object is not in persistent memory.
  * @throw pmem::transaction_error when snapshotting failed.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-radix_tree<Key, Value, BytesView, MtMode> &
-radix_tree<Key, Value, BytesView, MtMode>::operator=(radix_tree &&other)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes> &
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::operator=(
+	radix_tree &&other)
 {
 	check_pmem();
 
@@ -877,7 +1202,16 @@ radix_tree<Key, Value, BytesView, MtMode>::operator=(radix_tree &&other)
 		flat_transaction::run(pop, [&] {
 			clear();
 
-			store(this->root, load(other.root));
+			if (VolatileNodes) {
+				invalidate_nodes_on_abort();
+				other.invalidate_nodes_on_abort();
+				this->directory_swap(other);
+				invalidate_nodes();
+				other.invalidate_nodes();
+			} else {
+				store(this->root, load(other.root));
+			}
+
 			this->size_ = other.size_;
 			store(other.root, nullptr);
 			other.size_ = 0;
@@ -897,15 +1231,18 @@ radix_tree<Key, Value, BytesView, MtMode>::operator=(radix_tree &&other)
  * @throw pmem::transaction_error when snapshotting failed.
  * @throw pmem::transaction_alloc_error when allocating new memory failed.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-radix_tree<Key, Value, BytesView, MtMode> &
-radix_tree<Key, Value, BytesView, MtMode>::operator=(
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes> &
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::operator=(
 	std::initializer_list<value_type> ilist)
 {
 	check_pmem();
 
 	auto pop = pool_by_vptr(this);
 
+	auto nodes = check_nodes();
+
 	transaction::run(pop, [&] {
 		clear();
 
@@ -913,7 +1250,7 @@ radix_tree<Key, Value, BytesView, MtMode>::operator=(
 		this->size_ = 0;
 
 		for (auto it = ilist.begin(); it != ilist.end(); it++)
-			emplace(*it);
+			internal_emplace_value(nodes, *it);
 	});
 
 	return *this;
@@ -922,13 +1259,18 @@ radix_tree<Key, Value, BytesView, MtMode>::operator=(
 /**
  * Destructor.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-radix_tree<Key, Value, BytesView, MtMode>::~radix_tree()
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::~radix_tree()
 {
 	try {
 		clear();
 		for (size_t i = 0; i < EPOCHS_NUMBER; ++i)
 			clear_garbage(i);
+
+		if (VolatileNodes)
+			pmem::detail::volatile_state::destroy(
+				pmemobj_oid(this));
 	} catch (...) {
 		std::terminate();
 	}
@@ -939,9 +1281,10 @@ radix_tree<Key, Value, BytesView, MtMode>::~radix_tree()
  *
  * @return true if container is empty, false otherwise.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 bool
-radix_tree<Key, Value, BytesView, MtMode>::empty() const noexcept
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::empty() const noexcept
 {
 	return size_ == 0;
 }
@@ -949,9 +1292,11 @@ radix_tree<Key, Value, BytesView, MtMode>::empty() const noexcept
 /**
  * @return maximum number of elements the container is able to hold
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::size_type
-radix_tree<Key, Value, BytesView, MtMode>::max_size() const noexcept
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::size_type
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::max_size()
+	const noexcept
 {
 	return std::numeric_limits<difference_type>::max();
 }
@@ -959,9 +1304,10 @@ radix_tree<Key, Value, BytesView, MtMode>::max_size() const noexcept
 /**
  * @return number of elements.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 uint64_t
-radix_tree<Key, Value, BytesView, MtMode>::size() const noexcept
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::size() const noexcept
 {
 	return this->size_;
 }
@@ -971,18 +1317,52 @@ radix_tree<Key, Value, BytesView, MtMode>::size() const noexcept
  *
  * Exchanges *this with @param rhs
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 void
-radix_tree<Key, Value, BytesView, MtMode>::swap(radix_tree &rhs)
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::swap(radix_tree &rhs)
 {
 	auto pop = pool_by_vptr(this);
 
 	flat_transaction::run(pop, [&] {
 		this->size_.swap(rhs.size_);
-		this->root.swap(rhs.root);
+
+		if (VolatileNodes) {
+			invalidate_nodes_on_abort();
+			rhs.invalidate_nodes_on_abort();
+			this->directory_swap(rhs);
+			invalidate_nodes();
+			rhs.invalidate_nodes();
+		} else {
+			this->root.swap(rhs.root);
+		}
 	});
 }
 
+/**
+ * Iterates over pointers stored in values of all elements (if Value is
+ * defragmentable, e.g. pmem::obj::string) and executes a callback function
+ * on each of them.
+ *
+ * Nodes and leaves are linked with self-relative pointers, which cannot
+ * be updated by the defragmentation, so they are not visited.
+ * For the same reason the tree itself must not be relocated: add it to
+ * pmem::obj::defrag by reference, not by a persistent_ptr to it.
+ *
+ * Must not be called concurrently with any modifications of the tree.
+ *
+ * @param func callback function to call on internal pointer.
+ */
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+void
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::for_each_ptr(
+	for_each_ptr_function func)
+{
+	for (auto it = begin(); it != end(); ++it)
+		detail::for_each_ptr_of(it->value(), func);
+}
+
 /**
  * Performs full epochs synchronisation. Transactionally collects and frees all
  * garbage produced by erase, clear, insert_or_assign or assign_val in
@@ -992,10 +1372,12 @@ radix_tree<Key, Value, BytesView, MtMode>::swap(radix_tree &rhs)
  *
  * @throw pmem::transaction_error when snapshotting failed.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool Mt, typename Enable>
 void
-radix_tree<Key, Value, BytesView, MtMode>::garbage_collect_force()
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::garbage_collect_force()
 {
 	ebr_->full_sync();
 	for (size_t i = 0; i < EPOCHS_NUMBER; ++i) {
@@ -1013,18 +1395,21 @@ radix_tree<Key, Value, BytesView, MtMode>::garbage_collect_force()
  *
  * @throw pmem::transaction_error when snapshotting failed.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool Mt, typename Enable>
 void
-radix_tree<Key, Value, BytesView, MtMode>::garbage_collect()
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::garbage_collect()
 {
 	ebr_->sync();
 	clear_garbage(ebr_->gc_epoch());
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 void
-radix_tree<Key, Value, BytesView, MtMode>::clear_garbage(size_t n)
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::clear_garbage(
+	size_t n)
 {
 	assert(n >= 0 && n < EPOCHS_NUMBER);
 
@@ -1046,35 +1431,45 @@ radix_tree<Key, Value, BytesView, MtMode>::clear_garbage(size_t n)
 	});
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::pointer_type
-radix_tree<Key, Value, BytesView, MtMode>::load(
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::pointer_type
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::load(
 	const std::atomic<detail::tagged_ptr<leaf, node>> &ptr)
 {
 	return ptr.load_acquire();
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::pointer_type
-radix_tree<Key, Value, BytesView, MtMode>::load(const pointer_type &ptr)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::pointer_type
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::load(
+	const pointer_type &ptr)
 {
 	return ptr;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 void
-radix_tree<Key, Value, BytesView, MtMode>::store(
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::store(
 	std::atomic<detail::tagged_ptr<leaf, node>> &ptr, pointer_type desired)
 {
 	ptr.store_with_snapshot_release(desired);
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 void
-radix_tree<Key, Value, BytesView, MtMode>::store(pointer_type &ptr,
-						 pointer_type desired)
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::store(
+	pointer_type &ptr, pointer_type desired)
 {
-	ptr = desired;
+	/* with volatile nodes, pointers to nodes are rebuilt after an abort
+	 * or a restart, so they are not snapshotted */
+	if (VolatileNodes)
+		new (&ptr) pointer_type(desired);
+	else
+		ptr = desired;
 }
 
 /**
@@ -1085,10 +1480,12 @@ radix_tree<Key, Value, BytesView, MtMode>::store(pointer_type &ptr,
  * @param[in] e pointer to already created ebr, default it will be created
  * automatically.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool Mt, typename Enable>
 void
-radix_tree<Key, Value, BytesView, MtMode>::runtime_initialize_mt(ebr *e)
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::runtime_initialize_mt(
+	ebr *e)
 {
 #if LIBPMEMOBJ_CPP_VG_PMEMCHECK_ENABLED
 	VALGRIND_PMC_REMOVE_PMEM_MAPPING(&ebr_, sizeof(ebr *));
@@ -1100,10 +1497,11 @@ radix_tree<Key, Value, BytesView, MtMode>::runtime_initialize_mt(ebr *e)
  * If MtMode == true, this function must be called before each application close
  * and before calling radix destructor or there will be possible a memory leak.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool Mt, typename Enable>
 void
-radix_tree<Key, Value, BytesView, MtMode>::runtime_finalize_mt()
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::runtime_finalize_mt()
 {
 	if (ebr_) {
 		delete ebr_;
@@ -1119,22 +1517,52 @@ radix_tree<Key, Value, BytesView, MtMode>::runtime_finalize_mt()
  *
  * @return new registered worker.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool Mt, typename Enable>
-typename radix_tree<Key, Value, BytesView, MtMode>::worker_type
-radix_tree<Key, Value, BytesView, MtMode>::register_worker()
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::worker_type
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::register_worker()
 {
 	assert(ebr_);
 
 	return ebr_->register_worker();
 }
 
+/**
+ * If VolatileNodes == true, rebuilds the internal nodes from the leaf
+ * directory using concurrency threads. Should be called after each
+ * application restart, otherwise the nodes are rebuilt (by one thread) by
+ * the first operation on the tree.
+ *
+ * @param[in] concurrency number of threads used to rebuild the nodes.
+ *
+ * @throw pmem::transaction_scope_error if called in a transaction and
+ * the tree was not used in this process yet.
+ * @throw std::system_error if a thread cannot be started.
+ */
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+template <bool Vn, typename Enable>
+void
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::runtime_initialize(
+	size_t concurrency)
+{
+	auto nodes = pmem::detail::volatile_state::get<volatile_nodes>(
+		pmemobj_oid(this));
+
+	std::lock_guard<std::mutex> lock(nodes->mutex);
+	rebuild_nodes(*nodes, (std::max)(concurrency, size_t(1)));
+}
+
 /*
  * Returns reference to n->parent (handles both internal and leaf nodes).
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::atomic_pointer_type &
-radix_tree<Key, Value, BytesView, MtMode>::parent_ref(pointer_type n)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::atomic_pointer_type &
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::parent_ref(
+	pointer_type n)
 {
 	if (is_leaf(n))
 		return get_leaf(n)->parent;
@@ -1150,10 +1578,12 @@ radix_tree<Key, Value, BytesView, MtMode>::parent_ref(pointer_type n)
  *
  * Can return nullptr if there is a conflicting, concurrent operation.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::leaf *
-radix_tree<Key, Value, BytesView, MtMode>::any_leftmost_leaf(
-	typename radix_tree<Key, Value, BytesView, MtMode>::pointer_type n,
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf *
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::any_leftmost_leaf(
+	typename radix_tree<Key, Value, BytesView, MtMode,
+			    VolatileNodes>::pointer_type n,
 	size_type min_depth) const
 {
 	assert(n);
@@ -1188,12 +1618,15 @@ radix_tree<Key, Value, BytesView, MtMode>::any_leftmost_leaf(
  *
  * Can return nullptr if there is a conflicting, concurrent operation.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K>
-std::pair<typename radix_tree<Key, Value, BytesView, MtMode>::leaf *,
-	  typename radix_tree<Key, Value, BytesView, MtMode>::path_type>
-radix_tree<Key, Value, BytesView, MtMode>::descend(pointer_type root_snap,
-						   const K &key) const
+std::pair<typename radix_tree<Key, Value, BytesView, MtMode,
+			      VolatileNodes>::leaf *,
+	  typename radix_tree<Key, Value, BytesView, MtMode,
+			      VolatileNodes>::path_type>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::descend(
+	pointer_type root_snap, const K &key) const
 {
 	assert(root_snap);
 
@@ -1237,10 +1670,12 @@ radix_tree<Key, Value, BytesView, MtMode>::descend(pointer_type root_snap,
 	}
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K>
 BytesView
-radix_tree<Key, Value, BytesView, MtMode>::bytes_view(const K &key)
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::bytes_view(
+	const K &key)
 {
 	/* bytes_view accepts const pointer instead of reference to make sure
 	 * there is no implicit conversion to a temporary type (and hence
@@ -1248,9 +1683,11 @@ radix_tree<Key, Value, BytesView, MtMode>::bytes_view(const K &key)
 	return BytesView(&key);
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 string_view
-radix_tree<Key, Value, BytesView, MtMode>::bytes_view(string_view key)
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::bytes_view(
+	string_view key)
 {
 	return key;
 }
@@ -1258,11 +1695,12 @@ radix_tree<Key, Value, BytesView, MtMode>::bytes_view(string_view key)
 /*
  * Checks for key equality.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K1, typename K2>
 bool
-radix_tree<Key, Value, BytesView, MtMode>::keys_equal(const K1 &k1,
-						      const K2 &k2)
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::keys_equal(
+	const K1 &k1, const K2 &k2)
 {
 	return k1.size() == k2.size() && compare(k1, k2) == 0;
 }
@@ -1270,11 +1708,12 @@ radix_tree<Key, Value, BytesView, MtMode>::keys_equal(const K1 &k1,
 /*
  * Checks for key equality.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K1, typename K2>
 int
-radix_tree<Key, Value, BytesView, MtMode>::compare(const K1 &k1, const K2 &k2,
-						   byten_t offset)
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::compare(
+	const K1 &k1, const K2 &k2, byten_t offset)
 {
 	auto ret = prefix_diff(k1, k2, offset);
 
@@ -1287,12 +1726,12 @@ radix_tree<Key, Value, BytesView, MtMode>::compare(const K1 &k1, const K2 &k2,
 /*
  * Returns length of common prefix of lhs and rhs.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K1, typename K2>
-typename radix_tree<Key, Value, BytesView, MtMode>::byten_t
-radix_tree<Key, Value, BytesView, MtMode>::prefix_diff(const K1 &lhs,
-						       const K2 &rhs,
-						       byten_t offset)
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::byten_t
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::prefix_diff(
+	const K1 &lhs, const K2 &rhs, byten_t offset)
 {
 	byten_t diff;
 	for (diff = offset; diff < (std::min)(lhs.size(), rhs.size()); diff++) {
@@ -1307,19 +1746,21 @@ radix_tree<Key, Value, BytesView, MtMode>::prefix_diff(const K1 &lhs,
  * Checks whether length of the path from root to n is equal
  * to key_size.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 bool
-radix_tree<Key, Value, BytesView, MtMode>::path_length_equal(size_t key_size,
-							     pointer_type n)
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::path_length_equal(
+	size_t key_size, pointer_type n)
 {
 	return n->byte == key_size && n->bit == bitn_t(FIRST_NIB);
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K1, typename K2>
-typename radix_tree<Key, Value, BytesView, MtMode>::bitn_t
-radix_tree<Key, Value, BytesView, MtMode>::bit_diff(const K1 &leaf_key,
-						    const K2 &key, byten_t diff)
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::bitn_t
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::bit_diff(
+	const K1 &leaf_key, const K2 &key, byten_t diff)
 {
 	auto min_key_len = (std::min)(leaf_key.size(), key.size());
 	bitn_t sh = 8;
@@ -1340,11 +1781,11 @@ radix_tree<Key, Value, BytesView, MtMode>::bit_diff(const K1 &leaf_key,
  * Follows path saved in @param path until appropriate node is found
  * (for which @param diff and @param sh matches with byte and bit).
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::node_desc
-radix_tree<Key, Value, BytesView, MtMode>::follow_path(const path_type &path,
-						       byten_t diff,
-						       bitn_t sh) const
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::node_desc
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::follow_path(
+	const path_type &path, byten_t diff, bitn_t sh) const
 {
 	assert(path.size());
 
@@ -1364,15 +1805,28 @@ radix_tree<Key, Value, BytesView, MtMode>::follow_path(const path_type &path,
 	return n;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K, typename F, class... Args>
-std::pair<typename radix_tree<Key, Value, BytesView, MtMode>::iterator, bool>
-radix_tree<Key, Value, BytesView, MtMode>::internal_emplace(const K &k,
-							    F &&make_leaf)
+std::pair<typename radix_tree<Key, Value, BytesView, MtMode,
+			      VolatileNodes>::iterator,
+	  bool>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::internal_emplace(
+	volatile_nodes *nodes, const K &k, F &&construct_leaf)
 {
 	auto key = bytes_view(k);
 	auto pop = pool_base(pmemobj_pool_by_ptr(this));
 
+	/* the new leaf is also added to the leaf directory */
+	auto make_leaf = [&](pointer_type parent) {
+		invalidate_nodes_on_abort();
+
+		auto l = construct_leaf(parent);
+		this->directory_add(l.get());
+
+		return l;
+	};
+
 	auto r = load(root);
 	if (!r) {
 		pointer_type leaf;
@@ -1442,8 +1896,8 @@ radix_tree<Key, Value, BytesView, MtMode>::internal_emplace(const K &k,
 		 * We have to allocate new internal node above n. */
 		pointer_type node;
 		flat_transaction::run(pop, [&] {
-			node = make_persistent<radix_tree::node>(
-				load(parent_ref(n)), diff, bitn_t(FIRST_NIB));
+			node = make_node(nodes, load(parent_ref(n)), diff,
+					 bitn_t(FIRST_NIB));
 			store(node->embedded_entry, make_leaf(node));
 			store(node->child[slice_index(leaf_key[diff],
 						      bitn_t(FIRST_NIB))],
@@ -1464,8 +1918,8 @@ radix_tree<Key, Value, BytesView, MtMode>::internal_emplace(const K &k,
 		flat_transaction::run(pop, [&] {
 			/* We have to add new node at the edge from parent to n
 			 */
-			node = make_persistent<radix_tree::node>(
-				load(parent_ref(n)), diff, bitn_t(FIRST_NIB));
+			node = make_node(nodes, load(parent_ref(n)), diff,
+					 bitn_t(FIRST_NIB));
 			store(node->embedded_entry, n);
 			store(node->child[slice_index(key[diff],
 						      bitn_t(FIRST_NIB))],
@@ -1487,8 +1941,7 @@ radix_tree<Key, Value, BytesView, MtMode>::internal_emplace(const K &k,
 	 * node. */
 	pointer_type node;
 	flat_transaction::run(pop, [&] {
-		node = make_persistent<radix_tree::node>(load(parent_ref(n)),
-							 diff, sh);
+		node = make_node(nodes, load(parent_ref(n)), diff, sh);
 		store(node->child[slice_index(leaf_key[diff], sh)], n);
 		store(node->child[slice_index(key[diff], sh)], make_leaf(node));
 
@@ -1530,13 +1983,16 @@ radix_tree<Key, Value, BytesView, MtMode>::internal_emplace(const K &k,
  * failed.
  * @throw rethrows constructor exception.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <class... Args>
-std::pair<typename radix_tree<Key, Value, BytesView, MtMode>::iterator, bool>
-radix_tree<Key, Value, BytesView, MtMode>::try_emplace(const key_type &k,
-						       Args &&... args)
+std::pair<typename radix_tree<Key, Value, BytesView, MtMode,
+			      VolatileNodes>::iterator,
+	  bool>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::try_emplace(
+	const key_type &k, Args &&... args)
 {
-	return internal_emplace(k, [&](pointer_type parent) {
+	return internal_emplace(check_nodes(), k, [&](pointer_type parent) {
 		size_++;
 		return leaf::make_key_args(parent, k,
 					   std::forward<Args>(args)...);
@@ -1569,10 +2025,28 @@ radix_tree<Key, Value, BytesView, MtMode>::try_emplace(const key_type &k,
  * failed.
  * @throw rethrows constructor exception.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+template <class... Args>
+std::pair<typename radix_tree<Key, Value, BytesView, MtMode,
+			      VolatileNodes>::iterator,
+	  bool>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::emplace(
+	Args &&... args)
+{
+	return internal_emplace_value(check_nodes(),
+				      std::forward<Args>(args)...);
+}
+
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <class... Args>
-std::pair<typename radix_tree<Key, Value, BytesView, MtMode>::iterator, bool>
-radix_tree<Key, Value, BytesView, MtMode>::emplace(Args &&... args)
+std::pair<typename radix_tree<Key, Value, BytesView, MtMode,
+			      VolatileNodes>::iterator,
+	  bool>
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::internal_emplace_value(volatile_nodes *nodes,
+						  Args &&... args)
 {
 	auto pop = pool_base(pmemobj_pool_by_ptr(this));
 	std::pair<iterator, bool> ret;
@@ -1585,7 +2059,7 @@ radix_tree<Key, Value, BytesView, MtMode>::emplace(Args &&... args)
 			return leaf_;
 		};
 
-		ret = internal_emplace(leaf_->key(), make_leaf);
+		ret = internal_emplace(nodes, leaf_->key(), make_leaf);
 
 		if (!ret.second)
 			delete_persistent<leaf>(leaf_);
@@ -1609,9 +2083,13 @@ radix_tree<Key, Value, BytesView, MtMode>::emplace(Args &&... args)
  * failed.
  * @throw rethrows constructor exception.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-std::pair<typename radix_tree<Key, Value, BytesView, MtMode>::iterator, bool>
-radix_tree<Key, Value, BytesView, MtMode>::insert(const value_type &v)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+std::pair<typename radix_tree<Key, Value, BytesView, MtMode,
+			      VolatileNodes>::iterator,
+	  bool>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::insert(
+	const value_type &v)
 {
 	return try_emplace(v.first, v.second);
 }
@@ -1631,9 +2109,12 @@ radix_tree<Key, Value, BytesView, MtMode>::insert(const value_type &v)
  * failed.
  * @throw rethrows constructor exception.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-std::pair<typename radix_tree<Key, Value, BytesView, MtMode>::iterator, bool>
-radix_tree<Key, Value, BytesView, MtMode>::insert(value_type &&v)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+std::pair<typename radix_tree<Key, Value, BytesView, MtMode,
+			      VolatileNodes>::iterator,
+	  bool>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::insert(value_type &&v)
 {
 	return try_emplace(std::move(v.first), std::move(v.second));
 }
@@ -1657,10 +2138,13 @@ radix_tree<Key, Value, BytesView, MtMode>::insert(value_type &&v)
  * failed.
  * @throw rethrows constructor exception.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename P, typename>
-std::pair<typename radix_tree<Key, Value, BytesView, MtMode>::iterator, bool>
-radix_tree<Key, Value, BytesView, MtMode>::insert(P &&p)
+std::pair<typename radix_tree<Key, Value, BytesView, MtMode,
+			      VolatileNodes>::iterator,
+	  bool>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::insert(P &&p)
 {
 	return emplace(std::forward<P>(p));
 }
@@ -1676,11 +2160,12 @@ radix_tree<Key, Value, BytesView, MtMode>::insert(P &&p)
  * failed.
  * @throw rethrows constructor exception.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename InputIterator>
 void
-radix_tree<Key, Value, BytesView, MtMode>::insert(InputIterator first,
-						  InputIterator last)
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::insert(
+	InputIterator first, InputIterator last)
 {
 	for (auto it = first; it != last; it++)
 		try_emplace((*it).first, (*it).second);
@@ -1696,9 +2181,10 @@ radix_tree<Key, Value, BytesView, MtMode>::insert(InputIterator first,
  * failed.
  * @throw rethrows constructor exception.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 void
-radix_tree<Key, Value, BytesView, MtMode>::insert(
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::insert(
 	std::initializer_list<value_type> il)
 {
 	insert(il.begin(), il.end());
@@ -1728,13 +2214,16 @@ radix_tree<Key, Value, BytesView, MtMode>::insert(
  * failed.
  * @throw rethrows constructor exception.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <class... Args>
-std::pair<typename radix_tree<Key, Value, BytesView, MtMode>::iterator, bool>
-radix_tree<Key, Value, BytesView, MtMode>::try_emplace(key_type &&k,
-						       Args &&... args)
+std::pair<typename radix_tree<Key, Value, BytesView, MtMode,
+			      VolatileNodes>::iterator,
+	  bool>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::try_emplace(
+	key_type &&k, Args &&... args)
 {
-	return internal_emplace(k, [&](pointer_type parent) {
+	return internal_emplace(check_nodes(), k, [&](pointer_type parent) {
 		size_++;
 		return leaf::make_key_args(parent, std::move(k),
 					   std::forward<Args>(args)...);
@@ -1769,22 +2258,24 @@ radix_tree<Key, Value, BytesView, MtMode>::try_emplace(key_type &&k,
  * failed.
  * @throw rethrows constructor exception.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K, typename BV, class... Args>
 auto
-radix_tree<Key, Value, BytesView, MtMode>::try_emplace(K &&k, Args &&... args)
-	-> typename std::enable_if<
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::try_emplace(
+	K &&k, Args &&... args) ->
+	typename std::enable_if<
 		detail::has_is_transparent<BV>::value &&
 			!std::is_same<typename std::remove_const<
 					      typename std::remove_reference<
 						      K>::type>::type,
 				      key_type>::value,
-		std::pair<typename radix_tree<Key, Value, BytesView,
-					      MtMode>::iterator,
+		std::pair<typename radix_tree<Key, Value, BytesView, MtMode,
+					      VolatileNodes>::iterator,
 			  bool>>::type
 
 {
-	return internal_emplace(k, [&](pointer_type parent) {
+	return internal_emplace(check_nodes(), k, [&](pointer_type parent) {
 		size_++;
 		return leaf::make_key_args(parent, std::forward<K>(k),
 					   std::forward<Args>(args)...);
@@ -1809,11 +2300,14 @@ radix_tree<Key, Value, BytesView, MtMode>::try_emplace(K &&k, Args &&... args)
  * failed.
  * @throw rethrows constructor exception.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename M>
-std::pair<typename radix_tree<Key, Value, BytesView, MtMode>::iterator, bool>
-radix_tree<Key, Value, BytesView, MtMode>::insert_or_assign(const key_type &k,
-							    M &&obj)
+std::pair<typename radix_tree<Key, Value, BytesView, MtMode,
+			      VolatileNodes>::iterator,
+	  bool>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::insert_or_assign(
+	const key_type &k, M &&obj)
 {
 	auto ret = try_emplace(k, std::forward<M>(obj));
 	if (!ret.second)
@@ -1839,11 +2333,14 @@ radix_tree<Key, Value, BytesView, MtMode>::insert_or_assign(const key_type &k,
  * failed.
  * @throw rethrows constructor exception.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename M>
-std::pair<typename radix_tree<Key, Value, BytesView, MtMode>::iterator, bool>
-radix_tree<Key, Value, BytesView, MtMode>::insert_or_assign(key_type &&k,
-							    M &&obj)
+std::pair<typename radix_tree<Key, Value, BytesView, MtMode,
+			      VolatileNodes>::iterator,
+	  bool>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::insert_or_assign(
+	key_type &&k, M &&obj)
 {
 	auto ret = try_emplace(std::move(k), std::forward<M>(obj));
 	if (!ret.second)
@@ -1872,10 +2369,14 @@ radix_tree<Key, Value, BytesView, MtMode>::insert_or_assign(key_type &&k,
  * failed.
  * @throw rethrows constructor exception.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename M, typename K, typename>
-std::pair<typename radix_tree<Key, Value, BytesView, MtMode>::iterator, bool>
-radix_tree<Key, Value, BytesView, MtMode>::insert_or_assign(K &&k, M &&obj)
+std::pair<typename radix_tree<Key, Value, BytesView, MtMode,
+			      VolatileNodes>::iterator,
+	  bool>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::insert_or_assign(
+	K &&k, M &&obj)
 {
 	auto ret = try_emplace(std::forward<K>(k), std::forward<M>(obj));
 	if (!ret.second)
@@ -1892,9 +2393,11 @@ radix_tree<Key, Value, BytesView, MtMode>::insert_or_assign(K &&k, M &&obj)
  * @return Number of elements with key that compares equivalent to the
  * specified argument.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::size_type
-radix_tree<Key, Value, BytesView, MtMode>::count(const key_type &k) const
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::size_type
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::count(
+	const key_type &k) const
 {
 	return internal_find(k) != nullptr ? 1 : 0;
 }
@@ -1911,10 +2414,12 @@ radix_tree<Key, Value, BytesView, MtMode>::count(const key_type &k) const
  * @return Number of elements with key that compares equivalent to the
  * specified argument.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K, typename>
-typename radix_tree<Key, Value, BytesView, MtMode>::size_type
-radix_tree<Key, Value, BytesView, MtMode>::count(const K &k) const
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::size_type
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::count(
+	const K &k) const
 {
 	return internal_find(k) != nullptr ? 1 : 0;
 }
@@ -1927,9 +2432,11 @@ radix_tree<Key, Value, BytesView, MtMode>::count(const K &k) const
  * @return Iterator to an element with key equivalent to key. If no such
  * element is found, past-the-end iterator is returned.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::iterator
-radix_tree<Key, Value, BytesView, MtMode>::find(const key_type &k)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::find(
+	const key_type &k)
 {
 	return iterator(internal_find(k), this);
 }
@@ -1942,9 +2449,12 @@ radix_tree<Key, Value, BytesView, MtMode>::find(const key_type &k)
  * @return Const iterator to an element with key equivalent to key. If no such
  * element is found, past-the-end iterator is returned.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::const_iterator
-radix_tree<Key, Value, BytesView, MtMode>::find(const key_type &k) const
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::const_iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::find(
+	const key_type &k) const
 {
 	return const_iterator(internal_find(k), this);
 }
@@ -1960,10 +2470,11 @@ radix_tree<Key, Value, BytesView, MtMode>::find(const key_type &k) const
  * @return Iterator to an element with key equivalent to key. If no such
  * element is found, past-the-end iterator is returned.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K, typename>
-typename radix_tree<Key, Value, BytesView, MtMode>::iterator
-radix_tree<Key, Value, BytesView, MtMode>::find(const K &k)
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::find(const K &k)
 {
 	return iterator(internal_find(k), this);
 }
@@ -1979,21 +2490,27 @@ radix_tree<Key, Value, BytesView, MtMode>::find(const K &k)
  * @return Const iterator to an element with key equivalent to key. If no such
  * element is found, past-the-end iterator is returned.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K, typename>
-typename radix_tree<Key, Value, BytesView, MtMode>::const_iterator
-radix_tree<Key, Value, BytesView, MtMode>::find(const K &k) const
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::const_iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::find(const K &k) const
 {
 	return const_iterator(internal_find(k), this);
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K>
-typename radix_tree<Key, Value, BytesView, MtMode>::leaf *
-radix_tree<Key, Value, BytesView, MtMode>::internal_find(const K &k) const
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf *
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::internal_find(
+	const K &k) const
 {
 	auto key = bytes_view(k);
 
+	check_nodes();
+
 	auto n = load(root);
 	while (n && !is_leaf(n)) {
 		if (path_length_equal(key.size(), n))
@@ -2020,12 +2537,31 @@ radix_tree<Key, Value, BytesView, MtMode>::internal_find(const K &k) const
  *
  * @throw pmem::transaction_error when snapshotting failed.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 void
-radix_tree<Key, Value, BytesView, MtMode>::clear()
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::clear()
 {
-	if (size() != 0)
+	if (size() == 0)
+		return;
+
+	if (!VolatileNodes) {
 		erase(begin(), end());
+		return;
+	}
+
+	/* all leaves are in the directory, the nodes do not have to be read */
+	auto pop = pool_base(pmemobj_pool_by_ptr(this));
+	flat_transaction::run(pop, [&] {
+		invalidate_nodes_on_abort();
+		this->template directory_clear<radix_tree::leaf>();
+		store(this->root, nullptr);
+		size_ = 0;
+	});
+
+	auto nodes = get_volatile_nodes();
+	if (nodes)
+		nodes->reset();
 }
 
 /**
@@ -2043,20 +2579,27 @@ radix_tree<Key, Value, BytesView, MtMode>::clear()
  *
  * @throw pmem::transaction_error when snapshotting failed.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::iterator
-radix_tree<Key, Value, BytesView, MtMode>::erase(const_iterator pos)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::erase(
+	const_iterator pos)
 {
 	auto pop = pool_base(pmemobj_pool_by_ptr(this));
+	auto nodes = get_volatile_nodes();
 
 	flat_transaction::run(pop, [&] {
 		auto *leaf = pos.leaf_;
 		auto parent = load(leaf->parent);
 
+		invalidate_nodes_on_abort();
+
 		/* there are more elements in the container */
 		if (parent)
 			++pos;
 
+		/* It's safe to cast because we're inside non-const method. */
+		this->directory_remove(const_cast<radix_tree::leaf *>(leaf));
 		free(persistent_ptr<radix_tree::leaf>(leaf));
 
 		size_--;
@@ -2103,7 +2646,7 @@ radix_tree<Key, Value, BytesView, MtMode>::erase(const_iterator pos)
 					  : &root;
 		store(*child_slot, only_child);
 
-		free(persistent_ptr<radix_tree::node>(get_node(n)));
+		free_node(nodes, n);
 	});
 
 	return iterator(const_cast<typename iterator::leaf_ptr>(pos.leaf_),
@@ -2123,10 +2666,11 @@ radix_tree<Key, Value, BytesView, MtMode>::erase(const_iterator pos)
  *
  * @throw pmem::transaction_error when snapshotting failed.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::iterator
-radix_tree<Key, Value, BytesView, MtMode>::erase(const_iterator first,
-						 const_iterator last)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::erase(
+	const_iterator first, const_iterator last)
 {
 	auto pop = pool_base(pmemobj_pool_by_ptr(this));
 
@@ -2151,9 +2695,11 @@ radix_tree<Key, Value, BytesView, MtMode>::erase(const_iterator first,
  * @throw pmem::transaction_error when snapshotting failed.
  * @throw rethrows destructor exception.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::size_type
-radix_tree<Key, Value, BytesView, MtMode>::erase(const key_type &k)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::size_type
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::erase(
+	const key_type &k)
 {
 	auto it = const_iterator(internal_find(k), this);
 
@@ -2179,10 +2725,11 @@ radix_tree<Key, Value, BytesView, MtMode>::erase(const key_type &k)
  * @throw pmem::transaction_error when snapshotting failed.
  * @throw rethrows destructor exception.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K, typename>
-typename radix_tree<Key, Value, BytesView, MtMode>::size_type
-radix_tree<Key, Value, BytesView, MtMode>::erase(const K &k)
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::size_type
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::erase(const K &k)
 {
 	auto it = const_iterator(internal_find(k), this);
 
@@ -2198,10 +2745,12 @@ radix_tree<Key, Value, BytesView, MtMode>::erase(const K &k)
  * Deletes node/leaf pointed by ptr. If concurrent mode is used, adds element
  * to the garbage list. Otherwise, frees the element immediately.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename T>
 void
-radix_tree<Key, Value, BytesView, MtMode>::free(persistent_ptr<T> ptr)
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::free(
+	persistent_ptr<T> ptr)
 {
 	if (MtMode && ebr_ != nullptr)
 		garbages[ebr_->staging_epoch()].emplace_back(ptr);
@@ -2213,11 +2762,12 @@ radix_tree<Key, Value, BytesView, MtMode>::free(persistent_ptr<T> ptr)
  * Checks if iterator points to element which compares bigger (or equal)
  * to key.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool Lower, typename K>
 bool
-radix_tree<Key, Value, BytesView, MtMode>::validate_bound(const_iterator it,
-							  const K &key) const
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::validate_bound(
+	const_iterator it, const K &key) const
 {
 	if (it == cend())
 		return true;
@@ -2231,10 +2781,11 @@ radix_tree<Key, Value, BytesView, MtMode>::validate_bound(const_iterator it,
 /**
  * Checks if any node in the @param path was modified.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool Mt>
 typename std::enable_if<Mt, bool>::type
-radix_tree<Key, Value, BytesView, MtMode>::validate_path(
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::validate_path(
 	const path_type &path) const
 {
 	for (auto i = 0ULL; i < path.size(); i++) {
@@ -2249,19 +2800,23 @@ radix_tree<Key, Value, BytesView, MtMode>::validate_path(
 	return true;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool Mt>
 typename std::enable_if<!Mt, bool>::type
-radix_tree<Key, Value, BytesView, MtMode>::validate_path(
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::validate_path(
 	const path_type &path) const
 {
 	return true;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool Lower, typename K>
-typename radix_tree<Key, Value, BytesView, MtMode>::const_iterator
-radix_tree<Key, Value, BytesView, MtMode>::internal_bound(const K &k) const
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::const_iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::internal_bound(
+	const K &k) const
 {
 	auto key = bytes_view(k);
 	auto pop = pool_base(pmemobj_pool_by_ptr(this));
@@ -2269,6 +2824,8 @@ radix_tree<Key, Value, BytesView, MtMode>::internal_bound(const K &k) const
 	path_type path;
 	const_iterator result;
 
+	check_nodes();
+
 	while (true) {
 		auto r = load(root);
 
@@ -2463,9 +3020,12 @@ radix_tree<Key, Value, BytesView, MtMode>::internal_bound(const K &k) const
  * key. If no such element is found, a past-the-end iterator is
  * returned.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::const_iterator
-radix_tree<Key, Value, BytesView, MtMode>::lower_bound(const key_type &k) const
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::const_iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::lower_bound(
+	const key_type &k) const
 {
 	return internal_bound<true>(k);
 }
@@ -2480,9 +3040,11 @@ radix_tree<Key, Value, BytesView, MtMode>::lower_bound(const key_type &k) const
  * key. If no such element is found, a past-the-end iterator is
  * returned.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::iterator
-radix_tree<Key, Value, BytesView, MtMode>::lower_bound(const key_type &k)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::lower_bound(
+	const key_type &k)
 {
 	auto it = const_cast<const radix_tree *>(this)->lower_bound(k);
 	return iterator(const_cast<typename iterator::leaf_ptr>(it.leaf_),
@@ -2502,10 +3064,12 @@ radix_tree<Key, Value, BytesView, MtMode>::lower_bound(const key_type &k)
  * key. If no such element is found, a past-the-end iterator is
  * returned.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K, typename>
-typename radix_tree<Key, Value, BytesView, MtMode>::iterator
-radix_tree<Key, Value, BytesView, MtMode>::lower_bound(const K &k)
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::lower_bound(
+	const K &k)
 {
 	auto it = const_cast<const radix_tree *>(this)->lower_bound(k);
 	return iterator(const_cast<typename iterator::leaf_ptr>(it.leaf_),
@@ -2525,10 +3089,13 @@ radix_tree<Key, Value, BytesView, MtMode>::lower_bound(const K &k)
  * key. If no such element is found, a past-the-end iterator is
  * returned.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K, typename>
-typename radix_tree<Key, Value, BytesView, MtMode>::const_iterator
-radix_tree<Key, Value, BytesView, MtMode>::lower_bound(const K &k) const
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::const_iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::lower_bound(
+	const K &k) const
 {
 	return internal_bound<true>(k);
 }
@@ -2543,9 +3110,12 @@ radix_tree<Key, Value, BytesView, MtMode>::lower_bound(const K &k) const
  * key. If no such element is found, a past-the-end iterator is
  * returned.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::const_iterator
-radix_tree<Key, Value, BytesView, MtMode>::upper_bound(const key_type &k) const
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::const_iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::upper_bound(
+	const key_type &k) const
 {
 	return internal_bound<false>(k);
 }
@@ -2560,9 +3130,11 @@ radix_tree<Key, Value, BytesView, MtMode>::upper_bound(const key_type &k) const
  * key. If no such element is found, a past-the-end iterator is
  * returned.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::iterator
-radix_tree<Key, Value, BytesView, MtMode>::upper_bound(const key_type &k)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::upper_bound(
+	const key_type &k)
 {
 	auto it = const_cast<const radix_tree *>(this)->upper_bound(k);
 	return iterator(const_cast<typename iterator::leaf_ptr>(it.leaf_),
@@ -2582,10 +3154,12 @@ radix_tree<Key, Value, BytesView, MtMode>::upper_bound(const key_type &k)
  * key. If no such element is found, a past-the-end iterator is
  * returned.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K, typename>
-typename radix_tree<Key, Value, BytesView, MtMode>::iterator
-radix_tree<Key, Value, BytesView, MtMode>::upper_bound(const K &k)
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::upper_bound(
+	const K &k)
 {
 	auto it = const_cast<const radix_tree *>(this)->upper_bound(k);
 	return iterator(const_cast<typename iterator::leaf_ptr>(it.leaf_),
@@ -2605,10 +3179,13 @@ radix_tree<Key, Value, BytesView, MtMode>::upper_bound(const K &k)
  * key. If no such element is found, a past-the-end iterator is
  * returned.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K, typename>
-typename radix_tree<Key, Value, BytesView, MtMode>::const_iterator
-radix_tree<Key, Value, BytesView, MtMode>::upper_bound(const K &k) const
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::const_iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::upper_bound(
+	const K &k) const
 {
 	return internal_bound<false>(k);
 }
@@ -2619,9 +3196,10 @@ radix_tree<Key, Value, BytesView, MtMode>::upper_bound(const K &k) const
  *
  * @return Iterator to the first element.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::iterator
-radix_tree<Key, Value, BytesView, MtMode>::begin()
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::begin()
 {
 	auto const_begin = const_cast<const radix_tree *>(this)->begin();
 	return iterator(
@@ -2636,9 +3214,10 @@ radix_tree<Key, Value, BytesView, MtMode>::begin()
  *
  * @return Iterator to the element following the last element.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::iterator
-radix_tree<Key, Value, BytesView, MtMode>::end()
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::end()
 {
 	auto const_end = const_cast<const radix_tree *>(this)->end();
 	return iterator(
@@ -2651,10 +3230,14 @@ radix_tree<Key, Value, BytesView, MtMode>::end()
  *
  * @return const iterator to the first element.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::const_iterator
-radix_tree<Key, Value, BytesView, MtMode>::cbegin() const
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::const_iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::cbegin() const
 {
+	check_nodes();
+
 	while (true) {
 		auto root_ptr = load(root);
 		if (!root_ptr)
@@ -2675,9 +3258,11 @@ radix_tree<Key, Value, BytesView, MtMode>::cbegin() const
  *
  * @return const iterator to the element following the last element.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::const_iterator
-radix_tree<Key, Value, BytesView, MtMode>::cend() const
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::const_iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::cend() const
 {
 	return const_iterator(nullptr, this);
 }
@@ -2688,9 +3273,11 @@ radix_tree<Key, Value, BytesView, MtMode>::cend() const
  *
  * @return const iterator to the first element.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::const_iterator
-radix_tree<Key, Value, BytesView, MtMode>::begin() const
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::const_iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::begin() const
 {
 	return cbegin();
 }
@@ -2702,9 +3289,11 @@ radix_tree<Key, Value, BytesView, MtMode>::begin() const
  *
  * @return const iterator to the element following the last element.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::const_iterator
-radix_tree<Key, Value, BytesView, MtMode>::end() const
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::const_iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::end() const
 {
 	return cend();
 }
@@ -2716,9 +3305,11 @@ radix_tree<Key, Value, BytesView, MtMode>::end() const
  *
  * @return reverse_iterator pointing to the last element in the vector.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::reverse_iterator
-radix_tree<Key, Value, BytesView, MtMode>::rbegin()
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::reverse_iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::rbegin()
 {
 	return reverse_iterator(end());
 }
@@ -2731,9 +3322,11 @@ radix_tree<Key, Value, BytesView, MtMode>::rbegin()
  * @return reverse_iterator pointing to the theoretical element preceding the
  * first element in the vector.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::reverse_iterator
-radix_tree<Key, Value, BytesView, MtMode>::rend()
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::reverse_iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::rend()
 {
 	return reverse_iterator(begin());
 }
@@ -2745,9 +3338,11 @@ radix_tree<Key, Value, BytesView, MtMode>::rend()
  *
  * @return const_reverse_iterator pointing to the last element in the vector.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::const_reverse_iterator
-radix_tree<Key, Value, BytesView, MtMode>::crbegin() const
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::const_reverse_iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::crbegin() const
 {
 	return const_reverse_iterator(cend());
 }
@@ -2760,31 +3355,38 @@ radix_tree<Key, Value, BytesView, MtMode>::crbegin() const
  * @return const_reverse_iterator pointing to the theoretical element preceding
  * the first element in the vector.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::const_reverse_iterator
-radix_tree<Key, Value, BytesView, MtMode>::crend() const
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::const_reverse_iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::crend() const
 {
 	return const_reverse_iterator(cbegin());
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::const_reverse_iterator
-radix_tree<Key, Value, BytesView, MtMode>::rbegin() const
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::const_reverse_iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::rbegin() const
 {
 	return const_reverse_iterator(cend());
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::const_reverse_iterator
-radix_tree<Key, Value, BytesView, MtMode>::rend() const
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::const_reverse_iterator
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::rend() const
 {
 	return const_reverse_iterator(cbegin());
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 void
-radix_tree<Key, Value, BytesView, MtMode>::print_rec(std::ostream &os,
-						     radix_tree::pointer_type n)
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::print_rec(
+	std::ostream &os, radix_tree::pointer_type n)
 {
 	if (!is_leaf(n)) {
 		os << "\"" << get_node(n) << "\""
@@ -2838,15 +3440,20 @@ radix_tree<Key, Value, BytesView, MtMode>::print_rec(std::ostream &os,
 /**
  * Prints tree in DOT format. Used for debugging.
  */
-template <typename K, typename V, typename BV, bool MtMode>
+template <typename K, typename V, typename BV, bool MtMode, bool VolatileNodes>
 std::ostream &
-operator<<(std::ostream &os, const radix_tree<K, V, BV, MtMode> &tree)
+operator<<(std::ostream &os,
+	   const radix_tree<K, V, BV, MtMode, VolatileNodes> &tree)
 {
+	tree.check_nodes();
+
 	os << "digraph Radix {" << std::endl;
 
-	if (radix_tree<K, V, BV, MtMode>::load(tree.root))
-		radix_tree<K, V, BV, MtMode>::print_rec(
-			os, radix_tree<K, V, BV, MtMode>::load(tree.root));
+	if (radix_tree<K, V, BV, MtMode, VolatileNodes>::load(tree.root))
+		radix_tree<K, V, BV, MtMode, VolatileNodes>::print_rec(
+			os,
+			radix_tree<K, V, BV, MtMode, VolatileNodes>::load(
+				tree.root));
 
 	os << "}" << std::endl;
 
@@ -2856,24 +3463,29 @@ operator<<(std::ostream &os, const radix_tree<K, V, BV, MtMode> &tree)
 /*
  * internal: slice_index -- return index of child at the given nib
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 unsigned
-radix_tree<Key, Value, BytesView, MtMode>::slice_index(char b, uint8_t bit)
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::slice_index(
+	char b, uint8_t bit)
 {
 	return static_cast<unsigned>(b >> bit) & NIB;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-radix_tree<Key, Value, BytesView,
-	   MtMode>::node::forward_iterator::forward_iterator(pointer child,
-							     const node *n)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::node::
+	forward_iterator::forward_iterator(pointer child, const node *n)
     : child(child), n(n)
 {
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::node::forward_iterator
-radix_tree<Key, Value, BytesView, MtMode>::node::forward_iterator::operator++()
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::node::forward_iterator
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::node::forward_iterator::operator++()
 {
 	if (child == &n->embedded_entry)
 		child = &n->child[0];
@@ -2883,16 +3495,20 @@ radix_tree<Key, Value, BytesView, MtMode>::node::forward_iterator::operator++()
 	return *this;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-radix_tree<Key, Value, BytesView, MtMode>::node::node(pointer_type parent,
-						      byten_t byte, bitn_t bit)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::node::node(
+	pointer_type parent, byten_t byte, bitn_t bit)
     : parent(parent), byte(byte), bit(bit)
 {
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::node::forward_iterator
-radix_tree<Key, Value, BytesView, MtMode>::node::forward_iterator::operator--()
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::node::forward_iterator
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::node::forward_iterator::operator--()
 {
 	if (child == &n->child[0])
 		child = &n->embedded_entry;
@@ -2902,112 +3518,129 @@ radix_tree<Key, Value, BytesView, MtMode>::node::forward_iterator::operator--()
 	return *this;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::node::forward_iterator
-radix_tree<Key, Value, BytesView, MtMode>::node::forward_iterator::operator++(
-	int)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::node::forward_iterator
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::node::forward_iterator::operator++(int)
 {
 	forward_iterator tmp(child, n);
 	operator++();
 	return tmp;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView,
-		    MtMode>::node::forward_iterator::reference
-	radix_tree<Key, Value, BytesView,
-		   MtMode>::node::forward_iterator::operator*() const
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::node::forward_iterator::reference
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::node::forward_iterator::operator*() const
 {
 	return *child;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView,
-		    MtMode>::node::forward_iterator::pointer
-	radix_tree<Key, Value, BytesView,
-		   MtMode>::node::forward_iterator::operator->() const
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::node::forward_iterator::pointer
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::node::forward_iterator::operator->() const
 {
 	return child;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView,
-		    MtMode>::node::forward_iterator::pointer
-radix_tree<Key, Value, BytesView, MtMode>::node::forward_iterator::get_node()
-	const
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::node::forward_iterator::pointer
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::node::forward_iterator::get_node() const
 {
 	return n;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 bool
-radix_tree<Key, Value, BytesView, MtMode>::node::forward_iterator::operator==(
-	const forward_iterator &rhs) const
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::node::
+	forward_iterator::operator==(const forward_iterator &rhs) const
 {
 	return child == rhs.child && n == rhs.n;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 bool
-radix_tree<Key, Value, BytesView, MtMode>::node::forward_iterator::operator!=(
-	const forward_iterator &rhs) const
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::node::
+	forward_iterator::operator!=(const forward_iterator &rhs) const
 {
 	return child != rhs.child || n != rhs.n;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool Direction>
-typename std::enable_if<Direction ==
-				radix_tree<Key, Value, BytesView,
-					   MtMode>::node::direction::Forward,
-			typename radix_tree<Key, Value, BytesView, MtMode>::
-				node::forward_iterator>::type
-radix_tree<Key, Value, BytesView, MtMode>::node::begin() const
+typename std::enable_if<
+	Direction ==
+		radix_tree<Key, Value, BytesView, MtMode,
+			   VolatileNodes>::node::direction::Forward,
+	typename radix_tree<Key, Value, BytesView, MtMode,
+			    VolatileNodes>::node::forward_iterator>::type
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::node::begin() const
 {
 	return forward_iterator(&embedded_entry, this);
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool Direction>
-typename std::enable_if<Direction ==
-				radix_tree<Key, Value, BytesView,
-					   MtMode>::node::direction::Forward,
-			typename radix_tree<Key, Value, BytesView, MtMode>::
-				node::forward_iterator>::type
-radix_tree<Key, Value, BytesView, MtMode>::node::end() const
+typename std::enable_if<
+	Direction ==
+		radix_tree<Key, Value, BytesView, MtMode,
+			   VolatileNodes>::node::direction::Forward,
+	typename radix_tree<Key, Value, BytesView, MtMode,
+			    VolatileNodes>::node::forward_iterator>::type
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::node::end() const
 {
 	return forward_iterator(&child[SLNODES], this);
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool Direction>
-typename std::enable_if<Direction ==
-				radix_tree<Key, Value, BytesView,
-					   MtMode>::node::direction::Reverse,
-			typename radix_tree<Key, Value, BytesView, MtMode>::
-				node::reverse_iterator>::type
-radix_tree<Key, Value, BytesView, MtMode>::node::begin() const
+typename std::enable_if<
+	Direction ==
+		radix_tree<Key, Value, BytesView, MtMode,
+			   VolatileNodes>::node::direction::Reverse,
+	typename radix_tree<Key, Value, BytesView, MtMode,
+			    VolatileNodes>::node::reverse_iterator>::type
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::node::begin() const
 {
 	return reverse_iterator(end<direction::Forward>());
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool Direction>
-typename std::enable_if<Direction ==
-				radix_tree<Key, Value, BytesView,
-					   MtMode>::node::direction::Reverse,
-			typename radix_tree<Key, Value, BytesView, MtMode>::
-				node::reverse_iterator>::type
-radix_tree<Key, Value, BytesView, MtMode>::node::end() const
+typename std::enable_if<
+	Direction ==
+		radix_tree<Key, Value, BytesView, MtMode,
+			   VolatileNodes>::node::direction::Reverse,
+	typename radix_tree<Key, Value, BytesView, MtMode,
+			    VolatileNodes>::node::reverse_iterator>::type
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::node::end() const
 {
 	return reverse_iterator(begin<direction::Forward>());
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool Direction, typename Ptr>
-typename radix_tree<Key, Value, BytesView,
-		    MtMode>::node::template iterator<Direction>
-radix_tree<Key, Value, BytesView, MtMode>::node::find_child(const Ptr &n) const
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::node::template iterator<Direction>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::node::find_child(
+	const Ptr &n) const
 {
 	auto it = begin<Direction>();
 	while (it != end<Direction>()) {
@@ -3018,41 +3651,46 @@ radix_tree<Key, Value, BytesView, MtMode>::node::find_child(const Ptr &n) const
 	return it;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool Direction, typename Enable>
-typename radix_tree<Key, Value, BytesView,
-		    MtMode>::node::template iterator<Direction>
-radix_tree<Key, Value, BytesView, MtMode>::node::make_iterator(
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::node::template iterator<Direction>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::node::make_iterator(
 	const atomic_pointer_type *ptr) const
 {
 	return forward_iterator(ptr, this);
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool IsConst>
-radix_tree<Key, Value, BytesView, MtMode>::radix_tree_iterator<
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::radix_tree_iterator<
 	IsConst>::radix_tree_iterator(leaf_ptr leaf_, tree_ptr tree)
     : leaf_(leaf_), tree(tree)
 {
 	assert(tree);
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool IsConst>
 template <bool C, typename Enable>
-radix_tree<Key, Value, BytesView, MtMode>::radix_tree_iterator<
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::radix_tree_iterator<
 	IsConst>::radix_tree_iterator(const radix_tree_iterator<false> &rhs)
     : leaf_(rhs.leaf_), tree(rhs.tree)
 {
 	assert(tree);
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool IsConst>
-typename radix_tree<Key, Value, BytesView,
-		    MtMode>::template radix_tree_iterator<IsConst>::reference
-	radix_tree<Key, Value, BytesView,
-		   MtMode>::radix_tree_iterator<IsConst>::operator*() const
+typename radix_tree<
+	Key, Value, BytesView, MtMode,
+	VolatileNodes>::template radix_tree_iterator<IsConst>::reference
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::radix_tree_iterator<IsConst>::operator*() const
 {
 	assert(leaf_);
 	assert(tree);
@@ -3060,12 +3698,14 @@ typename radix_tree<Key, Value, BytesView,
 	return *leaf_;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool IsConst>
-typename radix_tree<Key, Value, BytesView,
-		    MtMode>::template radix_tree_iterator<IsConst>::pointer
-	radix_tree<Key, Value, BytesView,
-		   MtMode>::radix_tree_iterator<IsConst>::operator->() const
+typename radix_tree<
+	Key, Value, BytesView, MtMode,
+	VolatileNodes>::template radix_tree_iterator<IsConst>::pointer
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::radix_tree_iterator<IsConst>::operator->() const
 {
 	assert(leaf_);
 	assert(tree);
@@ -3084,11 +3724,12 @@ typename radix_tree<Key, Value, BytesView,
  *
  * @param[in] rhs value of type basic_string_view
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool IsConst>
 template <typename V, typename Enable>
 void
-radix_tree<Key, Value, BytesView, MtMode>::radix_tree_iterator<
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::radix_tree_iterator<
 	IsConst>::assign_val(basic_string_view<typename V::value_type,
 					       typename V::traits_type>
 				     rhs)
@@ -3105,12 +3746,13 @@ radix_tree<Key, Value, BytesView, MtMode>::radix_tree_iterator<
 	}
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool IsConst>
 template <typename T>
 void
-radix_tree<Key, Value, BytesView,
-	   MtMode>::radix_tree_iterator<IsConst>::replace_val(T &&rhs)
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::radix_tree_iterator<IsConst>::replace_val(T &&rhs)
 {
 	auto pop = pool_base(pmemobj_pool_by_ptr(leaf_));
 	atomic_pointer_type *slot;
@@ -3126,10 +3768,13 @@ radix_tree<Key, Value, BytesView,
 	auto old_leaf = leaf_;
 
 	flat_transaction::run(pop, [&] {
+		tree->invalidate_nodes_on_abort();
+
 		store(*slot,
 		      leaf::make_key_args(load(old_leaf->parent),
 					  old_leaf->key(),
 					  std::forward<T>(rhs)));
+		tree->directory_replace(old_leaf, get_leaf(load(*slot)));
 		tree->free(persistent_ptr<radix_tree::leaf>(old_leaf));
 	});
 
@@ -3143,12 +3788,13 @@ radix_tree<Key, Value, BytesView,
  *
  * @param[in] rhs value of type basic_string_view
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool IsConst>
 template <typename T, typename V, typename Enable>
 void
-radix_tree<Key, Value, BytesView,
-	   MtMode>::radix_tree_iterator<IsConst>::assign_val(T &&rhs)
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::radix_tree_iterator<IsConst>::assign_val(T &&rhs)
 {
 	if (MtMode && tree->ebr_ != nullptr)
 		replace_val(std::forward<T>(rhs));
@@ -3159,12 +3805,13 @@ radix_tree<Key, Value, BytesView,
 	}
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool IsConst>
-typename radix_tree<Key, Value, BytesView,
-		    MtMode>::template radix_tree_iterator<IsConst> &
-radix_tree<Key, Value, BytesView,
-	   MtMode>::radix_tree_iterator<IsConst>::operator++()
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::template radix_tree_iterator<IsConst> &
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::radix_tree_iterator<IsConst>::operator++()
 {
 	/* Fallback to top-down search. */
 	if (!try_increment())
@@ -3177,11 +3824,12 @@ radix_tree<Key, Value, BytesView,
  * Tries to increment iterator. Returns true on success, false otherwise.
  * Increment can fail in case of concurrent, conflicting operation.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool IsConst>
 bool
-radix_tree<Key, Value, BytesView,
-	   MtMode>::radix_tree_iterator<IsConst>::try_increment()
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::radix_tree_iterator<IsConst>::try_increment()
 {
 	assert(leaf_);
 	assert(tree);
@@ -3215,13 +3863,14 @@ radix_tree<Key, Value, BytesView,
  * XXX: it's not enabled in MtMode due to:
  * https://github.com/pmem/libpmemobj-cpp/issues/1159
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool IsConst>
 template <bool Mt, typename Enable>
-typename radix_tree<Key, Value, BytesView,
-		    MtMode>::template radix_tree_iterator<IsConst> &
-radix_tree<Key, Value, BytesView,
-	   MtMode>::radix_tree_iterator<IsConst>::operator--()
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::template radix_tree_iterator<IsConst> &
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::radix_tree_iterator<IsConst>::operator--()
 {
 	while (!try_decrement()) {
 		*this = tree->lower_bound(leaf_->key());
@@ -3234,11 +3883,12 @@ radix_tree<Key, Value, BytesView,
  * Tries to decrement iterator. Returns true on success, false otherwise.
  * Decrement can fail in case of concurrent, conflicting operation.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool IsConst>
 bool
-radix_tree<Key, Value, BytesView,
-	   MtMode>::radix_tree_iterator<IsConst>::try_decrement()
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::radix_tree_iterator<IsConst>::try_decrement()
 {
 	constexpr auto direction = radix_tree::node::direction::Reverse;
 	assert(tree);
@@ -3246,6 +3896,7 @@ radix_tree<Key, Value, BytesView,
 	while (true) {
 		if (!leaf_) {
 			/* this == end() */
+			tree->check_nodes();
 			auto r = load(tree->root);
 
 			/* Iterator must be decrementable. */
@@ -3280,12 +3931,13 @@ radix_tree<Key, Value, BytesView,
 	}
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool IsConst>
-typename radix_tree<Key, Value, BytesView,
-		    MtMode>::template radix_tree_iterator<IsConst>
-radix_tree<Key, Value, BytesView,
-	   MtMode>::radix_tree_iterator<IsConst>::operator++(int)
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::template radix_tree_iterator<IsConst>
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::radix_tree_iterator<IsConst>::operator++(int)
 {
 	auto tmp = *this;
 
@@ -3300,13 +3952,14 @@ radix_tree<Key, Value, BytesView,
  * XXX: it's not enabled in MtMode due to:
  * https://github.com/pmem/libpmemobj-cpp/issues/1159
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool IsConst>
 template <bool Mt, typename Enable>
-typename radix_tree<Key, Value, BytesView,
-		    MtMode>::template radix_tree_iterator<IsConst>
-radix_tree<Key, Value, BytesView,
-	   MtMode>::radix_tree_iterator<IsConst>::operator--(int)
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::template radix_tree_iterator<IsConst>
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::radix_tree_iterator<IsConst>::operator--(int)
 {
 	auto tmp = *this;
 
@@ -3315,21 +3968,23 @@ radix_tree<Key, Value, BytesView,
 	return tmp;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool IsConst>
 template <bool C>
 bool
-radix_tree<Key, Value, BytesView, MtMode>::radix_tree_iterator<
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::radix_tree_iterator<
 	IsConst>::operator!=(const radix_tree_iterator<C> &rhs) const
 {
 	return leaf_ != rhs.leaf_;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool IsConst>
 template <bool C>
 bool
-radix_tree<Key, Value, BytesView, MtMode>::radix_tree_iterator<
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::radix_tree_iterator<
 	IsConst>::operator==(const radix_tree_iterator<C> &rhs) const
 {
 	return !(*this != rhs);
@@ -3344,12 +3999,14 @@ radix_tree<Key, Value, BytesView, MtMode>::radix_tree_iterator<
  * Bool variable is set to true on success, false otherwise.
  * Failure can occur in case of a concurrent, conflicting operation.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool Direction, typename Iterator>
 std::pair<bool,
-	  const typename radix_tree<Key, Value, BytesView, MtMode>::leaf *>
-radix_tree<Key, Value, BytesView, MtMode>::next_leaf(Iterator node,
-						     pointer_type parent) const
+	  const typename radix_tree<Key, Value, BytesView, MtMode,
+				    VolatileNodes>::leaf *>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::next_leaf(
+	Iterator node, pointer_type parent) const
 {
 	while (true) {
 		++node;
@@ -3388,12 +4045,13 @@ radix_tree<Key, Value, BytesView, MtMode>::next_leaf(Iterator node,
  * Return value is null only if there was some concurrent, conflicting
  * operation.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <bool Direction>
-const typename radix_tree<Key, Value, BytesView, MtMode>::leaf *
-radix_tree<Key, Value, BytesView, MtMode>::find_leaf(
-	typename radix_tree<Key, Value, BytesView, MtMode>::pointer_type n)
-	const
+const typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf *
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::find_leaf(
+	typename radix_tree<Key, Value, BytesView, MtMode,
+			    VolatileNodes>::pointer_type n) const
 {
 	assert(n);
 
@@ -3412,32 +4070,36 @@ radix_tree<Key, Value, BytesView, MtMode>::find_leaf(
 	return nullptr;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 Key &
-radix_tree<Key, Value, BytesView, MtMode>::leaf::key()
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf::key()
 {
 	auto &const_key = const_cast<const leaf *>(this)->key();
 	return *const_cast<Key *>(&const_key);
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 Value &
-radix_tree<Key, Value, BytesView, MtMode>::leaf::value()
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf::value()
 {
 	auto &const_value = const_cast<const leaf *>(this)->value();
 	return *const_cast<Value *>(&const_value);
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 const Key &
-radix_tree<Key, Value, BytesView, MtMode>::leaf::key() const
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf::key() const
 {
 	return *reinterpret_cast<const Key *>(this + 1);
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 const Value &
-radix_tree<Key, Value, BytesView, MtMode>::leaf::value() const
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf::value() const
 {
 	auto key_dst = reinterpret_cast<const char *>(this + 1);
 	auto key_size = total_sizeof<Key>::value(key());
@@ -3448,16 +4110,20 @@ radix_tree<Key, Value, BytesView, MtMode>::leaf::value() const
 	return *val_dst;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-radix_tree<Key, Value, BytesView, MtMode>::leaf::~leaf()
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf::~leaf()
 {
 	detail::destroy<Key>(key());
 	detail::destroy<Value>(value());
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-persistent_ptr<typename radix_tree<Key, Value, BytesView, MtMode>::leaf>
-radix_tree<Key, Value, BytesView, MtMode>::leaf::make(pointer_type parent)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+persistent_ptr<
+	typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf::make(
+	pointer_type parent)
 {
 	auto t = std::make_tuple();
 	return make(parent, std::piecewise_construct, t, t,
@@ -3465,10 +4131,12 @@ radix_tree<Key, Value, BytesView, MtMode>::leaf::make(pointer_type parent)
 		    detail::index_sequence_for<>{});
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename... Args1, typename... Args2>
-persistent_ptr<typename radix_tree<Key, Value, BytesView, MtMode>::leaf>
-radix_tree<Key, Value, BytesView, MtMode>::leaf::make(
+persistent_ptr<
+	typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf::make(
 	pointer_type parent, std::piecewise_construct_t pc,
 	std::tuple<Args1...> first_args, std::tuple<Args2...> second_args)
 {
@@ -3477,31 +4145,36 @@ radix_tree<Key, Value, BytesView, MtMode>::leaf::make(
 		    detail::index_sequence_for<Args2...>{});
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-persistent_ptr<typename radix_tree<Key, Value, BytesView, MtMode>::leaf>
-radix_tree<Key, Value, BytesView, MtMode>::leaf::make(pointer_type parent,
-						      const Key &k,
-						      const Value &v)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+persistent_ptr<
+	typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf::make(
+	pointer_type parent, const Key &k, const Value &v)
 {
 	return make(parent, std::piecewise_construct, std::forward_as_tuple(k),
 		    std::forward_as_tuple(v));
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K, typename V>
-persistent_ptr<typename radix_tree<Key, Value, BytesView, MtMode>::leaf>
-radix_tree<Key, Value, BytesView, MtMode>::leaf::make(pointer_type parent,
-						      K &&k, V &&v)
+persistent_ptr<
+	typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf::make(
+	pointer_type parent, K &&k, V &&v)
 {
 	return make(parent, std::piecewise_construct,
 		    std::forward_as_tuple(std::forward<K>(k)),
 		    std::forward_as_tuple(std::forward<V>(v)));
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K, typename... Args>
-persistent_ptr<typename radix_tree<Key, Value, BytesView, MtMode>::leaf>
-radix_tree<Key, Value, BytesView, MtMode>::leaf::make_key_args(
+persistent_ptr<
+	typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf::make_key_args(
 	pointer_type parent, K &&k, Args &&... args)
 {
 	return make(parent, std::piecewise_construct,
@@ -3509,21 +4182,25 @@ radix_tree<Key, Value, BytesView, MtMode>::leaf::make_key_args(
 		    std::forward_as_tuple(std::forward<Args>(args)...));
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K, typename V>
-persistent_ptr<typename radix_tree<Key, Value, BytesView, MtMode>::leaf>
-radix_tree<Key, Value, BytesView, MtMode>::leaf::make(pointer_type parent,
-						      detail::pair<K, V> &&p)
+persistent_ptr<
+	typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf::make(
+	pointer_type parent, detail::pair<K, V> &&p)
 {
 	return make(parent, std::piecewise_construct,
 		    std::forward_as_tuple(std::move(p.first)),
 		    std::forward_as_tuple(std::move(p.second)));
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K, typename V>
-persistent_ptr<typename radix_tree<Key, Value, BytesView, MtMode>::leaf>
-radix_tree<Key, Value, BytesView, MtMode>::leaf::make(
+persistent_ptr<
+	typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf::make(
 	pointer_type parent, const detail::pair<K, V> &p)
 {
 	return make(parent, std::piecewise_construct,
@@ -3531,32 +4208,38 @@ radix_tree<Key, Value, BytesView, MtMode>::leaf::make(
 		    std::forward_as_tuple(p.second));
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K, typename V>
-persistent_ptr<typename radix_tree<Key, Value, BytesView, MtMode>::leaf>
-radix_tree<Key, Value, BytesView, MtMode>::leaf::make(pointer_type parent,
-						      std::pair<K, V> &&p)
+persistent_ptr<
+	typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf::make(
+	pointer_type parent, std::pair<K, V> &&p)
 {
 	return make(parent, std::piecewise_construct,
 		    std::forward_as_tuple(std::move(p.first)),
 		    std::forward_as_tuple(std::move(p.second)));
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename K, typename V>
-persistent_ptr<typename radix_tree<Key, Value, BytesView, MtMode>::leaf>
-radix_tree<Key, Value, BytesView, MtMode>::leaf::make(pointer_type parent,
-						      const std::pair<K, V> &p)
+persistent_ptr<
+	typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf::make(
+	pointer_type parent, const std::pair<K, V> &p)
 {
 	return make(parent, std::piecewise_construct,
 		    std::forward_as_tuple(p.first),
 		    std::forward_as_tuple(p.second));
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 template <typename... Args1, typename... Args2, size_t... I1, size_t... I2>
-persistent_ptr<typename radix_tree<Key, Value, BytesView, MtMode>::leaf>
-radix_tree<Key, Value, BytesView, MtMode>::leaf::make(
+persistent_ptr<
+	typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf::make(
 	pointer_type parent, std::piecewise_construct_t,
 	std::tuple<Args1...> &first_args, std::tuple<Args2...> &second_args,
 	detail::index_sequence<I1...>, detail::index_sequence<I2...>)
@@ -3585,10 +4268,12 @@ radix_tree<Key, Value, BytesView, MtMode>::leaf::make(
 	return ptr;
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-persistent_ptr<typename radix_tree<Key, Value, BytesView, MtMode>::leaf>
-radix_tree<Key, Value, BytesView, MtMode>::leaf::make(pointer_type parent,
-						      const leaf &other)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+persistent_ptr<
+	typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf>
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf::make(
+	pointer_type parent, const leaf &other)
 {
 	return make(parent, other.key(), other.value());
 }
@@ -3599,9 +4284,10 @@ radix_tree<Key, Value, BytesView, MtMode>::leaf::make(pointer_type parent,
  *
  * @throw pool_error if radix tree doesn't reside on pmem.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 void
-radix_tree<Key, Value, BytesView, MtMode>::check_pmem()
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::check_pmem()
 {
 	if (nullptr == pmemobj_pool_by_ptr(this))
 		throw pmem::pool_error("Invalid pool handle.");
@@ -3614,35 +4300,355 @@ radix_tree<Key, Value, BytesView, MtMode>::check_pmem()
  * @throw pmem::transaction_scope_error if current transaction stage is not
  * equal to TX_STAGE_WORK.
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 void
-radix_tree<Key, Value, BytesView, MtMode>::check_tx_stage_work()
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::check_tx_stage_work()
 {
 	if (pmemobj_tx_stage() != TX_STAGE_WORK)
 		throw pmem::transaction_scope_error(
 			"Function called out of transaction scope.");
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+/*
+ * Allocates a new internal node, in DRAM if VolatileNodes == true.
+ */
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::pointer_type
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::make_node(
+	volatile_nodes *nodes, pointer_type parent, byten_t byte, bitn_t bit)
+{
+	if (VolatileNodes)
+		return pointer_type(nodes->allocate(parent, byte, bit));
+
+	return make_persistent<radix_tree::node>(parent, byte, bit);
+}
+
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+void
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::free_node(
+	volatile_nodes *nodes, pointer_type n)
+{
+	if (!VolatileNodes)
+		free(persistent_ptr<radix_tree::node>(get_node(n)));
+	else if (nodes)
+		nodes->deallocate(get_node(n));
+}
+
+/*
+ * Returns volatile nodes of the tree or nullptr if they were not created
+ * yet (or VolatileNodes == false).
+ */
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode,
+		    VolatileNodes>::volatile_nodes *
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::get_volatile_nodes()
+	const
+{
+	if (!VolatileNodes)
+		return nullptr;
+
+	return pmem::detail::volatile_state::get_if_exists<volatile_nodes>(
+		pmemobj_oid(this));
+}
+
+/*
+ * Returns volatile nodes of the tree, rebuilds them if they are not valid.
+ *
+ * @throw pmem::transaction_scope_error if the nodes were not created yet
+ * and this function is called in a transaction.
+ */
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+template <bool Vn>
+typename std::enable_if<
+	Vn,
+	typename radix_tree<Key, Value, BytesView, MtMode,
+			    VolatileNodes>::volatile_nodes *>::type
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::check_nodes() const
+{
+	auto nodes = pmem::detail::volatile_state::get<volatile_nodes>(
+		pmemobj_oid(this));
+
+	if (!nodes->valid) {
+		std::lock_guard<std::mutex> lock(nodes->mutex);
+		if (!nodes->valid)
+			rebuild_nodes(*nodes, 1);
+	}
+
+	return nodes;
+}
+
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+template <bool Vn>
+typename std::enable_if<
+	!Vn,
+	typename radix_tree<Key, Value, BytesView, MtMode,
+			    VolatileNodes>::volatile_nodes *>::type
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::check_nodes() const
+{
+	return nullptr;
+}
+
+/*
+ * Rebuilds volatile nodes from the leaf directory: sorts the leaves, finds
+ * the position at which each pair of neighbours differs and creates nodes
+ * for these positions from left to right, keeping the rightmost path of the
+ * tree on a stack. Reading and sorting the leaves and computing the
+ * positions is split between concurrency threads.
+ */
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+void
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::rebuild_nodes(
+	volatile_nodes &nodes, size_t concurrency) const
+{
+	/* leaf with first 8 bytes of its key, used to speed up sorting */
+	struct entry {
+		uint64_t prefix;
+		leaf *leaf_;
+	};
+
+	/* position at which keys of neighbouring leaves differ */
+	struct split {
+		byten_t byte;
+		bitn_t bit;
+		/* left key is a prefix of the right one */
+		bool prefix;
+		unsigned left_slice;
+		unsigned right_slice;
+	};
+
+	nodes.valid = false;
+	nodes.reset();
+
+	auto &tree_root = const_cast<atomic_pointer_type &>(root);
+	auto n = this->directory_size();
+	if (n == 0) {
+		store(tree_root, nullptr);
+		nodes.valid = true;
+		return;
+	}
+
+	std::vector<entry> entries(n);
+	pmem::detail::parallel_for(
+		concurrency, n, [&](size_t first, size_t last) {
+			for (size_t i = first; i < last; ++i) {
+				auto l = this->template directory_at<leaf>(i);
+				auto key = bytes_view(l->key());
+
+				uint64_t prefix = 0;
+				for (size_t j = 0; j < sizeof(prefix); ++j) {
+					prefix <<= 8;
+					if (j < key.size())
+						prefix |= static_cast<
+							unsigned char>(key[j]);
+				}
+
+				entries[i] = {prefix, l};
+			}
+		});
+
+	auto less = [](const entry &lhs, const entry &rhs) {
+		if (lhs.prefix != rhs.prefix)
+			return lhs.prefix < rhs.prefix;
+
+		return compare(bytes_view(lhs.leaf_->key()),
+			       bytes_view(rhs.leaf_->key())) < 0;
+	};
+
+	/* sort parts of the array in parallel and merge them pairwise */
+	auto parts = (std::max)(size_t(1), (std::min)(concurrency, n));
+	std::vector<size_t> bounds(parts + 1);
+	for (size_t i = 0; i <= parts; ++i)
+		bounds[i] = n * i / parts;
+
+	auto data = entries.data();
+	pmem::detail::parallel_for(
+		parts, parts, [&](size_t first, size_t last) {
+			for (size_t i = first; i < last; ++i)
+				std::sort(data + bounds[i],
+					  data + bounds[i + 1], less);
+		});
+
+	for (size_t width = 1; width < parts; width *= 2) {
+		auto merges = (parts + 2 * width - 1) / (2 * width);
+		pmem::detail::parallel_for(
+			merges, merges, [&](size_t first, size_t last) {
+				for (size_t i = first; i < last; ++i) {
+					auto begin = 2 * width * i;
+					auto middle = begin + width;
+					auto end = (std::min)(middle + width,
+							      parts);
+					if (middle >= parts)
+						continue;
+
+					std::inplace_merge(
+						data + bounds[begin],
+						data + bounds[middle],
+						data + bounds[end], less);
+				}
+			});
+	}
+
+	/* splits[i] is the position at which keys i - 1 and i differ */
+	std::vector<split> splits(n);
+	pmem::detail::parallel_for(
+		concurrency, n - 1, [&](size_t first, size_t last) {
+			for (size_t i = first + 1; i <= last; ++i) {
+				auto left =
+					bytes_view(entries[i - 1].leaf_->key());
+				auto right =
+					bytes_view(entries[i].leaf_->key());
+				auto diff = prefix_diff(left, right);
+
+				assert(diff < right.size());
+
+				auto &s = splits[i];
+				s.byte = diff;
+				s.prefix = diff == left.size();
+				s.bit = s.prefix ? bitn_t(FIRST_NIB)
+						 : bit_diff(left, right, diff);
+				s.left_slice = s.prefix
+					? 0
+					: slice_index(left[diff], s.bit);
+				s.right_slice = slice_index(right[diff], s.bit);
+			}
+		});
+
+	/* node on the rightmost path and the slot which points to it */
+	struct frame {
+		node *n;
+		atomic_pointer_type *slot;
+	};
+
+	std::vector<frame> stack;
+	std::vector<node *> parents(n, nullptr);
+
+	atomic_pointer_type top(entries[0].leaf_);
+	atomic_pointer_type *leaf_slot = &top;
+
+	for (size_t i = 1; i < n; ++i) {
+		auto &s = splits[i];
+
+		/* subtree which ends with leaf i - 1 and lies below split i */
+		atomic_pointer_type *right_slot = leaf_slot;
+		node *right_node = nullptr;
+		while (!stack.empty() &&
+		       (stack.back().n->byte > s.byte ||
+			(stack.back().n->byte == s.byte &&
+			 stack.back().n->bit < s.bit))) {
+			right_slot = stack.back().slot;
+			right_node = stack.back().n;
+			stack.pop_back();
+		}
+
+		node *parent;
+		if (!stack.empty() && stack.back().n->byte == s.byte &&
+		    stack.back().n->bit == s.bit) {
+			parent = stack.back().n;
+		} else {
+			parent = nodes.allocate(
+				stack.empty() ? pointer_type(nullptr)
+					      : pointer_type(stack.back().n),
+				s.byte, s.bit);
+
+			auto right = load(*right_slot);
+			if (s.prefix) {
+				assert(!right_node);
+				store(parent->embedded_entry, right);
+			} else {
+				store(parent->child[s.left_slice], right);
+			}
+
+			if (right_node)
+				store(right_node->parent, pointer_type(parent));
+			else
+				parents[i - 1] = parent;
+
+			store(*right_slot, pointer_type(parent));
+			stack.push_back({parent, right_slot});
+		}
+
+		leaf_slot = &parent->child[s.right_slice];
+		store(*leaf_slot, pointer_type(entries[i].leaf_));
+		parents[i] = parent;
+	}
+
+	store(tree_root, load(top));
+
+	pmem::detail::parallel_for(
+		concurrency, n, [&](size_t first, size_t last) {
+			for (size_t i = first; i < last; ++i)
+				store(entries[i].leaf_->parent,
+				      pointer_type(parents[i]));
+		});
+
+	nodes.valid = true;
+}
+
+/*
+ * Marks volatile nodes (if they exist) as not valid, so that they are
+ * rebuilt by the next operation.
+ */
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+void
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::invalidate_nodes()
+	const
+{
+	auto nodes = get_volatile_nodes();
+	if (nodes)
+		nodes->valid = false;
+}
+
+/*
+ * Stores to volatile nodes (and to pointers to them) are not snapshotted,
+ * so the nodes must be rebuilt if the current transaction aborts.
+ */
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+void
+radix_tree<Key, Value, BytesView, MtMode,
+	   VolatileNodes>::invalidate_nodes_on_abort() const
+{
+	if (!VolatileNodes || pmemobj_tx_stage() != TX_STAGE_WORK)
+		return;
+
+	flat_transaction::register_callback(flat_transaction::stage::onabort,
+					    [this] { invalidate_nodes(); });
+}
+
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 bool
-radix_tree<Key, Value, BytesView, MtMode>::is_leaf(
-	const radix_tree<Key, Value, BytesView, MtMode>::pointer_type &p)
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::is_leaf(
+	const radix_tree<Key, Value, BytesView, MtMode,
+			 VolatileNodes>::pointer_type &p)
 {
 	return p.template is<leaf>();
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::leaf *
-radix_tree<Key, Value, BytesView, MtMode>::get_leaf(
-	const radix_tree<Key, Value, BytesView, MtMode>::pointer_type &p)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::leaf *
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::get_leaf(
+	const radix_tree<Key, Value, BytesView, MtMode,
+			 VolatileNodes>::pointer_type &p)
 {
 	return p.template get<leaf>();
 }
 
-template <typename Key, typename Value, typename BytesView, bool MtMode>
-typename radix_tree<Key, Value, BytesView, MtMode>::node *
-radix_tree<Key, Value, BytesView, MtMode>::get_node(
-	const radix_tree<Key, Value, BytesView, MtMode>::pointer_type &p)
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
+typename radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::node *
+radix_tree<Key, Value, BytesView, MtMode, VolatileNodes>::get_node(
+	const radix_tree<Key, Value, BytesView, MtMode,
+			 VolatileNodes>::pointer_type &p)
 {
 	return p.template get<node>();
 }
@@ -3651,10 +4657,11 @@ radix_tree<Key, Value, BytesView, MtMode>::get_node(
  * Non-member swap.
  * @relates radix_tree
  */
-template <typename Key, typename Value, typename BytesView, bool MtMode>
+template <typename Key, typename Value, typename BytesView, bool MtMode,
+	  bool VolatileNodes>
 void
-swap(radix_tree<Key, Value, BytesView, MtMode> &lhs,
-     radix_tree<Key, Value, BytesView, MtMode> &rhs)
+swap(radix_tree<Key, Value, BytesView, MtMode, VolatileNodes> &lhs,
+     radix_tree<Key, Value, BytesView, MtMode, VolatileNodes> &rhs)
 {
 	lhs.swap(rhs);
 }
@@ -3665,12 +4672,13 @@ template <typename>
 struct is_string : std::false_type {
 };
 
-template <typename CharT, typename Traits>
-struct is_string<obj::basic_string<CharT, Traits>> : std::true_type {
+template <typename CharT, typename Traits, std::size_t InlineBytes>
+struct is_string<obj::basic_string<CharT, Traits, InlineBytes>>
+    : std::true_type {
 };
 
-template <typename CharT, typename Traits>
-struct is_string<obj::experimental::basic_inline_string<CharT, Traits>>
+template <typename CharT, typename Traits, typename SizeT>
+struct is_string<obj::experimental::basic_inline_string<CharT, Traits, SizeT>>
     : std::true_type {
 };
 
@@ -0,0 +1,525 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/**
+ * @file
+ * Persistent self-relative smart pointer with 32-bit offset.
+ */
+
+#ifndef LIBPMEMOBJ_CPP_SELF_RELATIVE_PTR32_HPP
+#define LIBPMEMOBJ_CPP_SELF_RELATIVE_PTR32_HPP
+
+#include <libpmemobj++/detail/self_relative_ptr_base_impl.hpp>
+#include <libpmemobj++/detail/specialization.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+
+#include <cstdint>
+#include <type_traits>
+
+namespace pmem
+{
+namespace obj
+{
+namespace experimental
+{
+
+/**
+ * self_relative_ptr32 base (non-template) class
+ *
+ * Equivalent of self_relative_ptr_base which stores the offset as int32_t.
+ */
+using self_relative_ptr32_base =
+	pmem::detail::self_relative_ptr_base_impl<int32_t>;
+
+/**
+ * Persistent self-relative pointer class with 32-bit offset.
+ *
+ * self_relative_ptr32 works like self_relative_ptr, but takes only 4 bytes
+ * (self_relative_ptr takes 8 and persistent_ptr 16 bytes), which makes it
+ * suitable for pointer-heavy persistent structures, e.g. list or tree nodes.
+ *
+ * The price is the range: the pointed-to object has to lie within
+ * [-2^31, 2^31) bytes from the pointer itself. In practice it means that
+ * self_relative_ptr32 should only be a member of objects which are allocated
+ * in the same pool as the objects it points to. It cannot be kept on the
+ * stack or in the DRAM (except for nullptr) - use get() to obtain a raw
+ * pointer instead of copying self_relative_ptr32 to a local variable.
+ * Constructors and assignments throw std::out_of_range if the pointed-to
+ * object is out of range.
+ *
+ * For the same reason, operations which would have to return
+ * self_relative_ptr32 by value (like postfix increment or operator+) are not
+ * provided.
+ *
+ * @includedoc shared/pointer_requirements.txt
+ *
+ * @includedoc shared/self_relative_pointer_implementation.txt
+ * @ingroup primitives
+ */
+template <typename T>
+class self_relative_ptr32 : public self_relative_ptr32_base {
+public:
+	using base_type = self_relative_ptr32_base;
+	using this_type = self_relative_ptr32;
+	using element_type = typename pmem::detail::sp_element<T>::type;
+	using difference_type = typename base_type::difference_type;
+	using value_type = T;
+	using reference = T &;
+
+	/**
+	 * Default constructor, equal the nullptr
+	 */
+	constexpr self_relative_ptr32() noexcept = default;
+
+	/**
+	 * Nullptr constructor
+	 */
+	constexpr self_relative_ptr32(std::nullptr_t) noexcept
+	    : self_relative_ptr32_base()
+	{
+	}
+
+	/**
+	 * Volatile pointer constructor.
+	 *
+	 * @param ptr volatile pointer, pointing to persistent memory.
+	 *
+	 * @throw std::out_of_range if ptr is more than 2 GiB away.
+	 */
+	self_relative_ptr32(element_type *ptr)
+	    : self_relative_ptr32_base(self_offset(ptr))
+	{
+	}
+
+	/**
+	 * Constructor from persistent_ptr<T>
+	 *
+	 * @throw std::out_of_range if ptr is more than 2 GiB away.
+	 */
+	self_relative_ptr32(persistent_ptr<T> ptr)
+	    : self_relative_ptr32_base(self_offset(ptr.get()))
+	{
+	}
+
+	/**
+	 * PMEMoid constructor.
+	 *
+	 * @param oid C-style persistent pointer
+	 *
+	 * @throw std::out_of_range if oid is more than 2 GiB away.
+	 */
+	self_relative_ptr32(PMEMoid oid)
+	    : self_relative_ptr32_base(self_offset(
+		      static_cast<element_type *>(pmemobj_direct(oid))))
+	{
+	}
+
+	/**
+	 * Copy constructor
+	 *
+	 * @throw std::out_of_range if the pointed-to object is more than
+	 * 2 GiB away from the copy.
+	 */
+	self_relative_ptr32(const self_relative_ptr32 &ptr)
+	    : self_relative_ptr32_base(ptr)
+	{
+	}
+
+	/**
+	 * Copy constructor from a different self_relative_ptr32<>.
+	 *
+	 * Available only for convertible, non-void types.
+	 *
+	 * @throw std::out_of_range if the pointed-to object is more than
+	 * 2 GiB away from the copy.
+	 */
+	template <
+		typename U,
+		typename = typename std::enable_if<
+			!std::is_same<
+				typename std::remove_cv<T>::type,
+				typename std::remove_cv<U>::type>::value &&
+				!std::is_void<U>::value,
+			decltype(static_cast<T *>(std::declval<U *>()))>::type>
+	self_relative_ptr32(self_relative_ptr32<U> const &r)
+	    : self_relative_ptr32_base(self_offset(static_cast<T *>(r.get())))
+	{
+	}
+
+	~self_relative_ptr32()
+	{
+		static_assert(!std::is_polymorphic<element_type>::value,
+			      "Polymorphic types are not supported");
+	}
+
+	/**
+	 * Get the direct pointer.
+	 *
+	 * @return the direct pointer to the object.
+	 */
+	inline element_type *
+	get() const noexcept
+	{
+		return static_cast<element_type *>(
+			self_relative_ptr32_base::to_void_pointer());
+	}
+
+	/**
+	 * Conversion to persitent ptr
+	 */
+	persistent_ptr<T>
+	to_persistent_ptr() const
+	{
+		return persistent_ptr<T>{this->get()};
+	}
+
+	/**
+	 * Bool conversion operator.
+	 */
+	explicit operator bool() const noexcept
+	{
+		return !is_null();
+	}
+
+	/**
+	 * Conversion operator to persistent_ptr
+	 */
+	operator persistent_ptr<T>() const
+	{
+		return to_persistent_ptr();
+	}
+
+	/**
+	 * Dereference operator.
+	 */
+	typename pmem::detail::sp_dereference<T>::type operator*() const
+		noexcept
+	{
+		return *(this->get());
+	}
+
+	/**
+	 * Member access operator.
+	 */
+	typename pmem::detail::sp_member_access<T>::type operator->() const
+		noexcept
+	{
+		return this->get();
+	}
+
+	/**
+	 * Array access operator.
+	 *
+	 * Contains run-time bounds checking for static arrays.
+	 */
+	template <typename = typename std::enable_if<!std::is_void<T>::value>>
+	typename pmem::detail::sp_array_access<T>::type
+	operator[](difference_type i) const noexcept
+	{
+		assert(i >= 0 &&
+		       (i < pmem::detail::sp_extent<T>::value ||
+			pmem::detail::sp_extent<T>::value == 0) &&
+		       "persistent array index out of bounds");
+
+		return this->get()[i];
+	}
+
+	/**
+	 * Assignment operator.
+	 *
+	 * Automatically registers itself in a transaction.
+	 *
+	 * @throw pmem::transaction_error when adding the object to the
+	 *	transaction failed.
+	 * @throw std::out_of_range if the pointed-to object is more than
+	 *	2 GiB away.
+	 */
+	self_relative_ptr32 &
+	operator=(const self_relative_ptr32 &r)
+	{
+		this->base_type::operator=(r);
+		return *this;
+	}
+
+	/**
+	 * Converting assignment operator from a different
+	 * self_relative_ptr32<>.
+	 *
+	 * Available only for convertible types. Automatically registers
+	 * itself in a transaction.
+	 *
+	 * @throw pmem::transaction_error when adding the object
+	 * to the transaction failed.
+	 * @throw std::out_of_range if the pointed-to object is more than
+	 * 2 GiB away.
+	 */
+	template <typename Y,
+		  typename = typename std::enable_if<
+			  std::is_convertible<Y *, T *>::value>::type>
+	self_relative_ptr32<T> &
+	operator=(self_relative_ptr32<Y> const &r)
+	{
+		return *this = static_cast<element_type *>(r.get());
+	}
+
+	/**
+	 * Assignment operator from a volatile pointer.
+	 *
+	 * Automatically registers itself in a transaction.
+	 *
+	 * @throw pmem::transaction_error when adding the object
+	 * to the transaction failed.
+	 * @throw std::out_of_range if ptr is more than 2 GiB away.
+	 */
+	self_relative_ptr32 &
+	operator=(element_type *ptr)
+	{
+		detail::conditional_add_to_tx(this);
+		this->offset = narrow_offset(self_offset(ptr));
+		return *this;
+	}
+
+	/**
+	 * Assignment operator from persistent_ptr<T>.
+	 *
+	 * Automatically registers itself in a transaction.
+	 *
+	 * @throw pmem::transaction_error when adding the object
+	 * to the transaction failed.
+	 * @throw std::out_of_range if ptr is more than 2 GiB away.
+	 */
+	self_relative_ptr32 &
+	operator=(const persistent_ptr<T> &ptr)
+	{
+		return *this = ptr.get();
+	}
+
+	/**
+	 * Nullptr move assignment operator.
+	 *
+	 * @throw pmem::transaction_error when adding the object to the
+	 *	transaction failed.
+	 */
+	self_relative_ptr32 &operator=(std::nullptr_t)
+	{
+		detail::conditional_add_to_tx(this);
+		this->offset = 0;
+		return *this;
+	}
+
+	/**
+	 * Prefix increment operator.
+	 */
+	inline self_relative_ptr32<T> &
+	operator++()
+	{
+		return *this += 1;
+	}
+
+	/**
+	 * Prefix decrement operator.
+	 */
+	inline self_relative_ptr32<T> &
+	operator--()
+	{
+		return *this -= 1;
+	}
+
+	/**
+	 * Addition assignment operator.
+	 */
+	inline self_relative_ptr32<T> &
+	operator+=(std::ptrdiff_t s)
+	{
+		detail::conditional_add_to_tx(this);
+		this->offset = narrow_offset(
+			this->offset +
+			s * static_cast<difference_type>(sizeof(T)));
+		return *this;
+	}
+
+	/**
+	 * Subtraction assignment operator.
+	 */
+	inline self_relative_ptr32<T> &
+	operator-=(std::ptrdiff_t s)
+	{
+		detail::conditional_add_to_tx(this);
+		this->offset = narrow_offset(
+			this->offset -
+			s * static_cast<difference_type>(sizeof(T)));
+		return *this;
+	}
+
+private:
+	difference_type
+	self_offset(element_type *ptr) const noexcept
+	{
+		return base_type::pointer_to_offset(static_cast<void *>(ptr));
+	}
+};
+
+/**
+ * Swaps two self_relative_ptr32 objects of the same type.
+ *
+ * @relates self_relative_ptr32
+ */
+template <class T>
+inline void
+swap(self_relative_ptr32<T> &a, self_relative_ptr32<T> &b)
+{
+	a.swap(b);
+}
+
+/**
+ * Equality operator.
+ * @relates self_relative_ptr32
+ */
+template <typename T, typename Y>
+inline bool
+operator==(self_relative_ptr32<T> const &lhs,
+	   self_relative_ptr32<Y> const &rhs) noexcept
+{
+	return lhs.to_byte_pointer() == rhs.to_byte_pointer();
+}
+
+/**
+ * Inequality operator.
+ * @relates self_relative_ptr32
+ */
+template <typename T, typename Y>
+inline bool
+operator!=(self_relative_ptr32<T> const &lhs,
+	   self_relative_ptr32<Y> const &rhs) noexcept
+{
+	return !(lhs == rhs);
+}
+
+/**
+ * Equality operator with nullptr.
+ * @relates self_relative_ptr32
+ */
+template <typename T>
+inline bool
+operator==(self_relative_ptr32<T> const &lhs, std::nullptr_t) noexcept
+{
+	return lhs.is_null();
+}
+
+/**
+ * Equality operator with nullptr.
+ * @relates self_relative_ptr32
+ */
+template <typename T>
+inline bool
+operator==(std::nullptr_t, self_relative_ptr32<T> const &rhs) noexcept
+{
+	return rhs.is_null();
+}
+
+/**
+ * Inequality operator with nullptr.
+ * @relates self_relative_ptr32
+ */
+template <typename T>
+inline bool
+operator!=(self_relative_ptr32<T> const &lhs, std::nullptr_t) noexcept
+{
+	return !lhs.is_null();
+}
+
+/**
+ * Inequality operator with nullptr.
+ * @relates self_relative_ptr32
+ */
+template <typename T>
+inline bool
+operator!=(std::nullptr_t, self_relative_ptr32<T> const &rhs) noexcept
+{
+	return !rhs.is_null();
+}
+
+/**
+ * Less than operator.
+ * @relates self_relative_ptr32
+ */
+template <typename T, typename Y>
+inline bool
+operator<(self_relative_ptr32<T> const &lhs,
+	  self_relative_ptr32<Y> const &rhs) noexcept
+{
+	return lhs.to_byte_pointer() < rhs.to_byte_pointer();
+}
+
+/**
+ * Less or equal than operator.
+ * @relates self_relative_ptr32
+ */
+template <typename T, typename Y>
+inline bool
+operator<=(self_relative_ptr32<T> const &lhs,
+	   self_relative_ptr32<Y> const &rhs) noexcept
+{
+	return !(rhs < lhs);
+}
+
+/**
+ * Greater than operator.
+ * @relates self_relative_ptr32
+ */
+template <typename T, typename Y>
+inline bool
+operator>(self_relative_ptr32<T> const &lhs,
+	  self_relative_ptr32<Y> const &rhs) noexcept
+{
+	return (rhs < lhs);
+}
+
+/**
+ * Greater or equal than operator.
+ * @relates self_relative_ptr32
+ */
+template <typename T, typename Y>
+inline bool
+operator>=(self_relative_ptr32<T> const &lhs,
+	   self_relative_ptr32<Y> const &rhs) noexcept
+{
+	return !(lhs < rhs);
+}
+
+/**
+ * Subtraction operator for self-relative pointers of identical type.
+ *
+ * Calculates the offset difference.
+ * @relates self_relative_ptr32
+ */
+template <typename T, typename Y,
+	  typename = typename std::enable_if<
+		  std::is_same<typename std::remove_cv<T>::type,
+			       typename std::remove_cv<Y>::type>::value>>
+inline ptrdiff_t
+operator-(self_relative_ptr32<T> const &lhs, self_relative_ptr32<Y> const &rhs)
+{
+	return self_relative_ptr32_base::distance_between(rhs, lhs) /
+		static_cast<ptrdiff_t>(sizeof(T));
+}
+
+/**
+ * Ostream operator
+ * @relates self_relative_ptr32
+ */
+template <typename T>
+std::ostream &
+operator<<(std::ostream &os, self_relative_ptr32<T> const &ptr)
+{
+	os << ptr.to_void_pointer();
+	return os;
+}
+
+} /* namespace experimental */
+
+} /* namespace obj */
+
+} /* namespace pmem */
+
+#endif /* LIBPMEMOBJ_CPP_SELF_RELATIVE_PTR32_HPP */
@@ -22,6 +22,7 @@
 #include <libpmemobj++/detail/common.hpp>
 #include <libpmemobj++/detail/ctl.hpp>
 #include <libpmemobj++/detail/pool_data.hpp>
+#include <libpmemobj++/detail/pool_lookup_cache.hpp>
 #include <libpmemobj++/p.hpp>
 #include <libpmemobj++/persistent_ptr_base.hpp>
 #include <libpmemobj++/pexceptions.hpp>
@@ -266,6 +267,7 @@ public:
 
 		delete user_data;
 
+		detail::invalidate_pool_lookup_cache();
 		pmemobj_close(this->pop);
 		this->pop = nullptr;
 	}
@@ -1,11 +1,13 @@
 // SPDX-License-Identifier: BSD-3-Clause
-/* Copyright 2019-2020, Intel Corporation */
+/* Copyright 2019-2021, Intel Corporation */
 
 #include "helper_classes.hpp"
 #include "unittest.hpp"
 
 #include <algorithm>
 #include <iterator>
+#include <list>
+#include <vector>
 
 #include <libpmemobj++/container/array.hpp>
 #include <libpmemobj++/container/string.hpp>
@@ -16,6 +18,7 @@
 using array_type = pmem::obj::array<double, 5>;
 using array_move_type = pmem::obj::array<move_only, 5>;
 using array_str = pmem::obj::array<pmem::obj::string, 10>;
+using array_bulk = pmem::obj::array<int, 1024>;
 
 struct root {
 	pmem::obj::persistent_ptr<array_type> ptr_a;
@@ -24,6 +27,7 @@ struct root {
 	pmem::obj::persistent_ptr<array_move_type> ptr_c;
 	pmem::obj::persistent_ptr<array_move_type> ptr_d;
 	pmem::obj::persistent_ptr<array_str> ptr_str;
+	pmem::obj::persistent_ptr<array_bulk> ptr_bulk;
 };
 
 void
@@ -252,6 +256,108 @@ test_snapshotting(pmem::obj::pool<struct root> &pop, bool do_abort)
 	}
 }
 
+void
+test_bulk_modifiers(pmem::obj::pool<struct root> &pop)
+{
+	auto r = pop.root();
+
+	try {
+		pmem::obj::transaction::run(pop, [&] {
+			r->ptr_bulk = pmem::obj::make_persistent<array_bulk>();
+		});
+	} catch (std::exception &e) {
+		UT_FATALexc(e);
+	}
+
+	auto &a = *r->ptr_bulk;
+
+	a.fill(0);
+	a.fill_range(100, 200, 7);
+	for (size_t i = 0; i < a.size(); i++)
+		UT_ASSERTeq(a.cdata()[i], (i >= 100 && i < 300) ? 7 : 0);
+
+	std::vector<int> src(a.size());
+	for (size_t i = 0; i < src.size(); i++)
+		src[i] = static_cast<int>(i);
+
+	a.copy_from(512, src.data(), 512);
+	for (size_t i = 512; i < a.size(); i++)
+		UT_ASSERTeq(a.cdata()[i], static_cast<int>(i - 512));
+
+	a.copy_from(0,
+		    pmem::obj::slice<const int *>(src.data(), src.data() + 10));
+	for (size_t i = 0; i < 10; i++)
+		UT_ASSERTeq(a.cdata()[i], static_cast<int>(i));
+	UT_ASSERTeq(a.cdata()[10], 0);
+
+	std::list<int> l(20, 3);
+	a.assign(l.begin(), l.end());
+	for (size_t i = 0; i < 20; i++)
+		UT_ASSERTeq(a.cdata()[i], 3);
+	UT_ASSERTeq(a.cdata()[20], 0);
+
+	a.assign(src.begin(), src.end());
+	UT_ASSERT(std::equal(a.cbegin(), a.cend(), src.begin()));
+
+	/* changes made by bulk modifiers are rolled back on abort */
+	try {
+		pmem::obj::transaction::run(pop, [&] {
+			a.fill_range(0, a.size(), -1);
+			a.copy_from(10, src.data(), 10);
+			a.assign(l.begin(), l.end());
+			pmem::obj::transaction::abort(0);
+		});
+		UT_ASSERT(0);
+	} catch (pmem::manual_tx_abort &) {
+	} catch (std::exception &e) {
+		UT_FATALexc(e);
+	}
+	UT_ASSERT(std::equal(a.cbegin(), a.cend(), src.begin()));
+
+	try {
+		a.fill_range(1000, 25, 1);
+		UT_ASSERT(0);
+	} catch (std::out_of_range &) {
+	} catch (std::exception &e) {
+		UT_FATALexc(e);
+	}
+
+	try {
+		a.copy_from(1, src.data(), src.size());
+		UT_ASSERT(0);
+	} catch (std::out_of_range &) {
+	} catch (std::exception &e) {
+		UT_FATALexc(e);
+	}
+
+	try {
+		std::vector<int> too_long(a.size() + 1);
+		a.assign(too_long.begin(), too_long.end());
+		UT_ASSERT(0);
+	} catch (std::out_of_range &) {
+	} catch (std::exception &e) {
+		UT_FATALexc(e);
+	}
+	UT_ASSERT(std::equal(a.cbegin(), a.cend(), src.begin()));
+
+	array_type stack_array;
+	try {
+		stack_array.fill_range(0, 1, 1.0);
+		UT_ASSERT(0);
+	} catch (pmem::pool_error &) {
+	} catch (std::exception &e) {
+		UT_FATALexc(e);
+	}
+
+	try {
+		pmem::obj::transaction::run(pop, [&] {
+			pmem::obj::delete_persistent<array_bulk>(r->ptr_bulk);
+		});
+	} catch (std::exception &e) {
+		UT_FATALexc(e);
+	}
+}
+
 static void
 test(int argc, char *argv[])
 {
@@ -267,6 +373,7 @@ test(int argc, char *argv[])
 	test_modifiers(pop);
 	test_snapshotting(pop, false);
 	test_snapshotting(pop, true);
+	test_bulk_modifiers(pop);
 
 	pop.close();
 }
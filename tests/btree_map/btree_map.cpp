@@ -0,0 +1,379 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * btree_map.cpp -- pmem::obj::experimental::btree_map tests, checks that the
+ * order, lookups and erase are the same as for std::map, also after leaf
+ * splits, concurrent inserts, aborted transactions and reopening the pool
+ */
+
+#include "thread_helpers.hpp"
+#include "unittest.hpp"
+
+#include <libpmemobj++/container/string.hpp>
+#include <libpmemobj++/experimental/btree_map.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#define LAYOUT "btree_map"
+
+namespace nvobj = pmem::obj;
+namespace nvobjex = pmem::obj::experimental;
+
+namespace
+{
+
+using int_map_type = nvobjex::btree_map<nvobj::p<int>, nvobj::p<int>>;
+
+struct string_less {
+	using is_transparent = void;
+
+	template <typename T1, typename T2>
+	bool
+	operator()(const T1 &lhs, const T2 &rhs) const
+	{
+		return nvobj::string_view(lhs).compare(
+			       nvobj::string_view(rhs)) < 0;
+	}
+};
+
+using string_map_type =
+	nvobjex::btree_map<nvobj::string, nvobj::p<int>, string_less>;
+
+/* clears the source on move, without adding it to a transaction */
+struct move_value {
+	move_value(int val) : val(val)
+	{
+	}
+
+	move_value(move_value &&other) : val(other.val)
+	{
+		other.val = -1;
+	}
+
+	int val;
+};
+
+using move_map_type = nvobjex::btree_map<nvobj::p<int>, move_value>;
+
+struct root {
+	nvobj::persistent_ptr<int_map_type> int_map;
+	nvobj::persistent_ptr<string_map_type> string_map;
+	nvobj::persistent_ptr<move_map_type> move_map;
+};
+
+/* Keys are even, so odd numbers may be used as missing keys */
+void
+verify(int_map_type &map, const std::map<int, int> &expected)
+{
+	UT_ASSERTeq(map.size(), expected.size());
+
+	auto it = map.begin();
+	for (auto &e : expected) {
+		UT_ASSERT(it != map.end());
+		UT_ASSERTeq(it->first, e.first);
+		UT_ASSERTeq(it->second, e.second);
+		++it;
+	}
+	UT_ASSERT(it == map.end());
+
+	for (auto &e : expected) {
+		auto found = map.find(e.first);
+		UT_ASSERT(found != map.end());
+		UT_ASSERTeq(found->second, e.second);
+		UT_ASSERT(map.lower_bound(e.first) == found);
+
+		auto upper = map.upper_bound(e.first);
+		auto expected_upper = expected.upper_bound(e.first);
+		if (expected_upper == expected.end())
+			UT_ASSERT(upper == map.end());
+		else
+			UT_ASSERTeq(upper->first, expected_upper->first);
+
+		auto missing = e.first + 1;
+		UT_ASSERTeq(map.count(missing), 0);
+		auto lb = map.lower_bound(missing);
+		if (expected_upper == expected.end())
+			UT_ASSERT(lb == map.end());
+		else
+			UT_ASSERTeq(lb->first, expected_upper->first);
+	}
+}
+
+void
+insert_erase_test(nvobj::pool<root> &pop, int items)
+{
+	auto &map = *pop.root()->int_map;
+	std::map<int, int> expected;
+
+	std::vector<int> keys;
+	for (int i = 0; i < items; ++i)
+		keys.push_back(2 * i);
+	std::shuffle(keys.begin(), keys.end(),
+		     std::mt19937(static_cast<unsigned>(items)));
+
+	for (auto k : keys) {
+		auto ret = map.emplace(k, k + 1);
+		UT_ASSERT(ret.second);
+		UT_ASSERTeq(ret.first->first, k);
+		expected.emplace(k, k + 1);
+	}
+	verify(map, expected);
+
+	for (auto k : keys) {
+		auto ret = map.emplace(k, -1);
+		UT_ASSERT(!ret.second);
+		UT_ASSERTeq(ret.first->second, k + 1);
+	}
+
+	auto ret = map.insert_or_assign(keys[0], -1);
+	UT_ASSERT(!ret.second);
+	expected[keys[0]] = -1;
+	verify(map, expected);
+
+	/* erase whole ranges of keys, so that leaves become empty */
+	for (int k = items / 4; k < items; ++k) {
+		UT_ASSERTeq(map.unsafe_erase(2 * k), 1);
+		expected.erase(2 * k);
+	}
+	UT_ASSERTeq(map.unsafe_erase(1), 0);
+	verify(map, expected);
+
+	for (auto it = map.begin(); it != map.end();) {
+		if (it->first % 3 == 0) {
+			expected.erase(it->first);
+			it = map.unsafe_erase(it);
+		} else {
+			++it;
+		}
+	}
+	verify(map, expected);
+
+	/* ascending inserts after the last key */
+	for (int k = items; k < 2 * items; ++k) {
+		map.insert(std::make_pair(2 * k, k));
+		expected.emplace(2 * k, k);
+	}
+	verify(map, expected);
+
+	map.clear();
+	expected.clear();
+	verify(map, expected);
+	UT_ASSERT(map.empty());
+}
+
+void
+concurrent_test(nvobj::pool<root> &pop, int items, size_t concurrency)
+{
+	auto &map = *pop.root()->int_map;
+
+	parallel_exec(concurrency, [&](size_t thread_id) {
+		if (thread_id == 0) {
+			/* reader */
+			size_t found = 0;
+			for (int i = 0; i < items; ++i)
+				found += map.count(2 * i);
+			UT_ASSERT(found <= static_cast<size_t>(items));
+			return;
+		}
+
+		for (int i = static_cast<int>(thread_id) - 1; i < items;
+		     i += static_cast<int>(concurrency) - 1)
+			UT_ASSERT(map.emplace(2 * i, 2 * i + 1).second);
+	});
+
+	std::map<int, int> expected;
+	for (int i = 0; i < items; ++i)
+		expected.emplace(2 * i, 2 * i + 1);
+	verify(map, expected);
+}
+
+void
+tx_abort_test(nvobj::pool<root> &pop, int items)
+{
+	auto &map = *pop.root()->int_map;
+	auto size = map.size();
+
+	try {
+		nvobj::transaction::run(pop, [&] {
+			for (int i = 0; i < items; ++i)
+				map.emplace(2 * i + 1, 0);
+			UT_ASSERTeq(map.size(),
+				    size + static_cast<size_t>(items));
+			nvobj::transaction::abort(EINVAL);
+		});
+		UT_ASSERT(0);
+	} catch (pmem::manual_tx_abort &) {
+	}
+
+	UT_ASSERTeq(map.size(), size);
+	for (int i = 0; i < items; ++i)
+		UT_ASSERT(map.find(2 * i + 1) == map.end());
+}
+
+/* keys of different lengths, some of them stored out of line */
+std::string
+string_key(int i)
+{
+	return std::string(static_cast<size_t>(i % 7 * 10), 'x') +
+		std::to_string(i);
+}
+
+void
+string_test(nvobj::pool<root> &pop, int items)
+{
+	auto &map = *pop.root()->string_map;
+	std::map<std::string, int> expected;
+
+	for (int i = 0; i < items; ++i) {
+		auto key = string_key(i);
+		UT_ASSERT(map.try_emplace(key, i).second);
+		expected.emplace(key, i);
+	}
+
+	for (int i = 0; i < items; i += 2) {
+		auto key = string_key(i);
+		UT_ASSERTeq(map.unsafe_erase(key), 1);
+		expected.erase(key);
+	}
+
+	UT_ASSERTeq(map.size(), expected.size());
+	auto it = map.begin();
+	for (auto &e : expected) {
+		UT_ASSERT(it->first == e.first);
+		UT_ASSERTeq(it->second, e.second);
+		UT_ASSERT(map.find(e.first) == it);
+		UT_ASSERT(map.find(e.first + "x") == map.end());
+		++it;
+	}
+	UT_ASSERT(it == map.end());
+}
+
+/*
+ * Elements moved to a new leaf by a split are restored in the old leaf when
+ * the transaction aborts.
+ */
+void
+split_abort_test(nvobj::pool<root> &pop, int items)
+{
+	auto &map = *pop.root()->move_map;
+
+	for (int i = 0; i < items; ++i)
+		UT_ASSERT(map.try_emplace(2 * i, 2 * i).second);
+
+	try {
+		nvobj::transaction::run(pop, [&] {
+			for (int i = 0; i < items; ++i)
+				UT_ASSERT(map.try_emplace(2 * i + 1, 2 * i + 1)
+						  .second);
+			nvobj::transaction::abort(EINVAL);
+		});
+		UT_ASSERT(0);
+	} catch (pmem::manual_tx_abort &) {
+	}
+
+	UT_ASSERTeq(map.size(), static_cast<size_t>(items));
+	int expected = 0;
+	for (auto &e : map) {
+		UT_ASSERTeq(e.first, expected);
+		UT_ASSERTeq(e.second.val, expected);
+		expected += 2;
+	}
+
+	for (int i = 0; i < items; ++i) {
+		auto it = map.find(2 * i);
+		UT_ASSERT(it != map.end());
+		UT_ASSERTeq(it->second.val, 2 * i);
+		UT_ASSERT(map.find(2 * i + 1) == map.end());
+	}
+}
+
+} /* namespace */
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc < 2) {
+		UT_FATAL("usage: %s file-name", argv[0]);
+	}
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<root>::create(
+			path, LAYOUT, PMEMOBJ_MIN_POOL * 20, S_IWUSR | S_IRUSR);
+		nvobj::transaction::run(pop, [&] {
+			pop.root()->int_map =
+				nvobj::make_persistent<int_map_type>();
+			pop.root()->string_map =
+				nvobj::make_persistent<string_map_type>();
+			pop.root()->move_map =
+				nvobj::make_persistent<move_map_type>();
+		});
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	int items = 3000;
+	size_t concurrency = 8;
+	if (On_drd) {
+		items = 300;
+		concurrency = 3;
+	}
+
+	insert_erase_test(pop, items);
+	concurrent_test(pop, items, concurrency);
+	tx_abort_test(pop, items / 10);
+	string_test(pop, items / 3);
+	split_abort_test(pop, items / 10);
+
+	pop.close();
+
+	/* inner nodes are rebuilt by runtime_initialize() */
+	pop = nvobj::pool<root>::open(path, LAYOUT);
+	try {
+		nvobj::transaction::run(pop, [&] {
+			pop.root()->int_map->runtime_initialize();
+		});
+		UT_ASSERT(0);
+	} catch (pmem::transaction_scope_error &) {
+	}
+	pop.root()->int_map->runtime_initialize();
+
+	std::map<int, int> expected;
+	for (int i = 0; i < items; ++i)
+		expected.emplace(2 * i, 2 * i + 1);
+	verify(*pop.root()->int_map, expected);
+
+	pop.close();
+
+	/* or by the first operation */
+	pop = nvobj::pool<root>::open(path, LAYOUT);
+	verify(*pop.root()->int_map, expected);
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<int_map_type>(pop.root()->int_map);
+		nvobj::delete_persistent<string_map_type>(
+			pop.root()->string_map);
+		nvobj::delete_persistent<move_map_type>(pop.root()->move_map);
+	});
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * concurrent_hash_map_allocation_class.cpp -- test of allocating nodes of
+ * concurrent_hash_map from custom allocation classes and arenas
+ */
+
+#include "thread_helpers.hpp"
+#include "unittest.hpp"
+
+#include <libpmemobj++/container/concurrent_hash_map.hpp>
+#include <libpmemobj++/experimental/allocation_class.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/make_persistent_atomic.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include <vector>
+
+#define LAYOUT "concurrent_hash_map_allocation_class"
+
+namespace nvobj = pmem::obj;
+namespace nvobjex = pmem::obj::experimental;
+
+namespace
+{
+
+typedef nvobj::concurrent_hash_map<nvobj::p<int>, nvobj::p<int>>
+	persistent_map_type;
+
+struct foo {
+	char data[40];
+};
+
+struct root {
+	nvobj::persistent_ptr<persistent_map_type> cons;
+	nvobj::persistent_ptr<foo> f;
+};
+
+void
+allocation_class_test(nvobj::pool<root> &pop)
+{
+	auto cls = nvobjex::allocation_class::create_for<foo>(pop);
+
+	/* compact header takes 16 bytes */
+	UT_ASSERTeq(cls.unit_size(), sizeof(foo) + 16);
+
+	pobj_alloc_class_desc desc = pop.ctl_get<pobj_alloc_class_desc>(
+		"heap.alloc_class." + std::to_string(cls.id()) + ".desc");
+	UT_ASSERTeq(desc.unit_size, cls.unit_size());
+	UT_ASSERTeq(desc.header_type, POBJ_HEADER_COMPACT);
+
+	auto r = pop.root();
+	nvobj::transaction::run(
+		pop, [&] { r->f = nvobj::make_persistent<foo>(cls.flag()); });
+	UT_ASSERT(pmemobj_alloc_usable_size(r->f.raw()) >= sizeof(foo));
+	nvobj::transaction::run(pop,
+				[&] { nvobj::delete_persistent<foo>(r->f); });
+
+	nvobj::make_persistent_atomic<foo>(pop, r->f, cls.flag_atomic());
+	UT_ASSERT(r->f != nullptr);
+	nvobj::delete_persistent_atomic<foo>(r->f);
+
+	/* units are kept 8-byte aligned */
+	auto odd = nvobjex::allocation_class::create(pop, 13, 100,
+						     POBJ_HEADER_NONE);
+	UT_ASSERTeq(odd.unit_size(), 16);
+	UT_ASSERT(odd.id() != cls.id());
+}
+
+void
+arena_test(nvobj::pool<root> &pop)
+{
+	auto previous = nvobjex::arena::current(pop);
+	auto a = nvobjex::arena::create(pop);
+	UT_ASSERT(a.id() != previous.id());
+
+	{
+		nvobjex::scoped_thread_arena scope(a);
+		UT_ASSERTeq(nvobjex::arena::current(pop).id(), a.id());
+	}
+
+	UT_ASSERTeq(nvobjex::arena::current(pop).id(), previous.id());
+
+	auto r = pop.root();
+	nvobj::transaction::run(
+		pop, [&] { r->f = nvobj::make_persistent<foo>(a.flag()); });
+	UT_ASSERT(r->f != nullptr);
+	nvobj::transaction::run(pop,
+				[&] { nvobj::delete_persistent<foo>(r->f); });
+}
+
+void
+node_allocation_test(nvobj::pool<root> &pop, size_t concurrency)
+{
+	auto map = pop.root()->cons;
+
+	UT_ASSERTeq(map->node_allocation_flag().value, 0);
+
+	auto cls = nvobjex::allocation_class::create(
+		pop, persistent_map_type::node_allocation_size());
+	map->set_node_allocation_flag(cls.flag());
+	UT_ASSERTeq(map->node_allocation_flag().value, cls.flag().value);
+
+	std::vector<nvobjex::arena> arenas;
+	for (size_t i = 0; i < concurrency; ++i)
+		arenas.push_back(nvobjex::arena::create(pop));
+
+	int thread_items = 500;
+	parallel_exec(concurrency, [&](size_t thread_id) {
+		nvobjex::scoped_thread_arena scope(arenas[thread_id]);
+
+		int begin = static_cast<int>(thread_id) * thread_items;
+		for (int i = begin; i < begin + thread_items; ++i)
+			UT_ASSERT(map->insert(
+				persistent_map_type::value_type(i, i)));
+	});
+
+	UT_ASSERTeq(map->size(),
+		    static_cast<size_t>(thread_items) * concurrency);
+
+	/* nodes are allocated with the given flags */
+	map->set_node_allocation_flag(
+		nvobj::allocation_flag::class_id(POBJ_MAX_ALLOC_CLASSES - 1));
+	try {
+		map->insert(persistent_map_type::value_type(-1, -1));
+		UT_ASSERT(0);
+	} catch (pmem::transaction_alloc_error &) {
+	}
+	UT_ASSERT(map->count(-1) == 0);
+
+	/* the setting is not persistent */
+	map->runtime_initialize();
+	UT_ASSERTeq(map->node_allocation_flag().value, 0);
+	UT_ASSERT(map->insert(persistent_map_type::value_type(-1, -1)));
+
+	for (int i = 0; i < static_cast<int>(map->size()) - 1; ++i) {
+		persistent_map_type::const_accessor acc;
+		UT_ASSERT(map->find(acc, i));
+		UT_ASSERTeq(acc->second, i);
+	}
+}
+
+} /* namespace */
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc < 2)
+		UT_FATAL("usage: %s file-name", argv[0]);
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<root>::create(
+			path, LAYOUT, PMEMOBJ_MIN_POOL * 20, S_IWUSR | S_IRUSR);
+		nvobj::transaction::run(pop, [&] {
+			pop.root()->cons =
+				nvobj::make_persistent<persistent_map_type>();
+		});
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	size_t concurrency = 4;
+	if (On_drd)
+		concurrency = 2;
+
+	allocation_class_test(pop);
+	arena_test(pop);
+	node_allocation_test(pop, concurrency);
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<persistent_map_type>(pop.root()->cons);
+	});
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
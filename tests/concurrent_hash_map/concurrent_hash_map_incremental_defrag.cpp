@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * concurrent_hash_map_incremental_defrag.cpp -- test of
+ * experimental::incremental_defrag driving concurrent_hash_map
+ */
+
+#include "thread_helpers.hpp"
+#include "unittest.hpp"
+
+#include <libpmemobj++/container/concurrent_hash_map.hpp>
+#include <libpmemobj++/container/string.hpp>
+#include <libpmemobj++/experimental/incremental_defrag.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define LAYOUT "concurrent_hash_map_incremental_defrag"
+
+namespace nvobj = pmem::obj;
+namespace nvobjex = pmem::obj::experimental;
+
+namespace
+{
+
+typedef nvobj::concurrent_hash_map<nvobj::p<int>, nvobj::string>
+	persistent_map_type;
+
+struct root {
+	nvobj::persistent_ptr<persistent_map_type> cons;
+};
+
+std::string
+value_of(int key, int version)
+{
+	/* long enough not to fit in the SSO buffer */
+	return std::string(64, 'a' + static_cast<char>(version % 26)) +
+		std::to_string(key);
+}
+
+void
+fill(nvobj::pool<root> &pop, int items)
+{
+	auto map = pop.root()->cons;
+
+	for (int i = 0; i < items; ++i)
+		map->insert_or_assign(i, value_of(i, 0));
+
+	/* make holes */
+	for (int i = 0; i < items; i += 3)
+		map->erase(i);
+}
+
+void
+verify(nvobj::pool<root> &pop, int items)
+{
+	auto map = pop.root()->cons;
+
+	for (int i = 0; i < items; ++i) {
+		persistent_map_type::const_accessor acc;
+		bool found = map->find(acc, i);
+
+		UT_ASSERTeq(found, i % 3 != 0);
+		if (found)
+			UT_ASSERT(acc->second.size() == value_of(i, 0).size());
+	}
+}
+
+void
+slicing_test(nvobj::pool<root> &pop)
+{
+	nvobjex::incremental_defrag defrag(pop, 30);
+
+	std::vector<std::pair<double, double>> calls;
+	defrag.add([&](double start, double amount) {
+		calls.emplace_back(start, amount);
+		return pobj_defrag_result{1, 0};
+	});
+
+	size_t steps = 1;
+	while (!defrag.step())
+		++steps;
+
+	UT_ASSERTeq(steps, 4);
+	UT_ASSERTeq(calls.size(), 4);
+	UT_ASSERT(defrag.done());
+	UT_ASSERTeq(defrag.result().total, 4);
+
+	double covered = 0;
+	for (auto &c : calls) {
+		UT_ASSERT(c.first == covered);
+		covered += c.second;
+	}
+	UT_ASSERT(covered == 100);
+
+	/* nothing more to do in this pass */
+	UT_ASSERT(defrag.step());
+	UT_ASSERTeq(calls.size(), 4);
+
+	defrag.restart();
+	UT_ASSERT(!defrag.done());
+	UT_ASSERTeq(defrag.result().total, 0);
+
+	try {
+		nvobjex::incremental_defrag d(pop, 0);
+		UT_ASSERT(0);
+	} catch (std::range_error &) {
+	}
+
+	try {
+		nvobjex::incremental_defrag d(pop, 101);
+		UT_ASSERT(0);
+	} catch (std::range_error &) {
+	}
+}
+
+void
+single_threaded_test(nvobj::pool<root> &pop, int items)
+{
+	nvobjex::incremental_defrag defrag(pop, 10);
+	defrag.add(*pop.root()->cons);
+
+	size_t steps = 0;
+	while (!defrag.done()) {
+		defrag.step();
+		++steps;
+	}
+
+	UT_ASSERTeq(steps, 10);
+
+	auto result = defrag.result();
+	UT_ASSERT(result.total > 0);
+	UT_ASSERT(result.total >= result.relocated);
+
+	UT_ASSERT(defrag.before().run_active > 0);
+	UT_ASSERT(defrag.after().run_active > 0);
+	UT_ASSERT(defrag.before().fragmentation() >= 0);
+	UT_ASSERT(defrag.before().fragmentation() < 1);
+
+	verify(pop, items);
+}
+
+/*
+ * Defragmentation runs in short time slices while other threads keep
+ * reading and updating the map.
+ */
+void
+online_test(nvobj::pool<root> &pop, int items, size_t concurrency)
+{
+	auto map = pop.root()->cons;
+
+	nvobjex::incremental_defrag defrag(pop, 1);
+	defrag.add(*map);
+
+	std::atomic<bool> stop(false);
+
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < concurrency; ++t) {
+		threads.emplace_back([&, t] {
+			int version = 0;
+			while (!stop.load()) {
+				++version;
+				for (int i = static_cast<int>(t); i < items;
+				     i += static_cast<int>(concurrency)) {
+					if (i % 3 == 0)
+						continue;
+
+					if (t % 2) {
+						persistent_map_type::
+							const_accessor acc;
+						UT_ASSERT(map->find(acc, i));
+						continue;
+					}
+
+					persistent_map_type::accessor acc;
+					UT_ASSERT(map->find(acc, i));
+					acc->second = value_of(i, version);
+				}
+			}
+		});
+	}
+
+	for (int pass = 0; pass < 2; ++pass) {
+		while (!defrag.run_for(std::chrono::milliseconds(1)))
+			std::this_thread::yield();
+
+		UT_ASSERT(defrag.result().total >= defrag.result().relocated);
+		defrag.restart();
+	}
+
+	stop.store(true);
+	for (auto &t : threads)
+		t.join();
+
+	verify(pop, items);
+}
+
+} /* namespace */
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc < 2)
+		UT_FATAL("usage: %s file-name", argv[0]);
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<root>::create(
+			path, LAYOUT, PMEMOBJ_MIN_POOL * 20, S_IWUSR | S_IRUSR);
+		nvobj::transaction::run(pop, [&] {
+			pop.root()->cons =
+				nvobj::make_persistent<persistent_map_type>();
+		});
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	int enabled = 1;
+	pop.ctl_set<int>("stats.enabled", enabled);
+
+	pop.root()->cons->runtime_initialize();
+
+	int items = 3000;
+	size_t concurrency = 4;
+	if (On_drd) {
+		items = 300;
+		concurrency = 2;
+	}
+
+	fill(pop, items);
+
+	slicing_test(pop);
+	single_threaded_test(pop, items);
+	online_test(pop, items, concurrency);
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<persistent_map_type>(pop.root()->cons);
+	});
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
@@ -48,6 +48,8 @@ struct hashmap_test : public MapType {
 		ASSERT_OFFSET_CHECKPOINT(T, 16 * pmem::detail::CACHELINE_SIZE);
 		ASSERT_ALIGNED_FIELD(T, t, tls_ptr);
 		ASSERT_ALIGNED_FIELD(T, t, on_init_size);
+		ASSERT_ALIGNED_FIELD(T, t, my_node_alloc_flags);
+		ASSERT_ALIGNED_FIELD(T, t, my_shrink_mask);
 		ASSERT_ALIGNED_FIELD(T, t, reserved);
 		ASSERT_OFFSET_CHECKPOINT(T, 17 * pmem::detail::CACHELINE_SIZE);
 		ASSERT_ALIGNED_FIELD(T, t, my_segment_enable_mutex);
@@ -0,0 +1,223 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * concurrent_hash_map_parallel_for_each.cpp -- pmem::obj::concurrent_hash_map
+ * test, checks that parallel_for_each() visits each element exactly once,
+ * also with concurrent inserts, erases and held accessors
+ */
+
+#include "thread_helpers.hpp"
+#include "unittest.hpp"
+
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include <libpmemobj++/container/concurrent_hash_map.hpp>
+
+#define LAYOUT "concurrent_hash_map"
+
+namespace nvobj = pmem::obj;
+
+namespace
+{
+
+typedef nvobj::concurrent_hash_map<nvobj::p<int>, nvobj::p<int>>
+	persistent_map_type;
+
+struct root {
+	nvobj::persistent_ptr<persistent_map_type> cons;
+};
+
+/* counts how many times each key in [0, n) was visited */
+class visit_counter {
+public:
+	visit_counter(size_t n) : counts(n)
+	{
+		for (auto &c : counts)
+			c.store(0);
+	}
+
+	void
+	operator()(persistent_map_type::const_reference e)
+	{
+		UT_ASSERTeq(e.first, e.second);
+		if (e.first < static_cast<int>(counts.size()))
+			counts[static_cast<size_t>(e.first)]++;
+	}
+
+	void
+	check(size_t n) const
+	{
+		for (size_t i = 0; i < n; ++i)
+			UT_ASSERTeq(counts[i].load(), 1);
+	}
+
+private:
+	std::vector<std::atomic<int>> counts;
+};
+
+void
+insert(persistent_map_type &map, int from, int to)
+{
+	for (int i = from; i < to; ++i)
+		map.insert(persistent_map_type::value_type(i, i));
+}
+
+void
+for_each_test(nvobj::pool<root> &pop, int items)
+{
+	auto &map = *pop.root()->cons;
+
+	size_t calls = 0;
+	map.parallel_for_each(
+		[&](persistent_map_type::const_reference) { ++calls; }, 4);
+	UT_ASSERTeq(calls, 0);
+
+	insert(map, 0, items);
+
+	for (size_t concurrency : std::vector<size_t>{0, 1, 2, 8}) {
+		visit_counter counter(static_cast<size_t>(items));
+		map.parallel_for_each(
+			[&](persistent_map_type::const_reference e) {
+				counter(e);
+			},
+			concurrency);
+		counter.check(static_cast<size_t>(items));
+	}
+}
+
+/*
+ * Elements [0, items) are present during the whole parallel_for_each, other
+ * threads insert and erase other elements and hold accessors. The table does
+ * not grow, but its buckets are rehashed concurrently.
+ */
+void
+concurrent_test(nvobj::pool<root> &pop, int items, size_t concurrency)
+{
+	auto &map = *pop.root()->cons;
+
+	map.clear();
+	map.rehash(static_cast<size_t>(8 * items));
+	insert(map, 0, items);
+
+	visit_counter counter(static_cast<size_t>(items));
+
+	parallel_exec(concurrency + 2, [&](size_t thread_id) {
+		if (thread_id == 0) {
+			map.parallel_for_each(
+				[&](persistent_map_type::const_reference e) {
+					counter(e);
+				},
+				concurrency);
+		} else if (thread_id == 1) {
+			/* accessors held for a while force restarts */
+			for (int i = 0; i < items; i += 7) {
+				persistent_map_type::accessor acc;
+				UT_ASSERT(map.find(acc, i));
+				std::this_thread::yield();
+			}
+		} else {
+			int from = items * static_cast<int>(thread_id);
+			insert(map, from, from + items);
+			for (int i = from; i < from + items; i += 2)
+				UT_ASSERT(map.erase(i));
+		}
+	});
+
+	counter.check(static_cast<size_t>(items));
+}
+
+void
+exception_test(nvobj::pool<root> &pop)
+{
+	auto &map = *pop.root()->cons;
+
+	try {
+		map.parallel_for_each(
+			[&](persistent_map_type::const_reference e) {
+				if (e.first == 3)
+					throw std::runtime_error("for_each");
+			},
+			4);
+		UT_ASSERT(0);
+	} catch (std::runtime_error &) {
+	}
+
+	/* all locks were released */
+	persistent_map_type::accessor acc;
+	UT_ASSERT(map.find(acc, 3));
+}
+
+void
+tx_test(nvobj::pool<root> &pop)
+{
+	auto &map = *pop.root()->cons;
+
+	try {
+		nvobj::transaction::run(pop, [&] {
+			map.parallel_for_each(
+				[&](persistent_map_type::const_reference) {});
+		});
+		UT_ASSERT(0);
+	} catch (pmem::transaction_scope_error &) {
+	}
+}
+
+} /* namespace */
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc < 2) {
+		UT_FATAL("usage: %s file-name", argv[0]);
+	}
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<root>::create(
+			path, LAYOUT, PMEMOBJ_MIN_POOL * 20, S_IWUSR | S_IRUSR);
+		nvobj::transaction::run(pop, [&] {
+			pop.root()->cons =
+				nvobj::make_persistent<persistent_map_type>();
+		});
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	pop.root()->cons->runtime_initialize();
+
+	int items = 10000;
+	size_t concurrency = 4;
+	if (On_drd) {
+		items = 500;
+		concurrency = 2;
+	}
+
+	for_each_test(pop, items);
+	concurrent_test(pop, items, concurrency);
+	exception_test(pop);
+	tx_test(pop);
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<persistent_map_type>(pop.root()->cons);
+	});
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
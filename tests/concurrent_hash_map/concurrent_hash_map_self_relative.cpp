@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * concurrent_hash_map_self_relative.cpp -- test of concurrent_hash_map which
+ * links its nodes with self-relative pointers
+ */
+
+#include "thread_helpers.hpp"
+#include "unittest.hpp"
+
+#include <libpmemobj++/container/concurrent_hash_map.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#define LAYOUT "concurrent_hash_map_self_relative"
+
+namespace nvobj = pmem::obj;
+
+namespace
+{
+
+using self_relative_map_type =
+	nvobj::experimental::self_relative_concurrent_hash_map<nvobj::p<int>,
+							       nvobj::p<int>>;
+using default_map_type =
+	nvobj::concurrent_hash_map<nvobj::p<int>, nvobj::p<int>>;
+
+static_assert(sizeof(self_relative_map_type) == sizeof(default_map_type),
+	      "self-relative layout should not change the header size");
+
+struct root {
+	nvobj::persistent_ptr<self_relative_map_type> map1;
+	nvobj::persistent_ptr<self_relative_map_type> map2;
+};
+
+void
+verify(self_relative_map_type &map, int begin, int end)
+{
+	UT_ASSERTeq(map.size(), static_cast<size_t>(end - begin));
+
+	for (int i = begin; i < end; ++i) {
+		self_relative_map_type::const_accessor acc;
+		UT_ASSERT(map.find(acc, i));
+		UT_ASSERTeq(acc->first, i);
+		UT_ASSERTeq(acc->second, i * 2);
+	}
+
+	size_t counted = 0;
+	for (auto &e : map) {
+		UT_ASSERTeq(e.second, e.first * 2);
+		++counted;
+	}
+	UT_ASSERTeq(counted, map.size());
+}
+
+void
+insert_erase_test(nvobj::pool<root> &pop, size_t concurrency)
+{
+	size_t thread_items = 200;
+	int items = static_cast<int>(concurrency * thread_items);
+
+	auto &map = *pop.root()->map1;
+	map.runtime_initialize();
+
+	parallel_exec(concurrency, [&](size_t thread_id) {
+		int begin = static_cast<int>(thread_id * thread_items);
+		int end = begin + static_cast<int>(thread_items);
+		for (int i = begin; i < end; ++i) {
+			self_relative_map_type::value_type val(i, i * 2);
+			UT_ASSERT(map.insert(val));
+		}
+	});
+
+	verify(map, 0, items);
+
+	/* erase every item from the first half */
+	parallel_exec(concurrency, [&](size_t thread_id) {
+		for (int i = static_cast<int>(thread_id); i < items / 2;
+		     i += static_cast<int>(concurrency))
+			UT_ASSERT(map.erase(i));
+	});
+
+	verify(map, items / 2, items);
+}
+
+void
+reopen_test(nvobj::pool<root> &pop, const char *path, size_t concurrency)
+{
+	size_t items = concurrency * 200;
+
+	pop.close();
+	pop = nvobj::pool<root>::open(path, LAYOUT);
+
+	auto &map = *pop.root()->map1;
+	map.runtime_initialize();
+
+	verify(map, static_cast<int>(items / 2), static_cast<int>(items));
+
+	/* layouts are not compatible, opening as the default map must fail */
+	nvobj::persistent_ptr<default_map_type> other(pop.root()->map1.raw());
+	try {
+		other->runtime_initialize();
+		UT_ASSERT(0);
+	} catch (pmem::layout_error &) {
+	}
+}
+
+void
+swap_clear_test(nvobj::pool<root> &pop)
+{
+	auto &map1 = *pop.root()->map1;
+	auto &map2 = *pop.root()->map2;
+	map2.runtime_initialize();
+
+	size_t size1 = map1.size();
+
+	for (int i = 0; i < 100; ++i)
+		UT_ASSERT(map2.insert(self_relative_map_type::value_type(
+			-i - 1, (-i - 1) * 2)));
+
+	/* node pointers in embedded buckets have to survive the swap */
+	map1.swap(map2);
+
+	UT_ASSERTeq(map1.size(), 100);
+	UT_ASSERTeq(map2.size(), size1);
+	verify(map1, -100, 0);
+
+	map1.clear();
+	map2.clear();
+
+	UT_ASSERTeq(map1.size(), 0);
+	UT_ASSERTeq(map2.size(), 0);
+	UT_ASSERT(map1.begin() == map1.end());
+}
+
+} /* namespace */
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc < 2)
+		UT_FATAL("usage: %s file-name", argv[0]);
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<root>::create(
+			path, LAYOUT, PMEMOBJ_MIN_POOL * 20, S_IWUSR | S_IRUSR);
+		nvobj::transaction::run(pop, [&] {
+			pop.root()->map1 = nvobj::make_persistent<
+				self_relative_map_type>();
+			pop.root()->map2 = nvobj::make_persistent<
+				self_relative_map_type>();
+		});
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	size_t concurrency = 8;
+	if (On_drd)
+		concurrency = 2;
+
+	insert_erase_test(pop, concurrency);
+	reopen_test(pop, path, concurrency);
+	swap_clear_test(pop);
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<self_relative_map_type>(
+			pop.root()->map1);
+		nvobj::delete_persistent<self_relative_map_type>(
+			pop.root()->map2);
+	});
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
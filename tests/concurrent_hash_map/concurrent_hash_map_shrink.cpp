@@ -0,0 +1,259 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * concurrent_hash_map_shrink.cpp -- pmem::obj::concurrent_hash_map test,
+ * checks that shrink_to_fit() frees the buckets after erasing elements and
+ * that all remaining elements are accessible, also after growing the table
+ * again and reopening the pool, and while the table is shrunk concurrently
+ */
+
+#include "thread_helpers.hpp"
+#include "unittest.hpp"
+
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include <libpmemobj++/container/concurrent_hash_map.hpp>
+
+#include <atomic>
+
+#define LAYOUT "concurrent_hash_map"
+
+namespace nvobj = pmem::obj;
+
+namespace
+{
+
+typedef nvobj::concurrent_hash_map<nvobj::p<int>, nvobj::p<int>>
+	persistent_map_type;
+
+struct root {
+	nvobj::persistent_ptr<persistent_map_type> cons;
+};
+
+/* the first block is freed only if the map has at most one element */
+static constexpr size_t FIRST_BLOCK_BUCKETS = 256;
+static constexpr size_t EMBEDDED_BUCKETS = 2;
+
+/* checks that exactly the keys i * step for i < n are in the map */
+void
+check_elements(persistent_map_type &map, int n, int step)
+{
+	UT_ASSERTeq(map.size(), static_cast<size_t>(n));
+
+	size_t count = 0;
+	for (auto it = map.begin(); it != map.end(); ++it) {
+		UT_ASSERTeq(it->first % step, 0);
+		UT_ASSERT(it->first / step < n);
+		UT_ASSERTeq(it->first, it->second);
+		++count;
+	}
+	UT_ASSERTeq(count, static_cast<size_t>(n));
+
+	for (int i = 0; i < n; ++i) {
+		persistent_map_type::const_accessor acc;
+		UT_ASSERT(map.find(acc, i * step));
+		UT_ASSERTeq(acc->first, i * step);
+		UT_ASSERTeq(acc->second, i * step);
+	}
+}
+
+void
+insert(persistent_map_type &map, int from, int to)
+{
+	for (int i = from; i < to; ++i)
+		UT_ASSERT(map.insert(persistent_map_type::value_type(i, i)));
+}
+
+void
+shrink_test(nvobj::pool<root> &pop, int items)
+{
+	auto &map = *pop.root()->cons;
+	map.runtime_initialize();
+
+	insert(map, 0, items);
+	auto buckets = map.bucket_count();
+	UT_ASSERT(buckets > FIRST_BLOCK_BUCKETS);
+
+	/* nothing to shrink */
+	map.shrink_to_fit();
+	UT_ASSERTeq(map.bucket_count(), buckets);
+	check_elements(map, items, 1);
+
+	/* keep every 100th element */
+	for (int i = 0; i < items; ++i) {
+		if (i % 100 != 0)
+			UT_ASSERT(map.erase(i));
+	}
+
+	int remaining = items / 100;
+	map.shrink_to_fit();
+	UT_ASSERTeq(map.bucket_count(), FIRST_BLOCK_BUCKETS);
+	check_elements(map, remaining, 100);
+
+	/* the table grows again */
+	for (int i = 0; i < items; ++i) {
+		if (i % 100 != 0)
+			UT_ASSERT(map.insert(
+				persistent_map_type::value_type(i, i)));
+	}
+	UT_ASSERTeq(map.bucket_count(), buckets);
+	check_elements(map, items, 1);
+
+	for (int i = 1; i < items; ++i)
+		UT_ASSERT(map.erase(i));
+
+	/* single element fits in the embedded buckets */
+	map.shrink_to_fit();
+	UT_ASSERTeq(map.bucket_count(), EMBEDDED_BUCKETS);
+	check_elements(map, 1, 1);
+
+	insert(map, 1, items);
+	check_elements(map, items, 1);
+
+	for (int i = 0; i < items; ++i) {
+		if (i % 100 != 0)
+			UT_ASSERT(map.erase(i));
+	}
+	map.shrink_to_fit();
+	check_elements(map, remaining, 100);
+}
+
+/*
+ * concurrent_shrink_test -- elements are looked up, inserted and erased while
+ * the table is shrunk
+ */
+void
+concurrent_shrink_test(nvobj::pool<root> &pop, int items)
+{
+	auto &map = *pop.root()->cons;
+	const size_t threads = 8;
+	int remaining = items / 100;
+
+	for (int i = 0; i < items; ++i) {
+		if (i % 100 != 0)
+			UT_ASSERT(map.insert(
+				persistent_map_type::value_type(i, i)));
+	}
+	for (int i = 0; i < items; ++i) {
+		if (i % 100 != 0)
+			UT_ASSERT(map.erase(i));
+	}
+	UT_ASSERT(map.bucket_count() > FIRST_BLOCK_BUCKETS);
+
+	std::atomic<bool> done(false);
+
+	parallel_exec(threads, [&](size_t thread_id) {
+		if (thread_id == 0) {
+			map.shrink_to_fit();
+			done = true;
+			return;
+		}
+
+		/* each writer inserts and erases its own key */
+		int key = items + static_cast<int>(thread_id);
+		do {
+			if (thread_id % 2) {
+				UT_ASSERT(map.insert(
+					persistent_map_type::value_type(key,
+									key)));
+				UT_ASSERTeq(map.count(key), 1);
+				UT_ASSERT(map.erase(key));
+				continue;
+			}
+
+			for (int i = 0; i < items; i += 7) {
+				persistent_map_type::const_accessor acc;
+				bool found = map.find(acc, i);
+				UT_ASSERTeq(found, i % 100 == 0);
+				if (found)
+					UT_ASSERTeq(acc->second, i);
+			}
+		} while (!done);
+	});
+
+	UT_ASSERTeq(map.bucket_count(), FIRST_BLOCK_BUCKETS);
+	check_elements(map, remaining, 100);
+
+	/* the merged buckets are not used after the table grows again */
+	insert(map, items, 2 * items);
+	for (int i = items; i < 2 * items; ++i)
+		UT_ASSERT(map.erase(i));
+	check_elements(map, remaining, 100);
+}
+
+void
+tx_test(nvobj::pool<root> &pop)
+{
+	auto &map = *pop.root()->cons;
+	auto buckets = map.bucket_count();
+
+	try {
+		nvobj::transaction::run(pop, [&] { map.shrink_to_fit(); });
+		UT_ASSERT(0);
+	} catch (pmem::transaction_scope_error &) {
+	}
+
+	UT_ASSERTeq(map.bucket_count(), buckets);
+}
+
+} /* namespace */
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc < 2) {
+		UT_FATAL("usage: %s file-name", argv[0]);
+	}
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<root>::create(
+			path, LAYOUT, PMEMOBJ_MIN_POOL * 20, S_IWUSR | S_IRUSR);
+		nvobj::transaction::run(pop, [&] {
+			pop.root()->cons =
+				nvobj::make_persistent<persistent_map_type>();
+		});
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	int items = 10000;
+
+	shrink_test(pop, items);
+	concurrent_shrink_test(pop, items);
+	tx_test(pop);
+
+	auto buckets = pop.root()->cons->bucket_count();
+
+	pop.close();
+
+	/* the mask is recalculated from the remaining segments */
+	pop = nvobj::pool<root>::open(path, LAYOUT);
+	auto &map = *pop.root()->cons;
+	map.runtime_initialize();
+	UT_ASSERTeq(map.bucket_count(), buckets);
+	check_elements(map, items / 100, 100);
+
+	insert(map, items, 2 * items);
+	UT_ASSERT(map.bucket_count() > buckets);
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<persistent_map_type>(pop.root()->cons);
+	});
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
@@ -45,6 +45,10 @@ typedef nvobj::experimental::concurrent_map<nvobj::string, nvobj::string,
 					    hetero_less>
 	persistent_map_type_string;
 
+/* runtime-only data of the map must not change its persistent layout */
+static_assert(sizeof(persistent_map_type_int) == 2168,
+	      "Layout of concurrent_map changed");
+
 struct root {
 	nvobj::persistent_ptr<persistent_map_type_int> cons1;
 	nvobj::persistent_ptr<persistent_map_type_string> cons2;
@@ -0,0 +1,238 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * concurrent_map_emplace.cpp -- pmem::obj::experimental::concurrent_map
+ * emplace tests, checks that emplacing an existing key does not construct
+ * (and allocate) a new element
+ */
+
+#include "thread_helpers.hpp"
+#include "unittest.hpp"
+
+#include <libpmemobj++/container/string.hpp>
+#include <libpmemobj++/experimental/concurrent_map.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include <atomic>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#define LAYOUT "concurrent_map_emplace"
+
+namespace nvobj = pmem::obj;
+namespace nvobjex = pmem::obj::experimental;
+
+namespace
+{
+
+struct counted {
+	counted(int v) : val(v)
+	{
+		++constructed;
+	}
+
+	counted(const counted &other) : val(other.val)
+	{
+		++constructed;
+	}
+
+	nvobj::p<int> val;
+
+	static std::atomic<size_t> constructed;
+};
+
+std::atomic<size_t> counted::constructed(0);
+
+struct hetero_less {
+	using is_transparent = void;
+	template <typename T1, typename T2>
+	bool
+	operator()(const T1 &lhs, const T2 &rhs) const
+	{
+		return lhs < rhs;
+	}
+};
+
+using int_map_type = nvobjex::concurrent_map<nvobj::p<int>, counted>;
+using string_map_type = nvobjex::concurrent_map<nvobj::string, nvobj::p<int>>;
+using hetero_map_type =
+	nvobjex::concurrent_map<nvobj::string, nvobj::p<int>, hetero_less>;
+
+struct root {
+	nvobj::persistent_ptr<int_map_type> int_map;
+	nvobj::persistent_ptr<string_map_type> string_map;
+	nvobj::persistent_ptr<hetero_map_type> hetero_map;
+};
+
+void
+check_duplicate(int_map_type &map, std::pair<int_map_type::iterator, bool> ret,
+		int key)
+{
+	UT_ASSERT(!ret.second);
+	UT_ASSERT(ret.first != map.end());
+	UT_ASSERTeq(ret.first->first, key);
+	UT_ASSERTeq(ret.first->second.val, key);
+}
+
+/*
+ * Every supported form of emplace arguments finds an existing key before
+ * the element is constructed.
+ */
+void
+search_first_test(nvobj::pool<root> &pop, int items)
+{
+	auto &map = *pop.root()->int_map;
+	counted::constructed = 0;
+
+	for (int i = 0; i < items; ++i) {
+		auto ret = map.emplace(i, i);
+		UT_ASSERT(ret.second);
+		UT_ASSERTeq(ret.first->second.val, i);
+	}
+
+	UT_ASSERTeq(map.size(), static_cast<size_t>(items));
+	UT_ASSERTeq(counted::constructed.load(), static_cast<size_t>(items));
+
+	int allocs = num_allocs(pop);
+
+	for (int i = 0; i < items; ++i) {
+		check_duplicate(map, map.emplace(i, i + 1), i);
+		check_duplicate(map, map.emplace(nvobj::p<int>(i), i + 1), i);
+		check_duplicate(map,
+				map.emplace(std::piecewise_construct,
+					    std::forward_as_tuple(i),
+					    std::forward_as_tuple(i + 1)),
+				i);
+		check_duplicate(map, map.emplace(std::make_pair(i, i + 1)), i);
+
+		auto it = map.emplace_hint(map.end(), i, i + 1);
+		UT_ASSERTeq(it->first, i);
+		UT_ASSERTeq(it->second.val, i);
+	}
+
+	UT_ASSERTeq(map.size(), static_cast<size_t>(items));
+	UT_ASSERTeq(counted::constructed.load(), static_cast<size_t>(items));
+	UT_ASSERTeq(num_allocs(pop), allocs);
+}
+
+/*
+ * Threads emplace the same keys at the same time, every key is constructed
+ * only once.
+ */
+void
+concurrent_test(nvobj::pool<root> &pop, int items, size_t concurrency)
+{
+	auto &map = *pop.root()->int_map;
+	map.clear();
+	counted::constructed = 0;
+
+	parallel_exec(concurrency, [&](size_t thread_id) {
+		for (int i = 0; i < items; ++i) {
+			/* every thread goes over the keys in a different
+			 * order */
+			int key = (i + static_cast<int>(thread_id) * 7) % items;
+			auto ret = map.emplace(key, key);
+			UT_ASSERTeq(ret.first->first, key);
+			UT_ASSERTeq(ret.first->second.val, key);
+		}
+	});
+
+	UT_ASSERTeq(map.size(), static_cast<size_t>(items));
+	UT_ASSERTeq(counted::constructed.load(), static_cast<size_t>(items));
+
+	for (int i = 0; i < items; ++i) {
+		auto it = map.find(i);
+		UT_ASSERT(it != map.end());
+		UT_ASSERTeq(it->second.val, i);
+	}
+}
+
+/*
+ * Keys which have to be constructed in the pool are found before the
+ * element is constructed only with a transparent comparator. Otherwise the
+ * element is constructed and deleted when the key exists.
+ */
+template <typename MapType>
+void
+string_key_test(nvobj::pool<root> &pop, MapType &map, int items)
+{
+	for (int i = 0; i < items; ++i) {
+		auto ret = map.emplace(std::to_string(i), i);
+		UT_ASSERT(ret.second);
+	}
+
+	int allocs = num_allocs(pop);
+
+	for (int i = 0; i < items; ++i) {
+		auto key = std::to_string(i);
+		auto ret = map.emplace(key, i + 1);
+		UT_ASSERT(!ret.second);
+		UT_ASSERT(ret.first->first == key);
+		UT_ASSERTeq(ret.first->second, i);
+	}
+
+	UT_ASSERTeq(map.size(), static_cast<size_t>(items));
+	UT_ASSERTeq(num_allocs(pop), allocs);
+}
+
+} /* namespace */
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc < 2) {
+		UT_FATAL("usage: %s file-name", argv[0]);
+	}
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<root>::create(
+			path, LAYOUT, PMEMOBJ_MIN_POOL * 20, S_IWUSR | S_IRUSR);
+		nvobj::transaction::run(pop, [&] {
+			auto r = pop.root();
+			r->int_map = nvobj::make_persistent<int_map_type>();
+			r->string_map =
+				nvobj::make_persistent<string_map_type>();
+			r->hetero_map =
+				nvobj::make_persistent<hetero_map_type>();
+		});
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	int items = 1000;
+	size_t concurrency = 8;
+	if (On_drd) {
+		items = 100;
+		concurrency = 2;
+	}
+
+	search_first_test(pop, items);
+	concurrent_test(pop, items, concurrency);
+	string_key_test(pop, *pop.root()->string_map, items);
+	string_key_test(pop, *pop.root()->hetero_map, items);
+
+	nvobj::transaction::run(pop, [&] {
+		auto r = pop.root();
+		nvobj::delete_persistent<int_map_type>(r->int_map);
+		nvobj::delete_persistent<string_map_type>(r->string_map);
+		nvobj::delete_persistent<hetero_map_type>(r->hetero_map);
+	});
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
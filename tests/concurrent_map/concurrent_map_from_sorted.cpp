@@ -0,0 +1,313 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * concurrent_map_from_sorted.cpp -- pmem::obj::experimental::concurrent_map
+ * bulk load tests (range constructor and from_sorted), also with the
+ * null_mutex policy
+ */
+
+#include "unittest.hpp"
+
+#include <libpmemobj++/detail/common.hpp>
+#include <libpmemobj++/experimental/concurrent_map.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#define LAYOUT "concurrent_map_from_sorted"
+
+namespace nvobj = pmem::obj;
+namespace nvobjex = pmem::obj::experimental;
+
+namespace
+{
+
+using map_type = nvobjex::concurrent_map<nvobj::p<int>, nvobj::p<int>>;
+using single_map_type = nvobjex::concurrent_map<
+	nvobj::p<int>, nvobj::p<int>, std::less<nvobj::p<int>>,
+	nvobj::allocator<
+		pmem::detail::pair<const nvobj::p<int>, nvobj::p<int>>>,
+	nvobjex::null_mutex>;
+
+struct root {
+	nvobj::persistent_ptr<map_type> map;
+	nvobj::persistent_ptr<map_type> ctor_map;
+	nvobj::persistent_ptr<single_map_type> single_map;
+};
+
+using input_type = std::vector<std::pair<int, int>>;
+
+template <typename MapType>
+void
+verify(MapType &map, int items)
+{
+	UT_ASSERTeq(map.size(), static_cast<size_t>(items));
+	UT_ASSERTeq(static_cast<size_t>(std::distance(map.begin(), map.end())),
+		    static_cast<size_t>(items));
+
+	int expected = 0;
+	for (auto &e : map) {
+		UT_ASSERTeq(e.first, expected);
+		UT_ASSERTeq(e.second, expected);
+		++expected;
+	}
+
+	for (int i = 0; i < items; ++i) {
+		auto it = map.find(i);
+		UT_ASSERT(it != map.end());
+		UT_ASSERTeq(it->second, i);
+
+		/* every level of a node has to keep the order */
+		auto lb = map.lower_bound(i);
+		UT_ASSERT(lb == it);
+	}
+
+	UT_ASSERT(map.find(items) == map.end());
+}
+
+/*
+ * Sorted input, appending to a non-empty map, unsorted and duplicated keys.
+ */
+template <typename MapType>
+void
+from_sorted_test(nvobj::pool<root> &pop, MapType &map, int items)
+{
+	input_type sorted;
+	for (int i = 0; i < items / 2; ++i)
+		sorted.emplace_back(i, i);
+
+	map.from_sorted(sorted.begin(), sorted.end());
+	verify(map, items / 2);
+
+	/* appends after the last element */
+	input_type tail;
+	for (int i = items / 2; i < items; ++i)
+		tail.emplace_back(i, i);
+	map.from_sorted(tail.begin(), tail.end());
+	verify(map, items);
+
+	/* duplicates are not inserted and do not leak */
+	int allocs = num_allocs(pop);
+	map.from_sorted(sorted.begin(), sorted.end());
+	verify(map, items);
+	UT_ASSERTeq(num_allocs(pop), allocs);
+
+	/* out of order input falls back to regular inserts */
+	map.clear();
+	input_type unsorted;
+	for (int i = 0; i < items; ++i)
+		unsorted.emplace_back((i * 7) % items, (i * 7) % items);
+	unsorted.emplace_back(0, 1);
+	map.from_sorted(unsorted.begin(), unsorted.end());
+	verify(map, items);
+
+	/* elements inserted later are still correctly linked */
+	map.clear();
+	map.from_sorted(sorted.begin(), sorted.end());
+	for (int i = items - 1; i >= items / 2; --i)
+		UT_ASSERT(map.emplace(i, i).second);
+	verify(map, items);
+}
+
+/*
+ * Aborted bulk load leaves the map unchanged, also when elements were
+ * inserted out of order between the existing ones.
+ */
+void
+abort_test(nvobj::pool<root> &pop, int items)
+{
+	auto &map = *pop.root()->map;
+	map.clear();
+
+	input_type sorted;
+	for (int i = 0; i < items; ++i)
+		sorted.emplace_back(i, i);
+
+	try {
+		nvobj::transaction::run(pop, [&] {
+			map.from_sorted(sorted.begin(), sorted.end());
+			nvobj::transaction::abort(EINVAL);
+		});
+		UT_ASSERT(0);
+	} catch (pmem::manual_tx_abort &) {
+	}
+
+	UT_ASSERTeq(map.size(), 0);
+	UT_ASSERT(map.begin() == map.end());
+
+	map.from_sorted(sorted.begin(), sorted.end());
+	verify(map, items);
+
+	map.clear();
+	input_type even, odd;
+	for (int i = 0; i < items; ++i) {
+		if (i % 2 == 0)
+			even.emplace_back(i, i);
+		else
+			odd.emplace_back(items - i, items - i);
+	}
+	map.from_sorted(even.begin(), even.end());
+
+	try {
+		nvobj::transaction::run(pop, [&] {
+			map.from_sorted(odd.begin(), odd.end());
+			nvobj::transaction::abort(EINVAL);
+		});
+		UT_ASSERT(0);
+	} catch (pmem::manual_tx_abort &) {
+	}
+
+	UT_ASSERTeq(map.size(), even.size());
+	UT_ASSERTeq(static_cast<size_t>(std::distance(map.begin(), map.end())),
+		    even.size());
+	for (int i = 0; i < items; ++i) {
+		auto it = map.lower_bound(i);
+		int expected = i % 2 == 0 ? i : i + 1;
+		if (expected >= items) {
+			UT_ASSERT(it == map.end());
+			continue;
+		}
+
+		UT_ASSERT(it != map.end());
+		UT_ASSERTeq(it->first, expected);
+	}
+
+	map.from_sorted(odd.begin(), odd.end());
+	verify(map, items);
+}
+
+/*
+ * Returns the difference between the sizes of the largest and the smallest
+ * skip list node in the pool, dummy heads (the largest objects) excluded.
+ */
+size_t
+node_size_range(nvobj::pool<root> &pop)
+{
+	std::vector<size_t> sizes;
+	for (auto oid = pmemobj_first(pop.handle()); !OID_IS_NULL(oid);
+	     oid = pmemobj_next(oid)) {
+		if (pmemobj_type_num(oid) == pmem::detail::type_num<uint8_t>())
+			sizes.push_back(pmemobj_alloc_usable_size(oid));
+	}
+
+	std::sort(sizes.begin(), sizes.end());
+	sizes.erase(std::lower_bound(sizes.begin(), sizes.end(), sizes.back()),
+		    sizes.end());
+	UT_ASSERT(!sizes.empty());
+
+	return sizes.back() - sizes.front();
+}
+
+/*
+ * Levels of bulk loaded nodes are generated for the final size of the map,
+ * not for its size before the load (at most 2 levels for an empty map).
+ * Every level adds one self-relative pointer to the node, with 10000
+ * elements a node with 9 levels is all but certain.
+ */
+void
+heights_test(nvobj::pool<root> &pop)
+{
+	auto r = pop.root();
+	int items = 10000;
+	size_t min_range = 8 * sizeof(std::ptrdiff_t);
+
+	input_type sorted;
+	for (int i = 0; i < items; ++i)
+		sorted.emplace_back(i, i);
+
+	nvobj::transaction::run(
+		pop, [&] { r->map = nvobj::make_persistent<map_type>(); });
+	r->map->from_sorted(sorted.begin(), sorted.end());
+	verify(*r->map, items);
+	UT_ASSERT(node_size_range(pop) >= min_range);
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<map_type>(r->map);
+		r->ctor_map = nvobj::make_persistent<map_type>(sorted.begin(),
+							       sorted.end());
+	});
+	verify(*r->ctor_map, items);
+	UT_ASSERT(node_size_range(pop) >= min_range);
+
+	nvobj::transaction::run(
+		pop, [&] { nvobj::delete_persistent<map_type>(r->ctor_map); });
+}
+
+} /* namespace */
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc < 2) {
+		UT_FATAL("usage: %s file-name", argv[0]);
+	}
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	int items = 1000;
+
+	try {
+		pop = nvobj::pool<root>::create(
+			path, LAYOUT, PMEMOBJ_MIN_POOL * 20, S_IWUSR | S_IRUSR);
+
+		input_type sorted;
+		for (int i = 0; i < items; ++i)
+			sorted.emplace_back(i, i);
+
+		nvobj::transaction::run(pop, [&] {
+			auto r = pop.root();
+			r->map = nvobj::make_persistent<map_type>();
+			r->ctor_map = nvobj::make_persistent<map_type>(
+				sorted.begin(), sorted.end());
+			r->single_map =
+				nvobj::make_persistent<single_map_type>();
+		});
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	verify(*pop.root()->ctor_map, items);
+
+	from_sorted_test(pop, *pop.root()->map, items);
+	from_sorted_test(pop, *pop.root()->single_map, items);
+	abort_test(pop, items);
+
+	pop.close();
+
+	pop = nvobj::pool<root>::open(path, LAYOUT);
+
+	auto r = pop.root();
+	r->map->runtime_initialize();
+	r->ctor_map->runtime_initialize();
+	r->single_map->runtime_initialize();
+
+	verify(*r->map, items);
+	verify(*r->ctor_map, items);
+	verify(*r->single_map, items);
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<map_type>(r->map);
+		nvobj::delete_persistent<map_type>(r->ctor_map);
+		nvobj::delete_persistent<single_map_type>(r->single_map);
+	});
+
+	heights_test(pop);
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
@@ -0,0 +1,199 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * concurrent_map_key_prefix.cpp -- pmem::obj::experimental::concurrent_map
+ * with key_prefix_less comparator, checks that the order and lookups are the
+ * same as for std::map with std::string keys
+ */
+
+#include "thread_helpers.hpp"
+#include "unittest.hpp"
+
+#include <libpmemobj++/container/string.hpp>
+#include <libpmemobj++/experimental/concurrent_map.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#define LAYOUT "concurrent_map_key_prefix"
+
+namespace nvobj = pmem::obj;
+namespace nvobjex = pmem::obj::experimental;
+
+namespace
+{
+
+using map_type = nvobjex::concurrent_map<nvobj::string, nvobj::p<int>,
+					 nvobjex::key_prefix_less>;
+
+struct root {
+	nvobj::persistent_ptr<map_type> map;
+};
+
+/*
+ * Keys which are decided by the prefix and keys which share the whole
+ * prefix, keys shorter than the prefix, embedded zeros and bytes with the
+ * highest bit set.
+ */
+std::vector<std::string>
+gen_keys(int items)
+{
+	std::vector<std::string> keys;
+	const std::string common = "common_prefix_";
+
+	for (int i = 0; i < items; ++i) {
+		auto n = std::to_string(i);
+		keys.push_back(n);
+		keys.push_back(common + n);
+		keys.push_back(
+			std::string(1, static_cast<char>(128 + i % 128)) + n);
+		keys.push_back(std::string("ab\0", 3) + n);
+	}
+
+	keys.push_back("");
+	keys.push_back("a");
+	keys.push_back(std::string("a\0", 2));
+	keys.push_back(std::string("a\0\0\0\0\0\0\0", 8));
+	keys.push_back(std::string("a\0\0\0\0\0\0\0\0", 9));
+	keys.push_back("\xff\xff\xff\xff\xff\xff\xff\xff");
+	keys.push_back("\xff\xff\xff\xff\xff\xff\xff\xff\x01");
+	keys.push_back(common);
+
+	return keys;
+}
+
+void
+verify(map_type &map, const std::map<std::string, int> &expected)
+{
+	UT_ASSERTeq(map.size(), expected.size());
+
+	auto it = map.begin();
+	for (auto &e : expected) {
+		UT_ASSERT(it != map.end());
+		UT_ASSERT(it->first == e.first);
+		UT_ASSERTeq(it->second, e.second);
+		++it;
+	}
+	UT_ASSERT(it == map.end());
+
+	for (auto &e : expected) {
+		auto found = map.find(e.first);
+		UT_ASSERT(found != map.end());
+		UT_ASSERTeq(found->second, e.second);
+
+		UT_ASSERT(map.lower_bound(e.first) == found);
+
+		auto upper = map.upper_bound(e.first);
+		auto expected_upper = expected.upper_bound(e.first);
+		if (expected_upper == expected.end())
+			UT_ASSERT(upper == map.end());
+		else
+			UT_ASSERT(upper->first == expected_upper->first);
+
+		/* a key which is not in the map, right after e.first */
+		auto missing = e.first + std::string(1, '\0') + "missing";
+		UT_ASSERT(map.find(missing) == map.end());
+		auto lb = map.lower_bound(missing);
+		auto expected_lb = expected.lower_bound(missing);
+		if (expected_lb == expected.end())
+			UT_ASSERT(lb == map.end());
+		else
+			UT_ASSERT(lb->first == expected_lb->first);
+	}
+}
+
+void
+insert_test(nvobj::pool<root> &pop, const std::vector<std::string> &keys,
+	    size_t concurrency)
+{
+	auto &map = *pop.root()->map;
+
+	std::map<std::string, int> expected;
+	for (size_t i = 0; i < keys.size(); ++i)
+		expected.emplace(keys[i], static_cast<int>(i));
+
+	parallel_exec(concurrency, [&](size_t thread_id) {
+		for (size_t i = thread_id; i < keys.size(); i += concurrency) {
+			auto ret = map.emplace(keys[i], static_cast<int>(i));
+			UT_ASSERT(ret.second);
+		}
+	});
+
+	verify(map, expected);
+
+	/* duplicates */
+	for (size_t i = 0; i < keys.size(); ++i) {
+		auto ret = map.emplace(keys[i], -1);
+		UT_ASSERT(!ret.second);
+		UT_ASSERTeq(ret.first->second, static_cast<int>(i));
+	}
+
+	/* C string lookup */
+	UT_ASSERT(map.find("common_prefix_") != map.end());
+	UT_ASSERT(map.find("common_prefix") == map.end());
+}
+
+} /* namespace */
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc < 2) {
+		UT_FATAL("usage: %s file-name", argv[0]);
+	}
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<root>::create(
+			path, LAYOUT, PMEMOBJ_MIN_POOL * 20, S_IWUSR | S_IRUSR);
+		nvobj::transaction::run(pop, [&] {
+			pop.root()->map = nvobj::make_persistent<map_type>();
+		});
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	int items = 300;
+	size_t concurrency = 8;
+	if (On_drd) {
+		items = 50;
+		concurrency = 2;
+	}
+
+	auto keys = gen_keys(items);
+	insert_test(pop, keys, concurrency);
+
+	pop.close();
+
+	pop = nvobj::pool<root>::open(path, LAYOUT);
+
+	auto &map = *pop.root()->map;
+	map.runtime_initialize();
+
+	std::map<std::string, int> expected;
+	for (size_t i = 0; i < keys.size(); ++i)
+		expected.emplace(keys[i], static_cast<int>(i));
+	verify(map, expected);
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<map_type>(pop.root()->map);
+	});
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
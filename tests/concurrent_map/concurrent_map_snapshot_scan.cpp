@@ -0,0 +1,219 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * concurrent_map_snapshot_scan.cpp -- pmem::obj::experimental::concurrent_map
+ * snapshot_scan tests, checks that a scan running concurrently with inserts
+ * returns a consistent snapshot of the range
+ */
+
+#include "thread_helpers.hpp"
+#include "unittest.hpp"
+
+#include <libpmemobj++/experimental/concurrent_map.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include <atomic>
+#include <initializer_list>
+#include <vector>
+
+#define LAYOUT "concurrent_map_snapshot_scan"
+
+namespace nvobj = pmem::obj;
+namespace nvobjex = pmem::obj::experimental;
+
+namespace
+{
+
+using map_type = nvobjex::concurrent_map<nvobj::p<int>, nvobj::p<int>>;
+
+struct root {
+	nvobj::persistent_ptr<map_type> map;
+};
+
+std::vector<int>
+scan(map_type &map, int first, int last, size_t batch_size)
+{
+	std::vector<int> keys;
+
+	map.snapshot_scan(
+		first, last,
+		[&](const map_type::scan_batch_type &batch) {
+			UT_ASSERT(batch.size() > 0);
+			UT_ASSERT(batch.size() <= batch_size);
+			for (auto e : batch) {
+				UT_ASSERTeq(e->first, e->second);
+				keys.push_back(e->first);
+			}
+		},
+		batch_size);
+
+	return keys;
+}
+
+/*
+ * Scans of a map which is not modified.
+ */
+void
+range_test(nvobj::pool<root> &pop, int items)
+{
+	auto &map = *pop.root()->map;
+
+	for (int i = 0; i < items; i += 2)
+		map.emplace(i, i);
+
+	for (size_t batch_size : {size_t(1), size_t(7), size_t(64)}) {
+		auto keys = scan(map, 0, items, batch_size);
+		UT_ASSERTeq(keys.size(), static_cast<size_t>(items / 2));
+		for (size_t i = 0; i < keys.size(); ++i)
+			UT_ASSERTeq(keys[i], static_cast<int>(2 * i));
+
+		/* bounds which are not in the map */
+		keys = scan(map, 3, 11, batch_size);
+		UT_ASSERTeq(keys.size(), 4);
+		UT_ASSERTeq(keys[0], 4);
+		UT_ASSERTeq(keys[3], 10);
+
+		UT_ASSERT(scan(map, items, items + 10, batch_size).empty());
+		UT_ASSERT(scan(map, 5, 5, batch_size).empty());
+	}
+
+	size_t count = 0;
+	map.snapshot_scan([&](const map_type::scan_batch_type &batch) {
+		count += batch.size();
+	});
+	UT_ASSERTeq(count, map.size());
+}
+
+/*
+ * A single writer inserts odd keys in ascending order. A consistent
+ * snapshot contains all even keys and a prefix of the odd keys.
+ */
+void
+concurrent_test(nvobj::pool<root> &pop, int items, size_t concurrency)
+{
+	auto &map = *pop.root()->map;
+	std::atomic<bool> done(false);
+
+	parallel_exec(concurrency, [&](size_t thread_id) {
+		if (thread_id == 0) {
+			for (int i = 1; i < items; i += 2)
+				map.emplace(i, i);
+			done = true;
+			return;
+		}
+
+		do {
+			auto keys = scan(map, 0, items, 16);
+
+			int odd = 0;
+			for (size_t i = 1; i < keys.size(); ++i)
+				UT_ASSERT(keys[i - 1] < keys[i]);
+			for (auto k : keys) {
+				if (k % 2 == 0)
+					continue;
+				UT_ASSERTeq(k, 2 * odd + 1);
+				++odd;
+			}
+			UT_ASSERTeq(keys.size(),
+				    static_cast<size_t>(items / 2 + odd));
+		} while (!done);
+	});
+
+	auto keys = scan(map, 0, items, 16);
+	UT_ASSERTeq(keys.size(), static_cast<size_t>(items));
+}
+
+/*
+ * Elements inserted by the constructor out of order, in the transaction
+ * which creates the map, are visible to all scans.
+ */
+void
+tx_insert_test(nvobj::pool<root> &pop)
+{
+	nvobj::persistent_ptr<map_type> map;
+	nvobj::transaction::run(pop, [&] {
+		map = nvobj::make_persistent<map_type>(
+			std::initializer_list<map_type::value_type>{
+				{2, 2}, {1, 1}, {4, 4}, {3, 3}});
+	});
+
+	auto keys = scan(*map, 0, 10, 64);
+	UT_ASSERTeq(keys.size(), 4);
+	for (size_t i = 0; i < keys.size(); ++i)
+		UT_ASSERTeq(keys[i], static_cast<int>(i + 1));
+
+	map->emplace(0, 0);
+	UT_ASSERTeq(scan(*map, 0, 10, 64).size(), 5);
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<map_type>(map);
+	});
+}
+
+} /* namespace */
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc < 2) {
+		UT_FATAL("usage: %s file-name", argv[0]);
+	}
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<root>::create(
+			path, LAYOUT, PMEMOBJ_MIN_POOL * 20, S_IWUSR | S_IRUSR);
+		nvobj::transaction::run(pop, [&] {
+			pop.root()->map = nvobj::make_persistent<map_type>();
+		});
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	int items = 2000;
+	size_t concurrency = 4;
+	if (On_drd) {
+		items = 200;
+		concurrency = 2;
+	}
+
+	range_test(pop, items);
+	pop.root()->map->clear();
+	range_test(pop, items);
+	concurrent_test(pop, items, concurrency);
+	tx_insert_test(pop);
+
+	pop.close();
+
+	/* nodes inserted before reopening are visible to all scans */
+	pop = nvobj::pool<root>::open(path, LAYOUT);
+
+	auto &map = *pop.root()->map;
+	map.runtime_initialize();
+
+	UT_ASSERTeq(scan(map, 0, items, 64).size(), static_cast<size_t>(items));
+
+	map.emplace(items, items);
+	UT_ASSERTeq(scan(map, 0, items + 1, 64).size(),
+		    static_cast<size_t>(items + 1));
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<map_type>(pop.root()->map);
+	});
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: BSD-3-Clause
-/* Copyright 2020, Intel Corporation */
+/* Copyright 2020-2021, Intel Corporation */
 
 #include "unittest.hpp"
 
@@ -21,6 +21,7 @@ struct root {
 	nvobj::persistent_ptr<int> i;
 	nvobj::persistent_ptr<char> c;
 	nvobj::persistent_ptr<double> d;
+	nvobj::persistent_ptr<int> many[64];
 };
 
 void
@@ -147,6 +148,57 @@ test_try_add_wrong_pointer(nvobj::pool<root> &pop, std::string path)
 				[&] { nvobj::delete_persistent<double>(d); });
 	pop_test.close();
 }
+
+/*
+ * Pointers are split between threads, results of all of them are summed up.
+ */
+void
+test_parallel(nvobj::pool<root> &pop)
+{
+	auto r = pop.root();
+
+	nvobj::transaction::run(pop, [&] {
+		for (int i = 0; i < 64; ++i)
+			r->many[i] = nvobj::make_persistent<int>(i);
+	});
+
+	size_t concurrencies[] = {1, 3, 4, 100};
+	for (size_t concurrency : concurrencies) {
+		nvobj::defrag my_defrag(pop);
+		for (auto &ptr : r->many)
+			my_defrag.add(ptr);
+
+		pobj_defrag_result res;
+		try {
+			res = my_defrag.run(concurrency);
+		} catch (pmem::defrag_error &) {
+			UT_ASSERT(0);
+		}
+
+		UT_ASSERTeq(res.total, 64);
+		UT_ASSERT(res.relocated <= res.total);
+	}
+
+	for (int i = 0; i < 64; ++i)
+		UT_ASSERTeq(*r->many[i], i);
+
+	try {
+		nvobj::transaction::run(pop, [&] {
+			nvobj::defrag my_defrag(pop);
+			my_defrag.add(r->many[0]);
+			my_defrag.run(4);
+		});
+		UT_ASSERT(0);
+	} catch (pmem::transaction_scope_error &) {
+	} catch (...) {
+		UT_ASSERT(0);
+	}
+
+	nvobj::transaction::run(pop, [&] {
+		for (auto &ptr : r->many)
+			nvobj::delete_persistent<int>(ptr);
+	});
+}
 }
 
 static void
@@ -169,6 +221,7 @@ test(int argc, char *argv[])
 	test_basic(pop);
 	test_add_empty(pop);
 	test_try_add_wrong_pointer(pop, std::string(path) + "_tmp");
+	test_parallel(pop);
 
 	pop.close();
 }
@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+#include "unittest.hpp"
+
+#include <libpmemobj++/container/string.hpp>
+#include <libpmemobj++/defrag.hpp>
+#include <libpmemobj++/experimental/concurrent_map.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pexceptions.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+#include <libpmemobj/atomic_base.h>
+
+#include <string>
+
+namespace nvobj = pmem::obj;
+namespace nvobjex = pmem::obj::experimental;
+
+namespace
+{
+
+struct hetero_less {
+	using is_transparent = void;
+	template <typename T1, typename T2>
+	bool
+	operator()(const T1 &lhs, const T2 &rhs) const
+	{
+		return lhs < rhs;
+	}
+};
+
+using map_type =
+	nvobjex::concurrent_map<nvobj::string, nvobj::string, hetero_less>;
+
+struct root {
+	nvobj::persistent_ptr<map_type> m;
+};
+
+std::string
+key_of(int i)
+{
+	/* long enough not to fit in the SSO buffer */
+	return std::string(32, 'k') + std::to_string(i);
+}
+
+std::string
+value_of(int i)
+{
+	return std::string(64, 'v') + std::to_string(i);
+}
+
+size_t
+count_ptrs(map_type &m)
+{
+	size_t count = 0;
+	m.for_each_ptr([&](nvobj::persistent_ptr_base &ptr) {
+		if (ptr.raw().off != 0)
+			++count;
+	});
+
+	return count;
+}
+
+/*
+ * Pointers stored in both keys and values are defragmented, nodes are linked
+ * with self-relative pointers. The map holds a self-relative pointer to its
+ * head node, so it is added by reference and is not relocated.
+ */
+void
+test_defrag(nvobj::pool<root> &pop)
+{
+	static_assert(nvobj::is_defragmentable<map_type>(),
+		      "should not assert");
+
+	auto r = pop.root();
+	nvobj::transaction::run(
+		pop, [&] { r->m = nvobj::make_persistent<map_type>(); });
+	r->m->runtime_initialize();
+
+	const int items = 100;
+	for (int i = 0; i < items; ++i)
+		r->m->emplace(key_of(i), value_of(i));
+
+	/* short strings do not allocate */
+	r->m->emplace("a", "b");
+
+	UT_ASSERTeq(count_ptrs(*r->m), 2 * items);
+
+	for (size_t concurrency = 1; concurrency <= 4; ++concurrency) {
+		nvobj::defrag my_defrag(pop);
+		my_defrag.add(*r->m);
+
+		pobj_defrag_result res;
+		try {
+			res = my_defrag.run(concurrency);
+		} catch (pmem::defrag_error &) {
+			UT_ASSERT(0);
+		}
+
+		UT_ASSERTeq(res.total, 2 * items);
+	}
+
+	for (int i = 0; i < items; ++i) {
+		auto it = r->m->find(key_of(i));
+		UT_ASSERT(it != r->m->end());
+		UT_ASSERT(it->second == value_of(i));
+	}
+
+	r->m->free_data();
+	nvobj::transaction::run(
+		pop, [&] { nvobj::delete_persistent<map_type>(r->m); });
+}
+}
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc != 2)
+		UT_FATAL("usage: %s file-name", argv[0]);
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<struct root>::create(
+			path, "layout", PMEMOBJ_MIN_POOL, S_IWUSR | S_IRUSR);
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	test_defrag(pop);
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
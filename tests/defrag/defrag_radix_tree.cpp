@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+#include "unittest.hpp"
+
+#include <libpmemobj++/container/string.hpp>
+#include <libpmemobj++/defrag.hpp>
+#include <libpmemobj++/experimental/inline_string.hpp>
+#include <libpmemobj++/experimental/radix_tree.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pexceptions.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+#include <libpmemobj/atomic_base.h>
+
+#include <string>
+
+namespace nvobj = pmem::obj;
+namespace nvobjex = pmem::obj::experimental;
+
+namespace
+{
+
+using tree_string_type = nvobjex::radix_tree<unsigned, nvobj::string>;
+using tree_inline_type =
+	nvobjex::radix_tree<nvobjex::inline_string, nvobjex::inline_string>;
+
+struct root {
+	nvobj::persistent_ptr<tree_string_type> ts;
+	nvobj::persistent_ptr<tree_inline_type> ti;
+};
+
+std::string
+value_of(unsigned key)
+{
+	/* long enough not to fit in the SSO buffer */
+	return std::string(64, 'x') + std::to_string(key);
+}
+
+template <typename Tree>
+size_t
+count_ptrs(Tree &t)
+{
+	size_t count = 0;
+	t.for_each_ptr([&](nvobj::persistent_ptr_base &ptr) {
+		if (ptr.raw().off != 0)
+			++count;
+	});
+
+	return count;
+}
+
+/*
+ * Only pointers stored in values are defragmented, leaves and internal nodes
+ * are linked with self-relative pointers. The tree holds a self-relative
+ * pointer to its root, so it is added by reference and is not relocated.
+ */
+void
+test_string_values(nvobj::pool<root> &pop)
+{
+	static_assert(nvobj::is_defragmentable<tree_string_type>(),
+		      "should not assert");
+
+	auto r = pop.root();
+	nvobj::transaction::run(pop, [&] {
+		r->ts = nvobj::make_persistent<tree_string_type>();
+	});
+
+	const unsigned items = 100;
+	for (unsigned i = 0; i < items; ++i)
+		r->ts->try_emplace(i, value_of(i));
+
+	/* short strings do not allocate */
+	r->ts->try_emplace(items, "a");
+
+	UT_ASSERTeq(count_ptrs(*r->ts), items);
+
+	for (size_t concurrency = 1; concurrency <= 4; ++concurrency) {
+		nvobj::defrag my_defrag(pop);
+		my_defrag.add(*r->ts);
+
+		pobj_defrag_result res;
+		try {
+			res = my_defrag.run(concurrency);
+		} catch (pmem::defrag_error &) {
+			UT_ASSERT(0);
+		}
+
+		UT_ASSERTeq(res.total, items);
+	}
+
+	for (unsigned i = 0; i < items; ++i) {
+		auto it = r->ts->find(i);
+		UT_ASSERT(it != r->ts->end());
+		UT_ASSERT(it->value() == value_of(i));
+	}
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<tree_string_type>(r->ts);
+	});
+}
+
+void
+test_inline_values(nvobj::pool<root> &pop)
+{
+	static_assert(nvobj::is_defragmentable<tree_inline_type>(),
+		      "should not assert");
+
+	auto r = pop.root();
+	nvobj::transaction::run(pop, [&] {
+		r->ti = nvobj::make_persistent<tree_inline_type>();
+	});
+
+	for (unsigned i = 0; i < 100; ++i)
+		r->ti->try_emplace(std::to_string(i), value_of(i));
+
+	UT_ASSERTeq(count_ptrs(*r->ti), 0);
+
+	nvobj::defrag my_defrag(pop);
+	my_defrag.add(*r->ti);
+
+	pobj_defrag_result res;
+	try {
+		res = my_defrag.run(2);
+	} catch (pmem::defrag_error &) {
+		UT_ASSERT(0);
+	}
+
+	UT_ASSERTeq(res.total, 0);
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<tree_inline_type>(r->ti);
+	});
+}
+}
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc != 2)
+		UT_FATAL("usage: %s file-name", argv[0]);
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<struct root>::create(
+			path, "layout", PMEMOBJ_MIN_POOL, S_IWUSR | S_IRUSR);
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	test_string_values(pop);
+	test_inline_values(pop);
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+#include "unittest.hpp"
+
+#include <libpmemobj++/container/segment_vector.hpp>
+#include <libpmemobj++/container/vector.hpp>
+#include <libpmemobj++/defrag.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pexceptions.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+#include <libpmemobj/atomic_base.h>
+
+namespace nvobj = pmem::obj;
+
+namespace
+{
+
+using vector_type = nvobj::segment_vector<int>;
+using array_vector_type =
+	nvobj::segment_vector<int, nvobj::exponential_size_array_policy<>>;
+using fixed_vector_type =
+	nvobj::segment_vector<int, nvobj::fixed_size_vector_policy<16>>;
+using nested_vector_type = nvobj::segment_vector<nvobj::vector<int>>;
+
+struct root {
+	nvobj::persistent_ptr<vector_type> v;
+	nvobj::persistent_ptr<array_vector_type> va;
+	nvobj::persistent_ptr<fixed_vector_type> vf;
+	nvobj::persistent_ptr<nested_vector_type> vv;
+};
+
+template <typename Vector>
+size_t
+count_ptrs(Vector &v)
+{
+	size_t count = 0;
+	v.for_each_ptr([&](nvobj::persistent_ptr_base &ptr) {
+		if (ptr.raw().off != 0)
+			++count;
+	});
+
+	return count;
+}
+
+template <typename Vector>
+void
+test_defrag(nvobj::pool<root> &pop, nvobj::persistent_ptr<Vector> &v,
+	    size_t segments)
+{
+	static_assert(nvobj::is_defragmentable<Vector>(), "should not assert");
+
+	nvobj::transaction::run(pop,
+				[&] { v = nvobj::make_persistent<Vector>(); });
+
+	UT_ASSERTeq(count_ptrs(*v), 0);
+
+	for (int i = 0; i < 100; ++i)
+		v->push_back(i);
+
+	size_t ptrs = count_ptrs(*v);
+	UT_ASSERTeq(ptrs, segments);
+
+	for (size_t concurrency = 1; concurrency <= 4; ++concurrency) {
+		nvobj::defrag my_defrag(pop);
+		my_defrag.add(v);
+
+		pobj_defrag_result res;
+		try {
+			res = my_defrag.run(concurrency);
+		} catch (pmem::defrag_error &) {
+			UT_ASSERT(0);
+		}
+
+		/* vector object itself + its internal pointers */
+		UT_ASSERTeq(res.total, ptrs + 1);
+	}
+
+	for (int i = 0; i < 100; ++i)
+		UT_ASSERTeq((*v)[static_cast<size_t>(i)], i);
+
+	nvobj::transaction::run(pop,
+				[&] { nvobj::delete_persistent<Vector>(v); });
+}
+
+/*
+ * Pointers to the data of the inner vectors are stored in the segments of
+ * the outer vector, so they have to be defragmented together with them,
+ * also when run in parallel.
+ */
+void
+test_defrag_nested(nvobj::pool<root> &pop)
+{
+	auto &v = pop.root()->vv;
+
+	nvobj::transaction::run(
+		pop, [&] { v = nvobj::make_persistent<nested_vector_type>(); });
+
+	for (int i = 0; i < 100; ++i)
+		v->emplace_back(static_cast<size_t>(i % 10 + 1), i);
+
+	size_t ptrs = count_ptrs(*v);
+	/* segments of sizes 2, 2, 4, ..., 64 and the vector of segments */
+	UT_ASSERTeq(ptrs, 7 + 1);
+
+	for (size_t concurrency = 1; concurrency <= 8; ++concurrency) {
+		nvobj::defrag my_defrag(pop);
+		my_defrag.add(v);
+		for (auto &inner : *v)
+			my_defrag.add(inner);
+
+		pobj_defrag_result res;
+		try {
+			res = my_defrag.run(concurrency);
+		} catch (pmem::defrag_error &) {
+			UT_ASSERT(0);
+		}
+
+		/* outer vector, its internal pointers and inner vectors */
+		UT_ASSERTeq(res.total, ptrs + 1 + 100);
+	}
+
+	for (int i = 0; i < 100; ++i) {
+		auto &inner = (*v)[static_cast<size_t>(i)];
+		UT_ASSERTeq(inner.size(), static_cast<size_t>(i % 10 + 1));
+		for (auto &e : inner)
+			UT_ASSERTeq(e, i);
+	}
+
+	nvobj::transaction::run(
+		pop, [&] { nvobj::delete_persistent<nested_vector_type>(v); });
+}
+}
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc != 2)
+		UT_FATAL("usage: %s file-name", argv[0]);
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<struct root>::create(path, "layout",
+						       PMEMOBJ_MIN_POOL * 2,
+						       S_IWUSR | S_IRUSR);
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	/* segments of sizes 2, 2, 4, ..., 64 and the vector of segments */
+	test_defrag(pop, pop.root()->v, 7 + 1);
+	/* segments are stored in an array */
+	test_defrag(pop, pop.root()->va, 7);
+	/* 7 segments of size 16 and the vector of segments */
+	test_defrag(pop, pop.root()->vf, 7 + 1);
+	test_defrag_nested(pop);
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
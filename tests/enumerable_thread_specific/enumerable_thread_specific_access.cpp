@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: BSD-3-Clause
-/* Copyright 2019-2020, Intel Corporation */
+/* Copyright 2019-2021, Intel Corporation */
 
 #include "unittest.hpp"
 
@@ -13,7 +13,11 @@ namespace nvobj = pmem::obj;
 
 using test_t = std::size_t;
 
+#ifdef ENUMERABLE_THREAD_SPECIFIC_PADDED
+using container_type = pmem::detail::padded_enumerable_thread_specific<test_t>;
+#else
 using container_type = pmem::detail::enumerable_thread_specific<test_t>;
+#endif
 
 struct root {
 	nvobj::persistent_ptr<container_type> pptr;
@@ -190,6 +194,36 @@ test_multiple_tls(nvobj::pool<struct root> &pop)
 	}
 }
 
+#ifdef ENUMERABLE_THREAD_SPECIFIC_PADDED
+/*
+ * Elements of different threads must not share a cache line.
+ */
+void
+test_padding(nvobj::pool<struct root> &pop, size_t concurrency)
+{
+	auto tls = pop.root()->pptr;
+
+	parallel_exec_with_sync(concurrency, [&](size_t thread_index) {
+		tls->local() = thread_index;
+		pop.persist(&tls->local(), sizeof(tls->local()));
+	});
+
+	UT_ASSERTeq(tls->size(), concurrency);
+
+	uintptr_t prev_end = 0;
+	for (auto &e : *tls) {
+		auto begin = reinterpret_cast<uintptr_t>(&e);
+		if (prev_end != 0 && begin > prev_end)
+			UT_ASSERT(begin / pmem::detail::CACHELINE_SIZE !=
+				  (prev_end - 1) /
+					  pmem::detail::CACHELINE_SIZE);
+		prev_end = begin + sizeof(e);
+	}
+
+	tls->clear();
+}
+#endif
+
 static void
 test(int argc, char *argv[])
 {
@@ -214,6 +248,9 @@ test(int argc, char *argv[])
 		test(pop);
 		test_multiple_tls(pop);
 		test_with_spin(pop, 16);
+#ifdef ENUMERABLE_THREAD_SPECIFIC_PADDED
+		test_padding(pop, 16);
+#endif
 
 		if (!On_valgrind) {
 			/*
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: BSD-3-Clause
-/* Copyright 2019-2020, Intel Corporation */
+/* Copyright 2019-2021, Intel Corporation */
 
 #include "unittest.hpp"
 
@@ -8,6 +8,10 @@
 template <typename T>
 using container_type = pmem::detail::enumerable_thread_specific<T>;
 
+template <typename T>
+using padded_container_type =
+	pmem::detail::padded_enumerable_thread_specific<T>;
+
 static void
 test(int argc, char *argv[])
 {
@@ -30,6 +34,23 @@ test(int argc, char *argv[])
 	static_assert(sizeof(container_type<container_type<int>>) == 2128, "");
 
 	static_assert(std::is_standard_layout<container_type<char>>::value, "");
+
+	using pmem::detail::cache_line_padded;
+	using pmem::detail::CACHELINE_SIZE;
+
+	static_assert(sizeof(cache_line_padded<char>) == CACHELINE_SIZE, "");
+	static_assert(sizeof(cache_line_padded<size_t>) == 2 * CACHELINE_SIZE,
+		      "");
+	static_assert(sizeof(cache_line_padded<char[CACHELINE_SIZE]>) ==
+			      2 * CACHELINE_SIZE,
+		      "");
+
+	static_assert(sizeof(padded_container_type<int>) ==
+			      sizeof(container_type<int>),
+		      "");
+	static_assert(
+		std::is_standard_layout<padded_container_type<char>>::value,
+		"");
 }
 
 int
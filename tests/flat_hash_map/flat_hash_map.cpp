@@ -0,0 +1,298 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * flat_hash_map.cpp -- pmem::obj::experimental::flat_hash_map tests, checks
+ * that lookups and erase are the same as for std::map, also after growing,
+ * rehashing, colliding hashes, concurrent inserts and reopening the pool
+ */
+
+#include "thread_helpers.hpp"
+#include "unittest.hpp"
+
+#include <libpmemobj++/experimental/flat_hash_map.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+#define LAYOUT "flat_hash_map"
+
+namespace nvobj = pmem::obj;
+namespace nvobjex = pmem::obj::experimental;
+
+namespace
+{
+
+using int_map_type = nvobjex::flat_hash_map<int, nvobj::p<int>>;
+
+/* all keys have the same hash, so every lookup probes all of them */
+struct collision_hash {
+	size_t
+	operator()(int) const
+	{
+		return 42;
+	}
+};
+
+using collision_map_type =
+	nvobjex::flat_hash_map<int, nvobj::p<int>, collision_hash>;
+
+struct root {
+	nvobj::persistent_ptr<int_map_type> int_map;
+	nvobj::persistent_ptr<collision_map_type> collision_map;
+};
+
+/* Keys are even, so odd numbers may be used as missing keys */
+template <typename MapType>
+void
+verify(MapType &map, const std::map<int, int> &expected)
+{
+	UT_ASSERTeq(map.size(), expected.size());
+	UT_ASSERTeq(map.empty(), expected.empty());
+
+	std::map<int, int> elements;
+	for (auto it = map.begin(); it != map.end(); ++it)
+		UT_ASSERT(elements.emplace(it->first, it->second).second);
+	UT_ASSERT(elements == expected);
+
+	for (auto &e : expected) {
+		typename MapType::const_accessor acc;
+		UT_ASSERT(map.find(acc, e.first));
+		UT_ASSERTeq(acc->first, e.first);
+		UT_ASSERTeq(acc->second, e.second);
+		acc.release();
+		UT_ASSERT(acc.empty());
+
+		UT_ASSERTeq(map.count(e.first), 1);
+		UT_ASSERTeq(map.count(e.first + 1), 0);
+		UT_ASSERT(!map.find(acc, e.first + 1));
+		UT_ASSERT(acc.empty());
+	}
+}
+
+void
+insert_erase_test(nvobj::pool<root> &pop, int items)
+{
+	auto &map = *pop.root()->int_map;
+	std::map<int, int> expected;
+
+	std::vector<int> keys;
+	for (int i = 0; i < items; ++i)
+		keys.push_back(2 * i);
+	std::shuffle(keys.begin(), keys.end(),
+		     std::mt19937(static_cast<unsigned>(items)));
+
+	auto initial_buckets = map.bucket_count();
+	for (auto k : keys) {
+		UT_ASSERT(map.insert(int_map_type::value_type(k, k + 1)));
+		expected.emplace(k, k + 1);
+	}
+	auto buckets = map.bucket_count();
+	UT_ASSERT(buckets > initial_buckets);
+	UT_ASSERT(map.size() <= buckets);
+	verify(map, expected);
+
+	for (auto k : keys)
+		UT_ASSERT(!map.insert(int_map_type::value_type(k, -1)));
+
+	UT_ASSERT(!map.insert_or_assign(keys[0], -1));
+	UT_ASSERT(map.insert_or_assign(2 * items, 1));
+	expected[keys[0]] = -1;
+	expected[2 * items] = 1;
+	verify(map, expected);
+	UT_ASSERT(map.erase(2 * items));
+	expected.erase(2 * items);
+
+	{
+		int_map_type::accessor acc;
+		UT_ASSERT(map.find(acc, keys[1]));
+		acc->second = 7;
+		pop.persist(acc->second);
+		expected[keys[1]] = 7;
+	}
+	verify(map, expected);
+
+	for (int k = 0; k < items; k += 3) {
+		UT_ASSERT(map.erase(2 * k));
+		expected.erase(2 * k);
+	}
+	UT_ASSERT(!map.erase(1));
+	verify(map, expected);
+
+	for (int k = 0; k < items; k += 3) {
+		UT_ASSERT(map.insert(int_map_type::value_type(2 * k, k)));
+		expected.emplace(2 * k, k);
+	}
+	verify(map, expected);
+
+	map.rehash(4 * map.bucket_count());
+	UT_ASSERT(map.bucket_count() > buckets);
+	verify(map, expected);
+
+	/* shrinks back to the size reached by inserting all elements */
+	map.rehash();
+	UT_ASSERTeq(map.bucket_count(), buckets);
+	verify(map, expected);
+
+	map.clear();
+	expected.clear();
+	verify(map, expected);
+	UT_ASSERTeq(map.bucket_count(), int_map_type::group_size);
+}
+
+void
+collision_test(nvobj::pool<root> &pop, int items)
+{
+	auto &map = *pop.root()->collision_map;
+	std::map<int, int> expected;
+
+	for (int i = 0; i < items; ++i) {
+		UT_ASSERT(map.insert(collision_map_type::value_type(2 * i, i)));
+		expected.emplace(2 * i, i);
+	}
+	verify(map, expected);
+
+	/* erased elements in the middle of the probe sequence */
+	for (int i = 0; i < items; i += 2) {
+		UT_ASSERT(map.erase(2 * i));
+		expected.erase(2 * i);
+	}
+	verify(map, expected);
+
+	for (int i = items; i < 2 * items; ++i) {
+		UT_ASSERT(map.insert(collision_map_type::value_type(2 * i, i)));
+		expected.emplace(2 * i, i);
+	}
+	verify(map, expected);
+}
+
+void
+concurrent_test(nvobj::pool<root> &pop, int items, size_t concurrency)
+{
+	auto &map = *pop.root()->int_map;
+
+	parallel_exec(concurrency, [&](size_t thread_id) {
+		if (thread_id == 0) {
+			/* reader */
+			size_t found = 0;
+			for (int i = 0; i < items; ++i)
+				found += map.count(2 * i);
+			UT_ASSERT(found <= static_cast<size_t>(items));
+			return;
+		}
+
+		for (int i = static_cast<int>(thread_id) - 1; i < items;
+		     i += static_cast<int>(concurrency) - 1)
+			UT_ASSERT(map.insert(
+				int_map_type::value_type(2 * i, 2 * i + 1)));
+	});
+
+	std::map<int, int> expected;
+	for (int i = 0; i < items; ++i)
+		expected.emplace(2 * i, 2 * i + 1);
+	verify(map, expected);
+}
+
+void
+tx_test(nvobj::pool<root> &pop)
+{
+	auto &map = *pop.root()->int_map;
+
+	try {
+		nvobj::transaction::run(pop, [&] {
+			map.insert(int_map_type::value_type(1, 1));
+		});
+		UT_ASSERT(0);
+	} catch (pmem::transaction_scope_error &) {
+	}
+
+	UT_ASSERTeq(map.count(1), 0);
+}
+
+} /* namespace */
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc < 2) {
+		UT_FATAL("usage: %s file-name", argv[0]);
+	}
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<root>::create(
+			path, LAYOUT, PMEMOBJ_MIN_POOL * 20, S_IWUSR | S_IRUSR);
+		nvobj::transaction::run(pop, [&] {
+			pop.root()->int_map =
+				nvobj::make_persistent<int_map_type>();
+			pop.root()->collision_map =
+				nvobj::make_persistent<collision_map_type>();
+		});
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	int items = 3000;
+	size_t concurrency = 8;
+	if (On_drd) {
+		items = 300;
+		concurrency = 3;
+	}
+
+	insert_erase_test(pop, items);
+	collision_test(pop, items / 30);
+	concurrent_test(pop, items, concurrency);
+	tx_test(pop);
+
+	pop.close();
+
+	std::map<int, int> expected;
+	for (int i = 0; i < items; ++i)
+		expected.emplace(2 * i, 2 * i + 1);
+
+	/* the size is recounted by runtime_initialize() */
+	pop = nvobj::pool<root>::open(path, LAYOUT);
+	pop.root()->int_map->runtime_initialize();
+	verify(*pop.root()->int_map, expected);
+
+	pop.close();
+
+	/* or by the first operation */
+	pop = nvobj::pool<root>::open(path, LAYOUT);
+	verify(*pop.root()->int_map, expected);
+
+	nvobj::persistent_ptr<int_map_type> copy;
+	nvobj::transaction::run(pop, [&] {
+		copy = nvobj::make_persistent<int_map_type>(
+			pop.root()->int_map->begin(),
+			pop.root()->int_map->end());
+	});
+	verify(*copy, expected);
+
+	nvobj::transaction::run(
+		pop, [&] { nvobj::delete_persistent<int_map_type>(copy); });
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<int_map_type>(pop.root()->int_map);
+		nvobj::delete_persistent<collision_map_type>(
+			pop.root()->collision_map);
+	});
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
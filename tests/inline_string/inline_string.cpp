@@ -328,6 +328,47 @@ test_traits()
 
 	UT_ASSERTeq(pmem::detail::is_inline_string<StringType>::value, true);
 }
+
+/* test inline_string with a narrower size/capacity header */
+template <typename T>
+void
+test_compact_header()
+{
+	using string_type =
+		nvobjex::basic_dram_inline_string<T, std::char_traits<T>,
+						  uint16_t>;
+
+	static_assert(sizeof(string_type) == 2 * sizeof(uint16_t), "");
+
+	constexpr size_t string_size = 300;
+	typename std::aligned_storage<sizeof(string_type) +
+					      (string_size + 1) * sizeof(T),
+				      alignof(string_type)>::type buffer;
+
+	std::basic_string<T> s(string_size, T('a'));
+
+	auto dram_location = reinterpret_cast<string_type *>(&buffer);
+	new (dram_location)
+		string_type(nvobj::basic_string_view<T>(s.data(), s.length()));
+
+	UT_ASSERTeq(dram_location->size(), string_size);
+	UT_ASSERTeq(dram_location->capacity(), string_size);
+	UT_ASSERTeq(std::char_traits<T>::compare(
+			    s.data(), dram_location->data(), s.length()),
+		    0);
+
+	dram_location->~string_type();
+
+	/* capacity not representable by the header */
+	try {
+		new (dram_location) string_type(
+			size_t((std::numeric_limits<uint16_t>::max)()) + 1);
+		ASSERT_UNREACHABLE;
+	} catch (std::length_error &) {
+	} catch (...) {
+		ASSERT_UNREACHABLE;
+	}
+}
 }
 
 template <typename T>
@@ -354,6 +395,12 @@ test(int argc, char *argv[])
 	test_pmem<T>();
 	test_traits<T, nvobjex::basic_inline_string<T>>();
 	test_traits<T, nvobjex::basic_dram_inline_string<T>>();
+	test_traits<T,
+		    nvobjex::basic_inline_string<T, std::char_traits<T>,
+						 uint32_t>>();
+	test_traits<T,
+		    nvobjex::basic_dram_inline_string<T, std::char_traits<T>,
+						      uint32_t>>();
 
 	pop.close();
 }
@@ -365,5 +412,7 @@ main(int argc, char *argv[])
 		test<char>(argc, argv);
 		test<wchar_t>(argc, argv);
 		test<uint8_t>(argc, argv);
+		test_compact_header<char>();
+		test_compact_header<uint8_t>();
 	});
 }
@@ -0,0 +1,309 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * make_persistent_batch.cpp -- cpp make_persistent_batch and
+ * make_persistent_batch_atomic test
+ */
+
+#include "unittest.hpp"
+
+#include <libpmemobj++/experimental/make_persistent_batch.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/make_persistent_atomic.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include <set>
+
+#define LAYOUT "cpp"
+
+namespace nvobj = pmem::obj;
+namespace nvobjex = pmem::obj::experimental;
+
+namespace
+{
+
+const int TEST_ARR_SIZE = 10;
+const int BATCH_SIZE = 100;
+
+/* more than fits in the pool */
+const int BIG_BATCH_SIZE = 64;
+
+struct force_throw {};
+
+class foo {
+public:
+	foo() : bar(1)
+	{
+		for (int i = 0; i < TEST_ARR_SIZE; ++i)
+			this->arr[i] = 1;
+	}
+
+	foo(int val, char arr_val) : bar(val)
+	{
+		for (int i = 0; i < TEST_ARR_SIZE; ++i)
+			this->arr[i] = arr_val;
+	}
+
+	/* throws when constructing the n-th object */
+	foo(int &n)
+	{
+		if (--n == 0)
+			throw force_throw();
+	}
+
+	void
+	check_foo(int val, char arr_val)
+	{
+		UT_ASSERTeq(val, this->bar);
+		for (int i = 0; i < TEST_ARR_SIZE; ++i)
+			UT_ASSERTeq(arr_val, this->arr[i]);
+	}
+
+	nvobj::p<int> bar;
+	nvobj::p<char> arr[TEST_ARR_SIZE];
+};
+
+struct big {
+	char data[1 << 20];
+};
+
+struct root {
+	nvobj::persistent_ptr<foo> pfoo[BATCH_SIZE];
+	nvobj::persistent_ptr<big> pbig[BIG_BATCH_SIZE];
+};
+
+/*
+ * test_make_batch -- allocate a batch and free its objects one by one
+ */
+void
+test_make_batch(nvobj::pool<root> &pop)
+{
+	int allocs = num_allocs(pop);
+
+	std::vector<nvobj::persistent_ptr<foo>> ptrs;
+	nvobj::transaction::run(pop, [&] {
+		ptrs = nvobjex::make_persistent_batch<foo>(pop, BATCH_SIZE, 2,
+							   'b');
+	});
+
+	UT_ASSERTeq(ptrs.size(), BATCH_SIZE);
+	UT_ASSERTeq(num_allocs(pop), allocs + BATCH_SIZE);
+
+	std::set<foo *> distinct;
+	for (auto &ptr : ptrs) {
+		UT_ASSERT(ptr != nullptr);
+		ptr->check_foo(2, 'b');
+		distinct.insert(ptr.get());
+	}
+	UT_ASSERTeq(distinct.size(), BATCH_SIZE);
+
+	for (auto &ptr : ptrs) {
+		nvobj::transaction::run(
+			pop, [&] { nvobj::delete_persistent<foo>(ptr); });
+	}
+
+	UT_ASSERTeq(num_allocs(pop), allocs);
+
+	nvobj::transaction::run(pop, [&] {
+		ptrs = nvobjex::make_persistent_batch<foo>(
+			pop, 0, nvobj::allocation_flag::none());
+	});
+	UT_ASSERT(ptrs.empty());
+
+	/* flags accepted only by transactional allocations */
+	nvobj::transaction::run(pop, [&] {
+		ptrs = nvobjex::make_persistent_batch<foo>(
+			pop, BATCH_SIZE, nvobj::allocation_flag::no_flush(), 3,
+			'c');
+	});
+
+	UT_ASSERTeq(ptrs.size(), BATCH_SIZE);
+	UT_ASSERTeq(num_allocs(pop), allocs + BATCH_SIZE);
+	for (auto &ptr : ptrs)
+		ptr->check_foo(3, 'c');
+
+	nvobj::transaction::run(pop, [&] {
+		for (auto &ptr : ptrs)
+			nvobj::delete_persistent<foo>(ptr);
+	});
+
+	UT_ASSERTeq(num_allocs(pop), allocs);
+}
+
+/*
+ * test_abort -- objects of a batch are freed when the transaction aborts
+ */
+void
+test_abort(nvobj::pool<root> &pop)
+{
+	int allocs = num_allocs(pop);
+
+	try {
+		nvobj::transaction::run(pop, [&] {
+			auto ptrs = nvobjex::make_persistent_batch<foo>(
+				pop, BATCH_SIZE);
+			UT_ASSERTeq(ptrs.size(), BATCH_SIZE);
+			ptrs.back()->check_foo(1, 1);
+
+			nvobj::transaction::abort(EINVAL);
+		});
+		UT_ASSERT(0);
+	} catch (pmem::manual_tx_abort &) {
+	} catch (...) {
+		UT_ASSERT(0);
+	}
+
+	UT_ASSERTeq(num_allocs(pop), allocs);
+
+	int n = BATCH_SIZE / 2;
+	try {
+		nvobj::transaction::run(pop, [&] {
+			nvobjex::make_persistent_batch<foo>(pop, BATCH_SIZE, n);
+		});
+		UT_ASSERT(0);
+	} catch (force_throw &) {
+	} catch (...) {
+		UT_ASSERT(0);
+	}
+
+	UT_ASSERTeq(num_allocs(pop), allocs);
+}
+
+/*
+ * test_errors -- allocation failures and calls outside of a transaction
+ */
+void
+test_errors(nvobj::pool<root> &pop)
+{
+	int allocs = num_allocs(pop);
+
+	try {
+		nvobjex::make_persistent_batch<foo>(pop, BATCH_SIZE);
+		UT_ASSERT(0);
+	} catch (pmem::transaction_scope_error &) {
+	} catch (...) {
+		UT_ASSERT(0);
+	}
+
+	try {
+		nvobj::transaction::run(pop, [&] {
+			nvobjex::make_persistent_batch<big>(pop,
+							    BIG_BATCH_SIZE);
+		});
+		UT_ASSERT(0);
+	} catch (pmem::transaction_out_of_memory &) {
+	} catch (...) {
+		UT_ASSERT(0);
+	}
+
+	/* the transaction is aborted, as with make_persistent */
+	try {
+		nvobj::transaction::run(pop, [&] {
+			try {
+				nvobjex::make_persistent_batch<big>(
+					pop, BIG_BATCH_SIZE);
+				UT_ASSERT(0);
+			} catch (pmem::transaction_out_of_memory &) {
+				UT_ASSERTeq(pmemobj_tx_stage(),
+					    TX_STAGE_ONABORT);
+				throw;
+			}
+		});
+		UT_ASSERT(0);
+	} catch (pmem::transaction_out_of_memory &) {
+	} catch (...) {
+		UT_ASSERT(0);
+	}
+
+	UT_ASSERTeq(num_allocs(pop), allocs);
+}
+
+/*
+ * test_make_batch_atomic -- allocate a batch atomically into pointers
+ * residing in the pool
+ */
+void
+test_make_batch_atomic(nvobj::pool<root> &pop)
+{
+	auto r = pop.root();
+	int allocs = num_allocs(pop);
+
+	int n = BATCH_SIZE / 2;
+	try {
+		nvobjex::make_persistent_batch_atomic<foo>(pop, r->pfoo,
+							   BATCH_SIZE, n);
+		UT_ASSERT(0);
+	} catch (force_throw &) {
+	} catch (...) {
+		UT_ASSERT(0);
+	}
+
+	UT_ASSERTeq(num_allocs(pop), allocs);
+	for (auto &ptr : r->pfoo)
+		UT_ASSERT(ptr == nullptr);
+
+	nvobjex::make_persistent_batch_atomic<foo>(
+		pop, r->pfoo, BATCH_SIZE, nvobj::allocation_flag_atomic::none(),
+		3, 'c');
+
+	UT_ASSERTeq(num_allocs(pop), allocs + BATCH_SIZE);
+	for (auto &ptr : r->pfoo) {
+		UT_ASSERT(ptr != nullptr);
+		ptr->check_foo(3, 'c');
+	}
+
+	for (auto &ptr : r->pfoo)
+		nvobj::delete_persistent_atomic<foo>(ptr);
+
+	UT_ASSERTeq(num_allocs(pop), allocs);
+
+	try {
+		nvobjex::make_persistent_batch_atomic<big>(pop, r->pbig,
+							   BIG_BATCH_SIZE);
+		UT_ASSERT(0);
+	} catch (std::bad_alloc &) {
+	} catch (...) {
+		UT_ASSERT(0);
+	}
+
+	UT_ASSERTeq(num_allocs(pop), allocs);
+	for (auto &ptr : r->pbig)
+		UT_ASSERT(ptr == nullptr);
+}
+
+} /* namespace */
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc != 2)
+		UT_FATAL("usage: %s file-name", argv[0]);
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<root>::create(
+			path, LAYOUT, PMEMOBJ_MIN_POOL * 4, S_IWUSR | S_IRUSR);
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	test_make_batch(pop);
+	test_abort(pop);
+	test_errors(pop);
+	test_make_batch_atomic(pop);
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
@@ -0,0 +1,192 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * adaptive_shared_mutex.cpp -- adaptive_shared_mutex test
+ */
+
+#include "thread_helpers.hpp"
+#include "unittest.hpp"
+
+#include <libpmemobj++/container/concurrent_hash_map.hpp>
+#include <libpmemobj++/experimental/adaptive_shared_mutex.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include <mutex>
+#include <thread>
+
+#define LAYOUT "cpp"
+
+namespace nvobj = pmem::obj;
+
+namespace
+{
+
+struct counter_tag;
+struct bucket_tag;
+
+using counter_mutex = nvobj::experimental::adaptive_shared_mutex<counter_tag>;
+using bucket_mutex = nvobj::experimental::adaptive_shared_mutex<bucket_tag>;
+
+using map_type =
+	nvobj::concurrent_hash_map<nvobj::p<int>, nvobj::p<int>,
+				   std::hash<nvobj::p<int>>,
+				   std::equal_to<nvobj::p<int>>, bucket_mutex>;
+
+static_assert(sizeof(counter_mutex) == sizeof(nvobj::shared_mutex), "");
+
+struct root {
+	counter_mutex pmutex;
+	unsigned counter;
+
+	nvobj::persistent_ptr<map_type> map;
+};
+
+/* number of ops per thread */
+const unsigned num_ops = 200;
+
+/* the number of threads */
+const unsigned num_threads = 16;
+
+void
+check_stats(const nvobj::experimental::lock_contention_stats &stats)
+{
+	UT_ASSERTeq(stats.contended, stats.spin_acquired + stats.parked);
+}
+
+void
+mutex_test(nvobj::pool<root> &pop)
+{
+	auto proot = pop.root();
+
+	counter_mutex::reset_stats();
+
+	parallel_exec(num_threads, [&](size_t thread_id) {
+		for (unsigned i = 0; i < num_ops; ++i) {
+			if (thread_id % 2) {
+				std::lock_guard<counter_mutex> lock(
+					proot->pmutex);
+				++(proot->counter);
+				++(proot->counter);
+			} else {
+				proot->pmutex.lock_shared();
+				UT_ASSERTeq(proot->counter % 2, 0);
+				proot->pmutex.unlock_shared();
+			}
+		}
+	});
+
+	UT_ASSERTeq(proot->counter, num_threads / 2 * num_ops * 2);
+	check_stats(counter_mutex::stats());
+
+	/* counters are per lock class */
+	auto stats = bucket_mutex::stats();
+	UT_ASSERTeq(stats.contended, 0);
+}
+
+void
+try_lock_test(nvobj::pool<root> &pop)
+{
+	auto proot = pop.root();
+
+	proot->pmutex.lock();
+	UT_ASSERT(proot->pmutex.try_lock() == false);
+	UT_ASSERT(proot->pmutex.try_lock_shared() == false);
+	proot->pmutex.unlock();
+
+	UT_ASSERT(proot->pmutex.try_lock_shared());
+	UT_ASSERT(proot->pmutex.try_lock_shared());
+	UT_ASSERT(proot->pmutex.try_lock() == false);
+	proot->pmutex.unlock_shared();
+	proot->pmutex.unlock_shared();
+
+	UT_ASSERT(proot->pmutex.try_lock());
+	proot->pmutex.unlock();
+
+	UT_ASSERT(proot->pmutex.native_handle() != nullptr);
+	UT_ASSERT(proot->pmutex.lock_type() == TX_PARAM_RWLOCK);
+
+	/* contended lock either spins or blocks */
+	counter_mutex::reset_stats();
+	proot->pmutex.lock();
+	std::thread reader([&] {
+		proot->pmutex.lock_shared();
+		proot->pmutex.unlock_shared();
+	});
+	/* the reader counts the contention before it spins or blocks */
+	while (counter_mutex::stats().contended == 0)
+		std::this_thread::yield();
+	proot->pmutex.unlock();
+	reader.join();
+
+	auto stats = counter_mutex::stats();
+	UT_ASSERTeq(stats.contended, 1);
+	check_stats(stats);
+}
+
+void
+hash_map_test(nvobj::pool<root> &pop)
+{
+	auto proot = pop.root();
+
+	nvobj::transaction::run(
+		pop, [&] { proot->map = nvobj::make_persistent<map_type>(); });
+
+	auto &map = *proot->map;
+	map.runtime_initialize();
+
+	parallel_exec(num_threads, [&](size_t thread_id) {
+		int begin = static_cast<int>(thread_id * num_ops);
+		for (int i = begin; i < begin + static_cast<int>(num_ops);
+		     ++i) {
+			UT_ASSERT(map.insert(map_type::value_type(i, i)));
+
+			map_type::const_accessor acc;
+			UT_ASSERT(map.find(acc, i));
+			UT_ASSERTeq(acc->second, i);
+		}
+	});
+
+	UT_ASSERTeq(map.size(), num_threads * num_ops);
+	check_stats(bucket_mutex::stats());
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<map_type>(proot->map);
+		proot->map = nullptr;
+	});
+}
+}
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc != 2)
+		UT_FATAL("usage: %s file-name", argv[0]);
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<root>::create(
+			path, LAYOUT, PMEMOBJ_MIN_POOL * 20, S_IWUSR | S_IRUSR);
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	mutex_test(pop);
+	try_lock_test(pop);
+	hash_map_test(pop);
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
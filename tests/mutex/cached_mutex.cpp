@@ -0,0 +1,267 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * cached_mutex.cpp -- cached_mutex, cached_shared_mutex and
+ * cached_timed_mutex test
+ */
+
+#include "thread_helpers.hpp"
+#include "unittest.hpp"
+
+#include <libpmemobj++/experimental/cached_mutex.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj/atomic_base.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#define LAYOUT "cpp"
+
+namespace nvobj = pmem::obj;
+namespace nvobjex = pmem::obj::experimental;
+
+namespace
+{
+
+/* pool root structure */
+struct root {
+	nvobjex::cached_mutex mutex;
+	nvobjex::cached_shared_mutex shared_mutex;
+	nvobjex::cached_timed_mutex timed_mutex;
+	unsigned counter;
+};
+
+static_assert(sizeof(nvobjex::cached_mutex) == sizeof(nvobj::mutex), "");
+static_assert(sizeof(nvobjex::cached_shared_mutex) ==
+		      sizeof(nvobj::shared_mutex),
+	      "");
+static_assert(sizeof(nvobjex::cached_timed_mutex) ==
+		      sizeof(nvobj::timed_mutex),
+	      "");
+
+/* number of ops per thread */
+const unsigned num_ops = 200;
+
+/* the number of threads */
+const unsigned num_threads = 16;
+
+/*
+ * mutex_test -- (internal) increment the counter under the mutex
+ */
+template <typename Mutex>
+void
+mutex_test(nvobj::pool<root> &pop, Mutex &mtx)
+{
+	auto proot = pop.root();
+	proot->counter = 0;
+
+	parallel_exec(num_threads, [&](size_t thread_id) {
+		for (unsigned i = 0; i < num_ops; ++i) {
+			if (thread_id % 2) {
+				std::lock_guard<Mutex> lock(mtx);
+				++(proot->counter);
+			} else {
+				while (!mtx.try_lock())
+					;
+				++(proot->counter);
+				mtx.unlock();
+			}
+		}
+	});
+
+	UT_ASSERTeq(proot->counter, num_threads * num_ops);
+
+	mtx.lock();
+	UT_ASSERT(mtx.try_lock() == false);
+	mtx.unlock();
+
+	UT_ASSERT(mtx.native_handle() != nullptr);
+}
+
+/*
+ * shared_mutex_test -- (internal) writers bump up the counter by 2, readers
+ * verify that it is even
+ */
+void
+shared_mutex_test(nvobj::pool<root> &pop)
+{
+	auto proot = pop.root();
+	auto &mtx = proot->shared_mutex;
+	proot->counter = 0;
+
+	parallel_exec(num_threads, [&](size_t thread_id) {
+		for (unsigned i = 0; i < num_ops; ++i) {
+			if (thread_id % 2) {
+				std::lock_guard<nvobjex::cached_shared_mutex>
+					lock(mtx);
+				++(proot->counter);
+				++(proot->counter);
+			} else {
+				mtx.lock_shared();
+				UT_ASSERTeq(proot->counter % 2, 0);
+				mtx.unlock_shared();
+			}
+		}
+	});
+
+	UT_ASSERTeq(proot->counter, num_threads / 2 * num_ops * 2);
+
+	UT_ASSERT(mtx.try_lock_shared());
+	UT_ASSERT(mtx.try_lock_shared());
+	UT_ASSERT(mtx.try_lock() == false);
+	mtx.unlock_shared();
+	mtx.unlock_shared();
+
+	UT_ASSERT(mtx.try_lock());
+	UT_ASSERT(mtx.try_lock_shared() == false);
+	mtx.unlock();
+
+	UT_ASSERT(mtx.lock_type() == TX_PARAM_RWLOCK);
+}
+
+/*
+ * timed_mutex_test -- (internal) test the timed locks
+ */
+void
+timed_mutex_test(nvobj::pool<root> &pop)
+{
+	auto &mtx = pop.root()->timed_mutex;
+	const auto timeout = std::chrono::milliseconds(10);
+
+	mutex_test(pop, mtx);
+
+	UT_ASSERT(mtx.try_lock_for(timeout));
+	std::thread other([&] {
+		UT_ASSERT(mtx.try_lock_for(timeout) == false);
+		auto until = std::chrono::steady_clock::now() + timeout;
+		UT_ASSERT(mtx.try_lock_until(until) == false);
+	});
+	other.join();
+	mtx.unlock();
+
+	UT_ASSERT(mtx.try_lock_until(std::chrono::system_clock::now() +
+				     timeout));
+	mtx.unlock();
+}
+
+/*
+ * test_stack -- (internal) cached mutexes are not allowed outside of pmem
+ */
+void
+test_stack()
+{
+	try {
+		nvobjex::cached_mutex stack_mutex;
+		UT_ASSERT(0);
+	} catch (pmem::lock_error &) {
+	}
+
+	try {
+		nvobjex::cached_shared_mutex stack_mutex;
+		UT_ASSERT(0);
+	} catch (pmem::lock_error &) {
+	}
+
+	try {
+		nvobjex::cached_timed_mutex stack_mutex;
+		UT_ASSERT(0);
+	} catch (pmem::lock_error &) {
+	}
+
+	/* no pool lookup for an address which is not from any pool */
+	int stack_var;
+	UT_ASSERT(pmem::detail::pool_by_ptr_cached(&stack_var) == nullptr);
+}
+
+/*
+ * test_pool_lookup_cache -- (internal) verify that cached locks resolve the
+ * right pool when mutexes from different pools are used and pools are
+ * reopened
+ */
+void
+test_pool_lookup_cache(nvobj::pool<root> &pop1, const std::string &path)
+{
+	auto pop2 = nvobj::pool<root>::create(path, LAYOUT, PMEMOBJ_MIN_POOL,
+					      S_IWUSR | S_IRUSR);
+
+	pop1.root()->counter = 0;
+	for (int i = 0; i < 10; ++i) {
+		auto &pop = (i % 2) ? pop1 : pop2;
+
+		UT_ASSERT(pmem::detail::pool_by_ptr_cached(
+				  &pop.root()->mutex) == pop.handle());
+
+		std::lock_guard<nvobjex::cached_mutex> lock(pop.root()->mutex);
+		++(pop.root()->counter);
+	}
+
+	pop2.close();
+
+	/* handles cached before close must not be used after reopen */
+	pop2 = nvobj::pool<root>::open(path, LAYOUT);
+	UT_ASSERT(pmem::detail::pool_by_ptr_cached(&pop2.root()->mutex) ==
+		  pop2.handle());
+	{
+		std::lock_guard<nvobjex::cached_shared_mutex> lock(
+			pop2.root()->shared_mutex);
+		UT_ASSERTeq(pop2.root()->counter, 5);
+	}
+	pop2.close();
+
+#ifndef _WIN32
+	/* also when the pool is closed by pmemobj_close() */
+	PMEMobjpool *raw = pmemobj_open(path.c_str(), LAYOUT);
+	UT_ASSERT(raw != nullptr);
+	auto *raw_root = static_cast<root *>(
+		pmemobj_direct(pmemobj_root(raw, sizeof(root))));
+	UT_ASSERT(pmem::detail::pool_by_ptr_cached(&raw_root->mutex) == raw);
+	pmemobj_close(raw);
+
+	pop2 = nvobj::pool<root>::open(path, LAYOUT);
+	UT_ASSERT(pmem::detail::pool_by_ptr_cached(&pop2.root()->mutex) ==
+		  pop2.handle());
+	{
+		std::lock_guard<nvobjex::cached_timed_mutex> lock(
+			pop2.root()->timed_mutex);
+		UT_ASSERTeq(pop2.root()->counter, 5);
+	}
+	pop2.close();
+#endif
+}
+}
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc != 2)
+		UT_FATAL("usage: %s file-name", argv[0]);
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<root>::create(path, LAYOUT, PMEMOBJ_MIN_POOL,
+						S_IWUSR | S_IRUSR);
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	mutex_test(pop, pop.root()->mutex);
+	shared_mutex_test(pop);
+	timed_mutex_test(pop);
+	test_stack();
+	test_pool_lookup_cache(pop, std::string(path) + "_second");
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
@@ -0,0 +1,209 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * pool_stats.cpp -- test of experimental::pool_statistics and
+ * experimental::pool_stats_sampler
+ */
+
+#include "unittest.hpp"
+
+#include <libpmemobj++/experimental/pool_stats.hpp>
+#include <libpmemobj++/make_persistent_array_atomic.hpp>
+#include <libpmemobj++/make_persistent_atomic.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+namespace nvobj = pmem::obj;
+namespace nvobjex = pmem::obj::experimental;
+
+namespace
+{
+
+struct root {
+	nvobj::persistent_ptr<int> small[100];
+	nvobj::persistent_ptr<char[]> huge;
+};
+
+void
+test_enable(nvobj::pool<root> &pop)
+{
+	nvobjex::pool_statistics stats(pop);
+
+	stats.enable(false);
+	UT_ASSERT(!stats.enabled());
+
+	stats.enable();
+	UT_ASSERT(stats.enabled());
+}
+
+void
+test_heap(nvobj::pool<root> &pop)
+{
+	nvobjex::pool_statistics stats(pop);
+
+	/* allocates the root object */
+	auto r = pop.root();
+
+	auto before = stats.snapshot();
+
+	for (auto &ptr : r->small)
+		nvobj::make_persistent_atomic<int>(pop, ptr, 1);
+	nvobj::make_persistent_atomic<char[]>(pop, r->huge, 1 << 20);
+
+	auto after = stats.snapshot();
+
+	UT_ASSERT(after.timestamp >= before.timestamp);
+	UT_ASSERT(after.curr_allocated >= before.curr_allocated + (1 << 20));
+	UT_ASSERT(after.runs.run_allocated > before.runs.run_allocated);
+	UT_ASSERT(after.runs.run_active >= after.runs.run_allocated);
+	UT_ASSERT(after.curr_allocated >= after.runs.run_allocated);
+	UT_ASSERT(after.huge_allocated() ==
+		  after.curr_allocated - after.runs.run_allocated);
+
+	UT_ASSERT(after.run_utilization() > 0);
+	UT_ASSERT(after.run_utilization() <= 1);
+	UT_ASSERT(after.run_utilization() + after.runs.fragmentation() == 1);
+
+	auto frag = stats.fragmentation();
+	UT_ASSERTeq(frag.run_allocated, after.runs.run_allocated);
+
+	for (auto &ptr : r->small)
+		nvobj::delete_persistent_atomic<int>(ptr);
+	nvobj::delete_persistent_atomic<char[]>(r->huge, 1 << 20);
+
+	auto freed = stats.snapshot();
+	UT_ASSERTeq(freed.curr_allocated, before.curr_allocated);
+}
+
+void
+test_classes_and_arenas(nvobj::pool<root> &pop)
+{
+	nvobjex::pool_statistics stats(pop);
+
+	auto before = stats.snapshot();
+	UT_ASSERTeq(before.arenas.size(), before.narenas_total);
+
+	pobj_alloc_class_desc desc;
+	desc.unit_size = 72;
+	desc.alignment = 0;
+	desc.units_per_block = 1000;
+	desc.header_type = POBJ_HEADER_NONE;
+	desc = pop.ctl_set("heap.alloc_class.new.desc", desc);
+
+	unsigned arena_id = pop.ctl_exec<unsigned>("heap.arena.create", 0);
+
+	auto after = stats.snapshot();
+
+	bool found = false;
+	for (auto &c : after.alloc_classes) {
+		if (c.id != desc.class_id)
+			continue;
+
+		found = true;
+		UT_ASSERTeq(c.unit_size, 72);
+		UT_ASSERTeq(c.units_per_block, 1000);
+		UT_ASSERTeq(c.header_type, POBJ_HEADER_NONE);
+	}
+	UT_ASSERT(found);
+	UT_ASSERTeq(after.alloc_classes.size(),
+		    before.alloc_classes.size() + 1);
+
+	/* classes are reported in the order of their ids */
+	for (size_t i = 1; i < after.alloc_classes.size(); ++i)
+		UT_ASSERT(after.alloc_classes[i - 1].id <
+			  after.alloc_classes[i].id);
+
+	auto again = stats.snapshot();
+	UT_ASSERTeq(again.alloc_classes.size(), after.alloc_classes.size());
+
+	UT_ASSERTeq(after.narenas_total, before.narenas_total + 1);
+	UT_ASSERTeq(after.arenas.size(), after.narenas_total);
+	UT_ASSERTeq(after.arenas.back().id, arena_id);
+}
+
+void
+test_sampler(nvobj::pool<root> &pop)
+{
+	std::atomic<size_t> calls(0);
+
+	{
+		nvobjex::pool_stats_sampler sampler(
+			pop, std::chrono::milliseconds(1),
+			[&](const nvobjex::pool_stats_snapshot &s) {
+				UT_ASSERT(s.runs.run_active >=
+					  s.runs.run_allocated);
+				++calls;
+			});
+
+		while (calls.load() < 3)
+			std::this_thread::yield();
+
+		sampler.stop();
+		UT_ASSERT(sampler.samples() >= 3);
+		UT_ASSERTeq(sampler.samples(), calls.load());
+
+		/* already stopped */
+		sampler.stop();
+	}
+
+	/* destructor stops sampling */
+	{
+		nvobjex::pool_stats_sampler sampler(
+			pop, std::chrono::hours(1),
+			[&](const nvobjex::pool_stats_snapshot &) {});
+	}
+
+	nvobjex::pool_stats_sampler failing(
+		pop, std::chrono::milliseconds(1),
+		[&](const nvobjex::pool_stats_snapshot &) {
+			throw std::runtime_error("callback failed");
+		});
+
+	try {
+		failing.stop();
+		UT_ASSERT(0);
+	} catch (std::runtime_error &e) {
+		UT_ASSERT(std::string(e.what()) == "callback failed");
+	}
+
+	UT_ASSERTeq(failing.samples(), 0);
+}
+}
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc != 2)
+		UT_FATAL("usage: %s file-name", argv[0]);
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<root>::create(path, "pool_stats",
+						PMEMOBJ_MIN_POOL * 2,
+						S_IWUSR | S_IRUSR);
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	test_enable(pop);
+	test_heap(pop);
+	test_classes_and_arenas(pop);
+	test_sampler(pop);
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * cached_get.cpp -- experimental::cached_get() test
+ */
+
+#include "thread_helpers.hpp"
+#include "unittest.hpp"
+
+#include <libpmemobj++/experimental/cached_get.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#define LAYOUT "cached_get"
+
+namespace nvobj = pmem::obj;
+namespace nvobjexp = pmem::obj::experimental;
+
+namespace
+{
+
+struct node {
+	nvobj::p<int> value;
+	nvobj::persistent_ptr<node> next;
+};
+
+struct root {
+	nvobj::persistent_ptr<node> head;
+};
+
+const int list_size = 100;
+
+void
+create_list(nvobj::pool<root> &pop, int offset)
+{
+	nvobj::transaction::run(pop, [&] {
+		for (int i = list_size - 1; i >= 0; --i) {
+			auto n = nvobj::make_persistent<node>();
+			n->value = offset + i;
+			n->next = pop.root()->head;
+			pop.root()->head = n;
+		}
+	});
+}
+
+void
+verify_list(nvobj::pool<root> &pop, int offset)
+{
+	int i = 0;
+	for (auto n = pop.root()->head; n != nullptr;
+	     n = nvobjexp::cached_get(n)->next) {
+		UT_ASSERT(nvobjexp::cached_get(n) == n.get());
+		UT_ASSERTeq(nvobjexp::cached_get(n)->value, offset + i);
+		++i;
+	}
+	UT_ASSERTeq(i, list_size);
+}
+
+void
+test_null()
+{
+	nvobj::persistent_ptr<node> null_ptr;
+	UT_ASSERT(nvobjexp::cached_get(null_ptr) == nullptr);
+
+	nvobj::persistent_ptr<node> null_ptr2 = nullptr;
+	UT_ASSERT(nvobjexp::cached_get(null_ptr2) == nullptr);
+}
+
+/*
+ * Dereferences pointers from two pools alternately, so every call switches
+ * the cached pool.
+ */
+void
+test_two_pools(nvobj::pool<root> &pop1, nvobj::pool<root> &pop2)
+{
+	verify_list(pop1, 0);
+	verify_list(pop2, list_size);
+
+	auto n1 = pop1.root()->head;
+	auto n2 = pop2.root()->head;
+	for (int i = 0; i < list_size; ++i) {
+		UT_ASSERTeq(nvobjexp::cached_get(n1)->value, i);
+		UT_ASSERTeq(nvobjexp::cached_get(n2)->value, list_size + i);
+		n1 = nvobjexp::cached_get(n1)->next;
+		n2 = nvobjexp::cached_get(n2)->next;
+	}
+}
+
+void
+test_threads(nvobj::pool<root> &pop1, nvobj::pool<root> &pop2)
+{
+	size_t concurrency = 8;
+	if (On_drd)
+		concurrency = 2;
+
+	parallel_exec(concurrency, [&](size_t thread_id) {
+		if (thread_id % 2)
+			verify_list(pop1, 0);
+		else
+			verify_list(pop2, list_size);
+	});
+}
+
+/*
+ * Reopened pool may be mapped at a different address, cached base of the
+ * closed pool must not be used.
+ */
+void
+test_reopen(nvobj::pool<root> &pop1, nvobj::pool<root> &pop2,
+	    const std::string &path1, const std::string &path2)
+{
+	verify_list(pop1, 0);
+
+	pop1.close();
+	pop2.close();
+
+	/* open in the reverse order to shuffle the mappings */
+	pop2 = nvobj::pool<root>::open(path2, LAYOUT);
+	pop1 = nvobj::pool<root>::open(path1, LAYOUT);
+
+	verify_list(pop1, 0);
+	verify_list(pop2, list_size);
+}
+
+} /* namespace */
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc < 2)
+		UT_FATAL("usage: %s file-name", argv[0]);
+
+	std::string path1 = argv[1];
+	std::string path2 = path1 + "_second";
+
+	nvobj::pool<root> pop1, pop2;
+
+	try {
+		pop1 = nvobj::pool<root>::create(
+			path1, LAYOUT, PMEMOBJ_MIN_POOL, S_IWUSR | S_IRUSR);
+		pop2 = nvobj::pool<root>::create(
+			path2, LAYOUT, PMEMOBJ_MIN_POOL, S_IWUSR | S_IRUSR);
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s", pe.what());
+	}
+
+	create_list(pop1, 0);
+	create_list(pop2, list_size);
+
+	test_null();
+	test_two_pools(pop1, pop2);
+	test_threads(pop1, pop2);
+	test_reopen(pop1, pop2, path1, path2);
+
+	pop1.close();
+	pop2.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
@@ -0,0 +1,352 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * self_relative_ptr32.cpp -- self_relative_ptr32 and
+ * atomic_self_relative_ptr32 test
+ */
+
+#include "thread_helpers.hpp"
+#include "unittest.hpp"
+
+#include <libpmemobj++/experimental/atomic_self_relative_ptr32.hpp>
+#include <libpmemobj++/experimental/self_relative_ptr32.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include <limits>
+#include <new>
+#include <stdexcept>
+
+#define LAYOUT "cpp"
+
+namespace nvobj = pmem::obj;
+
+template <typename T>
+using self_relative_ptr32 = nvobj::experimental::self_relative_ptr32<T>;
+template <typename T>
+using atomic_ptr32 = nvobj::experimental::atomic_self_relative_ptr32<T>;
+
+namespace
+{
+
+constexpr int TEST_INT = 10;
+constexpr size_t ARR_SIZE = 1000;
+constexpr size_t CONCURRENCY = 8;
+
+struct A {
+	uint64_t a;
+};
+
+struct B {
+	uint64_t b;
+};
+
+struct C : public A, public B {
+	uint64_t c;
+};
+
+struct node {
+	nvobj::p<int> value;
+	self_relative_ptr32<node> next;
+};
+
+struct root {
+	self_relative_ptr32<node> head;
+	self_relative_ptr32<nvobj::p<int>[]> parr;
+	self_relative_ptr32<C> pc;
+	self_relative_ptr32<B> pb;
+	self_relative_ptr32<nvobj::p<int>> it;
+
+	atomic_ptr32<int> aptr;
+	nvobj::persistent_ptr<int[]> arr;
+};
+
+static_assert(sizeof(self_relative_ptr32<node>) == 4, "");
+static_assert(sizeof(atomic_ptr32<int>) == 4, "");
+static_assert(sizeof(node) == 8, "");
+
+void
+test_null(nvobj::pool<root> &pop)
+{
+	auto r = pop.root();
+
+	UT_ASSERT(r->head == nullptr);
+	UT_ASSERT(!r->head);
+	UT_ASSERTeq(r->head.get(), nullptr);
+	UT_ASSERT(r->aptr.load() == nullptr);
+
+	/* nullptr does not depend on the location of the pointer */
+	self_relative_ptr32<node> null_ptr;
+	UT_ASSERT(null_ptr == nullptr);
+	UT_ASSERTeq(null_ptr.get(), nullptr);
+}
+
+void
+test_list(nvobj::pool<root> &pop)
+{
+	auto r = pop.root();
+
+	nvobj::transaction::run(pop, [&] {
+		for (int i = 0; i < TEST_INT; i++) {
+			auto n = nvobj::make_persistent<node>();
+			n->value = i;
+			n->next = r->head;
+			r->head = n;
+		}
+	});
+
+	int expected = TEST_INT - 1;
+	for (auto n = r->head.get(); n != nullptr; n = n->next.get()) {
+		UT_ASSERTeq(n->value, expected);
+		expected--;
+	}
+	UT_ASSERTeq(expected, -1);
+
+	/* pointer modifications are rolled back on abort */
+	auto old_head = r->head.get();
+	try {
+		nvobj::transaction::run(pop, [&] {
+			r->head = r->head->next;
+			UT_ASSERT(r->head.get() != old_head);
+			nvobj::transaction::abort(0);
+		});
+		UT_ASSERT(0);
+	} catch (pmem::manual_tx_abort &) {
+	}
+	UT_ASSERT(r->head.get() == old_head);
+
+	/* swap two pointers residing in the pool */
+	auto second = r->head->next.get();
+	nvobj::transaction::run(pop,
+				[&] { swap(r->head, r->head->next->next); });
+	UT_ASSERTeq(r->head->value, TEST_INT - 3);
+	UT_ASSERT(second->next.get() == old_head);
+	nvobj::transaction::run(pop, [&] { swap(r->head, second->next); });
+	UT_ASSERT(r->head.get() == old_head);
+
+	nvobj::transaction::run(pop, [&] {
+		while (r->head != nullptr) {
+			auto n = r->head.get();
+			r->head = n->next;
+			nvobj::delete_persistent<node>(
+				nvobj::persistent_ptr<node>(n));
+		}
+	});
+}
+
+void
+test_array(nvobj::pool<root> &pop)
+{
+	auto r = pop.root();
+
+	nvobj::transaction::run(pop, [&] {
+		r->parr = nvobj::make_persistent<nvobj::p<int>[]>(ARR_SIZE);
+		for (size_t i = 0; i < ARR_SIZE; i++)
+			r->parr[static_cast<std::ptrdiff_t>(i)] =
+				static_cast<int>(i);
+	});
+
+	nvobj::transaction::run(pop,
+				[&] { r->it = r->parr.get() + ARR_SIZE / 2; });
+	UT_ASSERTeq(*r->it, static_cast<int>(ARR_SIZE / 2));
+
+	nvobj::transaction::run(pop, [&] {
+		++r->it;
+		UT_ASSERTeq(*r->it, static_cast<int>(ARR_SIZE / 2 + 1));
+		--r->it;
+		r->it += 10;
+		UT_ASSERTeq(*r->it, static_cast<int>(ARR_SIZE / 2 + 10));
+		r->it -= 20;
+		UT_ASSERTeq(*r->it, static_cast<int>(ARR_SIZE / 2 - 10));
+	});
+
+	try {
+		nvobj::transaction::run(pop, [&] {
+			r->it += 5;
+			nvobj::transaction::abort(0);
+		});
+		UT_ASSERT(0);
+	} catch (pmem::manual_tx_abort &) {
+	}
+	UT_ASSERTeq(*r->it, static_cast<int>(ARR_SIZE / 2 - 10));
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<nvobj::p<int>[]>(r->parr, ARR_SIZE);
+		r->parr = nullptr;
+		r->it = nullptr;
+	});
+}
+
+void
+test_offset(nvobj::pool<root> &pop)
+{
+	auto r = pop.root();
+
+	nvobj::transaction::run(pop, [&] {
+		r->pc = nvobj::make_persistent<C>();
+		r->pb = r->pc;
+
+		UT_ASSERT(static_cast<size_t>(
+				  reinterpret_cast<char *>(r->pb.get()) -
+				  reinterpret_cast<char *>(r->pc.get())) ==
+			  sizeof(A));
+		UT_ASSERT(static_cast<B *>(r->pc.get()) == r->pb.get());
+
+		nvobj::delete_persistent<C>(r->pc);
+		r->pc = nullptr;
+		r->pb = nullptr;
+	});
+}
+
+void
+test_atomic(nvobj::pool<root> &pop)
+{
+	auto r = pop.root();
+
+	nvobj::transaction::run(pop, [&] {
+		r->arr = nvobj::make_persistent<int[]>(CONCURRENCY * ARR_SIZE);
+	});
+
+	int *first = r->arr.get();
+	int *last = first + CONCURRENCY * ARR_SIZE;
+	r->aptr.store(first);
+	UT_ASSERT(r->aptr.load() == first);
+
+	parallel_exec(CONCURRENCY, [&](size_t) {
+		for (size_t i = 0; i < ARR_SIZE; ++i) {
+			auto element = r->aptr.fetch_add(1);
+			*element += 1;
+		}
+	});
+
+	UT_ASSERT(r->aptr.load() == last);
+	for (size_t i = 0; i < CONCURRENCY * ARR_SIZE; i++)
+		UT_ASSERTeq(first[i], 1);
+
+	parallel_exec(CONCURRENCY, [&](size_t) {
+		for (size_t i = 0; i < ARR_SIZE; ++i) {
+			auto element = --r->aptr;
+			*element += 1;
+		}
+	});
+
+	UT_ASSERT(r->aptr.load() == first);
+	for (size_t i = 0; i < CONCURRENCY * ARR_SIZE; i++)
+		UT_ASSERTeq(first[i], 2);
+
+	std::atomic<size_t> exchanged(0);
+	parallel_exec(CONCURRENCY, [&](size_t) {
+		int *expected = first;
+		if (r->aptr.compare_exchange_strong(expected, last))
+			++exchanged;
+		else
+			UT_ASSERT(expected == last);
+	});
+	UT_ASSERTeq(exchanged.load(), 1);
+
+	UT_ASSERT(r->aptr.exchange(nullptr) == last);
+	UT_ASSERT(r->aptr.load() == nullptr);
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::transaction::snapshot(&r->aptr);
+		r->aptr = first;
+		nvobj::delete_persistent<int[]>(r->arr, CONCURRENCY * ARR_SIZE);
+		r->arr = nullptr;
+	});
+}
+
+/* global variables are far away from the pool in most address space layouts */
+nvobj::p<int> far_value;
+int far_int;
+
+bool
+is_far(const void *from, const void *to)
+{
+	auto distance = reinterpret_cast<const char *>(to) -
+		reinterpret_cast<const char *>(from);
+	return distance > std::numeric_limits<int32_t>::max() ||
+		distance < std::numeric_limits<int32_t>::min();
+}
+
+void
+test_out_of_range(nvobj::pool<root> &pop)
+{
+	auto r = pop.root();
+
+	if (is_far(&r->it, &far_value)) {
+		try {
+			r->it = &far_value;
+			UT_ASSERT(0);
+		} catch (std::out_of_range &) {
+		}
+		UT_ASSERT(r->it == nullptr);
+	}
+
+	if (is_far(&r->aptr, &far_int)) {
+		int *old = r->aptr.load();
+		try {
+			r->aptr.store(&far_int);
+			UT_ASSERT(0);
+		} catch (std::out_of_range &) {
+		}
+		UT_ASSERT(r->aptr.load() == old);
+	}
+
+	nvobj::transaction::run(pop, [&] {
+		r->it = nvobj::make_persistent<nvobj::p<int>>(TEST_INT);
+	});
+
+	/* copy to the stack */
+	alignas(self_relative_ptr32<nvobj::p<int>>) char
+		buf[sizeof(self_relative_ptr32<nvobj::p<int>>)];
+	if (is_far(buf, r->it.get())) {
+		try {
+			new (buf) self_relative_ptr32<nvobj::p<int>>(r->it);
+			UT_ASSERT(0);
+		} catch (std::out_of_range &) {
+		}
+	}
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<nvobj::p<int>>(r->it.get());
+		r->it = nullptr;
+	});
+}
+
+} /* namespace */
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc != 2)
+		UT_FATAL("usage: %s file-name", argv[0]);
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<root>::create(path, LAYOUT, PMEMOBJ_MIN_POOL,
+						S_IWUSR | S_IRUSR);
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	test_null(pop);
+	test_list(pop);
+	test_array(pop);
+	test_offset(pop);
+	test_atomic(pop);
+	test_out_of_range(pop);
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
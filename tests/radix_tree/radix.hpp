@@ -35,6 +35,9 @@ using cntr_inline_s_u8t =
 	nvobjex::radix_tree<nvobjex::basic_inline_string<uint8_t>,
 			    nvobjex::basic_inline_string<uint8_t>>;
 
+using cntr_compact_s = nvobjex::radix_tree<nvobjex::compact_inline_string,
+					   nvobjex::compact_inline_string>;
+
 using cntr_int_mt =
 	nvobjex::radix_tree<nvobjex::inline_string, nvobj::p<unsigned>,
 			    nvobjex::bytes_view<nvobjex::inline_string>, true>;
@@ -72,6 +75,7 @@ struct root {
 	nvobj::persistent_ptr<cntr_inline_s_wchart_wchart>
 		radix_inline_s_wchart_wchart;
 	nvobj::persistent_ptr<cntr_inline_s_u8t> radix_inline_s_u8t;
+	nvobj::persistent_ptr<cntr_compact_s> radix_compact_s;
 
 	nvobj::persistent_ptr<cntr_int_mt> radix_int_mt;
 	nvobj::persistent_ptr<cntr_string_mt> radix_str_mt;
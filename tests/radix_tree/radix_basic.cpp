@@ -1096,6 +1096,55 @@ test_inline_string_wchart_key(nvobj::pool<root> &pop)
 	UT_ASSERTeq(num_allocs(pop), 0);
 }
 
+void
+test_compact_inline_string(nvobj::pool<root> &pop)
+{
+	const size_t NUM_ITER = 100;
+	auto r = pop.root();
+
+	static_assert(sizeof(nvobjex::compact_inline_string) == 8,
+		      "compact_inline_string header should take 8 bytes");
+
+	nvobj::transaction::run(pop, [&] {
+		r->radix_compact_s = nvobj::make_persistent<cntr_compact_s>();
+	});
+	auto &m = *r->radix_compact_s;
+
+	for (size_t i = 0; i < NUM_ITER; i++) {
+		auto k = "compact_key_" + std::to_string(i);
+		auto ret = m.try_emplace(k, std::to_string(i));
+		UT_ASSERT(ret.second);
+		UT_ASSERTeq(nvobj::string_view(ret.first->key()).compare(k), 0);
+	}
+	UT_ASSERTeq(m.size(), NUM_ITER);
+
+	for (size_t i = 0; i < NUM_ITER; i++) {
+		auto k = "compact_key_" + std::to_string(i);
+		auto it = m.find(k);
+		UT_ASSERT(it != m.end());
+		UT_ASSERTeq(nvobj::string_view(it->value())
+				    .compare(std::to_string(i)),
+			    0);
+
+		/* forces reallocation of the leaf */
+		it.assign_val(std::string(64, 'x'));
+		UT_ASSERTeq(m.find(k)->value().size(), 64);
+	}
+
+	std::string prev;
+	for (auto &e : m) {
+		auto k = std::string(e.key().data(), e.key().size());
+		UT_ASSERT(prev < k);
+		prev = k;
+	}
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<cntr_compact_s>(r->radix_compact_s);
+	});
+
+	UT_ASSERTeq(num_allocs(pop), 0);
+}
+
 void
 test_remove_inserted(nvobj::pool<root> &pop)
 {
@@ -1189,6 +1238,7 @@ test(int argc, char *argv[])
 	test_compression(pop);
 	test_inline_string_u8t_key(pop);
 	test_inline_string_wchart_key(pop);
+	test_compact_inline_string(pop);
 	test_remove_inserted(pop);
 	test_error_handle(pop);
 
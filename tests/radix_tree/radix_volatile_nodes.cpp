@@ -0,0 +1,297 @@
+// SPDX-License-Identifier: BSD-3-Clause
+/* Copyright 2021, Intel Corporation */
+
+/*
+ * radix_volatile_nodes.cpp -- radix_tree with internal nodes in DRAM
+ * (VolatileNodes == true) tests, checks that the order and lookups are the
+ * same as for std::map, also after aborted transactions, copying, swapping
+ * and rebuilding the nodes after reopening the pool
+ */
+
+#include "unittest.hpp"
+
+#include <libpmemobj++/experimental/inline_string.hpp>
+#include <libpmemobj++/experimental/radix_tree.hpp>
+#include <libpmemobj++/make_persistent.hpp>
+#include <libpmemobj++/p.hpp>
+#include <libpmemobj++/persistent_ptr.hpp>
+#include <libpmemobj++/pool.hpp>
+#include <libpmemobj++/transaction.hpp>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#define LAYOUT "radix_volatile_nodes"
+
+namespace nvobj = pmem::obj;
+namespace nvobjex = pmem::obj::experimental;
+
+namespace
+{
+
+using int_tree =
+	nvobjex::radix_tree<uint64_t, nvobj::p<uint64_t>,
+			    nvobjex::bytes_view<uint64_t>, false, true>;
+using string_tree =
+	nvobjex::radix_tree<nvobjex::inline_string, nvobjex::inline_string,
+			    nvobjex::bytes_view<nvobjex::inline_string>, false,
+			    true>;
+
+struct root {
+	nvobj::persistent_ptr<int_tree> tree;
+	nvobj::persistent_ptr<int_tree> copy;
+	nvobj::persistent_ptr<string_tree> strings;
+};
+
+/* Keys are even, so odd numbers may be used as missing keys */
+void
+verify(int_tree &tree, const std::map<uint64_t, uint64_t> &expected)
+{
+	UT_ASSERTeq(tree.size(), expected.size());
+
+	auto it = tree.begin();
+	for (auto &e : expected) {
+		UT_ASSERT(it != tree.end());
+		UT_ASSERTeq(it->key(), e.first);
+		UT_ASSERTeq(it->value(), e.second);
+		++it;
+	}
+	UT_ASSERT(it == tree.end());
+
+	if (!expected.empty()) {
+		auto last = tree.end();
+		--last;
+		UT_ASSERTeq(last->key(), expected.rbegin()->first);
+	}
+
+	for (auto &e : expected) {
+		auto found = tree.find(e.first);
+		UT_ASSERT(found != tree.end());
+		UT_ASSERTeq(found->value(), e.second);
+		UT_ASSERT(tree.lower_bound(e.first) == found);
+
+		auto upper = tree.upper_bound(e.first);
+		auto expected_upper = expected.upper_bound(e.first);
+		if (expected_upper == expected.end())
+			UT_ASSERT(upper == tree.end());
+		else
+			UT_ASSERTeq(upper->key(), expected_upper->first);
+
+		auto missing = e.first + 1;
+		UT_ASSERTeq(tree.count(missing), 0);
+		auto lb = tree.lower_bound(missing);
+		if (expected_upper == expected.end())
+			UT_ASSERT(lb == tree.end());
+		else
+			UT_ASSERTeq(lb->key(), expected_upper->first);
+	}
+}
+
+std::map<uint64_t, uint64_t>
+insert_erase_test(nvobj::pool<root> &pop, uint64_t items)
+{
+	auto &tree = *pop.root()->tree;
+	std::map<uint64_t, uint64_t> expected;
+
+	std::vector<uint64_t> keys;
+	for (uint64_t i = 0; i < items; ++i)
+		keys.push_back(2 * i);
+	/* keys which differ only in the most significant bytes */
+	for (uint64_t i = 1; i < 16; ++i)
+		keys.push_back(i << 60);
+	std::shuffle(keys.begin(), keys.end(), std::mt19937_64(items));
+
+	for (auto k : keys) {
+		auto ret = tree.try_emplace(k, k + 1);
+		UT_ASSERT(ret.second);
+		UT_ASSERTeq(ret.first->key(), k);
+		expected.emplace(k, k + 1);
+	}
+	verify(tree, expected);
+
+	for (auto k : keys)
+		UT_ASSERT(!tree.emplace(k, 0U).second);
+
+	for (uint64_t i = 0; i < items; i += 3) {
+		UT_ASSERTeq(tree.erase(2 * i), 1);
+		expected.erase(2 * i);
+	}
+	UT_ASSERTeq(tree.erase(1), 0);
+	verify(tree, expected);
+
+	tree.insert_or_assign(keys[0], 7U);
+	expected[keys[0]] = 7;
+	verify(tree, expected);
+
+	return expected;
+}
+
+void
+tx_abort_test(nvobj::pool<root> &pop,
+	      const std::map<uint64_t, uint64_t> &expected)
+{
+	auto &tree = *pop.root()->tree;
+
+	try {
+		nvobj::transaction::run(pop, [&] {
+			for (uint64_t k = 1; k < 200; k += 2)
+				tree.try_emplace(k, k);
+			for (auto &e : expected) {
+				if (e.first % 4 == 0)
+					tree.erase(e.first);
+			}
+			UT_ASSERTeq(tree.count(1), 1);
+			nvobj::transaction::abort(EINVAL);
+		});
+		UT_ASSERT(0);
+	} catch (pmem::manual_tx_abort &) {
+	}
+
+	verify(tree, expected);
+
+	try {
+		nvobj::transaction::run(pop, [&] {
+			tree.clear();
+			UT_ASSERT(tree.empty());
+			UT_ASSERT(tree.begin() == tree.end());
+			nvobj::transaction::abort(EINVAL);
+		});
+		UT_ASSERT(0);
+	} catch (pmem::manual_tx_abort &) {
+	}
+
+	verify(tree, expected);
+}
+
+void
+copy_swap_test(nvobj::pool<root> &pop,
+	       const std::map<uint64_t, uint64_t> &expected)
+{
+	auto r = pop.root();
+
+	nvobj::transaction::run(pop, [&] {
+		r->copy = nvobj::make_persistent<int_tree>(*r->tree);
+	});
+	verify(*r->copy, expected);
+
+	r->copy->clear();
+	r->copy->try_emplace(1, 1U);
+	std::map<uint64_t, uint64_t> copy_expected{{1, 1}};
+	verify(*r->copy, copy_expected);
+
+	r->tree->swap(*r->copy);
+	verify(*r->tree, copy_expected);
+	verify(*r->copy, expected);
+
+	*r->tree = std::move(*r->copy);
+	verify(*r->tree, expected);
+	verify(*r->copy, {});
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<int_tree>(r->copy);
+		r->copy = nullptr;
+	});
+}
+
+bool
+equal(const nvobjex::inline_string &lhs, const std::string &rhs)
+{
+	return nvobj::string_view(lhs.data(), lhs.size()).compare(rhs) == 0;
+}
+
+/* keys of different lengths, some of them are prefixes of others */
+std::string
+string_key(int i)
+{
+	return std::string(static_cast<size_t>(i % 5), 'a') +
+		std::to_string(i % 100);
+}
+
+void
+string_test(nvobj::pool<root> &pop, int items)
+{
+	auto &tree = *pop.root()->strings;
+	std::map<std::string, std::string> expected;
+
+	for (int i = 0; i < items; ++i) {
+		auto key = string_key(i);
+		tree.try_emplace(key, key);
+		expected.emplace(key, key);
+	}
+
+	/* longer value reallocates the leaf */
+	auto it = tree.find(string_key(3));
+	it.assign_val(std::string(100, 'x'));
+	expected[string_key(3)] = std::string(100, 'x');
+
+	UT_ASSERTeq(tree.size(), expected.size());
+	auto tree_it = tree.begin();
+	for (auto &e : expected) {
+		UT_ASSERT(equal(tree_it->key(), e.first));
+		UT_ASSERT(equal(tree_it->value(), e.second));
+		UT_ASSERT(tree.find(e.first) == tree_it);
+		++tree_it;
+	}
+	UT_ASSERT(tree_it == tree.end());
+}
+
+} /* namespace */
+
+static void
+test(int argc, char *argv[])
+{
+	if (argc < 2) {
+		UT_FATAL("usage: %s file-name", argv[0]);
+	}
+
+	const char *path = argv[1];
+
+	nvobj::pool<root> pop;
+
+	try {
+		pop = nvobj::pool<root>::create(
+			path, LAYOUT, PMEMOBJ_MIN_POOL * 20, S_IWUSR | S_IRUSR);
+		nvobj::transaction::run(pop, [&] {
+			pop.root()->tree = nvobj::make_persistent<int_tree>();
+			pop.root()->strings =
+				nvobj::make_persistent<string_tree>();
+		});
+	} catch (pmem::pool_error &pe) {
+		UT_FATAL("!pool::create: %s %s", pe.what(), path);
+	}
+
+	auto expected = insert_erase_test(pop, 3000);
+	tx_abort_test(pop, expected);
+	copy_swap_test(pop, expected);
+	string_test(pop, 500);
+
+	pop.close();
+
+	/* nodes are rebuilt by runtime_initialize() */
+	pop = nvobj::pool<root>::open(path, LAYOUT);
+	pop.root()->tree->runtime_initialize(4);
+	verify(*pop.root()->tree, expected);
+
+	pop.close();
+
+	/* or by the first operation */
+	pop = nvobj::pool<root>::open(path, LAYOUT);
+	verify(*pop.root()->tree, expected);
+	string_test(pop, 500);
+
+	nvobj::transaction::run(pop, [&] {
+		nvobj::delete_persistent<int_tree>(pop.root()->tree);
+		nvobj::delete_persistent<string_tree>(pop.root()->strings);
+	});
+
+	pop.close();
+}
+
+int
+main(int argc, char *argv[])
+{
+	return run_test([&] { test(argc, argv); });
+}
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: BSD-3-Clause
-/* Copyright 2019-2020, Intel Corporation */
+/* Copyright 2019-2021, Intel Corporation */
 
 #include "unittest.hpp"
 
@@ -16,6 +16,15 @@ using char16_string = pmem::obj::basic_string<char16_t>;
 using char32_string = pmem::obj::basic_string<char32_t>;
 using wchar_string = pmem::obj::basic_string<wchar_t>;
 
+template <typename CharT, std::size_t InlineBytes>
+using inline_bytes_string =
+	pmem::obj::basic_string<CharT, std::char_traits<CharT>, InlineBytes>;
+
+using char_string_64 = inline_bytes_string<char, 64>;
+using char_string_128 = inline_bytes_string<char, 128>;
+using char16_string_64 = inline_bytes_string<char16_t, 64>;
+using char32_string_128 = inline_bytes_string<char32_t, 128>;
+
 void
 test_capacity(pmem::obj::pool<root> &pop)
 {
@@ -41,6 +50,47 @@ test_capacity(pmem::obj::pool<root> &pop)
 	});
 }
 
+template <typename String>
+void
+test_inline_bytes(pmem::obj::pool<root> &pop, std::size_t expected_capacity)
+{
+	using CharT = typename String::value_type;
+
+	UT_ASSERTeq(String::sso_capacity, expected_capacity);
+
+	pmem::obj::transaction::run(pop, [&] {
+		auto ptr = pmem::obj::make_persistent<String>();
+		UT_ASSERTeq(ptr->capacity(), expected_capacity);
+
+		/* longest string which still fits in place */
+		ptr->assign(expected_capacity, CharT('a'));
+		UT_ASSERTeq(ptr->size(), expected_capacity);
+		UT_ASSERTeq(ptr->capacity(), expected_capacity);
+		UT_ASSERT(ptr->cdata() >= reinterpret_cast<CharT *>(ptr.get()));
+		UT_ASSERT(ptr->cdata() <
+			  reinterpret_cast<CharT *>(ptr.get() + 1));
+
+		/* one more character requires a separate allocation */
+		ptr->append(1, CharT('b'));
+		UT_ASSERTeq(ptr->size(), expected_capacity + 1);
+		UT_ASSERT(ptr->capacity() > expected_capacity);
+		UT_ASSERT(ptr->cdata() < reinterpret_cast<CharT *>(ptr.get()) ||
+			  ptr->cdata() >=
+				  reinterpret_cast<CharT *>(ptr.get() + 1));
+
+		/* and back to the inline buffer */
+		ptr->erase(expected_capacity);
+		ptr->shrink_to_fit();
+		UT_ASSERTeq(ptr->size(), expected_capacity);
+		UT_ASSERTeq(ptr->capacity(), expected_capacity);
+		UT_ASSERT(*ptr ==
+			  std::basic_string<CharT>(expected_capacity,
+						   CharT('a')));
+
+		pmem::obj::delete_persistent<String>(ptr);
+	});
+}
+
 static void
 test(int argc, char *argv[])
 {
@@ -62,8 +112,27 @@ test(int argc, char *argv[])
 	static_assert(std::is_standard_layout<char32_string>::value, "");
 	static_assert(std::is_standard_layout<wchar_string>::value, "");
 
+	static_assert(sizeof(inline_bytes_string<char, 32>) ==
+			      sizeof(char_string),
+		      "");
+	static_assert(sizeof(char_string_64) == 64, "");
+	static_assert(sizeof(char_string_128) == 128, "");
+	static_assert(sizeof(char16_string_64) == 64, "");
+	static_assert(sizeof(char32_string_128) == 128, "");
+
+	static_assert(std::is_standard_layout<char_string_64>::value, "");
+	static_assert(std::is_standard_layout<char_string_128>::value, "");
+	static_assert(std::is_standard_layout<char16_string_64>::value, "");
+	static_assert(std::is_standard_layout<char32_string_128>::value, "");
+
 	test_capacity(pop);
 
+	test_inline_bytes<char_string>(pop, 23);
+	test_inline_bytes<char_string_64>(pop, 55);
+	test_inline_bytes<char_string_128>(pop, 119);
+	test_inline_bytes<char16_string_64>(pop, 27);
+	test_inline_bytes<char32_string_128>(pop, 29);
+
 	pop.close();
 }
 
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: BSD-3-Clause
-/* Copyright 2019-2020, Intel Corporation */
+/* Copyright 2019-2021, Intel Corporation */
 
 #include "unittest.hpp"
 
@@ -306,6 +306,74 @@ test_mt_same_element(nvobj::pool<root> &pop, size_t concurrency)
 	UT_ASSERT(v2_initialized == 0);
 }
 
+/*
+ * Threads look up states of all elements, while each of them recreates
+ * states of its own elements. Cached lookups must never return a state
+ * which was destroyed.
+ */
+void
+test_mt_many_elements(nvobj::pool<root> &pop, size_t concurrency)
+{
+	constexpr size_t NUM_ELEMENTS = 64;
+
+	auto r = pop.root();
+
+	nvobj::transaction::run(pop, [&] {
+		r->vec_obj_ptr =
+			nvobj::make_persistent<nvobj::vector<pmem_obj>>(
+				NUM_ELEMENTS);
+	});
+
+	auto oid = [&](size_t i) { return pmemobj_oid(&(*r->vec_obj_ptr)[i]); };
+
+	v2_initialized = 0;
+
+	for (size_t i = 0; i < NUM_ELEMENTS; i++)
+		*v_state::get<v_data2>(oid(i))->val = static_cast<int>(i);
+
+	std::vector<std::thread> threads;
+	threads.reserve(concurrency);
+
+	for (size_t t = 0; t < concurrency; ++t) {
+		threads.emplace_back([&, t] {
+			for (int round = 0; round < 10; ++round) {
+				for (size_t i = 0; i < NUM_ELEMENTS; i++) {
+					if (i % concurrency != t)
+						continue;
+
+					v_state::destroy(oid(i));
+					UT_ASSERT(
+						v_state::get_if_exists<v_data2>(
+							oid(i)) == nullptr);
+
+					auto *d = v_state::get<v_data2>(oid(i));
+					*d->val = static_cast<int>(i);
+					UT_ASSERT(
+						v_state::get_if_exists<v_data2>(
+							oid(i)) == d);
+				}
+			}
+		});
+	}
+
+	for (auto &t : threads) {
+		t.join();
+	}
+
+	UT_ASSERT(v2_initialized == NUM_ELEMENTS);
+
+	for (size_t i = 0; i < NUM_ELEMENTS; i++)
+		UT_ASSERT(*v_state::get_if_exists<v_data2>(oid(i))->val ==
+			  static_cast<int>(i));
+
+	nvobj::transaction::run(pop, [&] {
+		pmem::obj::delete_persistent<nvobj::vector<pmem_obj>>(
+			r->vec_obj_ptr);
+	});
+
+	UT_ASSERT(v2_initialized == 0);
+}
+
 void
 test_vector_of_elements(nvobj::pool<root> &pop)
 {
@@ -400,6 +468,7 @@ test(int argc, char *argv[])
 	test_volatile_state_lifecycle_tx(pop);
 	test_volatile_state_lifecycle_tx_abort(pop);
 	test_mt_same_element(pop, 8);
+	test_mt_many_elements(pop, 8);
 	test_vector_of_elements(pop);
 	test_multiple_pool(pop, path);
 